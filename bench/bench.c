@@ -0,0 +1,1335 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "bin_loader.h"
+#include "dijkstra.h"
+#include "graph.h"
+#include "reorder.h"
+#include "contract.h"
+#include "prune.h"
+#include "kpaths.h"
+#include "alternatives.h"
+#include "turns.h"
+#include "timedep.h"
+#include "traffic.h"
+#include "roadclass.h"
+#include "weighting.h"
+#include "pareto.h"
+#include "tsp.h"
+#include "matching.h"
+#include "utils.h"
+#include "bench_util.h"
+
+// =================
+// Constants
+// =================
+
+#define DEFAULT_NUM_QUERIES 1000
+#define DEFAULT_NUM_RANK_SOURCES 100
+#define DEFAULT_SEED 42
+#define MAX_QUERY_SETS 30
+#define FANOUT_TARGETS 32
+#define BENCH_K_PATHS 4
+#define BENCH_ALTERNATIVES 3
+#define DEFAULT_DEPARTURE_MS (8u * 3600000u)
+#define DEFAULT_TOUR_STOPS 40
+#define TRACE_SPACING_M 30.0
+#define TRACE_NOISE_M 5.0
+#define TRACE_MAX_FIXES 500
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// =================
+// Data Structures
+// =================
+
+/**
+ * A single point-to-point query. Queries are stored as node IDs so a query
+ * set stays the same whatever node order the graph is laid out in.
+ */
+typedef struct {
+  uint32_t source_id;       // ID of the source node
+  uint32_t target_id;       // ID of the target node
+} BenchQuery;
+
+/**
+ * A named, reproducible set of queries.
+ */
+typedef struct {
+  char name[32];            // "random", "fanout_<targets>" or "rank_<2^k>"
+  BenchQuery *queries;      // Array of queries
+  int count;                // Number of queries in the set
+} QuerySet;
+
+/**
+ * Outcome of a single query as seen by the harness.
+ */
+typedef struct {
+  bool found;               // True if a path was found
+  int settled;              // Number of nodes settled by the search
+  double cost;              // Path cost in mode units (meters or minutes)
+  bool truncated;           // True if the search stopped at its budget; found is then false
+} BenchSample;
+
+/**
+ * Engine entry point: answers one query and fills the sample.
+ */
+typedef error_code_t (*BenchEngineFn)(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info);
+
+/**
+ * Named routing engine under benchmark.
+ */
+typedef struct {
+  const char *name;         // Engine name used in reports
+  BenchEngineFn run;        // Engine entry point
+  bool edge_arcs_only;      // Needs one arc per edge: skipped on pruned or contracted graphs
+  bool time_only;           // Computes travel times only: skipped outside time mode
+  bool metrics_only;        // Routes the built-in distance and time metrics: skipped for weighting profiles
+} BenchEngine;
+
+/**
+ * Aggregated measurements for one (engine, mode, query set) combination.
+ */
+typedef struct {
+  const char *engine;       // Engine name
+  const char *mode;         // "distance", "time" or a weighting profile name
+  const char *query_set;    // Query set name
+  int queries;              // Number of queries run
+  int found;                // Number of queries with a path
+  int errors;               // Number of queries that returned an error
+  int truncated;            // Number of queries stopped at a search budget, not counted as found
+  double total_seconds;     // Wall time spent inside the engine
+  double throughput;        // Queries per second
+  double p50_ms;            // Median latency
+  double p90_ms;            // 90th percentile latency
+  double p99_ms;            // 99th percentile latency
+  double max_ms;            // Maximum latency
+  double mean_settled;      // Mean settled nodes per query
+  int max_settled;          // Maximum settled nodes in a query
+  double cost_checksum;     // Sum of path costs, to compare engines for equality
+} BenchReport;
+
+/**
+ * Command line options of the benchmark harness.
+ */
+typedef struct {
+  const char *nodes_file;   // Path to nodes.bin
+  const char *edges_file;   // Path to edges.bin
+  int num_queries;          // Number of random queries
+  int num_rank_sources;     // Number of sources for Dijkstra-rank queries
+  uint64_t seed;            // Seed for query generation
+  int mode_mask;            // Bit 0: distance, bit 1: time
+  NodeOrder node_order;     // Node layout applied after loading
+  bool prune;               // Prune dead-end trees after reordering
+  bool contract;            // Contract degree-2 chains after reordering (and pruning)
+  bool json;                // Output JSON instead of CSV
+  const char *output_file;  // Report destination (NULL for stdout)
+  const char *turns_file;   // Turn restrictions for the turn-aware engine (NULL for none)
+  const char *profiles_file; // Travel time profiles for the time-dependent engines (NULL for none)
+  uint32_t departure_ms;    // Departure time of the time-dependent engines
+  const char *traffic_file; // Live traffic batch applied after reordering (NULL for none)
+  uint16_t avoided_classes; // Road classes every engine avoids (0 for none)
+  const char *weightings_file; // Weighting profiles benchmarked as extra modes (NULL for none)
+  int num_tours;            // Stop ordering problems solved per mode (0 to skip)
+  int tour_stops;           // Stops per stop ordering problem
+  int num_threads;          // Worker threads of the tour and trace batches (0 for one per processor)
+  int num_traces;           // Synthetic GPS traces map-matched (0 to skip)
+} BenchOptions;
+
+// =================
+// Helpers
+// =================
+
+static const char *mode_name(const Graph *graph, DijkstraMode mode) {
+  if (DIJKSTRA_IS_WEIGHTING_MODE(mode)) return graph->weightings->profiles[DIJKSTRA_WEIGHTING_PROFILE(mode)].name;
+  return mode == DIJKSTRA_FASTEST_TIME ? "time" : "distance";
+}
+
+static void free_query_sets(QuerySet *sets, int count) {
+  for (int i = 0; i < count; i++) {
+    free(sets[i].queries);
+  }
+}
+
+// =================
+// Engines
+// =================
+
+static error_code_t run_dijkstra_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  DijkstraResult result;
+  error_code_t err_code = dijkstra_shortest_path(graph, query->source_id, query->target_id, mode, &result, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->found = result.target_found;
+  sample->settled = result.settled_count;
+  err_code = get_shortest_distance(&result, &sample->cost, err_info);
+  free_dijkstra_result(&result);
+  return err_code;
+}
+
+static error_code_t run_dijkstra_cost_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  DijkstraResult result;
+  error_code_t err_code = dijkstra_shortest_cost(graph, query->source_id, query->target_id, mode, &result, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->found = result.target_found;
+  sample->settled = result.settled_count;
+  err_code = get_shortest_distance(&result, &sample->cost, err_info);
+  free_dijkstra_result(&result);
+  return err_code;
+}
+
+// Session kept open between queries by the session engine
+static DijkstraSession bench_session;
+static bool bench_session_open = false;
+
+static void close_bench_session(void) {
+  if (!bench_session_open) return;
+  dijkstra_session_close(&bench_session);
+  bench_session_open = false;
+}
+
+/**
+ * Answers queries through a search session that is reopened whenever the
+ * source or mode changes, so consecutive queries from one source resume the
+ * same search. Settled counts only include the nodes each query added.
+ */
+static error_code_t run_dijkstra_session_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  DijkstraResult *result = &bench_session.result;
+  int settled_before = 0;
+  if (bench_session_open && bench_session.graph == graph && result->mode == mode &&
+      graph->node_ids[result->source_index] == query->source_id) {
+    settled_before = result->settled_count;
+  } else {
+    close_bench_session();
+    error_code_t err_code = dijkstra_session_open(graph, query->source_id, mode, &bench_session, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+    bench_session_open = true;
+  }
+
+  error_code_t err_code = dijkstra_session_query(&bench_session, query->target_id, err_info);
+  if (err_code != ERR_SUCCESS) {
+    close_bench_session();
+    return err_code;
+  }
+
+  sample->found = result->target_found;
+  sample->settled = result->settled_count - settled_before;
+  return get_shortest_distance(result, &sample->cost, err_info);
+}
+
+/**
+ * Computes BENCH_K_PATHS loopless routes; the sample cost is the shortest
+ * one, so checksums compare with the other engines.
+ */
+static error_code_t run_k_shortest_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  KShortestPaths paths;
+  error_code_t err_code = find_k_shortest_paths(graph, query->source_id, query->target_id, BENCH_K_PATHS, mode, &paths, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->found = paths.num_paths > 0;
+  sample->settled = paths.settled_count;
+  if (sample->found) {
+    const RoutePath *best = &paths.paths[0];
+    sample->cost = dijkstra_cost_value(mode, best->costs[best->length - 1]);
+  }
+  free_k_shortest_paths(&paths);
+  return ERR_SUCCESS;
+}
+
+/**
+ * Computes up to BENCH_ALTERNATIVES via-node alternatives with the default
+ * limits; the sample cost is the shortest route.
+ */
+static error_code_t run_alternatives_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  AlternativeRoutes routes;
+  error_code_t err_code = find_alternative_routes(graph, query->source_id, query->target_id, BENCH_ALTERNATIVES, mode, NULL, &routes, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->found = routes.num_paths > 0;
+  sample->settled = routes.settled_count;
+  if (sample->found) {
+    const RoutePath *best = &routes.paths[0];
+    sample->cost = dijkstra_cost_value(mode, best->costs[best->length - 1]);
+  }
+  free_alternative_routes(&routes);
+  return ERR_SUCCESS;
+}
+
+// Arc labels shared by the turn-aware queries of a run
+static TurnWorkspace *bench_turn_workspace = NULL;
+
+/**
+ * Runs the edge-based turn-aware search; without a restriction file only the
+ * default U-turn costs apply, so checksums match the node-based engines.
+ */
+static error_code_t run_turn_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  if (bench_turn_workspace == NULL) {
+    error_code_t err_code = create_turn_workspace(graph, &bench_turn_workspace, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+
+  TurnRoute route;
+  error_code_t err_code = turn_shortest_path(graph, bench_turn_workspace, query->source_id, query->target_id, mode, &route, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->found = route.target_found;
+  sample->settled = route.settled_count;
+  if (sample->found) {
+    sample->cost = dijkstra_cost_value(mode, route.path.costs[route.path.length - 1]);
+  }
+  free_turn_route(&route);
+  return ERR_SUCCESS;
+}
+
+// Departure time of the time-dependent engines
+static uint32_t bench_departure_ms = DEFAULT_DEPARTURE_MS;
+
+/**
+ * Runs the time-dependent search for the bench departure time; without a
+ * profile file travel times are static, so checksums match the node-based
+ * engines in time mode.
+ */
+static error_code_t run_time_dependent(Graph *graph, const BenchQuery *query, bool goal_directed, BenchSample *sample, error_info_t *err_info) {
+  DijkstraResult result;
+  error_code_t err_code = dijkstra_time_dependent(graph, query->source_id, query->target_id, bench_departure_ms, goal_directed, &result, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->found = result.target_found;
+  sample->settled = result.settled_count;
+  err_code = get_shortest_distance(&result, &sample->cost, err_info);
+  free_dijkstra_result(&result);
+  return err_code;
+}
+
+static error_code_t run_td_dijkstra_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  (void)mode;
+  return run_time_dependent(graph, query, false, sample, err_info);
+}
+
+static error_code_t run_td_astar_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  (void)mode;
+  return run_time_dependent(graph, query, true, sample, err_info);
+}
+
+/**
+ * Runs the exact bi-criteria search; its shortest route (distance mode) or
+ * fastest route (time mode) gives the checksum of the node-based engines.
+ * A front cut short by the label budget may miss that route, so it counts
+ * as truncated rather than found.
+ */
+static error_code_t run_pareto_engine(Graph *graph, const BenchQuery *query, DijkstraMode mode, BenchSample *sample, error_info_t *err_info) {
+  ParetoFront front;
+  error_code_t err_code = find_pareto_routes(graph, query->source_id, query->target_id, NULL, &front, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  sample->truncated = front.truncated;
+  sample->found = !front.truncated && front.num_routes > 0;
+  sample->settled = front.settled_count;
+  if (sample->found) {
+    const ParetoRoute *route = &front.routes[mode == DIJKSTRA_FASTEST_TIME ? front.num_routes - 1 : 0];
+    uint32_t cost = mode == DIJKSTRA_FASTEST_TIME ? route->times[route->length - 1] : route->distances[route->length - 1];
+    sample->cost = dijkstra_cost_value(mode, cost);
+  }
+  free_pareto_front(&front);
+  return ERR_SUCCESS;
+}
+
+static const BenchEngine ENGINES[] = {
+  { "dijkstra", run_dijkstra_engine, false, false, false },
+  { "dijkstra_cost", run_dijkstra_cost_engine, false, false, false },
+  { "dijkstra_session", run_dijkstra_session_engine, false, false, false },
+  { "yen_k4", run_k_shortest_engine, false, false, false },
+  { "via_alt3", run_alternatives_engine, false, false, false },
+  { "turn_edge", run_turn_engine, true, false, false },
+  { "td_dijkstra", run_td_dijkstra_engine, true, true, true },
+  { "td_astar", run_td_astar_engine, true, true, true },
+  { "pareto", run_pareto_engine, true, false, true },
+};
+
+#define NUM_ENGINES ((int)(sizeof(ENGINES) / sizeof(ENGINES[0])))
+
+// =================
+// Query Set Generation
+// =================
+
+/**
+ * Generates uniformly random source/target pairs. Called before reordering,
+ * so the drawn nodes depend only on the seed and the file order.
+ */
+static error_code_t generate_random_queries(Graph *graph, int count, uint64_t seed, QuerySet *set, error_info_t *err_info) {
+  if (graph->num_nodes < 2) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Graph needs at least two nodes for random queries.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  snprintf(set->name, sizeof(set->name), "random");
+  set->queries = NULL;
+  set->count = count;
+  if (count == 0) return ERR_SUCCESS;
+
+  set->queries = (BenchQuery *)malloc(count * sizeof(BenchQuery));
+  CHECK_ALLOCATION(set->queries, err_info);
+
+  uint64_t state = seed;
+  for (int i = 0; i < count; i++) {
+    int source = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+    int target;
+    do {
+      target = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+    } while (target == source);
+    set->queries[i].source_id = graph->node_ids[source];
+    set->queries[i].target_id = graph->node_ids[target];
+  }
+
+  return ERR_SUCCESS;
+}
+
+/**
+ * Generates FANOUT_TARGETS random targets for each of count / FANOUT_TARGETS
+ * random sources, grouped by source as in dispatch workloads. Called before
+ * reordering, like generate_random_queries().
+ */
+static error_code_t generate_fanout_queries(Graph *graph, int count, uint64_t seed, QuerySet *set, error_info_t *err_info) {
+  snprintf(set->name, sizeof(set->name), "fanout_%d", FANOUT_TARGETS);
+  set->queries = NULL;
+  set->count = (count / FANOUT_TARGETS) * FANOUT_TARGETS;
+  if (set->count == 0) return ERR_SUCCESS;
+
+  set->queries = (BenchQuery *)malloc(set->count * sizeof(BenchQuery));
+  CHECK_ALLOCATION(set->queries, err_info);
+
+  uint64_t state = seed ^ 0xF00DF00DULL;
+  for (int i = 0; i < set->count; i += FANOUT_TARGETS) {
+    int source = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+    for (int k = 0; k < FANOUT_TARGETS; k++) {
+      int target;
+      do {
+        target = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+      } while (target == source);
+      set->queries[i + k].source_id = graph->node_ids[source];
+      set->queries[i + k].target_id = graph->node_ids[target];
+    }
+  }
+
+  return ERR_SUCCESS;
+}
+
+/**
+ * Draws the sources of the Dijkstra-rank queries. Like random queries, this
+ * happens before reordering so the sources depend only on the seed.
+ */
+static error_code_t draw_rank_sources(Graph *graph, int num_sources, uint64_t seed, uint32_t **source_ids, error_info_t *err_info) {
+  *source_ids = NULL;
+  if (num_sources == 0) return ERR_SUCCESS;
+
+  *source_ids = (uint32_t *)malloc(num_sources * sizeof(uint32_t));
+  CHECK_ALLOCATION(*source_ids, err_info);
+
+  uint64_t state = seed ^ 0x5DEECE66DULL;
+  for (int s = 0; s < num_sources; s++) {
+    int source = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+    (*source_ids)[s] = graph->node_ids[source];
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Draws the stops of the stop ordering problems, tour_stops per tour. Drawn
+ * before reordering, like the other query sets.
+ */
+static error_code_t draw_tour_stops(Graph *graph, int num_tours, int tour_stops, uint64_t seed, uint32_t **stop_ids, error_info_t *err_info) {
+  *stop_ids = NULL;
+  if (num_tours == 0) return ERR_SUCCESS;
+
+  *stop_ids = (uint32_t *)malloc((size_t)num_tours * tour_stops * sizeof(uint32_t));
+  CHECK_ALLOCATION(*stop_ids, err_info);
+
+  uint64_t state = seed ^ 0x7005C0DEULL;
+  for (int s = 0; s < num_tours * tour_stops; s++) {
+    int node = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+    (*stop_ids)[s] = graph->node_ids[node];
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Draws the start and end node of every synthetic trace, before reordering
+ * like the other query sets.
+ */
+static error_code_t draw_trace_ends(Graph *graph, int num_traces, uint64_t seed, uint32_t **end_ids, error_info_t *err_info) {
+  *end_ids = NULL;
+  if (num_traces == 0) return ERR_SUCCESS;
+
+  *end_ids = (uint32_t *)malloc((size_t)num_traces * 2 * sizeof(uint32_t));
+  CHECK_ALLOCATION(*end_ids, err_info);
+
+  uint64_t state = seed ^ 0x6E55A6EULL;
+  for (int s = 0; s < num_traces * 2; s++) {
+    int node = (int)(rng_next(&state) % (uint64_t)graph->num_nodes);
+    (*end_ids)[s] = graph->node_ids[node];
+  }
+  return ERR_SUCCESS;
+}
+
+typedef struct {
+  uint32_t node_id;
+  int node_index;
+  uint32_t distance;
+} SettledNode;
+
+static int compare_settled_node(const void *a, const void *b) {
+  const SettledNode *na = (const SettledNode *)a;
+  const SettledNode *nb = (const SettledNode *)b;
+  if (na->distance < nb->distance) return -1;
+  if (na->distance > nb->distance) return 1;
+  // Break ties by ID so ranks do not depend on the node order
+  if (na->node_id < nb->node_id) return -1;
+  if (na->node_id > nb->node_id) return 1;
+  return 0;
+}
+
+/**
+ * Generates Dijkstra-rank query sets: for each source, the target of set k
+ * is the 2^k-th node settled by a full search from that source.
+ */
+static error_code_t generate_rank_queries(Graph *graph, const uint32_t *source_ids, int num_sources, DijkstraMode mode, QuerySet *sets, int *num_sets, error_info_t *err_info) {
+  *num_sets = 0;
+
+  SettledNode *settled = (SettledNode *)malloc(graph->num_nodes * sizeof(SettledNode));
+  CHECK_ALLOCATION(settled, err_info);
+
+  // One set per power of two, each able to hold one query per source
+  int max_sets = 0;
+  while (max_sets < MAX_QUERY_SETS && (1 << (max_sets + 1)) < graph->num_nodes) {
+    max_sets++;
+  }
+  for (int k = 0; k < max_sets; k++) {
+    sets[k].queries = (BenchQuery *)malloc(num_sources * sizeof(BenchQuery));
+    if (sets[k].queries == NULL) {
+      free_query_sets(sets, k);
+      free(settled);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for rank queries.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    snprintf(sets[k].name, sizeof(sets[k].name), "rank_%d", 1 << (k + 1));
+    sets[k].count = 0;
+  }
+
+  for (int s = 0; s < num_sources; s++) {
+    DijkstraResult result;
+    error_code_t err_code = dijkstra_shortest_path_tree(graph, source_ids[s], mode, &result, err_info);
+    if (err_code != ERR_SUCCESS) {
+      // Sources whose search fails (e.g. invalid speed data) are skipped
+      continue;
+    }
+
+    // Recover the settle order by sorting settled nodes by distance
+    int count = 0;
+    for (int i = 0; i < graph->num_nodes; i++) {
+      if (result.visited[i]) {
+        settled[count].node_id = graph->node_ids[i];
+        settled[count].node_index = i;
+        settled[count].distance = result.distances[i];
+        count++;
+      }
+    }
+    free_dijkstra_result(&result);
+    qsort(settled, count, sizeof(SettledNode), compare_settled_node);
+
+    for (int k = 0; k < max_sets; k++) {
+      int rank = 1 << (k + 1);
+      if (rank >= count) break;
+      BenchQuery *query = &sets[k].queries[sets[k].count++];
+      query->source_id = source_ids[s];
+      query->target_id = graph->node_ids[settled[rank].node_index];
+    }
+  }
+
+  free(settled);
+  *num_sets = max_sets;
+  return ERR_SUCCESS;
+}
+
+// =================
+// Measurement
+// =================
+
+static error_code_t run_query_set(Graph *graph, const BenchEngine *engine, DijkstraMode mode, const QuerySet *set, BenchReport *report, error_info_t *err_info) {
+  memset(report, 0, sizeof(BenchReport));
+  report->engine = engine->name;
+  report->mode = mode_name(graph, mode);
+  report->query_set = set->name;
+  report->queries = set->count;
+  if (set->count == 0) return ERR_SUCCESS;
+
+  double *latencies = (double *)malloc(set->count * sizeof(double));
+  CHECK_ALLOCATION(latencies, err_info);
+
+  long long total_settled = 0;
+  bool error_reported = false;
+  for (int i = 0; i < set->count; i++) {
+    BenchSample sample = { false, 0, 0.0, false };
+    error_info_t query_err;
+
+    double start = now_seconds();
+    error_code_t err_code = engine->run(graph, &set->queries[i], mode, &sample, &query_err);
+    double elapsed = now_seconds() - start;
+
+    latencies[i] = elapsed * 1000.0;
+    report->total_seconds += elapsed;
+
+    if (err_code != ERR_SUCCESS) {
+      report->errors++;
+      if (!error_reported) {
+        fprintf(stderr, "Warning: %s/%s/%s query failed: %s\n",
+            engine->name, report->mode, set->name, query_err.message);
+        error_reported = true;
+      }
+      continue;
+    }
+
+    if (sample.truncated) {
+      report->truncated++;
+    } else if (sample.found) {
+      report->found++;
+      report->cost_checksum += sample.cost;
+    }
+    total_settled += sample.settled;
+    if (sample.settled > report->max_settled) {
+      report->max_settled = sample.settled;
+    }
+  }
+
+  qsort(latencies, set->count, sizeof(double), compare_double);
+  report->p50_ms = percentile(latencies, set->count, 50.0);
+  report->p90_ms = percentile(latencies, set->count, 90.0);
+  report->p99_ms = percentile(latencies, set->count, 99.0);
+  report->max_ms = latencies[set->count - 1];
+  report->throughput = report->total_seconds > 0 ? set->count / report->total_seconds : 0.0;
+  int answered = set->count - report->errors;
+  report->mean_settled = answered > 0 ? (double)total_settled / answered : 0.0;
+  if (report->truncated > 0) {
+    fprintf(stderr, "Warning: %s/%s/%s: %d queries stopped at the search budget and are left out of found and the checksum\n",
+        engine->name, report->mode, set->name, report->truncated);
+  }
+
+  free(latencies);
+  return ERR_SUCCESS;
+}
+
+/**
+ * Solves the tour batch on one thread and then on num_threads threads, and
+ * reports both times and the gain of 2-opt and Or-opt over nearest neighbour
+ * on stderr. Tours are not point-to-point queries, so they stay out of the
+ * CSV/JSON report.
+ */
+static error_code_t run_tour_batch(Graph *graph, DijkstraMode mode, const uint32_t *stop_ids, const BenchOptions *options, error_info_t *err_info) {
+  TspJob *jobs = (TspJob *)malloc(options->num_tours * sizeof(TspJob));
+  CHECK_ALLOCATION(jobs, err_info);
+
+  TspParams params;
+  default_tsp_params(&params);
+
+  double seconds[2] = { 0.0, 0.0 };
+  int thread_counts[2] = { 1, options->num_threads };
+  double mean_gain = 0.0;
+  int solved = 0;
+  for (int run = 0; run < 2; run++) {
+    for (int t = 0; t < options->num_tours; t++) {
+      jobs[t].stop_ids = &stop_ids[(size_t)t * options->tour_stops];
+      jobs[t].num_stops = options->tour_stops;
+    }
+
+    double start = now_seconds();
+    error_code_t err_code = solve_tsp_batch(graph, jobs, options->num_tours, mode, &params, thread_counts[run], err_info);
+    seconds[run] = now_seconds() - start;
+    if (err_code != ERR_SUCCESS) {
+      free(jobs);
+      return err_code;
+    }
+
+    // Both runs solve the same problems; the gain is taken from the first
+    for (int t = 0; t < options->num_tours; t++) {
+      if (jobs[t].err_code != ERR_SUCCESS) continue;
+      const TspStats *stats = &jobs[t].tour.stats;
+      if (run == 0) {
+        if (stats->initial_cost > 0) mean_gain += 1.0 - (double)stats->cost / stats->initial_cost;
+        solved++;
+      }
+      free_tsp_tour(&jobs[t].tour);
+    }
+  }
+  free(jobs);
+
+  char threads[16];
+  if (options->num_threads > 0) snprintf(threads, sizeof(threads), "%d", options->num_threads);
+  else snprintf(threads, sizeof(threads), "all");
+  fprintf(stderr, "Tours %s: %d x %d stops, %d solved, 1 thread %.3f s, %s threads %.3f s (%.2fx), "
+      "2-opt/Or-opt gain over nearest neighbour %.2f%%\n",
+      mode_name(graph, mode), options->num_tours, options->tour_stops, solved, seconds[0],
+      threads, seconds[1], seconds[1] > 0 ? seconds[0] / seconds[1] : 0.0,
+      solved > 0 ? 100.0 * mean_gain / solved : 0.0);
+  return ERR_SUCCESS;
+}
+
+/**
+ * Synthetic GPS traces: fixes every TRACE_SPACING_M meters along shortest
+ * routes, with Gaussian noise of TRACE_NOISE_M meters, and the edge each fix
+ * was drawn on.
+ */
+typedef struct {
+  GeoPoint *points;         // Fixes of every trace
+  edge_index_t *true_edges; // Edge each fix was drawn on
+  int *first_point;         // Fixes of trace t are points[first_point[t]..first_point[t + 1])
+  int num_traces;           // Number of traces
+} SyntheticTraces;
+
+static void free_synthetic_traces(SyntheticTraces *traces) {
+  free(traces->points);
+  free(traces->true_edges);
+  free(traces->first_point);
+}
+
+/**
+ * Returns the shortest edge from one node to the next, -1 if there is none.
+ */
+static edge_index_t connecting_edge(const Graph *graph, int from, int to) {
+  const Arc *arcs = dijkstra_mode_arcs(graph, DIJKSTRA_SHORTEST_DISTANCE);
+  edge_index_t best = -1;
+  for (edge_index_t i = graph->adj_offsets[from]; i < graph->adj_offsets[from + 1]; i++) {
+    if (arcs[i].target == to && (best < 0 || arcs[i].weight < arcs[best].weight)) best = i;
+  }
+  return best < 0 ? -1 : graph->adj_indices[best];
+}
+
+static error_code_t generate_traces(Graph *graph, const uint32_t *end_ids, int num_traces, uint64_t seed, SyntheticTraces *traces, error_info_t *err_info) {
+  memset(traces, 0, sizeof(SyntheticTraces));
+  traces->points = (GeoPoint *)malloc((size_t)num_traces * TRACE_MAX_FIXES * sizeof(GeoPoint));
+  traces->true_edges = (edge_index_t *)malloc((size_t)num_traces * TRACE_MAX_FIXES * sizeof(edge_index_t));
+  traces->first_point = (int *)malloc(((size_t)num_traces + 1) * sizeof(int));
+  if (traces->points == NULL || traces->true_edges == NULL || traces->first_point == NULL) {
+    free_synthetic_traces(traces);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for synthetic traces.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  uint64_t state = seed ^ 0x9E3779B9ULL;
+  int count = 0;
+  traces->first_point[0] = 0;
+  for (int t = 0; t < num_traces; t++) {
+    DijkstraResult result;
+    int path_length = 0;
+    int *path = NULL;
+    error_code_t err_code = dijkstra_shortest_path(graph, end_ids[2 * t], end_ids[2 * t + 1], DIJKSTRA_SHORTEST_DISTANCE, &result, err_info);
+    if (err_code == ERR_SUCCESS && result.target_found) {
+      err_code = get_shortest_path(graph, &result, &path_length, &path, err_info);
+      if (err_code != ERR_SUCCESS) path_length = 0;
+    }
+    if (err_code == ERR_SUCCESS) free_dijkstra_result(&result);
+
+    // Walk the route, dropping a fix every TRACE_SPACING_M meters
+    int first = count;
+    double carry = 0.0;
+    for (int k = 0; k + 1 < path_length && count - first < TRACE_MAX_FIXES; k++) {
+      int u = path[k], v = path[k + 1];
+      double lat_u = coord_to_degrees(graph->node_lat[u]), lon_u = coord_to_degrees(graph->node_lon[u]);
+      double lat_v = coord_to_degrees(graph->node_lat[v]), lon_v = coord_to_degrees(graph->node_lon[v]);
+      double length = haversine_distance(lat_u, lon_u, lat_v, lon_v) * 1000.0;
+      edge_index_t edge = connecting_edge(graph, u, v);
+      for (double at = carry; at < length && count - first < TRACE_MAX_FIXES; at += TRACE_SPACING_M) {
+        double f = at / length;
+        double r = sqrt(-2.0 * log(1.0 - rng_unit(&state))) * TRACE_NOISE_M;
+        double angle = 2.0 * M_PI * rng_unit(&state);
+        double lat = lat_u + f * (lat_v - lat_u);
+        double lon = lon_u + f * (lon_v - lon_u);
+        traces->points[count].latitude = lat + r * sin(angle) / 111320.0;
+        traces->points[count].longitude = lon + r * cos(angle) / (111320.0 * cos(lat * M_PI / 180.0));
+        traces->true_edges[count] = edge;
+        count++;
+        carry = at + TRACE_SPACING_M - length;
+      }
+      if (length <= carry) carry -= length;
+    }
+    free(path);
+
+    // Routes shorter than two fixes are kept out of the batch
+    if (count - first < 2) count = first;
+    else traces->first_point[++traces->num_traces] = count;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Map-matches the synthetic traces on one thread and then on num_threads
+ * threads, and reports both times and the share of fixes matched to the edge
+ * they were drawn on (or a parallel edge) on stderr.
+ */
+static error_code_t run_trace_batch(Graph *graph, const uint32_t *end_ids, const BenchOptions *options, error_info_t *err_info) {
+  SyntheticTraces traces;
+  double generate_start = now_seconds();
+  error_code_t err_code = generate_traces(graph, end_ids, options->num_traces, options->seed, &traces, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  if (traces.num_traces == 0) {
+    free_synthetic_traces(&traces);
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "No synthetic trace has a route long enough to match.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  int num_fixes = traces.first_point[traces.num_traces];
+  fprintf(stderr, "Generated %d traces with %d fixes in %.2f s\n", traces.num_traces, num_fixes,
+      now_seconds() - generate_start);
+
+  double grid_start = now_seconds();
+  EdgeGrid *grid = NULL;
+  err_code = build_edge_grid(graph, MATCH_DEFAULT_CELL_SIZE_M, &grid, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free_synthetic_traces(&traces);
+    return err_code;
+  }
+  fprintf(stderr, "Built %dx%d edge grid in %.3f s\n", grid->rows, grid->cols, now_seconds() - grid_start);
+
+  MatchJob *jobs = (MatchJob *)malloc(traces.num_traces * sizeof(MatchJob));
+  if (jobs == NULL) {
+    free_edge_grid(grid);
+    free_synthetic_traces(&traces);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for trace jobs.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  double seconds[2] = { 0.0, 0.0 };
+  int thread_counts[2] = { 1, options->num_threads };
+  long long correct = 0, unmatched = 0, segments = 0, settled = 0;
+  int failed = 0;
+  for (int run = 0; run < 2 && err_code == ERR_SUCCESS; run++) {
+    for (int t = 0; t < traces.num_traces; t++) {
+      jobs[t].points = &traces.points[traces.first_point[t]];
+      jobs[t].num_points = traces.first_point[t + 1] - traces.first_point[t];
+    }
+
+    double start = now_seconds();
+    err_code = match_trace_batch(graph, grid, jobs, traces.num_traces, NULL, thread_counts[run], err_info);
+    seconds[run] = now_seconds() - start;
+    if (err_code != ERR_SUCCESS) break;
+
+    // Both runs match the same traces; accuracy is taken from the first
+    for (int t = 0; t < traces.num_traces; t++) {
+      if (jobs[t].err_code != ERR_SUCCESS) {
+        if (run == 0) failed++;
+        continue;
+      }
+      const MatchedTrace *trace = &jobs[t].trace;
+      if (run == 0) {
+        for (int p = 0; p < trace->num_points; p++) {
+          edge_index_t matched = trace->points[p].edge;
+          edge_index_t truth = traces.true_edges[traces.first_point[t] + p];
+          if (matched < 0 || truth < 0) continue;
+          int a = graph->edge_from[matched], b = graph->edge_to[matched];
+          int c = graph->edge_from[truth], d = graph->edge_to[truth];
+          if (matched == truth || (a == c && b == d) || (a == d && b == c)) correct++;
+        }
+        unmatched += trace->num_unmatched;
+        segments += trace->num_segments;
+        settled += trace->settled_count;
+      }
+      free_matched_trace(&jobs[t].trace);
+    }
+  }
+  free(jobs);
+  free_edge_grid(grid);
+  free_synthetic_traces(&traces);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  char threads[16];
+  if (options->num_threads > 0) snprintf(threads, sizeof(threads), "%d", options->num_threads);
+  else snprintf(threads, sizeof(threads), "all");
+  fprintf(stderr, "Traces: %d x %.1f fixes, %d failed, 1 thread %.3f s (%.0f fixes/s), %s threads %.3f s (%.2fx), "
+      "%.2f%% of fixes on the true edge, %lld unmatched, %.2f segments and %.0f settled nodes per trace\n",
+      traces.num_traces, (double)num_fixes / traces.num_traces, failed, seconds[0],
+      seconds[0] > 0 ? num_fixes / seconds[0] : 0.0, threads, seconds[1],
+      seconds[1] > 0 ? seconds[0] / seconds[1] : 0.0, 100.0 * correct / num_fixes, unmatched,
+      (double)segments / traces.num_traces, (double)settled / traces.num_traces);
+  return ERR_SUCCESS;
+}
+
+// =================
+// Reporting
+// =================
+
+static void write_report_header(FILE *out, const BenchOptions *options) {
+  if (options->json) {
+    fprintf(out, "[\n");
+  } else {
+    fprintf(out, "engine,mode,query_set,queries,found,errors,throughput_qps,"
+        "p50_ms,p90_ms,p99_ms,max_ms,mean_settled,max_settled,cost_checksum\n");
+  }
+}
+
+static void write_report_row(FILE *out, const BenchOptions *options, const BenchReport *report, bool first) {
+  if (options->json) {
+    fprintf(out, "%s  {\"engine\": \"%s\", \"mode\": \"%s\", \"query_set\": \"%s\", "
+        "\"queries\": %d, \"found\": %d, \"errors\": %d, \"throughput_qps\": %.2f, "
+        "\"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, "
+        "\"mean_settled\": %.1f, \"max_settled\": %d, \"cost_checksum\": %.4f}",
+        first ? "" : ",\n",
+        report->engine, report->mode, report->query_set,
+        report->queries, report->found, report->errors, report->throughput,
+        report->p50_ms, report->p90_ms, report->p99_ms, report->max_ms,
+        report->mean_settled, report->max_settled, report->cost_checksum);
+  } else {
+    fprintf(out, "%s,%s,%s,%d,%d,%d,%.2f,%.4f,%.4f,%.4f,%.4f,%.1f,%d,%.4f\n",
+        report->engine, report->mode, report->query_set,
+        report->queries, report->found, report->errors, report->throughput,
+        report->p50_ms, report->p90_ms, report->p99_ms, report->max_ms,
+        report->mean_settled, report->max_settled, report->cost_checksum);
+  }
+}
+
+static void write_report_footer(FILE *out, const BenchOptions *options) {
+  if (options->json) {
+    fprintf(out, "\n]\n");
+  }
+}
+
+// =================
+// Command Line
+// =================
+
+static void print_bench_usage(const char *program_name) {
+  printf("Usage: %s <nodes.bin> <edges.bin> [options]\n", program_name);
+  printf("  --queries N        Number of random queries (default %d)\n", DEFAULT_NUM_QUERIES);
+  printf("  --rank-sources N   Sources for Dijkstra-rank queries, 0 to skip (default %d)\n", DEFAULT_NUM_RANK_SOURCES);
+  printf("  --seed S           Seed for query generation (default %d)\n", DEFAULT_SEED);
+  printf("  --mode M           distance, time or all (default all)\n");
+  printf("  --order O          Node layout: file, hilbert or bfs (default file)\n");
+  printf("  --prune            Route on the graph with dead-end trees pruned\n");
+  printf("  --contract         Route on the graph with degree-2 chains contracted\n");
+  printf("  --turns FILE       Turn restrictions for the turn_edge engine\n");
+  printf("  --profiles FILE    Travel time profiles for the td_* engines\n");
+  printf("  --depart HH:MM     Departure time of the td_* engines (default 08:00)\n");
+  printf("  --traffic FILE     Live edge speeds applied before routing (not with --prune or --contract)\n");
+  printf("  --avoid LIST       Road classes every engine avoids, e.g. motorway or minor (not with --prune)\n");
+  printf("  --weightings FILE  Also benchmark every weighting profile as a mode (not with --prune or --contract)\n");
+  printf("  --tours N          Stop ordering problems solved per mode, 0 to skip (default 0)\n");
+  printf("  --tour-stops K     Stops per stop ordering problem (default %d)\n", DEFAULT_TOUR_STOPS);
+  printf("  --traces N         Synthetic GPS traces map-matched, 0 to skip (default 0, not with --prune or --contract)\n");
+  printf("  --threads T        Worker threads of the tour and trace batches, 0 for all processors (default 0)\n");
+  printf("  --format F         csv or json (default csv)\n");
+  printf("  --output FILE      Write the report to FILE instead of stdout\n");
+}
+
+static bool parse_bench_options(int argc, char *argv[], BenchOptions *options) {
+  if (argc < 3) return false;
+
+  options->nodes_file = argv[1];
+  options->edges_file = argv[2];
+  options->num_queries = DEFAULT_NUM_QUERIES;
+  options->num_rank_sources = DEFAULT_NUM_RANK_SOURCES;
+  options->seed = DEFAULT_SEED;
+  options->mode_mask = 3;
+  options->node_order = NODE_ORDER_FILE;
+  options->prune = false;
+  options->contract = false;
+  options->json = false;
+  options->output_file = NULL;
+  options->turns_file = NULL;
+  options->profiles_file = NULL;
+  options->departure_ms = DEFAULT_DEPARTURE_MS;
+  options->traffic_file = NULL;
+  options->avoided_classes = 0;
+  options->weightings_file = NULL;
+  options->num_tours = 0;
+  options->tour_stops = DEFAULT_TOUR_STOPS;
+  options->num_threads = 0;
+  options->num_traces = 0;
+
+  for (int i = 3; i < argc; i++) {
+    // Flags without a value
+    if (strcmp(argv[i], "--prune") == 0) {
+      options->prune = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--contract") == 0) {
+      options->contract = true;
+      continue;
+    }
+
+    if (i + 1 >= argc) return false;
+    const char *value = argv[i + 1];
+
+    if (strcmp(argv[i], "--queries") == 0) {
+      options->num_queries = atoi(value);
+      if (options->num_queries < 0) return false;
+    } else if (strcmp(argv[i], "--rank-sources") == 0) {
+      options->num_rank_sources = atoi(value);
+      if (options->num_rank_sources < 0) return false;
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      options->seed = strtoull(value, NULL, 10);
+    } else if (strcmp(argv[i], "--mode") == 0) {
+      if (strcmp(value, "distance") == 0) options->mode_mask = 1;
+      else if (strcmp(value, "time") == 0) options->mode_mask = 2;
+      else if (strcmp(value, "all") == 0) options->mode_mask = 3;
+      else return false;
+    } else if (strcmp(argv[i], "--order") == 0) {
+      error_info_t err_info;
+      if (parse_node_order(value, &options->node_order, &err_info) != ERR_SUCCESS) return false;
+    } else if (strcmp(argv[i], "--format") == 0) {
+      if (strcmp(value, "csv") == 0) options->json = false;
+      else if (strcmp(value, "json") == 0) options->json = true;
+      else return false;
+    } else if (strcmp(argv[i], "--output") == 0) {
+      options->output_file = value;
+    } else if (strcmp(argv[i], "--turns") == 0) {
+      options->turns_file = value;
+    } else if (strcmp(argv[i], "--profiles") == 0) {
+      options->profiles_file = value;
+    } else if (strcmp(argv[i], "--depart") == 0) {
+      error_info_t err_info;
+      if (parse_time_of_day(value, &options->departure_ms, &err_info) != ERR_SUCCESS) return false;
+    } else if (strcmp(argv[i], "--traffic") == 0) {
+      options->traffic_file = value;
+    } else if (strcmp(argv[i], "--avoid") == 0) {
+      error_info_t err_info;
+      if (parse_road_classes(value, &options->avoided_classes, &err_info) != ERR_SUCCESS) return false;
+    } else if (strcmp(argv[i], "--weightings") == 0) {
+      options->weightings_file = value;
+    } else if (strcmp(argv[i], "--tours") == 0) {
+      options->num_tours = atoi(value);
+      if (options->num_tours < 0) return false;
+    } else if (strcmp(argv[i], "--tour-stops") == 0) {
+      options->tour_stops = atoi(value);
+      if (options->tour_stops < 2 || options->tour_stops >= WAYPOINT_MAX_STOPS) return false;
+    } else if (strcmp(argv[i], "--traces") == 0) {
+      options->num_traces = atoi(value);
+      if (options->num_traces < 0) return false;
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      options->num_threads = atoi(value);
+      if (options->num_threads < 0) return false;
+    } else {
+      return false;
+    }
+    i++;
+  }
+
+  // Live traffic updates the arcs of individual edges, which chains and pruned trees hide;
+  // pruned trees also merge edges of different road classes, and neither keeps per-profile costs
+  if (options->avoided_classes != 0 && options->prune) return false;
+  if (options->weightings_file != NULL && (options->prune || options->contract)) return false;
+  // Matches are reported per edge
+  if (options->num_traces > 0 && (options->prune || options->contract)) return false;
+  return options->traffic_file == NULL || (!options->prune && !options->contract);
+}
+
+// =================
+// Main function
+// =================
+
+int main(int argc, char *argv[]) {
+  BenchOptions options;
+  if (!parse_bench_options(argc, argv, &options)) {
+    print_bench_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  error_info_t err_info;
+  error_code_t err_code;
+
+  // Load the graph once for all engines and query sets
+  fprintf(stderr, "Loading graph from %s and %s...\n", options.nodes_file, options.edges_file);
+  double load_start = now_seconds();
+  Graph *graph = NULL;
+  err_code = load_graph_from_binary(&graph, options.nodes_file, options.edges_file, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    return EXIT_FAILURE;
+  }
+  fprintf(stderr, "Loaded %d nodes and %lld edges in %.2f s\n",
+      graph->num_nodes, (long long)graph->num_edges, now_seconds() - load_start);
+
+  // Restrictions refer to edges and must be resolved before pruning or contraction
+  if (options.turns_file) {
+    err_code = load_turn_restrictions(graph, options.turns_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Loaded %d turn restrictions at %d junctions (%d records ignored)\n",
+        graph->turns->num_entries, graph->turns->num_via_nodes, graph->turns->num_ignored);
+  }
+
+  // Profiles are keyed by edge index, so node reordering keeps them
+  if (options.profiles_file) {
+    err_code = load_time_profiles(graph, options.profiles_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Loaded %d travel time profiles on %lld edges\n",
+        graph->profiles->num_profiles, (long long)graph->profiles->num_assigned);
+  }
+  bench_departure_ms = options.departure_ms;
+
+  // Weighting profiles are compiled from the edges, so node reordering recompiles them
+  if (options.weightings_file) {
+    double weightings_start = now_seconds();
+    err_code = load_weighting_profiles(graph, options.weightings_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Compiled %d weighting profiles in %.3f ms\n", graph->weightings->num_profiles,
+        (now_seconds() - weightings_start) * 1000.0);
+  }
+
+  FILE *out = stdout;
+  if (options.output_file) {
+    out = fopen(options.output_file, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Failed to open report file: %s\n", options.output_file);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  QuerySet random_set;
+  err_code = generate_random_queries(graph, options.num_queries, options.seed, &random_set, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    if (out != stdout) fclose(out);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+
+  QuerySet fanout_set;
+  err_code = generate_fanout_queries(graph, options.num_queries, options.seed, &fanout_set, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    if (out != stdout) fclose(out);
+    free(random_set.queries);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+
+  uint32_t *rank_sources;
+  err_code = draw_rank_sources(graph, options.num_rank_sources, options.seed, &rank_sources, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    if (out != stdout) fclose(out);
+    free(random_set.queries);
+    free(fanout_set.queries);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+
+  uint32_t *tour_stops;
+  err_code = draw_tour_stops(graph, options.num_tours, options.tour_stops, options.seed, &tour_stops, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    if (out != stdout) fclose(out);
+    free(rank_sources);
+    free(random_set.queries);
+    free(fanout_set.queries);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+
+  uint32_t *trace_ends;
+  err_code = draw_trace_ends(graph, options.num_traces, options.seed, &trace_ends, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    if (out != stdout) fclose(out);
+    free(rank_sources);
+    free(tour_stops);
+    free(random_set.queries);
+    free(fanout_set.queries);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+
+  // Lay out nodes after drawing queries so they do not depend on the order
+  if (options.node_order != NODE_ORDER_FILE) {
+    double reorder_start = now_seconds();
+    err_code = reorder_graph_nodes(graph, options.node_order, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      if (out != stdout) fclose(out);
+      free(rank_sources);
+      free(tour_stops);
+      free(trace_ends);
+      free(random_set.queries);
+      free(fanout_set.queries);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Applied %s node order in %.2f s\n",
+        node_order_name(options.node_order), now_seconds() - reorder_start);
+  }
+
+  // Traffic after reordering, which rebuilds the arcs from edges.bin
+  if (options.traffic_file) {
+    double traffic_start = now_seconds();
+    err_code = load_traffic_updates(graph, options.traffic_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      if (out != stdout) fclose(out);
+      free(rank_sources);
+      free(tour_stops);
+      free(trace_ends);
+      free(random_set.queries);
+      free(fanout_set.queries);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Applied %d live traffic updates (%lld arcs) in %.3f ms\n", graph->traffic->last_batch_edges,
+        (long long)graph->traffic->last_batch_arcs, (now_seconds() - traffic_start) * 1000.0);
+  }
+
+  // Prune after reordering: tree nodes are appended after the core
+  if (options.prune) {
+    double prune_start = now_seconds();
+    err_code = prune_dead_end_trees(graph, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      if (out != stdout) fclose(out);
+      free(rank_sources);
+      free(tour_stops);
+      free(trace_ends);
+      free(random_set.queries);
+      free(fanout_set.queries);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Pruned %d dead-end tree nodes, core of %d nodes in %.2f s\n",
+        graph->pruned->num_pruned_nodes, graph->pruned->num_core_nodes,
+        now_seconds() - prune_start);
+  }
+
+  // Contract after reordering and pruning: chain interiors are appended after routing nodes
+  if (options.contract) {
+    double contract_start = now_seconds();
+    err_code = contract_degree2_chains(graph, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      if (out != stdout) fclose(out);
+      free(rank_sources);
+      free(tour_stops);
+      free(trace_ends);
+      free(random_set.queries);
+      free(fanout_set.queries);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Contracted %d chains, routing on %d of %d nodes in %.2f s\n",
+        graph->chains->num_chains, graph->chains->num_routing_nodes, graph->num_nodes,
+        now_seconds() - contract_start);
+  }
+
+  // Avoid road classes last: contracted chains have a single class
+  if (options.avoided_classes != 0) {
+    double avoid_start = now_seconds();
+    err_code = set_avoided_road_classes(graph, options.avoided_classes, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      if (out != stdout) fclose(out);
+      free(rank_sources);
+      free(tour_stops);
+      free(trace_ends);
+      free(random_set.queries);
+      free(fanout_set.queries);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Avoiding %lld of %lld arcs by road class, set in %.3f ms\n",
+        (long long)graph->filter->num_avoided_arcs, (long long)graph->adj_offsets[graph->num_nodes],
+        (now_seconds() - avoid_start) * 1000.0);
+  }
+
+  write_report_header(out, &options);
+  bool first_row = true;
+
+  // Built-in modes as selected by --mode, then every weighting profile
+  const DijkstraMode modes[] = { DIJKSTRA_SHORTEST_DISTANCE, DIJKSTRA_FASTEST_TIME };
+  int num_modes = 2 + (graph->weightings != NULL ? graph->weightings->num_profiles : 0);
+  for (int m = 0; m < num_modes; m++) {
+    if (m < 2 && !(options.mode_mask & (1 << m))) continue;
+    DijkstraMode mode = m < 2 ? modes[m] : DIJKSTRA_WEIGHTING_MODE(m - 2);
+
+    // Rank queries depend on the metric, so they are generated per mode
+    QuerySet sets[MAX_QUERY_SETS + 1];
+    int num_sets = 0;
+    sets[num_sets++] = random_set;
+    sets[num_sets++] = fanout_set;
+
+    int num_rank_sets = 0;
+    if (options.num_rank_sources > 0) {
+      fprintf(stderr, "Generating Dijkstra-rank queries (%s)...\n", mode_name(graph, mode));
+      err_code = generate_rank_queries(graph, rank_sources, options.num_rank_sources, mode,
+          &sets[num_sets], &num_rank_sets, &err_info);
+      if (err_code != ERR_SUCCESS) {
+        print_error(&err_info);
+        break;
+      }
+      num_sets += num_rank_sets;
+    }
+
+    for (int e = 0; e < NUM_ENGINES; e++) {
+      if (ENGINES[e].edge_arcs_only && (graph->pruned != NULL || graph->chains != NULL)) {
+        fprintf(stderr, "Skipping %s: routing arcs no longer map to single edges\n", ENGINES[e].name);
+        continue;
+      }
+      if (ENGINES[e].time_only && mode != DIJKSTRA_FASTEST_TIME) continue;
+      if (ENGINES[e].metrics_only && DIJKSTRA_IS_WEIGHTING_MODE(mode)) continue;
+      for (int s = 0; s < num_sets; s++) {
+        fprintf(stderr, "Running %s/%s/%s (%d queries)...\n",
+            ENGINES[e].name, mode_name(graph, mode), sets[s].name, sets[s].count);
+
+        BenchReport report;
+        err_code = run_query_set(graph, &ENGINES[e], mode, &sets[s], &report, &err_info);
+        close_bench_session(); // Sessions do not carry over between query sets
+        if (err_code != ERR_SUCCESS) {
+          print_error(&err_info);
+          continue;
+        }
+        write_report_row(out, &options, &report, first_row);
+        first_row = false;
+      }
+    }
+
+    if (options.num_tours > 0) {
+      fprintf(stderr, "Solving %d stop ordering problems (%s)...\n", options.num_tours, mode_name(graph, mode));
+      err_code = run_tour_batch(graph, mode, tour_stops, &options, &err_info);
+      if (err_code != ERR_SUCCESS) print_error(&err_info);
+    }
+
+    free_query_sets(&sets[2], num_rank_sets);
+  }
+
+  write_report_footer(out, &options);
+
+  // Matching routes by distance whatever the mode, so traces run once
+  if (options.num_traces > 0) {
+    fprintf(stderr, "Map-matching %d synthetic traces...\n", options.num_traces);
+    err_code = run_trace_batch(graph, trace_ends, &options, &err_info);
+    if (err_code != ERR_SUCCESS) print_error(&err_info);
+  }
+
+  // Clean up all allocated resources
+  if (out != stdout) fclose(out);
+  free(rank_sources);
+  free(tour_stops);
+  free(trace_ends);
+  free(random_set.queries);
+  free(fanout_set.queries);
+  free_turn_workspace(bench_turn_workspace);
+  free_graph(graph);
+  return EXIT_SUCCESS;
+}
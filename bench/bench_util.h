@@ -0,0 +1,82 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_CYCLES 1
+#else
+#define BENCH_HAVE_CYCLES 0
+#endif
+
+// ==================
+// Shared Benchmark Helpers
+// ==================
+
+/**
+ * SplitMix64 generator, used so generated inputs are identical across platforms.
+ * 
+ * @param state Pointer to the generator state, advanced on every call
+ * @return Next 64-bit pseudo-random value
+ */
+static inline uint64_t rng_next(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Returns a uniform value in [0, 1).
+ */
+static inline double rng_unit(uint64_t *state) {
+  return (double)(rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Returns a monotonic timestamp in seconds.
+ * 
+ * @pre The including file must define _POSIX_C_SOURCE >= 199309L
+ */
+static inline double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Reads the time-stamp counter, or 0 where no cycle counter is available.
+ * 
+ * @note On x86 this counts reference cycles at the nominal TSC frequency
+ */
+static inline uint64_t read_cycles(void) {
+#if BENCH_HAVE_CYCLES
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static inline int compare_double(const void *a, const void *b) {
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  if (da < db) return -1;
+  if (da > db) return 1;
+  return 0;
+}
+
+/**
+ * Returns the nearest-rank percentile of a sorted array.
+ */
+static inline double percentile(const double *sorted, int count, double pct) {
+  if (count <= 0) return 0.0;
+  int rank = (int)ceil(pct / 100.0 * count) - 1;
+  if (rank < 0) rank = 0;
+  if (rank >= count) rank = count - 1;
+  return sorted[rank];
+}
+
+#endif // BENCH_UTIL_H
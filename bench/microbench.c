@@ -0,0 +1,609 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "bin_loader.h"
+#include "graph.h"
+#include "min_heap.h"
+#include "utils.h"
+#include "bench_util.h"
+
+// =================
+// Constants
+// =================
+
+#define DEFAULT_MAX_SIZE (1 << 22)
+#define DEFAULT_GRID_SIDE 512
+#define DEFAULT_REPS 3
+#define DEFAULT_SEED 42
+#define MIN_SIZE (1 << 10)
+#define SIZE_STEP 4
+
+// =================
+// Data Structures
+// =================
+
+/**
+ * Measurement of one kernel at one input size (best of several repetitions).
+ */
+typedef struct {
+  const char *kernel;       // Kernel name
+  long long size;           // Number of elements in the structure under test
+  double working_set_kb;    // Bytes touched by the kernel, to place it in the cache hierarchy
+  long long ops;            // Operations per repetition
+  double seconds;           // Best wall time of one repetition
+  uint64_t cycles;          // Cycle count of the best repetition (0 if unavailable)
+  double bytes_per_op;      // Bytes read per operation, for bandwidth reporting
+} KernelResult;
+
+/**
+ * Command line options of the microbenchmark suite.
+ */
+typedef struct {
+  const char *nodes_file;   // Optional nodes.bin for the CSR kernels
+  const char *edges_file;   // Optional edges.bin for the CSR kernels
+  int grid_side;            // Side of the synthetic grid used when no graph is given
+  long long max_size;       // Largest structure size in the sweeps
+  int reps;                 // Repetitions per measurement (best is kept)
+  uint64_t seed;            // Seed for all generated inputs
+  bool json;                // Output JSON instead of CSV
+  const char *output_file;  // Report destination (NULL for stdout)
+} MicrobenchOptions;
+
+/**
+ * Kernel body: runs one repetition over prepared state and returns ops done.
+ */
+typedef long long (*KernelFn)(void *state);
+
+// Prevents the compiler from discarding kernel results
+static volatile uint64_t g_sink;
+
+// =================
+// Measurement
+// =================
+
+/**
+ * Runs a kernel reps times and keeps the fastest repetition.
+ */
+static void measure_kernel(KernelFn kernel, void *state, int reps, KernelResult *result) {
+  result->seconds = -1.0;
+  for (int r = 0; r < reps; r++) {
+    uint64_t c0 = read_cycles();
+    double t0 = now_seconds();
+    long long ops = kernel(state);
+    double elapsed = now_seconds() - t0;
+    uint64_t cycles = read_cycles() - c0;
+
+    if (result->seconds < 0 || elapsed < result->seconds) {
+      result->seconds = elapsed;
+      result->cycles = cycles;
+      result->ops = ops;
+    }
+  }
+}
+
+// =================
+// MinHeap Kernels
+// =================
+
+typedef struct {
+  MinHeap *heap;
+  uint32_t *keys;           // Pre-generated random keys
+  int count;                // Number of keys / steady-state heap size
+  uint64_t seed;
+} HeapState;
+
+/**
+ * Inserts all keys, then extracts them all (heap sort pattern).
+ */
+static long long kernel_heap_bulk(void *arg) {
+  HeapState *state = (HeapState *)arg;
+  error_info_t err_info;
+  clear_heap(state->heap);
+
+  for (int i = 0; i < state->count; i++) {
+    insert_heap(state->heap, i, state->keys[i], &err_info);
+  }
+  uint64_t sum = 0;
+  HeapNode node;
+  while (!is_heap_empty(state->heap)) {
+    extract_min(state->heap, &node, &err_info);
+    sum += (uint64_t)node.node_index;
+  }
+  g_sink += sum;
+  return 2LL * state->count;
+}
+
+/**
+ * Dijkstra-like pattern: a heap of steady size where each extracted key is
+ * replaced by keys slightly larger than it, so priorities grow monotonically.
+ */
+static long long kernel_heap_dijkstra(void *arg) {
+  HeapState *state = (HeapState *)arg;
+  error_info_t err_info;
+  clear_heap(state->heap);
+
+  for (int i = 0; i < state->count; i++) {
+    insert_heap(state->heap, i, state->keys[i], &err_info);
+  }
+  uint64_t sum = 0;
+  HeapNode node;
+  for (int i = 0; i < state->count; i++) {
+    extract_min(state->heap, &node, &err_info);
+    insert_heap(state->heap, node.node_index, node.distance + state->keys[i], &err_info);
+    sum += (uint64_t)node.node_index;
+  }
+  g_sink += sum;
+  return 3LL * state->count;
+}
+
+static error_code_t setup_heap_state(HeapState *state, int count, uint64_t seed, error_info_t *err_info) {
+  state->count = count;
+  state->seed = seed;
+  state->keys = (uint32_t *)malloc(count * sizeof(uint32_t));
+  CHECK_ALLOCATION(state->keys, err_info);
+
+  uint64_t rng = seed;
+  for (int i = 0; i < count; i++) {
+    state->keys[i] = (uint32_t)(rng_unit(&rng) * 1000000.0);
+  }
+
+  error_code_t err_code = create_heap(&state->heap, count + 1, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free(state->keys);
+    return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+static void teardown_heap_state(HeapState *state) {
+  free_heap(state->heap);
+  free(state->keys);
+}
+
+// =================
+// Node Hash Table Kernels
+// =================
+
+typedef struct {
+  NodeHashTable *table;
+  uint32_t *ids;            // IDs inserted in the table
+  uint32_t *probes;         // IDs looked up (shuffled hits or guaranteed misses)
+  int count;
+} HashState;
+
+/**
+ * Builds a fresh table of count entries.
+ */
+static long long kernel_hash_insert(void *arg) {
+  HashState *state = (HashState *)arg;
+  error_info_t err_info;
+
+  free_node_hash_table(state->table);
+  state->table = NULL;
+  if (create_node_hash_table(&state->table, state->count * 2, &err_info) != ERR_SUCCESS) {
+    return 0;
+  }
+  for (int i = 0; i < state->count; i++) {
+    insert_node_hash(state->table, state->ids[i], i, &err_info);
+  }
+  return state->count;
+}
+
+static long long kernel_hash_lookup(void *arg) {
+  HashState *state = (HashState *)arg;
+  error_info_t err_info;
+  uint64_t sum = 0;
+
+  for (int i = 0; i < state->count; i++) {
+    int index;
+    if (lookup_node_hash(state->table, state->probes[i], &index, &err_info) == ERR_SUCCESS) {
+      sum += (uint64_t)index;
+    }
+  }
+  g_sink += sum;
+  return state->count;
+}
+
+/**
+ * Prepares distinct sparse IDs. The MurmurHash3 finalizer is a bijection on
+ * 32-bit values, so hashing distinct counters yields distinct IDs.
+ */
+static error_code_t setup_hash_state(HashState *state, int count, bool hits, uint64_t seed, error_info_t *err_info) {
+  state->count = count;
+  state->table = NULL;
+  state->ids = (uint32_t *)malloc(count * sizeof(uint32_t));
+  state->probes = (uint32_t *)malloc(count * sizeof(uint32_t));
+  if (state->ids == NULL || state->probes == NULL) {
+    free(state->ids);
+    free(state->probes);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for hash kernel inputs.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  uint32_t salt = (uint32_t)seed;
+  for (int i = 0; i < count; i++) {
+    state->ids[i] = hash_murmur3_32((uint32_t)i ^ salt);
+    state->probes[i] = hits ? state->ids[i] : hash_murmur3_32((uint32_t)(i + count) ^ salt);
+  }
+
+  // Shuffle probes so lookups do not follow insertion order
+  uint64_t rng = seed;
+  for (int i = count - 1; i > 0; i--) {
+    int j = (int)(rng_next(&rng) % (uint64_t)(i + 1));
+    uint32_t tmp = state->probes[i];
+    state->probes[i] = state->probes[j];
+    state->probes[j] = tmp;
+  }
+
+  // Lookup kernels need a populated table; the insert kernel rebuilds it
+  kernel_hash_insert(state);
+  if (state->table == NULL) {
+    free(state->ids);
+    free(state->probes);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to build hash table for lookups.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  return ERR_SUCCESS;
+}
+
+static void teardown_hash_state(HashState *state) {
+  free_node_hash_table(state->table);
+  free(state->ids);
+  free(state->probes);
+}
+
+static double hash_working_set(int count) {
+  return (double)count * 2 * sizeof(NodeHashEntry *) + (double)count * sizeof(NodeHashEntry);
+}
+
+// =================
+// CSR Scan Kernels
+// =================
+
+typedef struct {
+  Graph *graph;
+  int *order;               // Node visiting order (NULL for sequential)
+} CsrState;
+
+/**
+ * Scans every adjacency list, reading the edge index and edge length of each
+ * entry, in sequential or shuffled node order.
+ */
+static long long kernel_csr_scan(void *arg) {
+  CsrState *state = (CsrState *)arg;
+  Graph *graph = state->graph;
+  error_info_t err_info;
+  const Arc *arcs = graph->adj_arcs[WEIGHT_DISTANCE];
+  uint64_t sum = 0;
+  long long scanned = 0;
+
+  for (int i = 0; i < graph->num_nodes; i++) {
+    int node = state->order ? state->order[i] : i;
+    edge_index_t start_idx, end_idx;
+    if (get_adjacent_edges_csr(graph, node, &start_idx, &end_idx, &err_info) != ERR_SUCCESS) continue;
+    for (edge_index_t j = start_idx; j < end_idx; j++) {
+      sum += (uint64_t)arcs[j].target + (uint64_t)arcs[j].weight;
+    }
+    scanned += end_idx - start_idx;
+  }
+  g_sink += sum;
+  return scanned;
+}
+
+/**
+ * Builds an in-memory bidirectional grid graph of side x side nodes.
+ */
+static error_code_t build_grid_graph(Graph **graph, int side, error_info_t *err_info) {
+  int num_nodes = side * side;
+  int num_edges = 2 * side * (side - 1);
+  error_code_t err_code = create_graph(graph, num_nodes, num_edges, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  for (int i = 0; i < num_nodes; i++) {
+    (*graph)->node_ids[i] = (uint32_t)i + 1;
+    (*graph)->node_lat[i] = coord_from_degrees(45.0 + (i / side) * 0.001);
+    (*graph)->node_lon[i] = coord_from_degrees(9.0 + (i % side) * 0.001);
+    err_code = insert_node_hash((*graph)->node_hash, (uint32_t)i + 1, i, err_info);
+    if (err_code != ERR_SUCCESS) {
+      free_graph(*graph);
+      return err_code;
+    }
+  }
+
+  int e = 0;
+  for (int r = 0; r < side; r++) {
+    for (int c = 0; c < side; c++) {
+      int from = r * side + c;
+      int neighbors[2] = { c + 1 < side ? from + 1 : -1, r + 1 < side ? from + side : -1 };
+      for (int k = 0; k < 2; k++) {
+        if (neighbors[k] < 0) continue;
+        (*graph)->edge_from[e] = from;
+        (*graph)->edge_to[e] = neighbors[k];
+        (*graph)->edge_length[e] = 100;
+        (*graph)->edge_speed[e] = 50;
+        (*graph)->edge_highway[e] = HIGHWAY_RESIDENTIAL;
+        (*graph)->edge_one_way[e] = 0;
+        e++;
+      }
+    }
+  }
+
+  err_code = build_csr_representation(*graph, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free_graph(*graph);
+    return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+// =================
+// Haversine Kernel
+// =================
+
+typedef struct {
+  double *coords;           // lat1, lon1, lat2, lon2 per pair
+  int count;
+} HaversineState;
+
+static long long kernel_haversine(void *arg) {
+  HaversineState *state = (HaversineState *)arg;
+  double sum = 0.0;
+  for (int i = 0; i < state->count; i++) {
+    const double *c = &state->coords[4 * i];
+    sum += haversine_distance(c[0], c[1], c[2], c[3]);
+  }
+  g_sink += (uint64_t)sum;
+  return state->count;
+}
+
+// =================
+// Reporting
+// =================
+
+static void write_result(FILE *out, const MicrobenchOptions *options, const KernelResult *result, bool first) {
+  double ns_per_op = result->ops > 0 ? result->seconds * 1e9 / result->ops : 0.0;
+  double cycles_per_op = result->ops > 0 ? (double)result->cycles / result->ops : 0.0;
+  double mops = result->seconds > 0 ? result->ops / result->seconds / 1e6 : 0.0;
+  double bandwidth_gbs = result->seconds > 0 ? result->ops * result->bytes_per_op / result->seconds / 1e9 : 0.0;
+
+  if (options->json) {
+    fprintf(out, "%s  {\"kernel\": \"%s\", \"size\": %lld, \"working_set_kb\": %.1f, \"ops\": %lld, "
+        "\"ns_per_op\": %.3f, \"cycles_per_op\": %.2f, \"mops\": %.2f, \"bandwidth_gbs\": %.3f}",
+        first ? "" : ",\n", result->kernel, result->size, result->working_set_kb, result->ops,
+        ns_per_op, cycles_per_op, mops, bandwidth_gbs);
+  } else {
+    fprintf(out, "%s,%lld,%.1f,%lld,%.3f,%.2f,%.2f,%.3f\n",
+        result->kernel, result->size, result->working_set_kb, result->ops,
+        ns_per_op, cycles_per_op, mops, bandwidth_gbs);
+  }
+  fflush(out);
+}
+
+// =================
+// Suites
+// =================
+
+static error_code_t run_heap_suite(FILE *out, const MicrobenchOptions *options, bool *first, error_info_t *err_info) {
+  for (long long size = MIN_SIZE; size <= options->max_size; size *= SIZE_STEP) {
+    HeapState state;
+    error_code_t err_code = setup_heap_state(&state, (int)size, options->seed, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+
+    KernelResult result = { "heap_bulk", size, size * sizeof(HeapNode) / 1024.0, 0, 0, 0, 0.0 };
+    measure_kernel(kernel_heap_bulk, &state, options->reps, &result);
+    write_result(out, options, &result, *first);
+    *first = false;
+
+    result.kernel = "heap_dijkstra";
+    measure_kernel(kernel_heap_dijkstra, &state, options->reps, &result);
+    write_result(out, options, &result, *first);
+
+    teardown_heap_state(&state);
+  }
+  return ERR_SUCCESS;
+}
+
+static error_code_t run_hash_suite(FILE *out, const MicrobenchOptions *options, bool *first, error_info_t *err_info) {
+  for (long long size = MIN_SIZE; size <= options->max_size; size *= SIZE_STEP) {
+    const bool variants[2] = { true, false };
+    for (int v = 0; v < 2; v++) {
+      HashState state;
+      error_code_t err_code = setup_hash_state(&state, (int)size, variants[v], options->seed, err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+
+      KernelResult result = { variants[v] ? "hash_lookup_hit" : "hash_lookup_miss", size,
+                              hash_working_set((int)size) / 1024.0, 0, 0, 0, 0.0 };
+      measure_kernel(kernel_hash_lookup, &state, options->reps, &result);
+      write_result(out, options, &result, *first);
+      *first = false;
+
+      if (variants[v]) {
+        result.kernel = "hash_insert";
+        measure_kernel(kernel_hash_insert, &state, options->reps, &result);
+        write_result(out, options, &result, *first);
+      }
+
+      teardown_hash_state(&state);
+    }
+  }
+  return ERR_SUCCESS;
+}
+
+static error_code_t run_csr_suite(FILE *out, const MicrobenchOptions *options, bool *first, error_info_t *err_info) {
+  Graph *graph = NULL;
+  error_code_t err_code;
+  if (options->nodes_file) {
+    err_code = load_graph_from_binary(&graph, options->nodes_file, options->edges_file, err_info);
+  } else {
+    err_code = build_grid_graph(&graph, options->grid_side, err_info);
+  }
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  int *order = (int *)malloc(graph->num_nodes * sizeof(int));
+  if (order == NULL) {
+    free_graph(graph);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for scan order.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  uint64_t rng = options->seed;
+  for (int i = 0; i < graph->num_nodes; i++) order[i] = i;
+  for (int i = graph->num_nodes - 1; i > 0; i--) {
+    int j = (int)(rng_next(&rng) % (uint64_t)(i + 1));
+    int tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+
+  edge_index_t num_slots = graph->adj_offsets[graph->num_nodes];
+  double working_set = (double)(graph->num_nodes + 1) * sizeof(edge_index_t) +
+                       (double)num_slots * sizeof(Arc);
+  // Each scanned entry reads one packed (target, weight) arc
+  double bytes_per_op = sizeof(Arc);
+
+  CsrState state = { graph, NULL };
+  KernelResult result = { "csr_scan_seq", graph->num_nodes, working_set / 1024.0, 0, 0, 0, bytes_per_op };
+  measure_kernel(kernel_csr_scan, &state, options->reps, &result);
+  write_result(out, options, &result, *first);
+  *first = false;
+
+  state.order = order;
+  result.kernel = "csr_scan_random";
+  measure_kernel(kernel_csr_scan, &state, options->reps, &result);
+  write_result(out, options, &result, *first);
+
+  free(order);
+  free_graph(graph);
+  return ERR_SUCCESS;
+}
+
+static error_code_t run_haversine_suite(FILE *out, const MicrobenchOptions *options, bool *first, error_info_t *err_info) {
+  HaversineState state;
+  state.count = (int)(options->max_size < (1 << 20) ? options->max_size : (1 << 20));
+  state.coords = (double *)malloc(4 * (size_t)state.count * sizeof(double));
+  CHECK_ALLOCATION(state.coords, err_info);
+
+  uint64_t rng = options->seed;
+  for (int i = 0; i < 4 * state.count; i += 2) {
+    state.coords[i] = 35.0 + rng_unit(&rng) * 20.0;
+    state.coords[i + 1] = -10.0 + rng_unit(&rng) * 40.0;
+  }
+
+  KernelResult result = { "haversine", state.count, 4.0 * state.count * sizeof(double) / 1024.0,
+                          0, 0, 0, 4 * sizeof(double) };
+  measure_kernel(kernel_haversine, &state, options->reps, &result);
+  write_result(out, options, &result, *first);
+  *first = false;
+
+  free(state.coords);
+  return ERR_SUCCESS;
+}
+
+// =================
+// Command Line
+// =================
+
+static void print_microbench_usage(const char *program_name) {
+  printf("Usage: %s [options]\n", program_name);
+  printf("  --graph NODES EDGES  Use a real graph for the CSR scan kernels\n");
+  printf("  --grid N             Side of the synthetic grid otherwise (default %d)\n", DEFAULT_GRID_SIDE);
+  printf("  --max-size N         Largest heap/hash size in the sweeps (default %d)\n", DEFAULT_MAX_SIZE);
+  printf("  --reps N             Repetitions per kernel, best is reported (default %d)\n", DEFAULT_REPS);
+  printf("  --seed S             Seed for generated inputs (default %d)\n", DEFAULT_SEED);
+  printf("  --format F           csv or json (default csv)\n");
+  printf("  --output FILE        Write the report to FILE instead of stdout\n");
+  printf("Sizes sweep from %d by x%d so working sets cross L1, L2, LLC and DRAM.\n", MIN_SIZE, SIZE_STEP);
+  printf("cycles_per_op uses the x86 time-stamp counter and is 0 on other platforms.\n");
+}
+
+static bool parse_microbench_options(int argc, char *argv[], MicrobenchOptions *options) {
+  options->nodes_file = NULL;
+  options->edges_file = NULL;
+  options->grid_side = DEFAULT_GRID_SIDE;
+  options->max_size = DEFAULT_MAX_SIZE;
+  options->reps = DEFAULT_REPS;
+  options->seed = DEFAULT_SEED;
+  options->json = false;
+  options->output_file = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) return false;
+    const char *value = argv[i + 1];
+
+    if (strcmp(argv[i], "--graph") == 0) {
+      if (i + 2 >= argc) return false;
+      options->nodes_file = value;
+      options->edges_file = argv[i + 2];
+      i++;
+    } else if (strcmp(argv[i], "--grid") == 0) {
+      options->grid_side = atoi(value);
+    } else if (strcmp(argv[i], "--max-size") == 0) {
+      options->max_size = atoll(value);
+    } else if (strcmp(argv[i], "--reps") == 0) {
+      options->reps = atoi(value);
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      options->seed = strtoull(value, NULL, 10);
+    } else if (strcmp(argv[i], "--format") == 0) {
+      if (strcmp(value, "csv") == 0) options->json = false;
+      else if (strcmp(value, "json") == 0) options->json = true;
+      else return false;
+    } else if (strcmp(argv[i], "--output") == 0) {
+      options->output_file = value;
+    } else {
+      return false;
+    }
+    i++;
+  }
+
+  return options->grid_side >= 2 && options->reps >= 1 &&
+         options->max_size >= MIN_SIZE && options->max_size <= (1 << 28);
+}
+
+// =================
+// Main function
+// =================
+
+int main(int argc, char *argv[]) {
+  MicrobenchOptions options;
+  if (!parse_microbench_options(argc, argv, &options)) {
+    print_microbench_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *out = stdout;
+  if (options.output_file) {
+    out = fopen(options.output_file, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Failed to open report file: %s\n", options.output_file);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (options.json) {
+    fprintf(out, "[\n");
+  } else {
+    fprintf(out, "kernel,size,working_set_kb,ops,ns_per_op,cycles_per_op,mops,bandwidth_gbs\n");
+  }
+
+  error_info_t err_info;
+  error_code_t err_code = ERR_SUCCESS;
+  bool first = true;
+
+  if (err_code == ERR_SUCCESS) err_code = run_heap_suite(out, &options, &first, &err_info);
+  if (err_code == ERR_SUCCESS) err_code = run_hash_suite(out, &options, &first, &err_info);
+  if (err_code == ERR_SUCCESS) err_code = run_csr_suite(out, &options, &first, &err_info);
+  if (err_code == ERR_SUCCESS) err_code = run_haversine_suite(out, &options, &first, &err_info);
+
+  if (options.json) {
+    fprintf(out, "\n]\n");
+  }
+  if (out != stdout) fclose(out);
+
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
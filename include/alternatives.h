@@ -0,0 +1,88 @@
+#ifndef ALTERNATIVES_H
+#define ALTERNATIVES_H
+
+#include <stdint.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "kpaths.h"
+#include "error_handling.h"
+
+// ==================
+// Alternative Routes Data Structures
+// ==================
+
+/**
+ * Admissibility limits for via-node alternatives, as fractions of the
+ * shortest route cost.
+ */
+typedef struct {
+  double max_stretch;       // An alternative costs at most (1 + max_stretch) times the shortest route
+  double max_sharing;       // Cost shared with routes already chosen is at most this fraction
+  double min_plateau;       // The plateau (locally optimal stretch) covers at least this fraction
+} AlternativeParams;
+
+/**
+ * The shortest route followed by ranked alternatives (see find_alternative_routes()).
+ */
+typedef struct {
+  RoutePath *paths;         // Shortest route first, then alternatives by rank
+  int num_paths;            // Routes found (at most 1 + the alternatives requested)
+  DijkstraMode mode;        // Mode the costs were computed in
+  int num_plateaus;         // Plateaus found in the two search trees
+  int num_admissible;       // Plateaus passing the stretch, plateau and loop tests
+  int settled_count;        // Nodes settled by both searches
+} AlternativeRoutes;
+
+// ==================
+// Alternative Routes Function Prototypes
+// ==================
+
+/**
+ * Fills in the default admissibility limits: 25% stretch, 80% sharing and a
+ * plateau of at least 25% of the shortest route.
+ *
+ * @param params Pointer to the parameters to fill
+ */
+void default_alternative_params(AlternativeParams *params);
+
+/**
+ * Finds a shortest route and up to max_alternatives alternatives with the
+ * plateau (via-node) method.
+ *
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param target_node_id ID of the target node
+ * @param max_alternatives Maximum number of alternatives besides the shortest route
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param params Admissibility limits (NULL for the defaults)
+ * @param routes Pointer to store the routes
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph, routes and err_info must be non-NULL, max_alternatives must not be negative
+ * @pre source_node_id and target_node_id must exist and differ
+ * @post On success: routes holds the shortest route and the alternatives
+ *       found (nothing if the target is unreachable)
+ *       On failure: nothing is left allocated
+ * @note One forward search from the source and one backward search from the
+ *       target, both bounded by the largest admissible cost, are all the
+ *       searching done. An arc lying on both shortest path trees belongs to
+ *       a plateau; every maximal plateau gives one via route, which is a
+ *       shortest path up to the end of the plateau and from its start on, so
+ *       it is locally optimal over the plateau cost
+ * @note Alternatives are picked greedily by 2 * cost + shared cost - plateau
+ *       cost, with sharing measured against all routes chosen so far
+ * @note On pruned or contracted graphs, endpoints off the routing graph
+ *       join it over the virtual arcs of resolve_route_ends()
+ * @note The caller must call free_alternative_routes() to free allocated memory
+ */
+error_code_t find_alternative_routes(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, int max_alternatives, DijkstraMode mode, const AlternativeParams *params, AlternativeRoutes *routes, error_info_t *err_info);
+
+/**
+ * Frees the routes of an alternative routes result.
+ *
+ * @param routes Pointer to the result (NULL is allowed)
+ */
+void free_alternative_routes(AlternativeRoutes *routes);
+
+#endif // ALTERNATIVES_H
@@ -22,6 +22,7 @@
  * @post On success: *graph points to a valid CSR graph. On failure: *graph == NULL
  * @note The function opens both files, reads their contents, creates the graph structure,
  *       and builds the CSR (Compressed Sparse Row) representation for efficient access 
+ * @note Connected components are computed after the CSR (see compute_graph_components())
  */
 error_code_t load_graph_from_binary(Graph **graph, const char *nodes_filename, const char *edges_filename, error_info_t *err_info);
 
@@ -34,10 +35,11 @@ error_code_t load_graph_from_binary(Graph **graph, const char *nodes_filename, c
  * @return ERR_SUCCESS on success, ERR_FILE_READ on failure
  * 
  * @pre graph, file, and err_info must be non-NULL
- * @pre graph->nodes must be allocated for graph->num_nodes elements
- * @post On success: graph->nodes is filled and node hash table is populated
+ * @pre graph node arrays must be allocated for graph->num_nodes elements
+ * @post On success: node IDs and fixed-point coordinates are filled and node hash table is populated
  *       On failure: graph content is undefined
- * @note This function also populates the node hash table for efficient node lookup 
+ * @note Coordinates are rounded to COORD_SCALE units (1e-7 degrees) on load.
+ *       This function also populates the node hash table for efficient node lookup 
  */
 error_code_t load_nodes_from_binary(Graph *graph, FILE *file, error_info_t *err_info);
 
@@ -51,11 +53,12 @@ error_code_t load_nodes_from_binary(Graph *graph, FILE *file, error_info_t *err_
  * @return ERR_SUCCESS on success, ERR_FILE_READ on failure
  * 
  * @pre graph, file, and err_info must be non-NULL
- * @pre graph->edges must be allocated for graph->num_edges elements
+ * @pre graph edge columns must be allocated for graph->num_edges elements
  * @pre Nodes and node hash table must already be initialized
- * @post On success: graph->edges is filled and validated
+ * @post On success: edge columns are filled, with endpoints resolved to node indices
  *       On failure: graph content is undefined
- * @note This function validates that all referenced nodes in edges exist in the graph 
+ * @note This function validates that all referenced nodes in edges exist in the graph.
+ *       The reserved field of the file record is not kept 
  */
 error_code_t load_edges_from_binary(Graph *graph, FILE *file, error_info_t *err_info);
 
@@ -0,0 +1,77 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <stdbool.h>
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Component Data Structures
+// ==================
+
+/**
+ * Strongly connected components of a graph, attached by compute_graph_components().
+ * Components are numbered in the order Tarjan's algorithm completes them,
+ * which is a reverse topological order of the condensation: an arc between
+ * different components always points to a lower component number.
+ */
+typedef struct ComponentIndex {
+  int *node_component;      // Strongly connected component of each node
+  int *component_group;     // Weakly connected group of each component
+  int num_components;       // Number of strongly connected components
+  int num_groups;           // Number of weakly connected groups
+  int largest_component;    // Component with the most nodes (the main road network)
+  int largest_size;         // Number of nodes in the largest component
+} ComponentIndex;
+
+// ==================
+// Component Function Prototypes
+// ==================
+
+/**
+ * Computes strongly and weakly connected components of a graph.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph and err_info must be non-NULL, graph must be neither pruned nor contracted
+ * @post On success: graph->components is set (replacing a previous index)
+ *       On failure: graph->components is unchanged
+ * @note Uses an iterative Tarjan search (no recursion, O(nodes + arcs));
+ *       the index follows later node permutations, pruning and chain contraction
+ */
+error_code_t compute_graph_components(Graph *graph, error_info_t *err_info);
+
+/**
+ * Frees a component index.
+ *
+ * @param components Component index to free (NULL is allowed)
+ */
+void free_component_index(ComponentIndex *components);
+
+/**
+ * Tells whether a target node may be reachable from a source node.
+ *
+ * @param graph Pointer to the graph structure
+ * @param source_index Source node index
+ * @param target_index Target node index
+ * @return false if no path can exist (different weakly connected groups, or
+ *         a target component that does not follow the source component in
+ *         topological order), true otherwise or if components are not computed
+ *
+ * @note O(1); a true result does not guarantee a path unless both nodes share
+ *       a strongly connected component
+ */
+bool component_may_reach(const Graph *graph, int source_index, int target_index);
+
+/**
+ * Tells whether a node belongs to the largest strongly connected component.
+ *
+ * @param graph Pointer to the graph structure
+ * @param node_index Node index to test
+ * @return true if the node is in the largest component or components are not computed
+ */
+bool in_largest_component(const Graph *graph, int node_index);
+
+#endif // COMPONENTS_H
@@ -0,0 +1,205 @@
+#ifndef CONTRACT_H
+#define CONTRACT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "min_heap.h"
+#include "error_handling.h"
+
+// ==================
+// Chain Contraction Data Structures
+// ==================
+
+/**
+ * A maximal run of contracted degree-2 nodes between two routing nodes.
+ * Interior nodes occupy the consecutive node indices
+ * [first, first + num_interior) in travel order from 'from' to 'to'.
+ */
+typedef struct {
+  int from;                 // Routing node at the chain start
+  int to;                   // Routing node at the chain end (equal to from for loops)
+  int first;                // Node index of the first interior node
+  int num_interior;         // Number of interior nodes
+  bool one_way;             // Traversable only from 'from' to 'to'
+  uint8_t highway_type;     // Road class shared by every edge of the chain
+  uint32_t total[WEIGHT_NUM_METRICS]; // Cost of the whole chain per metric
+} Chain;
+
+/**
+ * Contracted topology attached to a graph by contract_degree2_chains().
+ * Routing nodes come first ([0, num_routing_nodes)), followed by the interior
+ * nodes of every chain and, on a pruned graph, the pruned nodes; only routing
+ * nodes have adjacency entries.
+ */
+typedef struct ChainIndex {
+  Chain *chains;            // Contracted chains
+  int num_chains;           // Number of chains
+  int num_routing_nodes;    // Nodes kept in the routing graph
+  int num_interior_nodes;   // Chain interior nodes, numbered right after the routing nodes
+  int *interior_chain;      // Chain of each interior node (indexed by node - num_routing_nodes)
+  uint32_t *prefix[WEIGHT_NUM_METRICS]; // Cost from the chain start to each interior node
+} ChainIndex;
+
+// Adjacency entries of contracted chains store a negative edge index
+#define CHAIN_ADJ_INDEX(chain) (-(edge_index_t)(chain) - 1)
+#define ADJ_INDEX_CHAIN(index) ((int)(-(index) - 1))
+
+// ==================
+// Contraction Function Prototypes
+// ==================
+
+/**
+ * Collapses chains of degree-2 nodes into single routing arcs.
+ *
+ * @param graph Pointer to graph with nodes, edges and CSR loaded
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph and err_info must be non-NULL, graph must not be contracted yet
+ *      and must not have weighting profiles
+ * @post On success: nodes are renumbered (routing nodes first, then chain
+ *       interiors in travel order), graph->chains is set and the CSR only
+ *       holds routing arcs, with summed weights per metric for chains
+ *       On failure: graph->chains is NULL (the node order may have changed)
+ * @note A node is contracted when it has exactly two incident edges to two
+ *       distinct neighbours and traffic passes straight through it: both
+ *       edges bidirectional, or both one-way with one entering and one
+ *       leaving. Cycles made only of such nodes keep one routing node.
+ * @note Apply node reordering and dead-end pruning before contraction; the
+ *       permutation functions refuse contracted graphs. Pruned nodes and the
+ *       core nodes their trees hang off are never contracted
+ */
+error_code_t contract_degree2_chains(Graph *graph, error_info_t *err_info);
+
+/**
+ * Frees a chain index.
+ *
+ * @param chains Chain index to free (NULL is allowed)
+ */
+void free_chain_index(ChainIndex *chains);
+
+/**
+ * Tells whether a node was contracted into a chain.
+ *
+ * @param graph Pointer to the graph structure
+ * @param node_index Node index to test
+ * @return true if the graph is contracted and the node is a chain interior node
+ */
+bool is_chain_interior(const Graph *graph, int node_index);
+
+// ==================
+// Query Support Function Prototypes
+// ==================
+
+/**
+ * Starts a search from a chain interior node by seeding the chain ends.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the search
+ * @param source_index Chain interior source node
+ * @param result Initialized search result (distances, optional predecessors)
+ * @param heap Priority queue of the search
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @post The reachable chain ends hold their cost from the source, are queued
+ *       and have the source as predecessor
+ */
+error_code_t chain_seed_source(const Graph *graph, WeightMetric metric, int source_index, DijkstraResult *result, MinHeap *heap, error_info_t *err_info);
+
+/**
+ * Computes the cost of reaching a chain interior target from its chain ends
+ * or from a source on the same chain.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the search
+ * @param result Search result where the chain ends (and the source) are final
+ * @param target_index Chain interior target node
+ * @param predecessor Pointer to store the node the target is reached from, or -1
+ * @return Cost of the target, WEIGHT_INFINITY if unreachable
+ */
+uint32_t chain_target_cost(const Graph *graph, WeightMetric metric, const DijkstraResult *result, int target_index, int *predecessor);
+
+/**
+ * Fills distances, predecessors and visited flags of all chain interior
+ * nodes after a full shortest path tree search on a contracted graph.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the search
+ * @param result Completed tree search result
+ *
+ * @post Interior nodes hold their shortest cost and an adjacent chain node
+ *       (or chain end) as predecessor, as in an uncontracted search
+ */
+void chain_fill_tree(const Graph *graph, WeightMetric metric, DijkstraResult *result);
+
+/**
+ * Expands a predecessor step into the contracted nodes it passes through.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the search
+ * @param distances Costs of the search (exact for from_index and to_index)
+ * @param from_index Predecessor node
+ * @param to_index Node reached from from_index
+ * @param nodes Output array for the intermediate nodes in travel order (may be NULL)
+ * @param costs Output array for their costs (may be NULL)
+ * @return Number of intermediate nodes, or -1 if the step matches no arc or chain
+ *
+ * @note Output arrays must hold the interior count of the longest chain
+ */
+int chain_expand_step(const Graph *graph, WeightMetric metric, const uint32_t *distances, int from_index, int to_index, int *nodes, uint32_t *costs);
+
+/**
+ * Expands one routing arc into the contracted nodes it passes through.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the search
+ * @param from_index Routing node the arc leaves
+ * @param arc_index Position of the arc in the CSR
+ * @param from_cost Cost at from_index
+ * @param nodes Output array for the interior nodes in travel order (may be NULL)
+ * @param costs Output array for their costs (may be NULL)
+ * @return Number of interior nodes, 0 for a direct edge
+ *
+ * @note Unlike chain_expand_step() the arc is known, so parallel chains of
+ *       equal cost are told apart. Loop chains are expanded forwards.
+ *       Output arrays must hold the interior count of the longest chain
+ */
+int chain_expand_arc(const Graph *graph, WeightMetric metric, int from_index, edge_index_t arc_index, uint32_t from_cost, int *nodes, uint32_t *costs);
+
+/**
+ * Computes the cost of travelling between two positions of a chain, where
+ * -1 is the 'from' end, num_interior the 'to' end and the positions in
+ * between are the interior nodes in travel order.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the cost
+ * @param chain_index Chain to travel along
+ * @param from_position Start position
+ * @param to_position End position
+ * @return Cost along the chain, WEIGHT_INFINITY if the positions are equal
+ *         or the chain is one-way and to_position comes first
+ */
+uint32_t chain_span_cost(const Graph *graph, WeightMetric metric, int chain_index, int from_position, int to_position);
+
+/**
+ * Expands a span of a chain (see chain_span_cost()) into the interior nodes
+ * strictly between its positions.
+ *
+ * @param graph Pointer to contracted graph
+ * @param metric Metric of the costs
+ * @param chain_index Chain to travel along
+ * @param from_position Start position
+ * @param to_position End position
+ * @param from_cost Cost at the start position
+ * @param nodes Output array for the interior nodes in travel order (may be NULL)
+ * @param costs Output array for their costs (may be NULL)
+ * @return Number of interior nodes, or -1 if the span cannot be travelled
+ *
+ * @note Output arrays must hold the interior count of the longest chain
+ */
+int chain_expand_span(const Graph *graph, WeightMetric metric, int chain_index, int from_position, int to_position, uint32_t from_cost, int *nodes, uint32_t *costs);
+
+#endif // CONTRACT_H
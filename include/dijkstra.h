@@ -4,26 +4,82 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "graph.h"
+#include "min_heap.h"
 #include "error_handling.h"
 
 // =================
 // Dijkstra's Algorithm Data Structures
 // =================
 
+typedef enum {
+  DIJKSTRA_SHORTEST_DISTANCE = 1,
+  DIJKSTRA_FASTEST_TIME = 2,
+  DIJKSTRA_WEIGHTING_BASE = 16 // First weighting profile mode (see DIJKSTRA_WEIGHTING_MODE)
+} DijkstraMode;
+
+// Mode searching weighting profile p of graph->weightings (see weighting.h)
+#define DIJKSTRA_WEIGHTING_MODE(p) ((DijkstraMode)(DIJKSTRA_WEIGHTING_BASE + (p)))
+
+// Tells whether a mode searches a weighting profile
+#define DIJKSTRA_IS_WEIGHTING_MODE(mode) ((int)(mode) >= DIJKSTRA_WEIGHTING_BASE)
+
+// Weighting profile searched by a weighting mode
+#define DIJKSTRA_WEIGHTING_PROFILE(mode) ((int)(mode) - DIJKSTRA_WEIGHTING_BASE)
+
 typedef struct {
-  double *distances;
+  uint32_t *distances;      // Integer costs (meters or milliseconds), WEIGHT_INFINITY if unreached
   int *predecessors;
   bool *visited;
   int source_index;
   int target_index;
   int num_nodes;
+  int settled_count;
   bool target_found;
+  DijkstraMode mode;        // Mode the costs were computed in
 } DijkstraResult;
 
-typedef enum {
-  DIJKSTRA_SHORTEST_DISTANCE = 1,
-  DIJKSTRA_FASTEST_TIME = 2
-} DijkstraMode;
+/**
+ * Suspended search from one source, answering targets one after another
+ * (see dijkstra_session_open()). The result arrays persist between queries:
+ * nodes settled for an earlier target stay settled, and the heap keeps the
+ * frontier the next query resumes from.
+ */
+typedef struct {
+  Graph *graph;             // Graph the session searches
+  DijkstraResult result;    // Shared search state; target fields describe the last query
+  MinHeap *heap;            // Frontier of the suspended search
+  int stopped_index;        // Node the search stopped at without relaxing its arcs, -1 if none
+  uint32_t weight_version;  // graph->weight_version the settled costs were computed with
+} DijkstraSession;
+
+/**
+ * Start node of a multi-source search (see dijkstra_multi_search()).
+ */
+typedef struct {
+  uint32_t node_id;         // Source node ID
+  uint32_t offset;          // Initial cost, in the integer units of the mode (meters or milliseconds)
+} DijkstraSource;
+
+/**
+ * Reusable search state for many small searches over one graph (see
+ * stamped_search_begin()). Per-node fields are only valid where stamp (or
+ * closed) equals search_id, so a new search costs nothing up front; the
+ * stamps are cleared when the ID wraps.
+ */
+typedef struct {
+  int num_nodes;
+  uint32_t *cost;           // Cost from the nearest seed
+  edge_index_t *pred_arc;   // Arc a node was reached by, -1 at a seed
+  int *pred_node;           // Node that arc leaves, -1 at a seed
+  uint32_t *stamp;          // Search that set cost and pred_arc
+  uint32_t *closed;         // Search that settled the node
+  uint32_t search_id;
+  MinHeap *heap;
+  int settled_count;        // Nodes settled over all searches
+} StampedSearch;
+
+// Tells a stamped search to stop after settling a node (context is passed through)
+typedef bool (*StampedStopFunc)(void *context, int node_index);
 
 // =================
 // Dijkstra's Algorithm Function Prototypes
@@ -46,11 +102,149 @@ typedef enum {
  * @pre mode must be either DIJKSTRA_SHORTEST_DISTANCE or DIJKSTRA_FASTEST_TIME
  * @post On success: result contains distances, predecessors, and visited arrays
  *       On failure: result content is undefined
- * @note For DIJKSTRA_FASTEST_TIME mode, edge speed_limit must be positive
+ * @note Edges with a zero speed limit use the fallback speed of their road class
+ * @note When the graph's component index proves the target unreachable, no
+ *       search runs and result->target_found is false (settled_count is 0)
  * @note The caller must call free_dijkstra_result() to free allocated memory
  */
 error_code_t dijkstra_shortest_path(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info);
 
+/**
+ * Computes the shortest distance between two nodes without recording the path.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param target_node_id ID of the target node
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param result Pointer to store the algorithm results
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre Same as dijkstra_shortest_path()
+ * @post On success: result contains distances and visited arrays, result->predecessors is NULL
+ *       On failure: result content is undefined
+ * @note Runs the kernel specialization without predecessor tracking; use it
+ *       when only the cost is needed (get_shortest_path() rejects the result)
+ * @note The caller must call free_dijkstra_result() to free allocated memory
+ */
+error_code_t dijkstra_shortest_cost(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info);
+
+/**
+ * Computes the shortest path tree from a source node using Dijkstra's algorithm.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param result Pointer to store the algorithm results
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL
+ * @pre source_node_id must exist in the graph
+ * @post On success: result holds distances and predecessors of every reachable node,
+ *       result->target_index is -1 and result->target_found is false
+ *       On failure: result content is undefined
+ * @note Used to build Dijkstra-rank query sets, where nodes are ranked by settle order
+ * @note The caller must call free_dijkstra_result() to free allocated memory
+ */
+error_code_t dijkstra_shortest_path_tree(Graph *graph, uint32_t source_node_id, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info);
+
+/**
+ * Starts a search session from a source node.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param session Pointer to the session to initialize
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL, source_node_id must exist in the graph
+ * @post On success: the source is queued and no target is resolved yet
+ *       On failure: nothing is left allocated
+ * @note The graph must not be modified while the session is open.
+ *       The caller must call dijkstra_session_close() to free allocated memory
+ */
+error_code_t dijkstra_session_open(Graph *graph, uint32_t source_node_id, DijkstraMode mode, DijkstraSession *session, error_info_t *err_info);
+
+/**
+ * Resolves one more target of a session, resuming the suspended search only
+ * as far as needed.
+ * 
+ * @param session Pointer to an open session
+ * @param target_node_id ID of the target node
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre session must be open, target_node_id must exist and differ from the source
+ * @pre graph weights must not have changed since the session was opened
+ *      (ERR_INVALID_ARGUMENT after a live traffic batch; reopen the session)
+ * @post On success: session->result describes the target as if it came from
+ *       dijkstra_shortest_path() (get_shortest_distance() and get_shortest_path()
+ *       accept it) and settled_count is the total over the session
+ *       On failure: the session can only be closed
+ * @note Targets already settled by earlier queries are answered without
+ *       touching the heap; paths returned earlier stay valid
+ */
+error_code_t dijkstra_session_query(DijkstraSession *session, uint32_t target_node_id, error_info_t *err_info);
+
+/**
+ * Frees memory held by a search session.
+ * 
+ * @param session Pointer to the session (NULL is allowed)
+ */
+void dijkstra_session_close(DijkstraSession *session);
+
+/**
+ * Runs one search from a set of sources towards a set of targets, e.g. to
+ * find the nearest of several facilities or to start from both ends of the
+ * edge a position was snapped to.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param sources Source nodes with their initial costs
+ * @param num_sources Number of sources
+ * @param target_node_ids IDs of the target nodes
+ * @param num_targets Number of targets
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param all_targets false to stop at the nearest target, true to settle every reachable target
+ * @param result Pointer to store the algorithm results
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL, num_sources and num_targets must be positive
+ * @pre Every node must exist in the graph and every offset must be below WEIGHT_INFINITY
+ * @post On success: result->target_index is the nearest target and
+ *       result->source_index the source its path starts from (the first source
+ *       if no target is reached); distances include the source offsets
+ *       On failure: result content is undefined
+ * @note A node may be listed more than once (the cheapest offset wins) and may
+ *       be both a source and a target. Targets that the component index proves
+ *       unreachable from every source do not keep the search running
+ * @note On pruned or contracted graphs sources and targets must be routing
+ *       nodes (not on a dead-end tree or inside a chain)
+ * @note Use dijkstra_select_target() to read the other targets.
+ *       The caller must call free_dijkstra_result() to free allocated memory
+ */
+error_code_t dijkstra_multi_search(Graph *graph, const DijkstraSource *sources, int num_sources, const uint32_t *target_node_ids, int num_targets, DijkstraMode mode, bool all_targets, DijkstraResult *result, error_info_t *err_info);
+
+/**
+ * Points a multi-source search result at another target.
+ * 
+ * @param graph Pointer to the graph structure the result was computed on
+ * @param result Result of dijkstra_multi_search()
+ * @param target_node_id ID of the target node
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL, target_node_id must exist in the graph
+ * @post On success: result->target_found tells whether the search settled
+ *       the target; if so result->target_index and result->source_index
+ *       describe its path for get_shortest_distance() and get_shortest_path()
+ * @note A search that stopped at the nearest target has only settled the
+ *       targets no farther than that one
+ */
+error_code_t dijkstra_select_target(Graph *graph, DijkstraResult *result, uint32_t target_node_id, error_info_t *err_info);
+
 /**
  * Frees memory allocated for DijkstraResult structure.
  * 
@@ -74,10 +268,55 @@ void free_dijkstra_result(DijkstraResult *result);
  * @pre result must be initialized by dijkstra_shortest_path()
  * @post On success: *distance contains the shortest distance or INFINITY if no path exists
  *       On failure: *distance is undefined
+ * @note The value is in meters or minutes depending on the mode (see dijkstra_cost_value())
  * @note If target was not found, distance is set to INFINITY (DBL_MAX)
  */
 error_code_t get_shortest_distance(DijkstraResult *result, double *distance, error_info_t *err_info);
 
+/**
+ * Validates a mode for a graph.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param mode Algorithm mode
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS if the mode is a built-in mode or a weighting profile
+ *         of the graph, ERR_INVALID_ARGUMENT otherwise
+ */
+error_code_t check_dijkstra_mode(const Graph *graph, DijkstraMode mode, error_info_t *err_info);
+
+/**
+ * Returns the weight metric searched in a mode.
+ * 
+ * @param mode Algorithm mode
+ * @return WEIGHT_TIME for DIJKSTRA_FASTEST_TIME and weighting profiles,
+ *         WEIGHT_DISTANCE otherwise
+ * @note Weighting profiles cost generalized milliseconds, so they are
+ *       reported and penalized like the time metric
+ */
+WeightMetric dijkstra_mode_metric(DijkstraMode mode);
+
+/**
+ * Returns the packed arc stream searched in a mode.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param mode Algorithm mode, validated by check_dijkstra_mode()
+ * @return The metric's adj_arcs stream, or the profile's compiled stream
+ * @note Inside a read section (see traffic_read_begin()) this is the stream
+ *       the section pinned, so every load in it sees the same traffic batch.
+ *       Outside one the stream is loaded with acquire ordering
+ */
+const Arc *dijkstra_mode_arcs(const Graph *graph, DijkstraMode mode);
+
+/**
+ * Converts an integer search cost to the unit shown to users.
+ * 
+ * @param mode Mode the cost was computed in
+ * @param cost Integer cost (meters or milliseconds)
+ * @return Meters for DIJKSTRA_SHORTEST_DISTANCE, minutes for
+ *         DIJKSTRA_FASTEST_TIME and weighting profiles
+ */
+double dijkstra_cost_value(DijkstraMode mode, uint32_t cost);
+
 /**
  * Retrieves the shortest path from Dijkstra algorithm result.
  * 
@@ -91,11 +330,82 @@ error_code_t get_shortest_distance(DijkstraResult *result, double *distance, err
  * @pre All pointers must be non-NULL
  * @pre result must be initialized by dijkstra_shortest_path()
  * @pre Target node must be reachable from source
+ * @pre result must have been computed with predecessor tracking
  * @post On success: *path contains node indices array, *path_length contains array size
  *       On failure: *path_length is 0, *path is undefined
  * @note The caller must free the allocated path array
  * @note Path contains node indices in order from source to target
+ * @note On pruned or contracted graphs tree and chain nodes skipped by a
+ *       predecessor step are restored into the path and their costs are
+ *       written to result->distances
  */
 error_code_t get_shortest_path(Graph *graph, DijkstraResult *result, int *path_length, int **path, error_info_t *err_info);
 
+// =================
+// Stamped Search Function Prototypes
+// =================
+
+/**
+ * Allocates a stamped search workspace.
+ *
+ * @param search Pointer to the workspace to initialize
+ * @param num_nodes Number of graph nodes
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @note The caller must call stamped_search_free() to free allocated memory
+ */
+error_code_t stamped_search_init(StampedSearch *search, int num_nodes, error_info_t *err_info);
+
+/**
+ * Frees memory held by a stamped search workspace.
+ *
+ * @param search Pointer to the workspace (NULL is allowed)
+ */
+void stamped_search_free(StampedSearch *search);
+
+/**
+ * Starts a new search: every node reads as unreached and the heap is empty.
+ *
+ * @param search Pointer to the workspace
+ */
+void stamped_search_begin(StampedSearch *search);
+
+/**
+ * Adds a start node with an initial cost to the current search.
+ *
+ * @param search Pointer to the workspace
+ * @param node_index Start node
+ * @param cost Initial cost (the cheapest of repeated seeds wins)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ */
+error_code_t stamped_search_seed(StampedSearch *search, int node_index, uint32_t cost, error_info_t *err_info);
+
+/**
+ * Runs the current search from its seeds.
+ *
+ * @param search Pointer to the workspace
+ * @param graph Graph searched
+ * @param arcs Arc stream of the mode searched
+ * @param avoided_arcs Avoided arc bitmap (NULL for none, see road_filter_arcs())
+ * @param bound Largest cost kept; costs above it are never queued
+ * @param stop Called on every settled node; true stops the search (NULL never stops)
+ * @param context Passed to stop
+ * @param stopped Set to whether stop ended the search (may be NULL)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @post Settled nodes have closed == search_id, with their exact cost and
+ *       a predecessor chain back to a seed
+ */
+error_code_t stamped_search_run(StampedSearch *search, const Graph *graph, const Arc *arcs, const uint64_t *avoided_arcs, uint32_t bound, StampedStopFunc stop, void *context, bool *stopped, error_info_t *err_info);
+
+/**
+ * Tells whether the current search settled a node.
+ */
+static inline bool stamped_search_settled(const StampedSearch *search, int node_index) {
+  return search->closed[node_index] == search->search_id;
+}
+
 #endif // DIJKSTRA_H
@@ -1,6 +1,7 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "error_handling.h"
@@ -11,12 +12,28 @@
 
 #define HASH_TABLE_SIZE 65536
 
+// Type of edge indices and CSR offsets. The default 32-bit build handles
+// graphs with up to INT32_MAX adjacency slots (twice the bidirectional edge
+// count); build with -DGRAPH_INDEX64 (make INDEX64=1) for planet-scale
+// graphs. Node indices stay 32-bit in both builds.
+#ifdef GRAPH_INDEX64
+typedef int64_t edge_index_t;
+#define EDGE_INDEX_MAX INT64_MAX
+#else
+typedef int32_t edge_index_t;
+#define EDGE_INDEX_MAX INT32_MAX
+#endif
+
+// Fixed-point coordinate units per degree (1e-7 degrees, the OSM precision)
+#define COORD_SCALE 10000000.0
+
 // ==================
 // Data Structures
 // ==================
 
 /**
- * Represents a node in the graph with geographical coordinates.
+ * Node record as stored in the binary node file. Loaded graphs keep node data
+ * in the compact per-field arrays of Graph instead (see graph->node_ids).
  */
 typedef struct {
   uint32_t node_id;    // Unique identifier for the node
@@ -25,7 +42,8 @@ typedef struct {
 } Node;
 
 /**
- * Represents an edge in the graph with routing information.
+ * Edge record as stored in the binary edge file. Loaded graphs keep edge data
+ * in the structure-of-arrays columns of Graph instead (see graph->edge_from).
  */
 typedef struct {
   uint32_t from_node;   // Source node identifier
@@ -37,6 +55,49 @@ typedef struct {
   uint8_t one_way;      // 1 if one-way, 0 if bidirectional
 } Edge;
 
+/**
+ * Road classification codes stored in Edge.highway_type, ordered from the
+ * most to the least important road class. Values above HIGHWAY_SERVICE are
+ * treated as HIGHWAY_UNKNOWN.
+ */
+typedef enum {
+  HIGHWAY_UNKNOWN = 0,      // Unclassified by the converter
+  HIGHWAY_MOTORWAY = 1,     // Motorways and their links
+  HIGHWAY_TRUNK = 2,        // Trunk roads
+  HIGHWAY_PRIMARY = 3,      // Primary roads
+  HIGHWAY_SECONDARY = 4,    // Secondary roads
+  HIGHWAY_TERTIARY = 5,     // Tertiary roads
+  HIGHWAY_UNCLASSIFIED = 6, // Minor public roads
+  HIGHWAY_RESIDENTIAL = 7,  // Residential streets
+  HIGHWAY_SERVICE = 8,      // Service and access roads
+  HIGHWAY_NUM_TYPES = 9
+} HighwayType;
+
+/**
+ * Edge weight metrics precomputed into the packed adjacency streams.
+ * Weights are unsigned integers so the search loop only adds and compares.
+ */
+typedef enum {
+  WEIGHT_DISTANCE = 0,      // Edge length in meters
+  WEIGHT_TIME = 1,          // Travel time in milliseconds
+  WEIGHT_NUM_METRICS = 2
+} WeightMetric;
+
+// Cost of an unreached node; path costs must stay below it (about 49 days
+// of travel time or 4.29 million km)
+#define WEIGHT_INFINITY UINT32_MAX
+
+// Time weight units per minute (weights are milliseconds)
+#define WEIGHT_TIME_UNITS_PER_MINUTE 60000.0
+
+/**
+ * Packed adjacency entry: everything the search loop reads to relax an edge.
+ */
+typedef struct {
+  int target;               // Neighbor node index
+  uint32_t weight;          // Edge weight in the metric's unit
+} Arc;
+
 /**
  * Hash table entry for efficient node lookup by ID.
  */
@@ -55,24 +116,127 @@ typedef struct {
   int count;                // Number of entries in the hash table
 } NodeHashTable;
 
+// Degree-2 chain contraction data (see contract.h)
+struct ChainIndex;
+
+// Connected component data (see components.h)
+struct ComponentIndex;
+
+// Dead-end tree pruning data (see prune.h)
+struct PruneIndex;
+
+// Turn restriction data (see turns.h)
+struct TurnIndex;
+
+// Time-dependent travel time profiles (see timedep.h)
+struct TimeProfiles;
+
+// Live traffic double buffer (see traffic.h)
+struct TrafficOverlay;
+
+// Avoided road classes (see roadclass.h)
+struct RoadFilter;
+
+// Compiled weighting profiles (see weighting.h)
+struct WeightingSet;
+
+/**
+ * Incoming arcs of every node as positions into the forward CSR. Weights are
+ * read from adj_arcs, so the index stays valid while only weights change.
+ */
+typedef struct {
+  edge_index_t *in_offsets; // Incoming arcs of node v are in_arcs[in_offsets[v]..in_offsets[v + 1])
+  edge_index_t *in_arcs;    // Forward CSR positions grouped by head node
+  int *arc_tail;            // Node each forward CSR position leaves
+} ReverseIndex;
+
 /**
  * Graph structure with CSR representation for efficient adjacency queries.
  */
 typedef struct {
-  Node *nodes;              // Array of nodes
-  Edge *edges;              // Array of edges
+  // Compact node storage, indexed by node index (12 bytes per node)
+  uint32_t *node_ids;       // Node identifiers
+  int32_t *node_lat;        // Latitudes in fixed-point COORD_SCALE units
+  int32_t *node_lon;        // Longitudes in fixed-point COORD_SCALE units
+
+  // Structure-of-arrays edge store, indexed by edge index (file order).
+  // Endpoints are resolved to node indices once at load time; the remaining
+  // columns are metadata used for filtering, weights and export.
+  int *edge_from;           // Source node index
+  int *edge_to;             // Destination node index
+  uint32_t *edge_length;    // Length of the edge in meters
+  uint16_t *edge_speed;     // Speed limit in km/h
+  uint8_t *edge_highway;    // Road class (HighwayType)
+  uint8_t *edge_one_way;    // 1 if one-way, 0 if bidirectional
 
   // CSR (Compressed Sparse Row) representation
-  int *adj_offsets;         // Offset array for adjacency list
-  int *adj_indices;         // Edge indices for each node's adjacency list
+  edge_index_t *adj_offsets; // Offset array for adjacency list
+  edge_index_t *adj_indices; // Edge indices for each node's adjacency list
+  Arc *adj_arcs[WEIGHT_NUM_METRICS]; // Packed (target, weight) stream per metric, parallel to adj_indices
+
+  // Contracted chains, NULL unless contract_degree2_chains() was applied
+  struct ChainIndex *chains;
+
+  // Connected components, computed at load time (NULL for hand-built graphs)
+  struct ComponentIndex *components;
+
+  // Dead-end trees outside the routing core, NULL unless prune_dead_end_trees() was applied
+  struct PruneIndex *pruned;
+
+  // Turn restrictions by via node, NULL unless load_turn_restrictions() was applied
+  struct TurnIndex *turns;
+
+  // Travel time profiles by edge, NULL unless load_time_profiles() was applied
+  struct TimeProfiles *profiles;
+
+  // Spare arc streams for live traffic, NULL unless apply_traffic_updates() was applied
+  struct TrafficOverlay *traffic;
+
+  // Twice the traffic batches published (odd while one swaps its streams)
+  // and the queries in a read section per buffer parity (see traffic_read_begin())
+  uint32_t arc_generation;
+  uint32_t arc_readers[2];
+
+  // Avoided road classes, NULL unless set_avoided_road_classes() was applied
+  struct RoadFilter *filter;
+
+  // Per-profile arc streams sharing the CSR, NULL unless load_weighting_profiles() was applied
+  struct WeightingSet *weightings;
+
+  // Incremented whenever live traffic publishes or drops weights, the avoided classes change
+  // or weighting profiles are loaded
+  uint32_t weight_version;
+
+  // Incoming arcs, built on first use by get_reverse_index() (published atomically) and
+  // dropped when the CSR is rebuilt
+  ReverseIndex *reverse;
 
   // Hash Table for node lookup
   NodeHashTable *node_hash; // Hash table for node ID to index mapping
 
   int num_nodes;            // Number of nodes in the graph
-  int num_edges;            // Number of edges in the graph
+  edge_index_t num_edges;   // Number of edges in the graph
 } Graph;
 
+// ==================
+// Coordinate Conversion
+// ==================
+
+/**
+ * Converts a coordinate in degrees to fixed-point COORD_SCALE units, rounding to nearest.
+ */
+static inline int32_t coord_from_degrees(double degrees) {
+  return (int32_t)(degrees * COORD_SCALE + (degrees < 0 ? -0.5 : 0.5));
+}
+
+/**
+ * Converts a fixed-point coordinate back to degrees. Only needed at output
+ * boundaries (printing, GPX, great-circle distances).
+ */
+static inline double coord_to_degrees(int32_t fixed) {
+  return fixed / COORD_SCALE;
+}
+
 // ==================
 // Graph Function Prototypes
 // ==================
@@ -89,9 +253,11 @@ typedef struct {
  * @pre All pointers must be non-NULL, num_nodes and num_edges must be positive
  * @post On success: *graph points to a valid, initialized graph structure
  *       On failure: *graph is undefined and memory is cleaned up
- * @note Allocates memory for all graph components including CSR arrays and hash table
+ * @note Allocates memory for all graph components including CSR arrays and hash table.
+ *       Fails with ERR_INVALID_ARGUMENT if twice num_edges does not fit edge_index_t
+ *       and with ERR_MEMORY_ALLOCATION if an allocation size overflows size_t
  */
-error_code_t create_graph(Graph **graph, int num_nodes, int num_edges, error_info_t *err_info);
+error_code_t create_graph(Graph **graph, int num_nodes, edge_index_t num_edges, error_info_t *err_info);
 
 /**
  * Frees all memory associated with a graph structure.
@@ -131,13 +297,81 @@ error_code_t find_node_index(Graph *graph, uint32_t node_id, int *out_index, err
  * @param err_info Error reporting structure
  * @return ERR_SUCCESS on success, error code otherwise
  * 
- * @pre graph and err_info must be non-NULL, nodes and edges must be loaded
- * @post On success: CSR arrays (adj_offsets, adj_indices) are populated
+ * @pre graph and err_info must be non-NULL, nodes and edge columns must be loaded
+ * @post On success: CSR arrays (adj_offsets, adj_indices, adj_arcs) are populated
  *       On failure: CSR arrays are undefined
- * @note Handles both directed and undirected edges based on one_way flag
+ * @note Handles both directed and undirected edges based on one_way flag.
+ *       Time weights of edges with a zero speed limit use highway_fallback_speed().
+ *       On a pruned graph only edges between core nodes get adjacency entries
  */
 error_code_t build_csr_representation(Graph *graph, error_info_t *err_info);
 
+/**
+ * Returns the incoming arcs of the current CSR, building them on first use.
+ * 
+ * @param graph Pointer to graph with CSR representation built
+ * @param reverse Pointer to store the reverse index (owned by the graph)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL
+ * @post On success: *reverse is valid until the CSR is rebuilt or the graph is freed
+ * @note Backward searches (k-shortest paths, alternative routes, Pareto
+ *       routes) use it; building it costs one pass over the arcs
+ * @note Safe to call from concurrent queries: the first finished build is
+ *       published atomically and concurrent builds are discarded. Dropping
+ *       the index (CSR rebuilds) must not overlap queries
+ */
+error_code_t get_reverse_index(Graph *graph, const ReverseIndex **reverse, error_info_t *err_info);
+
+/**
+ * Frees the reverse index of a graph, e.g. because its CSR changes.
+ * 
+ * @param graph Pointer to graph structure
+ */
+void drop_reverse_index(Graph *graph);
+
+/**
+ * Allocates an array, failing instead of wrapping around when the size overflows.
+ * 
+ * @param count Number of elements
+ * @param elem_size Size of one element in bytes
+ * @return Pointer to the uninitialized array, or NULL on overflow or allocation failure
+ */
+void *alloc_array(size_t count, size_t elem_size);
+
+/**
+ * Returns the speed assumed for an edge whose speed limit is zero.
+ * 
+ * @param highway_type Road class code of the edge (HighwayType)
+ * @return Fallback speed in km/h, always positive
+ * 
+ * @note Fallback speeds: motorway 110, trunk 90, primary 70, secondary 60,
+ *       tertiary 50, unclassified 40, residential 30, service 20 and
+ *       30 km/h for unknown classes
+ */
+uint16_t highway_fallback_speed(uint8_t highway_type);
+
+/**
+ * Converts a length and a speed into a travel time weight.
+ * 
+ * @param length_m Length in meters
+ * @param speed_kmh Speed in km/h, must be positive
+ * @return Travel time in milliseconds rounded to nearest (clamped below WEIGHT_INFINITY)
+ */
+uint32_t travel_time_ms(uint32_t length_m, uint16_t speed_kmh);
+
+/**
+ * Computes the integer weight of an edge under a metric.
+ * 
+ * @param graph Pointer to graph with edge columns loaded
+ * @param edge_idx Index of the edge
+ * @param metric Weight metric
+ * @return Length in meters, or travel time in milliseconds rounded to nearest
+ *         (clamped below WEIGHT_INFINITY)
+ */
+uint32_t compute_edge_weight(const Graph *graph, edge_index_t edge_idx, WeightMetric metric);
+
 /**
  * Gets the range of adjacent edges for a given node using CSR representation.
  * 
@@ -151,9 +385,9 @@ error_code_t build_csr_representation(Graph *graph, error_info_t *err_info);
  * @pre All pointers must be non-NULL, node_index must be valid
  * @post On success: *start_idx and *end_idx define the range [start_idx, end_idx)
  *       On failure: indices are undefined
- * @note Edge indices can be used to access edges in the edges array
+ * @note The range indexes adj_indices (edge metadata) and adj_arcs (packed targets and weights)
  */
-error_code_t get_adjacent_edges_csr(Graph *graph, int node_index, int *start_idx, int *end_idx, error_info_t *err_info);
+error_code_t get_adjacent_edges_csr(Graph *graph, int node_index, edge_index_t *start_idx, edge_index_t *end_idx, error_info_t *err_info);
 
 // ==================
 // Node Hash Table Function Prototypes
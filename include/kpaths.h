@@ -0,0 +1,190 @@
+#ifndef KPATHS_H
+#define KPATHS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "error_handling.h"
+
+// ==================
+// K-Shortest Paths Data Structures
+// ==================
+
+/**
+ * A route as node indices with the cost of reaching each node along it.
+ * Chain interiors of a contracted graph are restored, so the arrays can be
+ * passed to export_path_costs_to_gpx() as they are.
+ */
+typedef struct {
+  int *nodes;               // Node indices from source to target
+  uint32_t *costs;          // Cost of reaching each node along this route
+  int length;               // Number of nodes
+} RoutePath;
+
+/**
+ * Loopless routes between two nodes by increasing cost (see find_k_shortest_paths()).
+ */
+typedef struct {
+  RoutePath *paths;         // Routes by increasing cost
+  int num_paths;            // Routes found (at most the k requested)
+  DijkstraMode mode;        // Mode the costs were computed in
+  int spur_searches;        // Spur searches run (bounded-out spur nodes excluded)
+  int settled_count;        // Nodes settled by the reverse tree and all spur searches
+} KShortestPaths;
+
+// ==================
+// Route Endpoint Data Structures
+// ==================
+
+// Virtual arcs of RouteEnds: two exits, two entries and the direct arc
+#define ROUTE_EXIT_ARC 0
+#define ROUTE_ENTRY_ARC 2
+#define ROUTE_DIRECT_ARC 4
+#define ROUTE_NUM_VIRTUAL_ARCS 5
+
+// Routing arcs of the (up to two) chains holding an endpoint, two per chain
+#define ROUTE_MAX_CUT_ARCS 4
+
+/**
+ * How the endpoints of a route attach to the routing graph (see
+ * resolve_route_ends()). Chain interiors and dead-end tree nodes have no
+ * arcs of their own, so routes leave the source and reach the target over
+ * virtual arcs numbered first_virtual_arc + k: exits (k = 0, 1) run from the
+ * source to a routing node, entries (k = 2, 3) from a routing node to the
+ * target and the direct arc (k = 4) joins endpoints on one chain or dead-end
+ * tree without touching the routing graph. Unused virtual arcs have tail -1.
+ */
+typedef struct {
+  int source_index;
+  int target_index;
+  edge_index_t first_virtual_arc;   // Number of CSR arcs
+  int tail[ROUTE_NUM_VIRTUAL_ARCS];
+  int head[ROUTE_NUM_VIRTUAL_ARCS];
+  uint32_t cost[ROUTE_NUM_VIRTUAL_ARCS];
+  int chain[ROUTE_NUM_VIRTUAL_ARCS];         // Chain the arc runs along, -1 along a dead-end tree
+  int from_position[ROUTE_NUM_VIRTUAL_ARCS]; // Chain positions it runs between (see chain_span_cost())
+  int to_position[ROUTE_NUM_VIRTUAL_ARCS];
+  edge_index_t cut_arcs[ROUTE_MAX_CUT_ARCS]; // Routing arcs passing through an endpoint
+  int num_cut_arcs;
+  bool has_virtual_arcs;            // Some endpoint is off the routing graph
+  bool direct_only;                 // The direct arc is the only loopless route
+} RouteEnds;
+
+/**
+ * Tells whether an arc of a route is one of the virtual arcs of its ends.
+ */
+static inline bool is_virtual_arc(const RouteEnds *ends, edge_index_t arc) {
+  return arc >= ends->first_virtual_arc;
+}
+
+/**
+ * Returns the node a CSR or virtual arc leads to.
+ */
+static inline int route_arc_target(const RouteEnds *ends, const Arc *arcs, edge_index_t arc) {
+  return arc >= ends->first_virtual_arc ? ends->head[arc - ends->first_virtual_arc] : arcs[arc].target;
+}
+
+/**
+ * Returns the cost of a CSR or virtual arc.
+ */
+static inline uint32_t route_arc_weight(const RouteEnds *ends, const Arc *arcs, edge_index_t arc) {
+  return arc >= ends->first_virtual_arc ? ends->cost[arc - ends->first_virtual_arc] : arcs[arc].weight;
+}
+
+/**
+ * Tells whether a routing arc passes through an endpoint, so loopless
+ * routes must not use it.
+ */
+static inline bool is_cut_arc(const RouteEnds *ends, edge_index_t arc) {
+  for (int k = 0; k < ends->num_cut_arcs; k++) {
+    if (ends->cut_arcs[k] == arc) return true;
+  }
+  return false;
+}
+
+// ==================
+// K-Shortest Paths Function Prototypes
+// ==================
+
+/**
+ * Finds up to k loopless routes between two nodes by increasing cost with
+ * Yen's algorithm.
+ *
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param target_node_id ID of the target node
+ * @param k Maximum number of routes
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param paths Pointer to store the routes
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre All pointers must be non-NULL, k must be positive
+ * @pre source_node_id and target_node_id must exist and differ
+ * @post On success: paths holds the routes found (none if the target is
+ *       unreachable), the first being a shortest path
+ *       On failure: nothing is left allocated
+ * @note A reverse search from the target gives exact remaining costs. Spur
+ *       searches use them as A* potentials, and spur nodes that cannot beat
+ *       the routes already queued are skipped. Spur searches reuse stamped
+ *       workspaces, so none pays O(N) initialization
+ * @note On pruned or contracted graphs, endpoints off the routing graph
+ *       join it over the virtual arcs of resolve_route_ends(). Parallel
+ *       chains between the same routing nodes count as different routes
+ * @note The caller must call free_k_shortest_paths() to free allocated memory
+ */
+error_code_t find_k_shortest_paths(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, int k, DijkstraMode mode, KShortestPaths *paths, error_info_t *err_info);
+
+/**
+ * Describes how two nodes attach to the routing graph of a pruned or
+ * contracted graph.
+ *
+ * @param graph Pointer to the graph structure
+ * @param mode Mode of the virtual arc costs
+ * @param source_index Source node
+ * @param target_index Target node (the source itself only to read the exits
+ *        and entries of one node, whose direct arc is then meaningless)
+ * @param loopless true to keep routes simple: exits and entries running
+ *        through the other endpoint are dropped, the routing arcs of the
+ *        chains holding an endpoint are cut, and endpoints on one dead-end
+ *        tree only get the direct arc. false keeps every way on and off,
+ *        which is all shortest paths need
+ * @param ends Pointer to store the endpoint description
+ *
+ * @post Routing nodes get no virtual arcs: a route from a routing source
+ *       starts with its CSR arcs, one to a routing target ends on it
+ * @note Chain interiors exit to both chain ends (one on one-way chains, in
+ *       travel direction) and dead-end tree nodes to their root; nothing
+ *       leaves a node on an avoided chain
+ */
+void resolve_route_ends(const Graph *graph, DijkstraMode mode, int source_index, int target_index, bool loopless, RouteEnds *ends);
+
+/**
+ * Converts a route given as routing CSR arc positions into node indices and
+ * costs, restoring chain interiors of a contracted graph and the nodes along
+ * virtual arcs.
+ *
+ * @param graph Pointer to the graph structure
+ * @param mode Mode whose arc costs are summed
+ * @param ends Endpoints the virtual arcs of the route belong to (NULL if it has none)
+ * @param source_index Node the first arc leaves
+ * @param arcs Arc positions in travel order
+ * @param num_arcs Number of arcs (0 gives a single-node route)
+ * @param route Pointer to store the route
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre Consecutive arcs must connect; arcs may be NULL if num_arcs is 0
+ * @note The caller frees route->nodes and route->costs
+ */
+error_code_t build_route_path(const Graph *graph, DijkstraMode mode, const RouteEnds *ends, int source_index, const edge_index_t *arcs, int num_arcs, RoutePath *route, error_info_t *err_info);
+
+/**
+ * Frees the routes of a k-shortest paths result.
+ *
+ * @param paths Pointer to the result (NULL is allowed)
+ */
+void free_k_shortest_paths(KShortestPaths *paths);
+
+#endif // KPATHS_H
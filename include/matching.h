@@ -0,0 +1,215 @@
+#ifndef MATCHING_H
+#define MATCHING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+#define MATCH_DEFAULT_CELL_SIZE_M 100.0
+#define MATCH_MAX_CANDIDATES 32
+
+// ==================
+// Map Matching Data Structures
+// ==================
+
+/**
+ * Uniform grid over the node bounding box; each cell lists the edges whose
+ * bounding box overlaps it (see build_edge_grid()).
+ */
+typedef struct {
+  int32_t min_lat;          // South edge of the grid in COORD_SCALE units
+  int32_t min_lon;          // West edge of the grid in COORD_SCALE units
+  double cell_lat;          // Cell height in COORD_SCALE units
+  double cell_lon;          // Cell width in COORD_SCALE units
+  int rows;                 // Cells from south to north
+  int cols;                 // Cells from west to east
+  edge_index_t *cell_offsets; // Edges of cell c are cell_edges[cell_offsets[c]..cell_offsets[c + 1])
+  edge_index_t *cell_edges; // Edge indices grouped by cell
+} EdgeGrid;
+
+/**
+ * A coordinate in degrees.
+ */
+typedef struct {
+  double latitude;
+  double longitude;
+} GeoPoint;
+
+/**
+ * Hidden Markov model parameters (Newson and Krumm): GPS noise is Gaussian
+ * around the road, and the route between two fixes is about as long as the
+ * great-circle distance between them.
+ */
+typedef struct {
+  double search_radius_m;   // Edges farther from a fix are not candidates
+  int max_candidates;       // Nearest candidate edges kept per fix (1 to MATCH_MAX_CANDIDATES)
+  double sigma_m;           // Standard deviation of the GPS noise
+  double beta_m;            // Scale of the route/great-circle length difference
+  double max_route_factor;  // Routes longer than this times the great-circle distance,
+                            // plus twice the search radius, are not searched
+} MatchParams;
+
+/**
+ * Where a fix was matched.
+ */
+typedef struct {
+  edge_index_t edge;        // Matched edge, -1 if the fix has no candidate
+  double offset;            // Position along the edge from edge_from (0) to edge_to (1)
+  GeoPoint position;        // Fix projected onto the edge
+  double distance_m;        // Distance from the fix to the projection
+  int geometry_index;       // Position of the projection in the trace geometry, -1 if unmatched
+  bool starts_segment;      // No route joins this fix to the previous matched one
+} MatchedPoint;
+
+/**
+ * A trace matched to the road network (see match_trace()).
+ */
+typedef struct {
+  MatchedPoint *points;     // One entry per fix
+  int num_points;           // Number of fixes
+  edge_index_t *edges;      // Matched edges in driving order, consecutive repeats merged
+  int num_edges;            // Number of matched edges
+  GeoPoint *geometry;       // Projected fixes joined by the nodes of the routes between them
+  int geometry_length;      // Number of geometry points
+  int num_segments;         // Routes the trace splits into where no transition is possible
+  int num_unmatched;        // Fixes without a candidate edge
+  int settled_count;        // Nodes settled by every transition search
+} MatchedTrace;
+
+// Search state reused across the traces matched by one thread (see matching.c)
+typedef struct MatchWorkspace MatchWorkspace;
+
+/**
+ * One trace of a batch (see match_trace_batch()): the fixes in, the matched
+ * trace and the outcome out.
+ */
+typedef struct {
+  const GeoPoint *points;   // GPS fixes in time order
+  int num_points;           // Number of fixes
+  MatchedTrace trace;       // Matched trace, valid when err_code is ERR_SUCCESS
+  error_code_t err_code;    // Outcome of this trace
+  error_info_t err_info;    // Error details when err_code is not ERR_SUCCESS
+} MatchJob;
+
+// ==================
+// Map Matching Function Prototypes
+// ==================
+
+/**
+ * Fills in the default parameters: 50 m search radius, 8 candidates,
+ * sigma 5 m, beta 5 m and routes up to 4 times the great-circle distance.
+ *
+ * @param params Pointer to the parameters to fill
+ */
+void default_match_params(MatchParams *params);
+
+/**
+ * Builds the edge grid used to find candidate edges.
+ *
+ * @param graph Pointer to the graph structure
+ * @param cell_size_m Cell side in meters (MATCH_DEFAULT_CELL_SIZE_M is a good start)
+ * @param grid Pointer to store the grid
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @post On success: every edge is listed in every cell its bounding box overlaps
+ * @note Cells grow when the node bounding box would need more cells than
+ *       there are edges, so sparse graphs spanning large areas stay small
+ * @note The grid holds edge indices and reads coordinates through the graph,
+ *       so it stays valid when the nodes are reordered
+ * @note The caller must call free_edge_grid() to free allocated memory
+ */
+error_code_t build_edge_grid(const Graph *graph, double cell_size_m, EdgeGrid **grid, error_info_t *err_info);
+
+/**
+ * Frees an edge grid.
+ *
+ * @param grid Pointer to the grid (NULL is allowed)
+ */
+void free_edge_grid(EdgeGrid *grid);
+
+/**
+ * Allocates the search state of one matching thread.
+ *
+ * @param graph Pointer to the graph structure
+ * @param workspace Pointer to store the workspace
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @note Per-node and per-edge state is stamped with a search ID, so the
+ *       workspace serves any number of traces without O(N) resets
+ * @note The workspace holds no arc streams: match_trace() reads the arcs and
+ *       the road filter anew, so filter changes and traffic batches between
+ *       traces take effect
+ * @note The caller must call free_match_workspace() to free allocated memory
+ */
+error_code_t create_match_workspace(const Graph *graph, MatchWorkspace **workspace, error_info_t *err_info);
+
+/**
+ * Frees a match workspace.
+ *
+ * @param workspace Pointer to the workspace (NULL is allowed)
+ */
+void free_match_workspace(MatchWorkspace *workspace);
+
+/**
+ * Matches a GPS trace to the road network: candidate edges near every fix,
+ * bounded shortest paths between consecutive candidate sets and Viterbi
+ * decoding of the most likely sequence.
+ *
+ * @param graph Pointer to the graph structure
+ * @param grid Edge grid of the graph
+ * @param workspace Workspace created for this graph, used by one thread at a time
+ * @param points GPS fixes in time order
+ * @param num_points Number of fixes (at least 1)
+ * @param params Model parameters (NULL for the defaults)
+ * @param trace Pointer to store the matched trace
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre The graph is neither pruned nor contracted: matches are reported per edge
+ * @post On success: every fix with a candidate is matched; where no route
+ *       connects two consecutive candidate sets a new segment starts
+ *       On failure: nothing is left allocated
+ * @note Routes are measured in meters over the distance arcs; avoided road
+ *       classes are neither candidates nor routed over
+ * @note Transition searches run once per distinct exit node of the candidate
+ *       set and stop once every entry node of the next set is settled
+ * @note The caller must call free_matched_trace() to free allocated memory
+ */
+error_code_t match_trace(Graph *graph, const EdgeGrid *grid, MatchWorkspace *workspace, const GeoPoint *points, int num_points, const MatchParams *params, MatchedTrace *trace, error_info_t *err_info);
+
+/**
+ * Matches independent traces on a pool of threads, each with its own workspace.
+ *
+ * @param graph Pointer to the graph structure
+ * @param grid Edge grid of the graph
+ * @param jobs Traces to match; each receives its matched trace or error
+ * @param num_jobs Number of traces
+ * @param params Model parameters shared by every trace (NULL for the defaults)
+ * @param num_threads Worker threads, 0 for one per online processor
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS once every job has run (check each job's err_code),
+ *         error code if the workspaces could not be allocated
+ *
+ * @note Workers take the next unmatched trace, so long traces do not hold up
+ *       a fixed share of the batch
+ * @note Every trace runs in its own traffic read section, so another thread
+ *       may publish live traffic batches meanwhile (see traffic_read_begin())
+ * @note The caller must call free_matched_trace() on every successful job
+ */
+error_code_t match_trace_batch(Graph *graph, const EdgeGrid *grid, MatchJob *jobs, int num_jobs, const MatchParams *params, int num_threads, error_info_t *err_info);
+
+/**
+ * Frees a matched trace.
+ *
+ * @param trace Pointer to the trace (NULL is allowed)
+ */
+void free_matched_trace(MatchedTrace *trace);
+
+#endif // MATCHING_H
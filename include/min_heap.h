@@ -0,0 +1,113 @@
+#ifndef MIN_HEAP_H
+#define MIN_HEAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "error_handling.h"
+
+// =================
+// MinHeap Data Structures
+// =================
+
+/**
+ * Priority queue entry: a node index keyed by its tentative distance in
+ * integer weight units (8 bytes per entry).
+ */
+typedef struct {
+  int node_index;
+  uint32_t distance;
+} HeapNode;
+
+/**
+ * Binary min-heap with lazy deletion: a node may be inserted again with a
+ * smaller distance and stale entries are skipped by the caller.
+ */
+typedef struct {
+  HeapNode *nodes;
+  int size;
+  int capacity;
+} MinHeap;
+
+// =================
+// MinHeap Function Prototypes
+// =================
+
+/**
+ * Creates a new min-heap with specified capacity.
+ * 
+ * @param heap Pointer to heap pointer to initialize
+ * @param capacity Initial number of elements the heap can hold
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre heap and err_info must be non-NULL
+ * @pre capacity must be positive
+ * @post On success: *heap points to a valid MinHeap structure
+ *       On failure: *heap is undefined
+ * @note The caller must call free_heap() to free allocated memory
+ */
+error_code_t create_heap(MinHeap **heap, int capacity, error_info_t *err_info);
+
+/**
+ * Frees memory allocated for MinHeap structure.
+ * 
+ * @param heap Pointer to MinHeap structure to free
+ * 
+ * @pre None
+ * @post All allocated memory in heap is freed
+ * @note Safe to call with NULL pointer
+ */
+void free_heap(MinHeap *heap);
+
+/**
+ * Checks if the heap is empty.
+ * 
+ * @param heap Pointer to MinHeap structure
+ * @return true if heap is empty, false otherwise
+ * 
+ * @pre heap must be non-NULL
+ */
+bool is_heap_empty(MinHeap *heap);
+
+/**
+ * Removes every entry, keeping the allocated capacity for reuse.
+ * 
+ * @param heap Pointer to MinHeap structure
+ * 
+ * @pre heap must be non-NULL
+ * @post heap is empty
+ */
+void clear_heap(MinHeap *heap);
+
+/**
+ * Inserts a new node into the min-heap.
+ * 
+ * @param heap Pointer to MinHeap structure
+ * @param node_index Index of the node to insert
+ * @param distance Distance value for the node (integer weight units)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre heap and err_info must be non-NULL
+ * @post Node is inserted and min-heap property is maintained
+ * @note The heap doubles its capacity when full, since lazy deletion can
+ *       hold more entries than there are nodes; growth is computed in size_t
+ *       and stops at INT_MAX entries, beyond which insertion fails
+ */
+error_code_t insert_heap(MinHeap *heap, int node_index, uint32_t distance, error_info_t *err_info);
+
+/**
+ * Extracts the minimum node from the heap.
+ * 
+ * @param heap Pointer to MinHeap structure
+ * @param min_node Pointer to store the extracted minimum node
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre heap, min_node, and err_info must be non-NULL
+ * @post Minimum node is extracted and min-heap property is maintained
+ * @note If heap is empty, min_node is set to invalid values
+ */
+error_code_t extract_min(MinHeap *heap, HeapNode *min_node, error_info_t *err_info);
+
+#endif // MIN_HEAP_H
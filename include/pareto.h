@@ -0,0 +1,101 @@
+#ifndef PARETO_H
+#define PARETO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+// Labels a Pareto search may create unless the caller sets another budget (16 bytes each)
+#define PARETO_DEFAULT_MAX_LABELS (1 << 22)
+
+// ==================
+// Pareto Routing Data Structures
+// ==================
+
+/**
+ * Limits of a Pareto search.
+ */
+typedef struct {
+  double epsilon;           // Drop routes at most (1 + epsilon) times slower than a shorter one already found, 0 for the exact front
+  int max_labels;           // Labels the search may create before it stops with a partial front
+} ParetoParams;
+
+/**
+ * A route of the front with both criteria along it.
+ */
+typedef struct {
+  int *nodes;               // Node indices from source to target
+  uint32_t *distances;      // Meters from the source to each node
+  uint32_t *times;          // Milliseconds from the source to each node
+  int length;               // Number of nodes
+} ParetoRoute;
+
+/**
+ * Routes no other route beats in both distance and travel time (see find_pareto_routes()).
+ */
+typedef struct {
+  ParetoRoute *routes;      // By increasing distance, hence decreasing travel time
+  int num_routes;           // Routes on the front
+  int num_labels;           // Labels created
+  int settled_count;        // Labels settled, including those of the two bound searches
+  bool truncated;           // The label budget ran out: the fastest end of the front may be missing
+} ParetoFront;
+
+// ==================
+// Pareto Routing Function Prototypes
+// ==================
+
+/**
+ * Fills in the default limits: the exact front and PARETO_DEFAULT_MAX_LABELS labels.
+ *
+ * @param params Pointer to the parameters to fill
+ */
+void default_pareto_params(ParetoParams *params);
+
+/**
+ * Finds the Pareto front of (distance, travel time) routes between two nodes
+ * with a bi-criteria label-setting search.
+ *
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param target_node_id ID of the target node
+ * @param params Search limits (NULL for the defaults)
+ * @param front Pointer to store the front
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph, front and err_info must be non-NULL, the graph must be neither
+ *      pruned nor contracted
+ * @pre source_node_id and target_node_id must exist and differ
+ * @post On success: front holds the routes found (none if the target is
+ *       unreachable), the first being a shortest and the last, unless
+ *       truncated, a fastest route
+ *       On failure: nothing is left allocated
+ * @note Two backward searches give the exact remaining distance and time of
+ *       every node. The forward search settles labels by distance plus
+ *       remaining distance, so target labels come out by increasing distance,
+ *       and drops a label when a label already settled at its node is not
+ *       slower, or when the fastest route found so far is at most
+ *       (1 + epsilon) times its time plus the remaining time
+ * @note epsilon only applies against target labels, so every exact Pareto
+ *       route has a front route that is not longer and at most (1 + epsilon)
+ *       times slower; the front has at most log(slowest / fastest) /
+ *       log(1 + epsilon) + 1 routes
+ * @note Labels live in one arena addressed by index and are freed together
+ * @note The caller must call free_pareto_front() to free allocated memory
+ */
+error_code_t find_pareto_routes(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, const ParetoParams *params, ParetoFront *front, error_info_t *err_info);
+
+/**
+ * Frees the routes of a Pareto front.
+ *
+ * @param front Pointer to the front (NULL is allowed)
+ */
+void free_pareto_front(ParetoFront *front);
+
+#endif // PARETO_H
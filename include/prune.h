@@ -0,0 +1,154 @@
+#ifndef PRUNE_H
+#define PRUNE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "error_handling.h"
+
+// ==================
+// Dead-End Pruning Data Structures
+// ==================
+
+/**
+ * Dead-end trees removed from the routing graph by prune_dead_end_trees().
+ * Core nodes (the 2-core plus one root per tree-shaped fragment) come first,
+ * followed by the pruned nodes with every parent placed before its children.
+ * Per-node arrays are indexed by node - num_core_nodes.
+ */
+typedef struct PruneIndex {
+  int num_core_nodes;       // Nodes kept in the routing graph
+  int num_pruned_nodes;     // Nodes on dead-end trees
+  int *parent;              // Neighbour towards the core
+  int *root;                // Core node the tree hangs off
+  int *depth;               // Links between the node and its root
+  uint32_t *link_up[WEIGHT_NUM_METRICS];   // Cheapest cost node -> parent, WEIGHT_INFINITY if none
+  uint32_t *link_down[WEIGHT_NUM_METRICS]; // Cheapest cost parent -> node, WEIGHT_INFINITY if none
+} PruneIndex;
+
+// ==================
+// Pruning Function Prototypes
+// ==================
+
+/**
+ * Removes dead-end trees from the routing graph, keeping its 2-core.
+ *
+ * @param graph Pointer to graph with nodes, edges and CSR loaded
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph and err_info must be non-NULL, graph must be neither pruned nor contracted
+ *      and must neither avoid road classes nor have weighting profiles
+ * @post On success: nodes are renumbered (core first, then pruned nodes),
+ *       graph->pruned is set and the CSR only holds arcs between core nodes
+ *       On failure: graph->pruned is NULL (the node order may have changed)
+ * @note Nodes are peeled while they have at most one distinct neighbour,
+ *       ignoring edge direction. A fragment that is a tree entirely keeps
+ *       its last node as root. Apply node reordering before pruning and
+ *       chain contraction after it
+ */
+error_code_t prune_dead_end_trees(Graph *graph, error_info_t *err_info);
+
+/**
+ * Frees a prune index.
+ *
+ * @param pruned Prune index to free (NULL is allowed)
+ */
+void free_prune_index(PruneIndex *pruned);
+
+/**
+ * Tells whether a node lies on a pruned dead-end tree.
+ *
+ * @param graph Pointer to the graph structure
+ * @param node_index Node index to test
+ * @return true if the graph is pruned and the node is not a core node
+ */
+bool is_pruned_node(const Graph *graph, int node_index);
+
+/**
+ * Returns the core node a node's tree hangs off (the node itself for core nodes).
+ */
+int prune_tree_root(const Graph *graph, int node_index);
+
+// ==================
+// Query Support Function Prototypes
+// ==================
+
+/**
+ * Computes the cost of the unique tree path between two nodes of the same tree.
+ *
+ * @param graph Pointer to pruned graph
+ * @param metric Weight metric
+ * @param from_index Start node
+ * @param to_index End node (same tree or its root)
+ * @return Path cost, WEIGHT_INFINITY if a link cannot be travelled in the needed
+ *         direction or the nodes hang off different roots
+ */
+uint32_t prune_tree_path_cost(const Graph *graph, WeightMetric metric, int from_index, int to_index);
+
+/**
+ * Settles a pruned source and its ancestors along the tree up to its root.
+ *
+ * @param graph Pointer to pruned graph
+ * @param metric Weight metric
+ * @param source_index Pruned source node
+ * @param result Initialized search result
+ * @return Cost of reaching the root (also stored in its distance),
+ *         WEIGHT_INFINITY if a link on the way up cannot be travelled upwards
+ *
+ * @post The source and its reachable pruned ancestors are visited with their
+ *       final costs and the next node down as predecessor; the root is not
+ *       visited and must be queued by the caller
+ */
+uint32_t prune_seed_source(const Graph *graph, WeightMetric metric, int source_index, DijkstraResult *result);
+
+/**
+ * Fills distances, predecessors and visited flags of pruned nodes after a
+ * full shortest path tree search on the core.
+ *
+ * @param graph Pointer to pruned graph
+ * @param metric Weight metric
+ * @param result Completed tree search result (core nodes and the source final)
+ *
+ * @post Pruned nodes hold their shortest cost and their tree neighbour on the
+ *       path from the source as predecessor
+ */
+void prune_fill_tree(const Graph *graph, WeightMetric metric, DijkstraResult *result);
+
+/**
+ * Expands a predecessor step along a tree path into the nodes it passes through.
+ *
+ * @param graph Pointer to pruned graph
+ * @param metric Weight metric
+ * @param distances Costs of the search (exact for from_index and to_index)
+ * @param from_index Predecessor node
+ * @param to_index Node reached from from_index
+ * @param nodes Output array for the intermediate nodes in travel order (may be NULL)
+ * @param costs Output array for their costs (may be NULL)
+ * @return Number of intermediate nodes, or -1 if the nodes are not on one
+ *         traversable tree path with a matching cost
+ *
+ * @note Output arrays must hold twice the depth of the deepest tree
+ */
+int prune_expand_step(const Graph *graph, WeightMetric metric, const uint32_t *distances, int from_index, int to_index, int *nodes, uint32_t *costs);
+
+/**
+ * Lists the nodes strictly between two nodes of the same tree along the
+ * tree path, without a search result to check costs against.
+ *
+ * @param graph Pointer to pruned graph
+ * @param metric Weight metric
+ * @param from_index Start node
+ * @param to_index End node (same tree or its root)
+ * @param from_cost Cost at from_index
+ * @param nodes Output array for the intermediate nodes in travel order (may be NULL)
+ * @param costs Output array for their costs (may be NULL)
+ * @return Number of intermediate nodes, or -1 if the nodes are not on one
+ *         traversable tree path
+ *
+ * @note Output arrays must hold twice the depth of the deepest tree
+ */
+int prune_expand_path(const Graph *graph, WeightMetric metric, int from_index, int to_index, uint32_t from_cost, int *nodes, uint32_t *costs);
+
+#endif // PRUNE_H
@@ -0,0 +1,97 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Node Order Definitions
+// ==================
+
+/**
+ * Node layouts that can be applied after loading. Node IDs move with their
+ * nodes and the hash table is updated, so callers working with node IDs are
+ * unaffected; only node indices change.
+ */
+typedef enum {
+  NODE_ORDER_FILE = 0,      // Keep the order of nodes.bin
+  NODE_ORDER_HILBERT = 1,   // Sort nodes along a Hilbert curve over their coordinates
+  NODE_ORDER_BFS = 2        // Breadth-first order over the road network
+} NodeOrder;
+
+// ==================
+// Reordering Function Prototypes
+// ==================
+
+/**
+ * Parses a node order name ("file", "hilbert" or "bfs").
+ * 
+ * @param name Order name to parse
+ * @param order Pointer to store the parsed order
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, ERR_INVALID_ARGUMENT for unknown names
+ * 
+ * @pre All pointers must be non-NULL
+ * @post On success: *order holds the parsed value
+ */
+error_code_t parse_node_order(const char *name, NodeOrder *order, error_info_t *err_info);
+
+/**
+ * Returns the name of a node order.
+ * 
+ * @param order Node order
+ * @return Static string naming the order
+ */
+const char *node_order_name(NodeOrder order);
+
+/**
+ * Computes a node permutation that improves memory locality.
+ * 
+ * @param graph Pointer to graph with nodes and CSR loaded
+ * @param order Layout to compute
+ * @param new_to_old Array of graph->num_nodes entries; new_to_old[i] is the
+ *        current index of the node that will be placed at index i
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL, new_to_old must hold num_nodes entries
+ * @post On success: new_to_old is a permutation of [0, num_nodes)
+ * @note Hilbert order only needs coordinates; BFS order walks the CSR and
+ *       starts a new traversal from every node not reached yet
+ */
+error_code_t compute_node_order(Graph *graph, NodeOrder order, int *new_to_old, error_info_t *err_info);
+
+/**
+ * Permutes the nodes of a graph and rebuilds all index-based structures.
+ * 
+ * @param graph Pointer to graph with nodes and CSR loaded
+ * @param new_to_old Permutation as produced by compute_node_order()
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre All pointers must be non-NULL, new_to_old must be a valid permutation
+ * @post On success: nodes array, hash table indices and CSR follow the new order
+ *       On failure: graph content is undefined
+ * @note Edges keep their file order so edge indices remain stable
+ * @note Fails with ERR_INVALID_ARGUMENT on graphs with contracted chains, and
+ *       on pruned graphs unless every pruned node keeps its index
+ */
+error_code_t apply_node_permutation(Graph *graph, const int *new_to_old, error_info_t *err_info);
+
+/**
+ * Reorders the nodes of a graph for cache locality.
+ * 
+ * @param graph Pointer to graph with nodes and CSR loaded
+ * @param order Layout to apply (NODE_ORDER_FILE is a no-op)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre graph and err_info must be non-NULL
+ * @post On success: the graph uses the requested node layout
+ *       On failure: graph content is undefined
+ * @note Neighbouring nodes end up close in distances, visited and adj_offsets,
+ *       which reduces cache misses during relaxation
+ */
+error_code_t reorder_graph_nodes(Graph *graph, NodeOrder order, error_info_t *err_info);
+
+#endif // REORDER_H
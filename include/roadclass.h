@@ -0,0 +1,137 @@
+#ifndef ROADCLASS_H
+#define ROADCLASS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+// Bit of a road class (HighwayType) in a class set
+#define ROAD_CLASS_BIT(type) ((uint16_t)(1u << (type)))
+
+// Every road class
+#define ROAD_CLASSES_ALL ((uint16_t)((1u << HIGHWAY_NUM_TYPES) - 1))
+
+// Major roads: motorways, trunk, primary and secondary roads
+#define ROAD_CLASSES_MAJOR ((uint16_t)(ROAD_CLASS_BIT(HIGHWAY_MOTORWAY) | ROAD_CLASS_BIT(HIGHWAY_TRUNK) | \
+                                       ROAD_CLASS_BIT(HIGHWAY_PRIMARY) | ROAD_CLASS_BIT(HIGHWAY_SECONDARY)))
+
+// Everything else (avoiding these keeps trucks on major roads)
+#define ROAD_CLASSES_MINOR ((uint16_t)(ROAD_CLASSES_ALL & ~ROAD_CLASSES_MAJOR))
+
+// ==================
+// Road Class Filter Data Structures
+// ==================
+
+/**
+ * Road classes avoided by every search on a graph, attached by
+ * set_avoided_road_classes(). One bitset per class marks the CSR positions
+ * of its arcs, so changing the avoided classes only ORs bitsets together,
+ * and searches test one bit of the combined set per arc.
+ */
+typedef struct RoadFilter {
+  uint16_t avoided_classes; // Avoided classes, one ROAD_CLASS_BIT per HighwayType
+  uint64_t *class_arcs[HIGHWAY_NUM_TYPES]; // Bit i set if CSR arc i is of the class
+  uint64_t *avoided_arcs;   // Union of the avoided classes' bitsets, NULL if no class is avoided
+  edge_index_t num_avoided_arcs; // Arcs set in avoided_arcs
+  size_t num_words;         // 64-bit words per bitset
+} RoadFilter;
+
+// ==================
+// Search Support
+// ==================
+
+/**
+ * Returns the class of a highway type, mapping unknown codes to HIGHWAY_UNKNOWN.
+ */
+static inline uint8_t road_class_of(uint8_t highway_type) {
+  return highway_type < HIGHWAY_NUM_TYPES ? highway_type : HIGHWAY_UNKNOWN;
+}
+
+/**
+ * Returns the avoided arcs searches must skip, NULL if nothing is avoided.
+ */
+static inline const uint64_t *road_filter_arcs(const Graph *graph) {
+  return graph->filter != NULL ? graph->filter->avoided_arcs : NULL;
+}
+
+/**
+ * Tells whether the arc at a CSR position is avoided.
+ */
+static inline bool is_arc_avoided(const uint64_t *avoided_arcs, edge_index_t arc) {
+  return (avoided_arcs[(size_t)arc >> 6] >> ((size_t)arc & 63)) & 1;
+}
+
+/**
+ * Tells whether a road class is avoided on a graph.
+ */
+static inline bool is_road_class_avoided(const Graph *graph, uint8_t highway_type) {
+  return graph->filter != NULL && (graph->filter->avoided_classes & ROAD_CLASS_BIT(road_class_of(highway_type))) != 0;
+}
+
+// ==================
+// Road Class Filter Function Prototypes
+// ==================
+
+/**
+ * Parses a comma-separated list of road classes.
+ *
+ * @param text Class names: unknown, motorway, trunk, primary, secondary,
+ *        tertiary, unclassified, residential, service, or the groups major
+ *        and minor
+ * @param classes Pointer to store the class set (ROAD_CLASS_BIT per class)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, ERR_INVALID_ARGUMENT for unknown names
+ *
+ * @pre All pointers must be non-NULL
+ */
+error_code_t parse_road_classes(const char *text, uint16_t *classes, error_info_t *err_info);
+
+/**
+ * Sets the road classes every search on the graph avoids.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param classes Classes to avoid (ROAD_CLASS_BIT per class), 0 to avoid none
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph and err_info must be non-NULL, graph must not be pruned
+ * @post On success: searches skip the arcs of the avoided classes and
+ *       graph->weight_version is incremented (open sessions must be reopened)
+ *       On failure: the avoided classes are unchanged
+ * @note The first call builds the per-class bitsets (one pass over the arcs,
+ *       HIGHWAY_NUM_TYPES bits per arc); later calls only combine them.
+ *       Routes never use an avoided road, so endpoints reachable only over
+ *       avoided roads are unreachable
+ * @note Node reordering and chain contraction keep the avoided classes;
+ *       contracted chains have a single class. Pruned dead-end trees merge
+ *       parallel edges of different classes, so pruning is refused while
+ *       classes are avoided
+ */
+error_code_t set_avoided_road_classes(Graph *graph, uint16_t classes, error_info_t *err_info);
+
+/**
+ * Rebuilds the bitsets of a graph's road filter after its CSR changed.
+ *
+ * @param graph Pointer to graph with the new CSR built
+ * @param chains Chains whose arcs the CSR holds, NULL if it has none
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @post Does nothing for graphs without a road filter
+ */
+error_code_t rebuild_road_filter(Graph *graph, const struct ChainIndex *chains, error_info_t *err_info);
+
+/**
+ * Frees a road filter.
+ *
+ * @param filter Road filter to free (NULL is allowed)
+ */
+void free_road_filter(RoadFilter *filter);
+
+#endif // ROADCLASS_H
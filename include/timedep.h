@@ -0,0 +1,191 @@
+#ifndef TIMEDEP_H
+#define TIMEDEP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+// Profile factor units: a factor of PROFILE_FACTOR_ONE keeps the free-flow travel time
+#define PROFILE_FACTOR_ONE 1024
+
+// Breakpoint times are minutes of the day
+#define PROFILE_MINUTES_PER_DAY 1440
+
+// Travel times repeat every day (milliseconds)
+#define PROFILE_DAY_MS 86400000u
+
+// ==================
+// Time-Dependent Data Structures
+// ==================
+
+/**
+ * Breakpoint of a travel time profile, quantized to 4 bytes.
+ */
+typedef struct {
+  uint16_t minute;          // Minute of the day (0-1439)
+  uint16_t factor;          // Travel time factor in 1/PROFILE_FACTOR_ONE units
+} ProfilePoint;
+
+/**
+ * Travel time profiles of a graph, attached by load_time_profiles(). Edges
+ * share a pool of daily profiles: the travel time of an edge entered at time
+ * t is its free-flow time scaled by its profile's factor at t, interpolated
+ * linearly between breakpoints and wrapping around midnight.
+ */
+typedef struct TimeProfiles {
+  uint32_t *profile_offsets; // Breakpoints of profile p are points[profile_offsets[p]..profile_offsets[p + 1])
+  ProfilePoint *points;      // Breakpoints of all profiles by increasing minute
+  uint16_t *min_factor;      // Smallest factor of each profile
+  double *max_fall;          // Steepest fall of each profile in factor units per millisecond (FIFO check)
+  int num_profiles;          // Profiles in the pool
+  uint16_t *edge_profile;    // Profile of each edge plus one, 0 for free flow (2 bytes per edge)
+  edge_index_t num_assigned; // Edges with a profile
+  double min_ms_per_meter;   // Lower bound on travel time per meter of straight-line distance (A* potentials)
+} TimeProfiles;
+
+// ==================
+// Time-Dependent Function Prototypes
+// ==================
+
+/**
+ * Parses a time of day written as HH:MM or HH:MM:SS.
+ *
+ * @param text Time to parse
+ * @param time_of_day_ms Pointer to store the milliseconds since midnight
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, ERR_INVALID_ARGUMENT for malformed times
+ *
+ * @pre All pointers must be non-NULL
+ * @post On success: *time_of_day_ms is below PROFILE_DAY_MS
+ */
+error_code_t parse_time_of_day(const char *text, uint32_t *time_of_day_ms, error_info_t *err_info);
+
+/**
+ * Loads travel time profiles from a binary file into the graph.
+ *
+ * @param graph Pointer to graph with edges loaded
+ * @param filename Path to the profile file
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre All pointers must be non-NULL
+ * @post On success: graph->profiles is set (replacing previous profiles)
+ *       On failure: graph->profiles is unchanged
+ * @note File layout: uint32_t profile count; per profile a uint32_t
+ *       breakpoint count followed by ProfilePoint records with strictly
+ *       increasing minutes; then a uint32_t assignment count followed by
+ *       (uint32_t edge index, uint32_t profile index) pairs. Edge indices
+ *       follow the order of edges.bin
+ * @note Fails with ERR_INVALID_DATA unless every assigned edge is FIFO
+ *       (entering later never means arriving earlier), i.e. no profile
+ *       falls faster than one millisecond of travel time per millisecond
+ * @note At most 65535 profiles; factors must be positive
+ * @note Under live traffic the FIFO check also covers the current time weights
+ */
+error_code_t load_time_profiles(Graph *graph, const char *filename, error_info_t *err_info);
+
+/**
+ * Frees travel time profiles.
+ *
+ * @param profiles Profiles to free (NULL is allowed)
+ */
+void free_time_profiles(TimeProfiles *profiles);
+
+/**
+ * Computes the travel time of an edge entered at a time of day.
+ *
+ * @param profiles Travel time profiles (NULL for free flow)
+ * @param edge_idx Index of the edge
+ * @param free_flow_ms Free-flow travel time of the edge in milliseconds
+ * @param time_of_day_ms Entry time in milliseconds since midnight (any value, taken modulo a day)
+ * @return Travel time in milliseconds, rounded up (clamped below WEIGHT_INFINITY)
+ */
+uint32_t profile_travel_time(const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms, uint32_t time_of_day_ms);
+
+/**
+ * Checks that an edge stays FIFO under its profile with a given free-flow time.
+ *
+ * @param profiles Travel time profiles
+ * @param edge_idx Index of the edge
+ * @param free_flow_ms Free-flow travel time of the edge in milliseconds
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS if the edge is FIFO (or has no profile, or is closed),
+ *         ERR_INVALID_DATA otherwise
+ *
+ * @note Live traffic checks slowed-down edges with it before publishing
+ */
+error_code_t check_profile_travel_time(const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms, error_info_t *err_info);
+
+/**
+ * Returns the A* bound admissible for an edge with a given free-flow time.
+ *
+ * @param graph Pointer to the graph structure
+ * @param profiles Travel time profiles of the graph (NULL is allowed)
+ * @param edge_idx Index of the edge
+ * @param free_flow_ms Free-flow travel time of the edge in milliseconds
+ * @return Travel time per meter of straight-line distance, INFINITY for
+ *         zero-length or closed edges
+ */
+double edge_speed_bound(Graph *graph, const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms);
+
+/**
+ * Lowers the A* bound of the profiles to a new value. The bound is never
+ * raised.
+ *
+ * @param profiles Travel time profiles of the graph (NULL is allowed)
+ * @param ms_per_meter Bound to lower to, e.g. the least edge_speed_bound() of a batch
+ * @note The bound is updated atomically, so queries may read it meanwhile;
+ *       live traffic lowers it once per batch, before publishing the batch
+ */
+void lower_profile_speed_bound(TimeProfiles *profiles, double ms_per_meter);
+
+/**
+ * Attaches free-flow profiles to a graph without profiles, to hold the A*
+ * bound of time-dependent queries.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param profiles Set to the profiles of the graph, attached or not
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @note Queries and traffic batches may race to attach them; one set wins.
+ *       Live traffic attaches them before its first batch, so the bound
+ *       only ever has to cover streams published after it was computed
+ */
+error_code_t attach_free_flow_profiles(Graph *graph, TimeProfiles **profiles, error_info_t *err_info);
+
+/**
+ * Finds the fastest path for a departure time with time-dependent travel times.
+ *
+ * @param graph Pointer to the graph structure
+ * @param source_node_id ID of the source node
+ * @param target_node_id ID of the target node
+ * @param departure_ms Departure time in milliseconds since midnight
+ * @param goal_directed Whether to run A* with straight-line lower bounds instead of Dijkstra
+ * @param result Pointer to store the algorithm results
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph, result and err_info must be non-NULL, source and target must differ
+ * @pre graph must be neither pruned nor contracted
+ * @post On success: result is a DIJKSTRA_FASTEST_TIME result whose costs are
+ *       durations since departure, so get_shortest_path() and
+ *       get_shortest_distance() work as usual
+ * @note Profiles are FIFO, so the earliest arrival at a node is the only one
+ *       worth continuing from and the search stays label-setting. Without
+ *       loaded profiles travel times are the current time weights, and
+ *       profiles scale the live traffic weights where present
+ * @note A* potentials are the great-circle distance to the target times
+ *       min_ms_per_meter. The bound costs one pass over the edges, done at
+ *       load time; on a graph without profiles the first goal-directed query
+ *       or traffic batch attaches free-flow profiles to hold it
+ */
+error_code_t dijkstra_time_dependent(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, uint32_t departure_ms, bool goal_directed, DijkstraResult *result, error_info_t *err_info);
+
+#endif // TIMEDEP_H
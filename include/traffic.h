@@ -0,0 +1,174 @@
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <stdint.h>
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+// Update speed closing the edge in both metrics
+#define TRAFFIC_SPEED_CLOSED 0
+
+// Update speed restoring the speed limit of edges.bin
+#define TRAFFIC_SPEED_RESTORE UINT16_MAX
+
+// ==================
+// Live Traffic Data Structures
+// ==================
+
+/**
+ * Live speed of one edge, as stored in the binary traffic file after a
+ * uint32_t record count.
+ */
+typedef struct {
+  uint32_t edge_index;      // Position of the edge in edges.bin
+  uint16_t speed_kmh;       // Current speed in km/h, TRAFFIC_SPEED_CLOSED or TRAFFIC_SPEED_RESTORE
+  uint16_t reserved;        // Padding, must be zero
+} TrafficUpdate;
+
+/**
+ * Double buffer for the arc weights, attached by the first traffic batch.
+ * Queries read graph->adj_arcs; a batch is written into the spare streams,
+ * which are then swapped in with release stores, so a query never sees half
+ * of a batch. The spare streams are the ones the batch before replaced, so a
+ * batch first waits for the read sections that may still hold them to end
+ * (see traffic_read_begin()). Only the arcs of updated edges are written,
+ * once per buffer. The arc streams of weighting profiles are double-buffered
+ * the same way.
+ */
+typedef struct TrafficOverlay {
+  Arc *spare[WEIGHT_NUM_METRICS]; // Arc streams queries do not read (previous weights)
+  Arc **weighting_spare;    // Spare stream per weighting profile, NULL until a batch meets profiles
+  int num_weighting_spares; // Profiles weighting_spare covers
+  uint16_t *live_speed;     // Last update speed per edge, TRAFFIC_SPEED_RESTORE if none
+  edge_index_t *stale;      // Arc positions the spare streams miss from the last batch
+  size_t num_stale;         // Positions in stale
+  size_t stale_capacity;    // Allocated positions in stale
+  uint32_t num_batches;     // Batches published
+  int last_batch_edges;     // Edges updated by the last batch
+  size_t last_batch_arcs;   // Arcs written by the last batch (per buffer and metric)
+} TrafficOverlay;
+
+// ==================
+// Live Traffic Function Prototypes
+// ==================
+
+/**
+ * Publishes a batch of live edge speeds.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param updates Live speeds to apply (later entries win for repeated edges)
+ * @param num_updates Number of updates
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph, err_info and (if num_updates > 0) updates must be non-NULL
+ * @pre graph must be neither pruned nor contracted
+ * @post On success: time weights of the updated edges follow their live
+ *       speed, closed edges weigh WEIGHT_INFINITY in every metric and
+ *       weighting profile, restored edges are back to their edges.bin
+ *       weights, and graph->weight_version is incremented. Weighting profile
+ *       costs take the live speed as their travel time term
+ *       On failure: no weight has changed
+ * @note Costs O(updates * (1 + profiles) + arcs of updated edges); adj_offsets
+ *       and adj_indices are untouched. The first batch allocates the spare arc
+ *       streams, which doubles the memory of the packed arcs and of the
+ *       weighting profile streams, and attaches free-flow profiles to a
+ *       graph without travel time profiles (see attach_free_flow_profiles())
+ * @note Batches may be published while other threads query: every query
+ *       runs in a read section (see traffic_read_begin()), and the batch
+ *       waits for the sections that may still read the streams it recycles.
+ *       The A* bound of time-dependent queries is lowered for the batch
+ *       before it is published. Batches themselves come from one thread at
+ *       a time
+ * @note Rebuilding the CSR (node reordering, pruning, contraction) returns
+ *       to edges.bin weights and drops the overlay, so apply layout steps
+ *       first; like loading profiles or changing the avoided road classes,
+ *       they must not overlap queries
+ */
+error_code_t apply_traffic_updates(Graph *graph, const TrafficUpdate *updates, int num_updates, error_info_t *err_info);
+
+/**
+ * Reads a traffic file and publishes it as one batch.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param filename Path to the traffic file
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre Same as apply_traffic_updates()
+ * @post Same as apply_traffic_updates(); a file that cannot be read or
+ *       names an unknown edge changes nothing
+ * @note A feed writing the file every minute keeps the router current
+ *       without reloading the graph
+ */
+error_code_t load_traffic_updates(Graph *graph, const char *filename, error_info_t *err_info);
+
+/**
+ * Enters a read section: the arc streams are pinned on the calling thread
+ * when the outermost section starts, every stream loaded inside it comes
+ * from the same traffic batch, and later batches do not recycle them until
+ * the section ends.
+ *
+ * @param graph Pointer to graph structure (NULL is allowed and pins nothing)
+ * @return Ticket to pass to traffic_read_end()
+ *
+ * @note Every public query opens its own section, so callers only need one
+ *       to keep several queries on one batch
+ * @note Sections nest. A nested section for the same graph costs nothing;
+ *       one for another graph holds back its batches but pins no streams
+ * @note Costs two atomic operations plus one load per stream and waits only
+ *       for the few stores of a batch swap, so queries run on any number of
+ *       threads while one thread publishes batches
+ * @note Sections must be short-lived: a batch published while one is open
+ *       completes, but the batch after it waits for the section to end. A
+ *       thread must not publish a batch for a graph while in a section for it
+ */
+int traffic_read_begin(Graph *graph);
+
+/**
+ * Leaves a read section.
+ *
+ * @param graph Pointer to graph structure passed to traffic_read_begin()
+ * @param ticket Value returned by traffic_read_begin()
+ */
+void traffic_read_end(Graph *graph, int ticket);
+
+/**
+ * Returns a stream pinned by the read section of the calling thread.
+ *
+ * @param graph Pointer to graph structure
+ * @param stream Weight metric, or WEIGHT_NUM_METRICS plus a weighting profile
+ * @return The pinned stream, NULL outside a section for graph
+ * @note dijkstra_mode_arcs() uses it, so queries need not call it directly
+ */
+const Arc *traffic_section_arcs(const Graph *graph, int stream);
+
+/**
+ * Frees a traffic overlay.
+ *
+ * @param traffic Overlay to free (NULL is allowed)
+ */
+void free_traffic_overlay(TrafficOverlay *traffic);
+
+/**
+ * Drops the traffic overlay of a graph, e.g. because its CSR is rebuilt.
+ *
+ * @param graph Pointer to graph structure
+ * @note The arc streams queries read stay with the graph
+ */
+void drop_traffic_overlay(Graph *graph);
+
+/**
+ * Releases the spare weighting profile streams of the traffic overlay.
+ *
+ * @param graph Pointer to graph structure
+ * @note Called by load_weighting_profiles() when it replaces the profiles;
+ *       the next batch copies the new streams
+ */
+void drop_traffic_weightings(Graph *graph);
+
+#endif // TRAFFIC_H
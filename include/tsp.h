@@ -0,0 +1,138 @@
+#ifndef TSP_H
+#define TSP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "waypoints.h"
+#include "error_handling.h"
+
+// ==================
+// Stop Ordering Data Structures
+// ==================
+
+/**
+ * How a visiting order is searched for.
+ */
+typedef struct {
+  bool round_trip;          // Return to the first stop; otherwise the last stop stays last
+  double time_limit_ms;     // Stop improving the order after this long, 0 for no limit
+} TspParams;
+
+/**
+ * Visiting order of a set of stops with its costs over the stop matrix.
+ */
+typedef struct {
+  uint64_t initial_cost;    // Cost of the nearest neighbour order
+  uint64_t cost;            // Cost of the improved order
+  int improvements;         // 2-opt and Or-opt moves applied
+  bool timed_out;           // The time limit stopped the improvement early
+} TspStats;
+
+/**
+ * A solved stop ordering problem (see find_tsp_tour()).
+ */
+typedef struct {
+  WaypointRoute route;      // Ordered route with full geometry; stop_order indexes the input stops
+  TspStats stats;           // Cost of the order before and after improvement
+} TspTour;
+
+/**
+ * One problem of a batch (see solve_tsp_batch()): the stops in, the tour
+ * and the outcome out.
+ */
+typedef struct {
+  const uint32_t *stop_ids; // Node IDs of the stops, the first being the depot
+  int num_stops;            // Number of stops
+  TspTour tour;             // Solved tour, valid when err_code is ERR_SUCCESS
+  error_code_t err_code;    // Outcome of this problem
+  error_info_t err_info;    // Error details when err_code is not ERR_SUCCESS
+} TspJob;
+
+// ==================
+// Stop Ordering Function Prototypes
+// ==================
+
+/**
+ * Fills in the default parameters: a round trip without time limit.
+ *
+ * @param params Pointer to the parameters to fill
+ */
+void default_tsp_params(TspParams *params);
+
+/**
+ * Orders stops over a cost matrix: nearest neighbour construction, then
+ * 2-opt and Or-opt moves until none improves the order.
+ *
+ * @param matrix num_stops x num_stops row-major cost matrix (may be asymmetric)
+ * @param num_stops Number of stops (at least 1)
+ * @param params Search parameters (NULL for the defaults)
+ * @param order Out: stop positions in visiting order, num_stops + 1 entries
+ *        for a round trip (the first stop is repeated at the end), num_stops otherwise
+ * @param stats Pointer to store the costs of the order (NULL is allowed)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @post The first stop is visited first, and last unless it is an open
+ *       route, whose last stop stays last
+ * @note Moves are evaluated in O(1) on an asymmetric matrix: prefix sums of
+ *       the tour cost in both directions give the cost of a reversed segment
+ * @note Each pass applies the best move found; the time limit is checked
+ *       between passes
+ */
+error_code_t solve_stop_order(const uint32_t *matrix, int num_stops, const TspParams *params, int *order, TspStats *stats, error_info_t *err_info);
+
+/**
+ * Computes the stop matrix with the routing engine, orders the stops and
+ * routes the tour with full geometry.
+ *
+ * @param graph Pointer to the graph structure
+ * @param stop_ids Node IDs of the stops, the first being the depot
+ * @param num_stops Number of stops (2 to WAYPOINT_MAX_STOPS - 1)
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param params Search parameters (NULL for the defaults)
+ * @param tour Pointer to store the tour
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre Same stop requirements as find_waypoint_route()
+ * @post On success: tour->route is the route in the solved order (see
+ *       find_waypoint_route() for unreachable legs) and its input_order_cost
+ *       is the matrix cost of the input order
+ *       On failure: nothing is left allocated
+ * @note Only reads the graph, so tours may be solved concurrently on a graph
+ *       that is not modified meanwhile
+ * @note The caller must call free_tsp_tour() to free allocated memory
+ */
+error_code_t find_tsp_tour(Graph *graph, const uint32_t *stop_ids, int num_stops, DijkstraMode mode, const TspParams *params, TspTour *tour, error_info_t *err_info);
+
+/**
+ * Solves independent tours on a pool of threads.
+ *
+ * @param graph Pointer to the graph structure
+ * @param jobs Problems to solve; each receives its tour or error
+ * @param num_jobs Number of problems
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param params Search parameters shared by every problem (NULL for the defaults)
+ * @param num_threads Worker threads, 0 for one per online processor
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS once every job has run (check each job's err_code),
+ *         error code if the workers could not be started
+ *
+ * @note Workers take the next unsolved job, so long tours do not hold up a
+ *       fixed share of the batch. The time limit applies to each problem
+ * @note Every job runs in its own traffic read section, so another thread
+ *       may publish live traffic batches meanwhile (see traffic_read_begin())
+ * @note The caller must call free_tsp_tour() on every successful job
+ */
+error_code_t solve_tsp_batch(Graph *graph, TspJob *jobs, int num_jobs, DijkstraMode mode, const TspParams *params, int num_threads, error_info_t *err_info);
+
+/**
+ * Frees a tour.
+ *
+ * @param tour Pointer to the tour (NULL is allowed)
+ */
+void free_tsp_tour(TspTour *tour);
+
+#endif // TSP_H
@@ -0,0 +1,185 @@
+#ifndef TURNS_H
+#define TURNS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "kpaths.h"
+#include "error_handling.h"
+
+// ==================
+// Turn Restriction Data Structures
+// ==================
+
+/**
+ * Kinds of turn restrictions, following the OSM restriction tag prefixes.
+ */
+typedef enum {
+  TURN_RESTRICTION_NO = 0,   // no_left_turn, no_u_turn, ...: this turn is banned
+  TURN_RESTRICTION_ONLY = 1  // only_straight_on, ...: this is the only turn allowed
+} TurnRestrictionType;
+
+/**
+ * Turn restriction record as stored in the binary restriction file, after a
+ * uint32_t record count. OSM from/to ways are given by their nodes next to
+ * the via node, so the record names the junction by three node IDs.
+ */
+typedef struct {
+  uint32_t from_node;       // Node before the via node on the incoming road
+  uint32_t via_node;        // Junction the restriction applies at
+  uint32_t to_node;         // Node after the via node on the outgoing road
+  uint8_t type;             // TurnRestrictionType
+  uint8_t reserved[3];      // Padding, must be zero
+} TurnRestriction;
+
+/**
+ * A restricted turn between two edges at its via node.
+ */
+typedef struct {
+  edge_index_t from_edge;   // Edge arriving at the via node
+  edge_index_t to_edge;     // Edge leaving the via node
+  uint8_t type;             // TurnRestrictionType
+} TurnEntry;
+
+/**
+ * Turn restrictions of a graph, attached by load_turn_restrictions() and
+ * grouped by via node. Nodes without restrictions have an empty range, so
+ * the search checks them with a single comparison.
+ */
+typedef struct TurnIndex {
+  int *via_offsets;         // Restrictions at node v are entries[via_offsets[v]..via_offsets[v + 1])
+  TurnEntry *entries;       // Restricted turns grouped by via node
+  int num_entries;          // Restricted turns stored
+  int num_via_nodes;        // Nodes with at least one restriction
+  int num_ignored;          // File records whose nodes or edges are not in the graph
+  uint32_t u_turn_cost[WEIGHT_NUM_METRICS]; // Cost of turning back along the arrival edge, WEIGHT_INFINITY bans it
+} TurnIndex;
+
+/**
+ * A route found by turn_shortest_path(). A route may pass a junction twice,
+ * e.g. to make up for a banned left turn, which a node tree cannot express.
+ */
+typedef struct {
+  RoutePath path;           // Nodes and costs from source to target (length 0 if unreachable)
+  bool target_found;        // Whether the target is reachable under the restrictions
+  DijkstraMode mode;        // Mode the costs were computed in
+  int settled_count;        // Arc labels settled
+} TurnRoute;
+
+// Arc labels reused across turn-aware searches (see turns.c)
+typedef struct TurnWorkspace TurnWorkspace;
+
+// ==================
+// Turn Restriction Function Prototypes
+// ==================
+
+/**
+ * Loads turn restrictions from a binary file into the graph.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param filename Path to the restriction file
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre All pointers must be non-NULL, graph must be neither pruned nor contracted
+ * @post On success: graph->turns is set (replacing a previous index) with
+ *       the default U-turn costs (see set_u_turn_cost())
+ *       On failure: graph->turns is unchanged
+ * @note A record becomes one entry per matching pair of parallel edges.
+ *       Records naming unknown nodes or nodes without a travelable edge
+ *       between them are counted in num_ignored, as extracts clipped from a
+ *       larger region reference roads outside it
+ * @note Node reordering keeps the index; it must be loaded before pruning or
+ *       chain contraction, whose routing arcs no longer map to single edges
+ */
+error_code_t load_turn_restrictions(Graph *graph, const char *filename, error_info_t *err_info);
+
+/**
+ * Sets the cost of turning back along the arrival edge.
+ *
+ * @param graph Pointer to graph with turn restrictions loaded
+ * @param metric Weight metric
+ * @param cost Cost in the metric's unit, WEIGHT_INFINITY to ban U-turns
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @note Defaults are 0 for distance and 30 s for time. Banning U-turns makes
+ *       dead ends a trap: routes cannot turn around at them
+ */
+error_code_t set_u_turn_cost(Graph *graph, WeightMetric metric, uint32_t cost, error_info_t *err_info);
+
+/**
+ * Frees a turn index.
+ *
+ * @param turns Turn index to free (NULL is allowed)
+ */
+void free_turn_index(TurnIndex *turns);
+
+/**
+ * Moves turn restrictions to the new node order of a renumbered graph.
+ *
+ * @param turns Turn index to update
+ * @param num_nodes Number of nodes
+ * @param new_to_old Old node index at each new position
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @note Called by apply_node_permutation(); entries refer to edges, which
+ *       keep their indices
+ */
+error_code_t permute_turn_index(TurnIndex *turns, int num_nodes, const int *new_to_old, error_info_t *err_info);
+
+/**
+ * Allocates the arc labels of turn-aware searches on a graph.
+ *
+ * @param graph Pointer to the graph structure
+ * @param workspace Pointer to store the workspace
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @note Labels are stamped with a search ID, so the workspace serves any
+ *       number of queries without O(arcs) resets
+ * @note The caller must call free_turn_workspace() to free allocated memory
+ */
+error_code_t create_turn_workspace(const Graph *graph, TurnWorkspace **workspace, error_info_t *err_info);
+
+/**
+ * Frees a turn workspace.
+ *
+ * @param workspace Pointer to the workspace (NULL is allowed)
+ */
+void free_turn_workspace(TurnWorkspace *workspace);
+
+/**
+ * Finds a cheapest route that obeys the turn restrictions of the graph.
+ *
+ * @param graph Pointer to the graph structure
+ * @param workspace Workspace created for this graph, used by one thread at a
+ *        time (NULL allocates labels for this query only)
+ * @param source_node_id ID of the source node
+ * @param target_node_id ID of the target node
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param route Pointer to store the route
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre graph, route and err_info must be non-NULL, source and target must differ
+ * @pre graph must be neither pruned nor contracted
+ * @post On success: route holds the route if the target is reachable
+ * @note The search is edge-based: labels belong to arcs, so the cost of
+ *       leaving a junction may depend on how it was entered. Without loaded
+ *       restrictions only the default U-turn costs apply, which never change
+ *       a cheapest route, and costs match dijkstra_shortest_path()
+ * @note The caller must call free_turn_route() to free allocated memory
+ */
+error_code_t turn_shortest_path(Graph *graph, TurnWorkspace *workspace, uint32_t source_node_id, uint32_t target_node_id, DijkstraMode mode, TurnRoute *route, error_info_t *err_info);
+
+/**
+ * Frees the path of a turn-aware route.
+ *
+ * @param route Pointer to the route (NULL is allowed)
+ */
+void free_turn_route(TurnRoute *route);
+
+#endif // TURNS_H
@@ -14,6 +14,7 @@ typedef struct {
     double latitude;         // Node latitude coordinate
     double longitude;        // Node longitude coordinate
     double distance_km;      // Distance from target point in kilometers
+    bool main_component;     // Node is in the largest strongly connected component
 } NodeDistance;
 
 // ================
@@ -35,6 +36,19 @@ typedef struct {
  */
 double haversine_distance(double lat1, double lon1, double lat2, double lon2);
 
+/**
+ * Calculates the great-circle distance between two graph nodes.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param from_index Index of the first node
+ * @param to_index Index of the second node
+ * @return Distance in kilometers
+ * 
+ * @pre Both indices must be valid node indices of graph
+ * @note Converts the fixed-point node coordinates to degrees and applies haversine_distance()
+ */
+double node_distance_km(Graph *graph, int from_index, int to_index);
+
 /**
  * Comparison function for sorting NodeDistance structures by distance.
  * 
@@ -112,7 +126,10 @@ void print_usage(const char *program_name);
  * @pre count and nodes must be non-NULL
  * @post On success: *nodes contains up to 5 nearest nodes, *count set appropriately
  *       On failure: *nodes is NULL, *count is undefined
- * @note Caller is responsible for freeing the returned nodes array
+ * @note Caller is responsible for freeing the returned nodes array.
+ *       Candidates are preselected on the fixed-point coordinates and ranked by haversine distance.
+ *       Candidates in the largest strongly connected component come first, so
+ *       snapped endpoints can reach each other unless none is nearby
  */
 error_code_t find_nearest_nodes(Graph *graph, double target_lat, double target_lon, int *count, NodeDistance **nodes, error_info_t *err_info);
 
@@ -180,4 +197,36 @@ error_code_t interactive_coordinate_mode(Graph *graph, uint32_t *source_id, uint
  */
 error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const char *filename, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info);
 
+/**
+ * Exports a path with the cost of each of its nodes to a GPX file format.
+ * 
+ * @param graph Pointer to the graph structure
+ * @param path Array of node indices representing the path
+ * @param costs Cost of reaching each path node (meters or milliseconds)
+ * @param path_length Number of nodes in the path
+ * @param filename Output GPX filename
+ * @param mode Dijkstra mode the costs were computed in
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ * 
+ * @pre Same as export_path_to_gpx()
+ * @post Same as export_path_to_gpx()
+ * @note Used for routes that do not come from a single search result, such
+ *       as the alternatives of find_k_shortest_paths()
+ */
+error_code_t export_path_costs_to_gpx(Graph *graph, const int *path, const uint32_t *costs, int path_length, const char *filename, DijkstraMode mode, error_info_t *err_info);
+
+/**
+ * Derives the GPX filename of a numbered route from the main one
+ * ("route.gpx" becomes "route_2.gpx" for route 2).
+ * 
+ * @param filename Main GPX filename
+ * @param route_number Number appended to the name
+ * @param buffer Output buffer for the derived filename
+ * @param buffer_size Size of the output buffer
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, ERR_BUFFER_OVERFLOW if the name does not fit
+ */
+error_code_t format_route_filename(const char *filename, int route_number, char *buffer, size_t buffer_size, error_info_t *err_info);
+
 #endif
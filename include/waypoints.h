@@ -0,0 +1,110 @@
+#ifndef WAYPOINTS_H
+#define WAYPOINTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "kpaths.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+// Stops one waypoint route may visit, source and target included
+#define WAYPOINT_MAX_STOPS 4096
+
+// ==================
+// Waypoint Routing Data Structures
+// ==================
+
+/**
+ * A route visiting a list of stops, stitched from one shortest path per leg
+ * (see find_waypoint_route()).
+ */
+typedef struct {
+  RoutePath path;           // Every node from the first to the last stop, costs accumulated along the whole route
+  int *stop_order;          // Input position of each stop in visiting order
+  int *stop_positions;      // Position of each visited stop in path.nodes
+  uint32_t *leg_costs;      // Cost of each leg, leg i leaving stop i of the visiting order
+  int num_stops;            // Stops visited
+  int unreachable_leg;      // First leg without a route (the path is then empty), -1 if none
+  DijkstraMode mode;        // Mode the costs were computed in
+  uint32_t input_order_cost; // Matrix cost of visiting the stops in input order when reordering, 0 otherwise
+  int settled_count;        // Nodes settled by every leg and matrix search
+} WaypointRoute;
+
+// ==================
+// Waypoint Routing Function Prototypes
+// ==================
+
+/**
+ * Routes through a list of stops in order, or in an order chosen to shorten
+ * the route, keeping the first and last stop in place.
+ *
+ * @param graph Pointer to the graph structure
+ * @param stop_ids Node IDs of the stops, from the source to the target
+ * @param num_stops Number of stops (2 to WAYPOINT_MAX_STOPS)
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param reorder true to reorder the intermediate stops by cheapest insertion
+ *        over the stop-to-stop cost matrix
+ * @param route Pointer to store the route
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre All pointers must be non-NULL, every stop must exist in the graph
+ * @post On success: route holds the stitched path and the per-leg costs, or
+ *       an empty path and route->unreachable_leg if some leg has no route
+ *       On failure: nothing is left allocated
+ * @note On pruned or contracted graphs, stops off the routing graph join it
+ *       over the virtual arcs of resolve_route_ends()
+ * @note One workspace serves every leg and matrix search: per-node state is
+ *       stamped with a search ID, so no search pays O(N) initialization.
+ *       Consecutive equal stops give an empty leg
+ * @note Reordering runs one search per stop, stopping once every other stop
+ *       is settled, and keeps the input order when no order is cheaper
+ * @note The caller must call free_waypoint_route() to free allocated memory
+ */
+error_code_t find_waypoint_route(Graph *graph, const uint32_t *stop_ids, int num_stops, DijkstraMode mode, bool reorder, WaypointRoute *route, error_info_t *err_info);
+
+/**
+ * Computes the cost of the shortest path between every ordered pair of stops.
+ *
+ * @param graph Pointer to the graph structure
+ * @param stop_ids Node IDs of the stops
+ * @param num_stops Number of stops (1 to WAYPOINT_MAX_STOPS)
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param matrix Pointer to store the num_stops x num_stops row-major matrix
+ * @param settled_count Pointer to add the settled nodes to (NULL is allowed)
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre Same stop requirements as find_waypoint_route()
+ * @post On success: (*matrix)[i * num_stops + j] is the cost from stop i to
+ *       stop j, WEIGHT_INFINITY if unreachable, 0 on the diagonal
+ * @note The caller must free *matrix
+ */
+error_code_t compute_stop_matrix(Graph *graph, const uint32_t *stop_ids, int num_stops, DijkstraMode mode, uint32_t **matrix, int *settled_count, error_info_t *err_info);
+
+/**
+ * Parses a comma-separated list of node IDs such as "12,40,7".
+ *
+ * @param text Text to parse
+ * @param ids Pointer to store the allocated ID array
+ * @param count Pointer to store the number of IDs
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, ERR_INVALID_ARGUMENT for malformed lists
+ *
+ * @note The caller must free *ids
+ */
+error_code_t parse_node_list(const char *text, uint32_t **ids, int *count, error_info_t *err_info);
+
+/**
+ * Frees a waypoint route.
+ *
+ * @param route Pointer to the route (NULL is allowed)
+ */
+void free_waypoint_route(WaypointRoute *route);
+
+#endif // WAYPOINTS_H
@@ -0,0 +1,136 @@
+#ifndef WEIGHTING_H
+#define WEIGHTING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+#include "error_handling.h"
+
+// ==================
+// Constants
+// ==================
+
+// Longest profile name, without the terminating NUL
+#define WEIGHTING_NAME_LENGTH 31
+
+// Profiles one file may define
+#define WEIGHTING_MAX_PROFILES 16
+
+// ==================
+// Weighting Profile Data Structures
+// ==================
+
+/**
+ * Cost model of one vehicle type. The cost of an edge is
+ *
+ *   class_factor * one_way_factor * (time_weight * time_ms + distance_weight * length_m)
+ *
+ * rounded to the nearest integer, where time_ms is the travel time at the
+ * speed limit capped by max_speed_kmh and the class speed cap. Costs are
+ * generalized travel times: with the defaults a profile reproduces the
+ * fastest-time weights, so results are reported in time units.
+ */
+typedef struct {
+  char name[WEIGHTING_NAME_LENGTH + 1]; // Name the profile is selected by
+  double time_weight;       // Cost per millisecond of travel time (default 1)
+  double distance_weight;   // Cost per meter (default 0)
+  uint16_t max_speed_kmh;   // Speed cap on every road, 0 for none
+  uint16_t class_speed_kmh[HIGHWAY_NUM_TYPES]; // Speed cap per road class, 0 for none
+  double class_factor[HIGHWAY_NUM_TYPES]; // Cost multiplier per road class, 0 bars the class
+  double one_way_factor;    // Cost multiplier on one-way edges (default 1)
+} WeightingProfile;
+
+/**
+ * Weighting profiles of a graph, attached by load_weighting_profiles().
+ * Every profile is compiled into its own packed arc stream parallel to
+ * adj_indices, so a query on a profile reads the same adjacency offsets and
+ * indices as the built-in metrics and pays nothing per edge for the profile.
+ */
+typedef struct WeightingSet {
+  WeightingProfile *profiles; // Cost models, in file order
+  Arc **arcs;               // Packed (target, cost) stream of each profile
+  int num_profiles;         // Profiles in the set
+} WeightingSet;
+
+// ==================
+// Weighting Profile Function Prototypes
+// ==================
+
+/**
+ * Loads weighting profiles from a text file and compiles them into arc streams.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param filename Path to the profile file
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @pre All pointers must be non-NULL, graph must be neither pruned nor contracted
+ * @post On success: graph->weightings is set (replacing previous profiles),
+ *       profile p is queried with DIJKSTRA_WEIGHTING_MODE(p) and
+ *       graph->weight_version is incremented
+ *       On failure: graph->weightings is unchanged
+ * @note File layout: one directive per line, '#' starts a comment.
+ *       "profile NAME" opens a profile; the directives after it set
+ *       "time W", "distance W", "max_speed KMH", "one_way F",
+ *       "speed CLASSES KMH", "factor CLASSES F" and "avoid CLASSES", where
+ *       CLASSES is a list as accepted by parse_road_classes()
+ * @note Profiles are compiled from the edges.bin speeds, or the live speeds
+ *       of edges under traffic; later traffic batches update them as well
+ */
+error_code_t load_weighting_profiles(Graph *graph, const char *filename, error_info_t *err_info);
+
+/**
+ * Compiles the arc streams of a graph's weighting profiles for its current CSR.
+ *
+ * @param graph Pointer to graph with CSR built
+ * @param err_info Error reporting structure
+ * @return ERR_SUCCESS on success, error code otherwise
+ *
+ * @post Does nothing for graphs without weighting profiles
+ * @note Called whenever the CSR is rebuilt (node reordering); edges under
+ *       live traffic are costed at their live speed
+ * @note Runs on one thread per online processor: each profile is costed in
+ *       chunks of edges, then scattered in chunks of arcs. Traffic batches
+ *       do not call it; they recost the updated edges only
+ */
+error_code_t compile_weighting_arcs(Graph *graph, error_info_t *err_info);
+
+/**
+ * Computes the cost of an edge under a weighting profile.
+ *
+ * @param graph Pointer to graph with edge columns loaded
+ * @param profile Cost model
+ * @param edge_idx Index of the edge
+ * @return Cost clamped below WEIGHT_INFINITY, WEIGHT_INFINITY if the profile bars the edge
+ */
+uint32_t weighting_edge_cost(const Graph *graph, const WeightingProfile *profile, edge_index_t edge_idx);
+
+/**
+ * Computes the cost of an edge under a weighting profile at a live speed.
+ *
+ * @param graph Pointer to graph with edge columns loaded
+ * @param profile Cost model
+ * @param edge_idx Index of the edge
+ * @param speed_kmh Live speed, TRAFFIC_SPEED_CLOSED or TRAFFIC_SPEED_RESTORE (see traffic.h)
+ * @return Cost as weighting_edge_cost(), WEIGHT_INFINITY for a closed edge
+ * @note The profile's speed caps apply to the live speed as to the speed limit
+ */
+uint32_t weighting_live_cost(const Graph *graph, const WeightingProfile *profile, edge_index_t edge_idx, uint16_t speed_kmh);
+
+/**
+ * Looks up a weighting profile by name.
+ *
+ * @param graph Pointer to graph structure
+ * @param name Profile name
+ * @return Index of the profile, or -1 if the graph has no such profile
+ */
+int find_weighting_profile(const Graph *graph, const char *name);
+
+/**
+ * Frees a weighting set.
+ *
+ * @param weightings Weighting set to free (NULL is allowed)
+ */
+void free_weighting_set(WeightingSet *weightings);
+
+#endif // WEIGHTING_H
@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alternatives.h"
+#include "min_heap.h"
+#include "components.h"
+#include "roadclass.h"
+#include "traffic.h"
+
+// ================
+// Search workspace
+// ================
+
+/**
+ * Forward and backward shortest path trees of one query. Costs above the
+ * search bound are tentative and the nodes carrying them take no part.
+ */
+typedef struct {
+  Graph *graph;
+  const Arc *arcs;
+  const ReverseIndex *reverse;
+  RouteEnds ends;           // Virtual arcs of endpoints off the routing graph
+  int source_index;
+  int target_index;
+  uint32_t bound;           // Largest admissible route cost
+  uint32_t *forward_cost;   // Cost from the source
+  edge_index_t *pred_arc;   // Forward tree arc into a node, -1 if none
+  uint32_t *backward_cost;  // Cost to the target
+  edge_index_t *succ_arc;   // Backward tree arc out of a node, -1 if none
+  int *visit;               // Candidate that last walked through a node (loop test)
+  unsigned char *on_route;  // Arcs of the routes chosen so far (virtual arcs after the CSR arcs)
+  MinHeap *heap;
+  int settled_count;
+} ViaWorkspace;
+
+/**
+ * A via route: the forward tree path to the end of a plateau followed by the
+ * backward tree path from there.
+ */
+typedef struct {
+  int via_index;            // Last node of the plateau
+  uint32_t cost;            // Route cost
+  uint32_t plateau;         // Plateau cost
+} ViaCandidate;
+
+static void free_workspace(ViaWorkspace *ws) {
+  free(ws->forward_cost);
+  free(ws->pred_arc);
+  free(ws->backward_cost);
+  free(ws->succ_arc);
+  free(ws->visit);
+  free(ws->on_route);
+  free_heap(ws->heap);
+}
+
+static error_code_t init_workspace(ViaWorkspace *ws, Graph *graph, DijkstraMode mode, int source_index, int target_index, error_info_t *err_info) {
+  int num_nodes = graph->num_nodes;
+  edge_index_t num_arcs = graph->adj_offsets[num_nodes] + ROUTE_NUM_VIRTUAL_ARCS;
+  memset(ws, 0, sizeof(ViaWorkspace));
+  ws->graph = graph;
+  ws->arcs = dijkstra_mode_arcs(graph, mode);
+  resolve_route_ends(graph, mode, source_index, target_index, true, &ws->ends);
+  ws->source_index = source_index;
+  ws->target_index = target_index;
+  ws->bound = WEIGHT_INFINITY;
+
+  error_code_t err_code = get_reverse_index(graph, &ws->reverse, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  ws->forward_cost = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  ws->pred_arc = (edge_index_t *)alloc_array(num_nodes, sizeof(edge_index_t));
+  ws->backward_cost = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  ws->succ_arc = (edge_index_t *)alloc_array(num_nodes, sizeof(edge_index_t));
+  ws->visit = (int *)calloc(num_nodes, sizeof(int));
+  ws->on_route = (unsigned char *)calloc((size_t)num_arcs, sizeof(unsigned char));
+  if (ws->forward_cost == NULL || ws->pred_arc == NULL || ws->backward_cost == NULL ||
+      ws->succ_arc == NULL || ws->visit == NULL || ws->on_route == NULL) {
+    free_workspace(ws);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for alternative routes workspace.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  err_code = create_heap(&ws->heap, num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    ws->heap = NULL;
+    free_workspace(ws);
+    return err_code;
+  }
+
+  for (int i = 0; i < num_nodes; i++) {
+    ws->forward_cost[i] = WEIGHT_INFINITY;
+    ws->pred_arc[i] = -1;
+    ws->backward_cost[i] = WEIGHT_INFINITY;
+    ws->succ_arc[i] = -1;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Returns the node a CSR or virtual arc leaves.
+ */
+static inline int via_arc_tail(const ViaWorkspace *ws, edge_index_t arc) {
+  return is_virtual_arc(&ws->ends, arc) ? ws->ends.tail[arc - ws->ends.first_virtual_arc] : ws->reverse->arc_tail[arc];
+}
+
+static inline int via_arc_target(const ViaWorkspace *ws, edge_index_t arc) {
+  return route_arc_target(&ws->ends, ws->arcs, arc);
+}
+
+// ================
+// Bounded tree searches
+// ================
+
+/**
+ * Lowers the cost of reaching a node in one of the two trees.
+ */
+static inline error_code_t relax_via_arc(MinHeap *heap, uint32_t *cost, edge_index_t *tree_arc, int w, edge_index_t arc, uint64_t new_cost, error_info_t *err_info) {
+  if (new_cost >= cost[w]) return ERR_SUCCESS;
+  cost[w] = (uint32_t)new_cost;
+  tree_arc[w] = arc;
+  return insert_heap(heap, w, (uint32_t)new_cost, err_info);
+}
+
+/**
+ * Returns the largest cost an alternative to a route of the given cost may have.
+ */
+static uint32_t stretch_bound(uint32_t shortest_cost, double max_stretch) {
+  double bound = (double)shortest_cost * (1.0 + max_stretch);
+  return bound < (double)(WEIGHT_INFINITY - 1) ? (uint32_t)bound : WEIGHT_INFINITY - 1;
+}
+
+/**
+ * Grows the forward tree until every node within the stretch bound is
+ * settled. The bound is set once the target is settled.
+ */
+static error_code_t search_forward(ViaWorkspace *ws, double max_stretch, error_info_t *err_info) {
+  const edge_index_t *adj_offsets = ws->graph->adj_offsets;
+  const Arc *arcs = ws->arcs;
+  const uint64_t *avoided_arcs = road_filter_arcs(ws->graph);
+  MinHeap *heap = ws->heap;
+
+  // Entries are only queued on improvement, so a stale entry has a higher cost
+  clear_heap(heap);
+  ws->forward_cost[ws->source_index] = 0;
+  error_code_t err_code = insert_heap(heap, ws->source_index, 0, err_info);
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    if (min_node.distance > ws->bound) break;
+    int v = min_node.node_index;
+    if (min_node.distance > ws->forward_cost[v]) continue;
+    ws->settled_count++;
+    if (v == ws->target_index) ws->bound = stretch_bound(min_node.distance, max_stretch);
+
+    for (edge_index_t i = adj_offsets[v]; i < adj_offsets[v + 1] && err_code == ERR_SUCCESS; i++) {
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+      if (is_cut_arc(&ws->ends, i)) continue;
+      err_code = relax_via_arc(heap, ws->forward_cost, ws->pred_arc, arcs[i].target, i,
+                               (uint64_t)min_node.distance + arcs[i].weight, err_info);
+    }
+    for (int k = 0; k < ROUTE_NUM_VIRTUAL_ARCS && ws->ends.has_virtual_arcs && err_code == ERR_SUCCESS; k++) {
+      if (ws->ends.tail[k] != v) continue;
+      err_code = relax_via_arc(heap, ws->forward_cost, ws->pred_arc, ws->ends.head[k], ws->ends.first_virtual_arc + k,
+                               (uint64_t)min_node.distance + ws->ends.cost[k], err_info);
+    }
+  }
+  return err_code;
+}
+
+/**
+ * Grows the backward tree from the target over the incoming arcs until
+ * every node within the stretch bound is settled.
+ */
+static error_code_t search_backward(ViaWorkspace *ws, error_info_t *err_info) {
+  const ReverseIndex *reverse = ws->reverse;
+  const Arc *arcs = ws->arcs;
+  const uint64_t *avoided_arcs = road_filter_arcs(ws->graph);
+  MinHeap *heap = ws->heap;
+
+  clear_heap(heap);
+  ws->backward_cost[ws->target_index] = 0;
+  error_code_t err_code = insert_heap(heap, ws->target_index, 0, err_info);
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    if (min_node.distance > ws->bound) break;
+    int v = min_node.node_index;
+    if (min_node.distance > ws->backward_cost[v]) continue;
+    ws->settled_count++;
+
+    for (edge_index_t j = reverse->in_offsets[v]; j < reverse->in_offsets[v + 1] && err_code == ERR_SUCCESS; j++) {
+      edge_index_t arc = reverse->in_arcs[j];
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, arc)) continue;
+      if (is_cut_arc(&ws->ends, arc)) continue;
+      err_code = relax_via_arc(heap, ws->backward_cost, ws->succ_arc, reverse->arc_tail[arc], arc,
+                               (uint64_t)min_node.distance + arcs[arc].weight, err_info);
+    }
+    for (int k = 0; k < ROUTE_NUM_VIRTUAL_ARCS && ws->ends.has_virtual_arcs && err_code == ERR_SUCCESS; k++) {
+      if (ws->ends.head[k] != v) continue;
+      err_code = relax_via_arc(heap, ws->backward_cost, ws->succ_arc, ws->ends.tail[k], ws->ends.first_virtual_arc + k,
+                               (uint64_t)min_node.distance + ws->ends.cost[k], err_info);
+    }
+  }
+  return err_code;
+}
+
+// ================
+// Plateaus
+// ================
+
+/**
+ * Tells whether an arc lies on both trees, i.e. belongs to a plateau.
+ */
+static inline bool is_plateau_arc(const ViaWorkspace *ws, edge_index_t arc) {
+  if (arc < 0) return false;
+  int u = via_arc_tail(ws, arc);
+  int w = via_arc_target(ws, arc);
+  return ws->succ_arc[u] == arc && ws->pred_arc[w] == arc &&
+         ws->forward_cost[w] <= ws->bound && ws->backward_cost[u] <= ws->bound;
+}
+
+/**
+ * Tells whether the forward path to a via node and the backward path from
+ * it share no node but the via node itself.
+ */
+static bool is_simple_via_route(ViaWorkspace *ws, int via_index, int id) {
+  for (int v = via_index; v != ws->source_index; v = via_arc_tail(ws, ws->pred_arc[v])) {
+    ws->visit[v] = id;
+  }
+  ws->visit[ws->source_index] = id;
+
+  for (int v = via_index; v != ws->target_index; ) {
+    v = via_arc_target(ws, ws->succ_arc[v]);
+    if (ws->visit[v] == id) return false;
+  }
+  return true;
+}
+
+static inline int64_t base_rank(const ViaCandidate *candidate) {
+  return 2 * (int64_t)candidate->cost - candidate->plateau;
+}
+
+static int compare_candidates(const void *a, const void *b) {
+  int64_t rank_a = base_rank((const ViaCandidate *)a);
+  int64_t rank_b = base_rank((const ViaCandidate *)b);
+  return (rank_a > rank_b) - (rank_a < rank_b);
+}
+
+/**
+ * Collects the plateaus of the two trees that pass the stretch, plateau and
+ * loop tests, ordered by 2 * cost - plateau cost.
+ */
+static error_code_t collect_candidates(ViaWorkspace *ws, const AlternativeParams *params, ViaCandidate **candidates, int *num_candidates, int *num_plateaus, error_info_t *err_info) {
+  int num_nodes = ws->graph->num_nodes;
+  uint32_t shortest_cost = ws->forward_cost[ws->target_index];
+  double min_plateau = params->min_plateau * (double)shortest_cost;
+
+  int capacity = 16;
+  int count = 0;
+  ViaCandidate *list = (ViaCandidate *)alloc_array(capacity, sizeof(ViaCandidate));
+  CHECK_ALLOCATION(list, err_info);
+
+  *num_plateaus = 0;
+  for (int u = 0; u < num_nodes; u++) {
+    // A plateau starts where a plateau arc leaves a node no plateau arc enters
+    if (!is_plateau_arc(ws, ws->succ_arc[u]) || is_plateau_arc(ws, ws->pred_arc[u])) continue;
+    (*num_plateaus)++;
+
+    int end = u;
+    while (is_plateau_arc(ws, ws->succ_arc[end])) end = via_arc_target(ws, ws->succ_arc[end]);
+
+    uint64_t cost = (uint64_t)ws->forward_cost[u] + ws->backward_cost[u];
+    uint32_t plateau = ws->forward_cost[end] - ws->forward_cost[u];
+    if (cost > ws->bound || (double)plateau < min_plateau) continue;
+    if (!is_simple_via_route(ws, end, *num_plateaus)) continue;
+
+    if (count == capacity) {
+      capacity *= 2;
+      ViaCandidate *grown = (ViaCandidate *)realloc(list, capacity * sizeof(ViaCandidate));
+      if (grown == NULL) {
+        free(list);
+        SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for via candidates.");
+        return ERR_MEMORY_ALLOCATION;
+      }
+      list = grown;
+    }
+    list[count].via_index = end;
+    list[count].cost = (uint32_t)cost;
+    list[count].plateau = plateau;
+    count++;
+  }
+
+  // Order by the part of the ranking known before any sharing
+  qsort(list, count, sizeof(ViaCandidate), compare_candidates);
+
+  *candidates = list;
+  *num_candidates = count;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Route selection
+// ================
+
+/**
+ * Sums the cost of the arcs of a via route that chosen routes already use.
+ *
+ * @param all_shared Set to whether every arc is already used
+ */
+static uint32_t shared_cost(const ViaWorkspace *ws, int via_index, bool *all_shared) {
+  uint32_t shared = 0;
+  *all_shared = true;
+  for (int v = via_index; v != ws->source_index; ) {
+    edge_index_t arc = ws->pred_arc[v];
+    if (ws->on_route[arc]) shared += route_arc_weight(&ws->ends, ws->arcs, arc);
+    else *all_shared = false;
+    v = via_arc_tail(ws, arc);
+  }
+  for (int v = via_index; v != ws->target_index; ) {
+    edge_index_t arc = ws->succ_arc[v];
+    if (ws->on_route[arc]) shared += route_arc_weight(&ws->ends, ws->arcs, arc);
+    else *all_shared = false;
+    v = via_arc_target(ws, arc);
+  }
+  return shared;
+}
+
+/**
+ * Collects the arcs of a via route in travel order (the shortest route when
+ * via_index is the target).
+ */
+static error_code_t collect_via_arcs(const ViaWorkspace *ws, int via_index, edge_index_t **arcs, int *num_arcs, error_info_t *err_info) {
+  int forward_arcs = 0;
+  int count = 0;
+  for (int v = via_index; v != ws->source_index; v = via_arc_tail(ws, ws->pred_arc[v])) forward_arcs++;
+  count = forward_arcs;
+  for (int v = via_index; v != ws->target_index; v = via_arc_target(ws, ws->succ_arc[v])) count++;
+
+  edge_index_t *list = (edge_index_t *)alloc_array(count > 0 ? count : 1, sizeof(edge_index_t));
+  CHECK_ALLOCATION(list, err_info);
+
+  int position = forward_arcs;
+  for (int v = via_index; v != ws->source_index; v = via_arc_tail(ws, list[position])) {
+    list[--position] = ws->pred_arc[v];
+  }
+  position = forward_arcs;
+  for (int v = via_index; v != ws->target_index; v = via_arc_target(ws, list[position - 1])) {
+    list[position++] = ws->succ_arc[v];
+  }
+
+  *arcs = list;
+  *num_arcs = count;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Appends a via route to the result and marks its arcs as used.
+ */
+static error_code_t accept_route(ViaWorkspace *ws, DijkstraMode mode, int via_index, AlternativeRoutes *routes, error_info_t *err_info) {
+  edge_index_t *arcs;
+  int num_arcs;
+  error_code_t err_code = collect_via_arcs(ws, via_index, &arcs, &num_arcs, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  err_code = build_route_path(ws->graph, mode, &ws->ends, ws->source_index, arcs, num_arcs, &routes->paths[routes->num_paths], err_info);
+  if (err_code == ERR_SUCCESS) {
+    routes->num_paths++;
+    for (int i = 0; i < num_arcs; i++) {
+      ws->on_route[arcs[i]] = 1;
+    }
+  }
+  free(arcs);
+  return err_code;
+}
+
+/**
+ * Picks alternatives greedily by 2 * cost + shared cost - plateau cost,
+ * skipping those sharing too much with the routes chosen so far.
+ */
+static error_code_t select_alternatives(ViaWorkspace *ws, DijkstraMode mode, const AlternativeParams *params, ViaCandidate *candidates, int num_candidates, int max_alternatives, AlternativeRoutes *routes, error_info_t *err_info) {
+  double max_shared = params->max_sharing * (double)ws->forward_cost[ws->target_index];
+  error_code_t err_code = ERR_SUCCESS;
+
+  for (int round = 0; round < max_alternatives && err_code == ERR_SUCCESS; round++) {
+    int best = -1;
+    int64_t best_rank = INT64_MAX;
+    for (int i = 0; i < num_candidates; i++) {
+      if (candidates[i].via_index < 0) continue;
+
+      // Sharing only adds to the rank, so later candidates cannot win
+      int64_t rank = base_rank(&candidates[i]);
+      if (rank >= best_rank) break;
+
+      bool all_shared;
+      uint32_t shared = shared_cost(ws, candidates[i].via_index, &all_shared);
+      if (all_shared || (double)shared > max_shared) continue;
+      if (rank + shared < best_rank) {
+        best_rank = rank + shared;
+        best = i;
+      }
+    }
+    if (best < 0) break;
+
+    err_code = accept_route(ws, mode, candidates[best].via_index, routes, err_info);
+    candidates[best].via_index = -1;
+  }
+  return err_code;
+}
+
+// ================
+// Alternative routes
+// ================
+
+void default_alternative_params(AlternativeParams *params) {
+  if (params == NULL) return;
+
+  params->max_stretch = 0.25;
+  params->max_sharing = 0.8;
+  params->min_plateau = 0.25;
+}
+
+void free_alternative_routes(AlternativeRoutes *routes) {
+  if (routes == NULL) return;
+
+  for (int i = 0; i < routes->num_paths; i++) {
+    free(routes->paths[i].nodes);
+    free(routes->paths[i].costs);
+  }
+  free(routes->paths);
+  routes->paths = NULL;
+  routes->num_paths = 0;
+}
+
+error_code_t find_alternative_routes(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, int max_alternatives, DijkstraMode mode, const AlternativeParams *params, AlternativeRoutes *routes, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(routes, err_info);
+
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+  if (max_alternatives < 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Number of alternatives cannot be negative.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (source_node_id == target_node_id) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  AlternativeParams defaults;
+  if (params == NULL) {
+    default_alternative_params(&defaults);
+    params = &defaults;
+  }
+  if (params->max_stretch < 0.0 || params->max_sharing < 0.0 || params->min_plateau < 0.0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Alternative route limits cannot be negative.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int source_index, target_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  routes->paths = NULL;
+  routes->num_paths = 0;
+  routes->mode = mode;
+  routes->num_plateaus = 0;
+  routes->num_admissible = 0;
+  routes->settled_count = 0;
+  if (!component_may_reach(graph, source_index, target_index)) return ERR_SUCCESS;
+
+  // Both searches and the route costs read the stream of one batch
+  int ticket = traffic_read_begin(graph);
+  ViaWorkspace ws;
+  err_code = init_workspace(&ws, graph, mode, source_index, target_index, err_info);
+  if (err_code != ERR_SUCCESS) {
+    traffic_read_end(graph, ticket);
+    return err_code;
+  }
+
+  err_code = search_forward(&ws, params->max_stretch, err_info);
+  if (err_code == ERR_SUCCESS && ws.forward_cost[target_index] == WEIGHT_INFINITY) {
+    routes->settled_count = ws.settled_count;
+    free_workspace(&ws);
+    traffic_read_end(graph, ticket);
+    return ERR_SUCCESS;
+  }
+  if (err_code == ERR_SUCCESS) err_code = search_backward(&ws, err_info);
+
+  ViaCandidate *candidates = NULL;
+  int num_candidates = 0;
+  if (err_code == ERR_SUCCESS) {
+    err_code = collect_candidates(&ws, params, &candidates, &num_candidates, &routes->num_plateaus, err_info);
+    routes->num_admissible = num_candidates;
+  }
+
+  if (err_code == ERR_SUCCESS) {
+    routes->paths = (RoutePath *)alloc_array(1 + max_alternatives, sizeof(RoutePath));
+    if (routes->paths == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for routes.");
+      err_code = ERR_MEMORY_ALLOCATION;
+    }
+  }
+
+  // The shortest route is the via route through the target
+  if (err_code == ERR_SUCCESS) err_code = accept_route(&ws, mode, target_index, routes, err_info);
+  if (err_code == ERR_SUCCESS) {
+    err_code = select_alternatives(&ws, mode, params, candidates, num_candidates, max_alternatives, routes, err_info);
+  }
+
+  routes->settled_count = ws.settled_count;
+  free(candidates);
+  free_workspace(&ws);
+  traffic_read_end(graph, ticket);
+  if (err_code != ERR_SUCCESS) free_alternative_routes(routes);
+  return err_code;
+}
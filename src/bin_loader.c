@@ -1,56 +1,107 @@
+// Large file support on 32-bit platforms: node and edge files of planet-scale
+// graphs exceed 4 GB. Must precede every system header.
+#define _FILE_OFFSET_BITS 64
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "bin_loader.h"
+#include "components.h"
+
+// Number of node records read from the file per fread call
+#define NODE_READ_CHUNK 65536
+// Number of edge records read from the file per fread call
+#define EDGE_READ_CHUNK 65536
 
 error_code_t load_nodes_from_binary(Graph *graph, FILE *file, error_info_t *err_info) {
   // Null error check is already done in load_graph_from_binary
   
-  // Read all nodes from binary file in one operation
-  size_t nodes_read = fread(graph->nodes, sizeof(Node), graph->num_nodes, file);
-  if (nodes_read != (size_t)graph->num_nodes) {
-    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read nodes from binary file.");
-    return ERR_FILE_READ;
-  }
+  // Read node records in fixed-size chunks and split them into the compact
+  // ID and fixed-point coordinate arrays, so the 24-byte records are never
+  // held in memory all at once
+  Node *chunk = (Node *)malloc(NODE_READ_CHUNK * sizeof(Node));
+  CHECK_ALLOCATION(chunk, err_info);
 
-  // Initialize node hash table for efficient node lookup
   error_code_t err_code;
-  for (int i = 0; i < graph->num_nodes; i++) {
-    // Insert each node into hash table mapping node_id to array index
-    err_code = insert_node_hash(graph->node_hash, graph->nodes[i].node_id, i, err_info);
-    if (err_code != ERR_SUCCESS) return err_code;
-  }
+  int loaded = 0;
+  while (loaded < graph->num_nodes) {
+    int want = graph->num_nodes - loaded;
+    if (want > NODE_READ_CHUNK) want = NODE_READ_CHUNK;
 
-  // Debug output for successful loading
-  printf("Debug: Loaded %d nodes from binary file.\n", graph->num_nodes);
-  
+    size_t nodes_read = fread(chunk, sizeof(Node), want, file);
+    if (nodes_read != (size_t)want) {
+      free(chunk);
+      SET_ERROR(err_info, ERR_FILE_READ, "Failed to read nodes from binary file.");
+      return ERR_FILE_READ;
+    }
+
+    for (int j = 0; j < want; j++) {
+      int i = loaded + j;
+      graph->node_ids[i] = chunk[j].node_id;
+      graph->node_lat[i] = coord_from_degrees(chunk[j].latitude);
+      graph->node_lon[i] = coord_from_degrees(chunk[j].longitude);
+
+      // Insert each node into hash table mapping node_id to array index
+      err_code = insert_node_hash(graph->node_hash, chunk[j].node_id, i, err_info);
+      if (err_code != ERR_SUCCESS) {
+        free(chunk);
+        return err_code;
+      }
+    }
+    loaded += want;
+  }
+  free(chunk);
   return ERR_SUCCESS;
 }
 
 error_code_t load_edges_from_binary(Graph *graph, FILE *file, error_info_t *err_info) {
   // Null error check is already done in load_graph_from_binary
   
-  // Read all edges from binary file in one operation
-  size_t edges_read = fread(graph->edges, sizeof(Edge), graph->num_edges, file);
-  if (edges_read != (size_t)graph->num_edges) {
-    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read edges from binary file.");
-    return ERR_FILE_READ;
-  }
-  
-  // Validate that all node_id references in edges exist in the graph
+  // Read edge records in chunks and split them into the edge columns,
+  // resolving endpoint IDs to node indices once (this also validates that
+  // every referenced node exists in the graph)
+  Edge *chunk = (Edge *)malloc(EDGE_READ_CHUNK * sizeof(Edge));
+  CHECK_ALLOCATION(chunk, err_info);
+
   error_code_t err_code;
-  for (int i = 0; i < graph->num_edges; i++) {
-    Edge *edge = &graph->edges[i];
-    int out_index;
-    
-    // Validate source node exists
-    err_code = find_node_index(graph, edge->from_node, &out_index, err_info);
-    if (err_code != ERR_SUCCESS) return err_code;
-    
-    // Validate destination node exists
-    err_code = find_node_index(graph, edge->to_node, &out_index, err_info);
-    if (err_code != ERR_SUCCESS) return err_code;
+  edge_index_t loaded = 0;
+  while (loaded < graph->num_edges) {
+    int want = EDGE_READ_CHUNK;
+    if (graph->num_edges - loaded < want) want = (int)(graph->num_edges - loaded);
+
+    size_t edges_read = fread(chunk, sizeof(Edge), want, file);
+    if (edges_read != (size_t)want) {
+      free(chunk);
+      SET_ERROR(err_info, ERR_FILE_READ, "Failed to read edges from binary file.");
+      return ERR_FILE_READ;
+    }
+
+    for (int j = 0; j < want; j++) {
+      edge_index_t i = loaded + j;
+      Edge *edge = &chunk[j];
+
+      // Validate and resolve source node
+      err_code = find_node_index(graph, edge->from_node, &graph->edge_from[i], err_info);
+      if (err_code != ERR_SUCCESS) {
+        free(chunk);
+        return err_code;
+      }
+
+      // Validate and resolve destination node
+      err_code = find_node_index(graph, edge->to_node, &graph->edge_to[i], err_info);
+      if (err_code != ERR_SUCCESS) {
+        free(chunk);
+        return err_code;
+      }
+
+      graph->edge_length[i] = edge->length;
+      graph->edge_speed[i] = edge->speed_limit;
+      graph->edge_highway[i] = edge->highway_type;
+      graph->edge_one_way[i] = edge->one_way;
+    }
+    loaded += want;
   }
+  free(chunk);
   
   // NOTE: Do not close the file here - caller will handle file closure
   return ERR_SUCCESS;
@@ -95,8 +146,24 @@ error_code_t load_graph_from_binary(Graph **graph, const char *nodes_filename, c
     return ERR_FILE_READ;
   }
   
+  // Node indices are 32-bit in every build; edge indices depend on GRAPH_INDEX64
+  if (num_nodes > INT32_MAX) {
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Too many nodes for 32-bit node indices.");
+    fclose(nodes_file);
+    fclose(edges_file);
+    return ERR_INVALID_DATA;
+  }
+#ifndef GRAPH_INDEX64
+  if ((uint64_t)num_edges > (uint64_t)(EDGE_INDEX_MAX / 2)) {
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Too many edges for 32-bit edge indices, rebuild with INDEX64=1.");
+    fclose(nodes_file);
+    fclose(edges_file);
+    return ERR_INVALID_DATA;
+  }
+#endif
+
   // Create graph structure with the read dimensions
-  error_code_t err_code = create_graph(graph, (int)num_nodes, (int)num_edges, err_info);
+  error_code_t err_code = create_graph(graph, (int)num_nodes, (edge_index_t)num_edges, err_info);
   if (err_code != ERR_SUCCESS) {
     fclose(nodes_file);
     fclose(edges_file);
@@ -131,6 +198,13 @@ error_code_t load_graph_from_binary(Graph **graph, const char *nodes_filename, c
     free_graph(*graph);
     return err_code;
   }
+
+  // Precompute connected components so unreachable queries fail without a search
+  err_code = compute_graph_components(*graph, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free_graph(*graph);
+    return err_code;
+  }
   
   return ERR_SUCCESS;
 }
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "components.h"
+
+// ================
+// Weakly connected groups
+// ================
+
+/**
+ * Finds the representative of a node in a union-find forest, halving paths.
+ */
+static int find_group_root(int *parent, int node_index) {
+  while (parent[node_index] != node_index) {
+    parent[node_index] = parent[parent[node_index]];
+    node_index = parent[node_index];
+  }
+  return node_index;
+}
+
+/**
+ * Assigns a weakly connected group to every strongly connected component by
+ * joining the endpoints of every edge, whatever its direction.
+ */
+static error_code_t compute_groups(const Graph *graph, ComponentIndex *index, error_info_t *err_info) {
+  int *parent = (int *)malloc(graph->num_nodes * sizeof(int));
+  CHECK_ALLOCATION(parent, err_info);
+
+  for (int i = 0; i < graph->num_nodes; i++) {
+    parent[i] = i;
+  }
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    int a = find_group_root(parent, graph->edge_from[e]);
+    int b = find_group_root(parent, graph->edge_to[e]);
+    if (a != b) parent[a] = b;
+  }
+
+  // Number groups densely; every node of a component shares one group
+  int *group_of_root = (int *)malloc(graph->num_nodes * sizeof(int));
+  if (group_of_root == NULL) {
+    free(parent);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for component groups.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  for (int i = 0; i < graph->num_nodes; i++) {
+    group_of_root[i] = -1;
+  }
+
+  index->num_groups = 0;
+  for (int i = 0; i < graph->num_nodes; i++) {
+    int root = find_group_root(parent, i);
+    if (group_of_root[root] < 0) group_of_root[root] = index->num_groups++;
+    index->component_group[index->node_component[i]] = group_of_root[root];
+  }
+
+  free(group_of_root);
+  free(parent);
+  return ERR_SUCCESS;
+}
+
+// ================
+// Strongly connected components
+// ================
+
+/**
+ * Runs Tarjan's algorithm with an explicit call stack over the CSR.
+ * Components are numbered as they complete and their sizes are counted.
+ */
+static error_code_t compute_sccs(const Graph *graph, ComponentIndex *index, int *component_size, error_info_t *err_info) {
+  int num_nodes = graph->num_nodes;
+  const edge_index_t *adj_offsets = graph->adj_offsets;
+  const Arc *arcs = graph->adj_arcs[WEIGHT_DISTANCE];
+  int *component = index->node_component;
+
+  int *order = (int *)malloc(num_nodes * sizeof(int));            // Discovery index
+  int *low = (int *)malloc(num_nodes * sizeof(int));              // Lowest reachable discovery index
+  int *stack = (int *)malloc(num_nodes * sizeof(int));            // Tarjan node stack
+  int *call_node = (int *)malloc(num_nodes * sizeof(int));        // Explicit DFS call stack
+  edge_index_t *call_arc = (edge_index_t *)alloc_array(num_nodes, sizeof(edge_index_t)); // Next arc per frame
+  if (order == NULL || low == NULL || stack == NULL || call_node == NULL || call_arc == NULL) {
+    free(order);
+    free(low);
+    free(stack);
+    free(call_node);
+    free(call_arc);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for component search.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  for (int i = 0; i < num_nodes; i++) {
+    order[i] = -1;
+    component[i] = -1;
+  }
+
+  int next_order = 0;
+  int stack_size = 0;
+  index->num_components = 0;
+
+  for (int root = 0; root < num_nodes; root++) {
+    if (order[root] >= 0) continue;
+
+    int depth = 0;
+    order[root] = low[root] = next_order++;
+    stack[stack_size++] = root;
+    call_node[depth] = root;
+    call_arc[depth++] = adj_offsets[root];
+
+    while (depth > 0) {
+      int v = call_node[depth - 1];
+      edge_index_t i = call_arc[depth - 1];
+
+      if (i < adj_offsets[v + 1]) {
+        call_arc[depth - 1] = i + 1;
+        int w = arcs[i].target;
+        if (order[w] < 0) {
+          // Descend into an undiscovered node
+          order[w] = low[w] = next_order++;
+          stack[stack_size++] = w;
+          call_node[depth] = w;
+          call_arc[depth++] = adj_offsets[w];
+        } else if (component[w] < 0 && order[w] < low[v]) {
+          // Discovered but unassigned nodes are still on the Tarjan stack
+          low[v] = order[w];
+        }
+        continue;
+      }
+
+      // All arcs of v done: close its component if v is the root
+      depth--;
+      if (low[v] == order[v]) {
+        int c = index->num_components++;
+        int size = 0;
+        int w;
+        do {
+          w = stack[--stack_size];
+          component[w] = c;
+          size++;
+        } while (w != v);
+        component_size[c] = size;
+      }
+      if (depth > 0) {
+        int parent = call_node[depth - 1];
+        if (low[v] < low[parent]) low[parent] = low[v];
+      }
+    }
+  }
+
+  free(order);
+  free(low);
+  free(stack);
+  free(call_node);
+  free(call_arc);
+  return ERR_SUCCESS;
+}
+
+// ================
+// Component index
+// ================
+
+void free_component_index(ComponentIndex *components) {
+  if (components == NULL) return;
+
+  free(components->node_component);
+  free(components->component_group);
+  free(components);
+}
+
+error_code_t compute_graph_components(Graph *graph, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+
+  // Chain interiors and pruned trees have no arcs in the routing CSR
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Compute components before pruning or contracting the graph.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  ComponentIndex *index = (ComponentIndex *)calloc(1, sizeof(ComponentIndex));
+  CHECK_ALLOCATION(index, err_info);
+  index->node_component = (int *)malloc(graph->num_nodes * sizeof(int));
+  int *component_size = (int *)malloc(graph->num_nodes * sizeof(int));
+  if (index->node_component == NULL || component_size == NULL) {
+    free(component_size);
+    free_component_index(index);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for components.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  error_code_t err_code = compute_sccs(graph, index, component_size, err_info);
+  if (err_code == ERR_SUCCESS) {
+    index->largest_component = 0;
+    for (int c = 1; c < index->num_components; c++) {
+      if (component_size[c] > component_size[index->largest_component]) index->largest_component = c;
+    }
+    index->largest_size = component_size[index->largest_component];
+
+    index->component_group = (int *)malloc(index->num_components * sizeof(int));
+    if (index->component_group == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for component groups.");
+      err_code = ERR_MEMORY_ALLOCATION;
+    } else {
+      err_code = compute_groups(graph, index, err_info);
+    }
+  }
+  free(component_size);
+
+  if (err_code != ERR_SUCCESS) {
+    free_component_index(index);
+    return err_code;
+  }
+
+  free_component_index(graph->components);
+  graph->components = index;
+  return ERR_SUCCESS;
+}
+
+bool component_may_reach(const Graph *graph, int source_index, int target_index) {
+  const ComponentIndex *index = graph->components;
+  if (index == NULL) return true;
+
+  int source_component = index->node_component[source_index];
+  int target_component = index->node_component[target_index];
+  if (index->component_group[source_component] != index->component_group[target_component]) return false;
+
+  // Arcs between components only lead to lower component numbers
+  return target_component <= source_component;
+}
+
+bool in_largest_component(const Graph *graph, int node_index) {
+  const ComponentIndex *index = graph->components;
+  return index == NULL || index->node_component[node_index] == index->largest_component;
+}
@@ -0,0 +1,628 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "contract.h"
+#include "reorder.h"
+#include "prune.h"
+#include "traffic.h"
+#include "roadclass.h"
+#include "weighting.h"
+
+// Node states while chains are discovered
+#define NODE_KEPT 0       // Stays in the routing graph
+#define NODE_INTERIOR 1   // Contractible, not assigned to a chain yet
+#define NODE_ASSIGNED 2   // Interior node of an already built chain
+
+// ================
+// Chain discovery helpers
+// ================
+
+/**
+ * Returns the endpoint of an edge opposite to a node.
+ */
+static inline int edge_other_end(const Graph *graph, edge_index_t edge_idx, int node_index) {
+  return graph->edge_from[edge_idx] == node_index ? graph->edge_to[edge_idx] : graph->edge_from[edge_idx];
+}
+
+/**
+ * Tells whether a node with exactly two incident edges can be contracted:
+ * two distinct neighbours, no self-loop, the same road class, and traffic
+ * passing straight through (both edges bidirectional, or both one-way with
+ * one entering and one leaving).
+ */
+static bool is_contractible(const Graph *graph, const edge_index_t *incident, int node_index) {
+  edge_index_t e0 = incident[2 * node_index];
+  edge_index_t e1 = incident[2 * node_index + 1];
+
+  if (graph->edge_from[e0] == graph->edge_to[e0] || graph->edge_from[e1] == graph->edge_to[e1]) return false;
+  if (edge_other_end(graph, e0, node_index) == edge_other_end(graph, e1, node_index)) return false;
+  if (graph->edge_highway[e0] != graph->edge_highway[e1]) return false;
+
+  if (!graph->edge_one_way[e0] && !graph->edge_one_way[e1]) return true;
+  if (graph->edge_one_way[e0] && graph->edge_one_way[e1]) {
+    return (graph->edge_to[e0] == node_index) != (graph->edge_to[e1] == node_index);
+  }
+  return false;
+}
+
+/**
+ * Returns the incident edge of a contractible node leading to a neighbour.
+ */
+static inline edge_index_t edge_towards(const Graph *graph, const edge_index_t *incident, int node_index, int neighbor) {
+  edge_index_t e0 = incident[2 * node_index];
+  return edge_other_end(graph, e0, node_index) == neighbor ? e0 : incident[2 * node_index + 1];
+}
+
+/**
+ * Returns the neighbour of a contractible node other than the one it was entered from.
+ */
+static inline int next_chain_node(const Graph *graph, const edge_index_t *incident, int node_index, int prev) {
+  int n0 = edge_other_end(graph, incident[2 * node_index], node_index);
+  return n0 == prev ? edge_other_end(graph, incident[2 * node_index + 1], node_index) : n0;
+}
+
+/**
+ * Adds the weights of an edge to a running chain cost, saturating below WEIGHT_INFINITY.
+ */
+static void add_edge_weights(const Graph *graph, edge_index_t edge_idx, uint32_t *cost) {
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    uint64_t sum = (uint64_t)cost[m] + compute_edge_weight(graph, edge_idx, (WeightMetric)m);
+    cost[m] = sum >= WEIGHT_INFINITY ? WEIGHT_INFINITY - 1 : (uint32_t)sum;
+  }
+}
+
+// ================
+// Routing CSR
+// ================
+
+/**
+ * Rebuilds the CSR of a renumbered graph with only routing nodes: direct
+ * edges between routing nodes keep their edge index, each chain becomes one
+ * arc (two if bidirectional) with adjacency index CHAIN_ADJ_INDEX(chain).
+ * Loop chains get no arc since they never shorten a route.
+ */
+static error_code_t build_routing_csr(Graph *graph, const ChainIndex *index, error_info_t *err_info) {
+  int num_routing = index->num_routing_nodes;
+  drop_reverse_index(graph);
+  drop_traffic_overlay(graph);
+
+  int *degree = (int *)calloc(graph->num_nodes, sizeof(int));
+  CHECK_ALLOCATION(degree, err_info);
+
+  // First pass: count routing arcs per node
+  for (edge_index_t i = 0; i < graph->num_edges; i++) {
+    if (graph->edge_from[i] >= num_routing || graph->edge_to[i] >= num_routing) continue;
+    degree[graph->edge_from[i]] += 1;
+    if (!graph->edge_one_way[i]) degree[graph->edge_to[i]] += 1;
+  }
+  for (int c = 0; c < index->num_chains; c++) {
+    const Chain *chain = &index->chains[c];
+    if (chain->from == chain->to) continue;
+    degree[chain->from] += 1;
+    if (!chain->one_way) degree[chain->to] += 1;
+  }
+
+  // Interior nodes get empty adjacency ranges
+  graph->adj_offsets[0] = 0;
+  for (int i = 0; i < graph->num_nodes; i++) {
+    graph->adj_offsets[i + 1] = graph->adj_offsets[i] + degree[i];
+  }
+  memset(degree, 0, graph->num_nodes * sizeof(int));
+
+  // Second pass: direct edges in file order, then chain shortcuts
+  for (edge_index_t i = 0; i < graph->num_edges; i++) {
+    int from_index = graph->edge_from[i];
+    int to_index = graph->edge_to[i];
+    if (from_index >= num_routing || to_index >= num_routing) continue;
+
+    edge_index_t pos = graph->adj_offsets[from_index] + degree[from_index]++;
+    graph->adj_indices[pos] = i;
+    for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+      graph->adj_arcs[m][pos].target = to_index;
+      graph->adj_arcs[m][pos].weight = compute_edge_weight(graph, i, (WeightMetric)m);
+    }
+
+    if (!graph->edge_one_way[i]) {
+      pos = graph->adj_offsets[to_index] + degree[to_index]++;
+      graph->adj_indices[pos] = i;
+      for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+        graph->adj_arcs[m][pos].target = from_index;
+        graph->adj_arcs[m][pos].weight = compute_edge_weight(graph, i, (WeightMetric)m);
+      }
+    }
+  }
+  for (int c = 0; c < index->num_chains; c++) {
+    const Chain *chain = &index->chains[c];
+    if (chain->from == chain->to) continue;
+
+    edge_index_t pos = graph->adj_offsets[chain->from] + degree[chain->from]++;
+    graph->adj_indices[pos] = CHAIN_ADJ_INDEX(c);
+    for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+      graph->adj_arcs[m][pos].target = chain->to;
+      graph->adj_arcs[m][pos].weight = chain->total[m];
+    }
+
+    if (!chain->one_way) {
+      pos = graph->adj_offsets[chain->to] + degree[chain->to]++;
+      graph->adj_indices[pos] = CHAIN_ADJ_INDEX(c);
+      for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+        graph->adj_arcs[m][pos].target = chain->from;
+        graph->adj_arcs[m][pos].weight = chain->total[m];
+      }
+    }
+  }
+
+  free(degree);
+  return rebuild_road_filter(graph, index, err_info);
+}
+
+// ================
+// Contraction
+// ================
+
+/**
+ * Allocates an empty chain index for up to num_interior interior nodes.
+ */
+static ChainIndex *create_chain_index(int num_interior) {
+  ChainIndex *index = (ChainIndex *)calloc(1, sizeof(ChainIndex));
+  if (index == NULL) return NULL;
+
+  size_t count = num_interior > 0 ? (size_t)num_interior : 1;
+  index->chains = (Chain *)alloc_array(count, sizeof(Chain));
+  index->interior_chain = (int *)alloc_array(count, sizeof(int));
+  bool ok = index->chains != NULL && index->interior_chain != NULL;
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    index->prefix[m] = (uint32_t *)alloc_array(count, sizeof(uint32_t));
+    ok = ok && index->prefix[m] != NULL;
+  }
+  if (!ok) {
+    free_chain_index(index);
+    return NULL;
+  }
+  return index;
+}
+
+void free_chain_index(ChainIndex *chains) {
+  if (chains == NULL) return;
+
+  free(chains->chains);
+  free(chains->interior_chain);
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    free(chains->prefix[m]);
+  }
+  free(chains);
+}
+
+error_code_t contract_degree2_chains(Graph *graph, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+
+  if (graph->chains != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Graph is already contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->weightings != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Weighting profiles need a graph that is not contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int num_nodes = graph->num_nodes;
+  uint8_t *state = (uint8_t *)calloc(num_nodes, sizeof(uint8_t));
+  int *incident_count = (int *)calloc(num_nodes, sizeof(int));
+  edge_index_t *incident = (edge_index_t *)alloc_array(2 * (size_t)num_nodes, sizeof(edge_index_t));
+  if (state == NULL || incident_count == NULL || incident == NULL) {
+    free(state);
+    free(incident_count);
+    free(incident);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for chain contraction.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Pruned trees stay outside the chains, and so do the core nodes they hang off
+  int num_core = graph->pruned != NULL ? graph->pruned->num_core_nodes : num_nodes;
+
+  // Record up to two incident edges per node, regardless of direction
+  for (edge_index_t i = 0; i < graph->num_edges; i++) {
+    int ends[2] = { graph->edge_from[i], graph->edge_to[i] };
+    if (ends[0] >= num_core || ends[1] >= num_core) {
+      incident_count[ends[0]] = 3;
+      incident_count[ends[1]] = 3;
+      continue;
+    }
+    for (int k = 0; k < 2; k++) {
+      int count = incident_count[ends[k]];
+      if (count < 2) incident[2 * ends[k] + count] = i;
+      if (count < 3) incident_count[ends[k]] = count + 1;
+    }
+  }
+
+  int num_interior = 0;
+  for (int v = 0; v < num_nodes; v++) {
+    if (incident_count[v] == 2 && is_contractible(graph, incident, v)) {
+      state[v] = NODE_INTERIOR;
+      num_interior++;
+    }
+  }
+  free(incident_count);
+
+  ChainIndex *index = create_chain_index(num_interior);
+  int *interior_order = (int *)alloc_array(num_interior > 0 ? (size_t)num_interior : 1, sizeof(int));
+  if (index == NULL || interior_order == NULL) {
+    free_chain_index(index);
+    free(interior_order);
+    free(state);
+    free(incident);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for chains.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Walk every chain once, in travel order for one-way chains
+  int num_assigned = 0;
+  for (int v = 0; v < num_nodes; v++) {
+    if (state[v] != NODE_INTERIOR) continue;
+
+    edge_index_t e0 = incident[2 * v];
+    edge_index_t e_in = (graph->edge_one_way[e0] && graph->edge_to[e0] != v) ? incident[2 * v + 1] : e0;
+    int back = edge_other_end(graph, e_in, v);
+
+    // Walk backwards to the routing node the chain starts at
+    int prev = v;
+    int current = back;
+    while (state[current] == NODE_INTERIOR && current != v) {
+      int next = next_chain_node(graph, incident, current, prev);
+      prev = current;
+      current = next;
+    }
+
+    int start, first;
+    if (current == v) {
+      // Closed cycle of contractible nodes: keep v as its routing node
+      state[v] = NODE_KEPT;
+      num_interior--;
+      start = v;
+      first = next_chain_node(graph, incident, v, back);
+    } else {
+      start = current;
+      first = prev;
+    }
+
+    // Walk forwards assigning interior nodes and accumulating costs
+    Chain *chain = &index->chains[index->num_chains];
+    chain->from = start;
+    chain->first = num_assigned;
+    chain->one_way = graph->edge_one_way[edge_towards(graph, incident, first, start)] != 0;
+    chain->highway_type = graph->edge_highway[edge_towards(graph, incident, first, start)];
+    uint32_t cost[WEIGHT_NUM_METRICS] = { 0 };
+
+    prev = start;
+    current = first;
+    while (state[current] == NODE_INTERIOR) {
+      add_edge_weights(graph, edge_towards(graph, incident, current, prev), cost);
+      for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+        index->prefix[m][num_assigned] = cost[m];
+      }
+      index->interior_chain[num_assigned] = index->num_chains;
+      interior_order[num_assigned++] = current;
+      state[current] = NODE_ASSIGNED;
+
+      int next = next_chain_node(graph, incident, current, prev);
+      prev = current;
+      current = next;
+    }
+    add_edge_weights(graph, edge_towards(graph, incident, prev, current), cost);
+
+    chain->to = current;
+    chain->num_interior = num_assigned - chain->first;
+    memcpy(chain->total, cost, sizeof(cost));
+    index->num_chains++;
+  }
+  free(incident);
+
+  // Routing nodes keep their relative order, interiors follow chain by chain
+  // and pruned nodes keep their place at the end
+  int num_routing = num_core - num_assigned;
+  int *new_to_old = (int *)malloc(num_nodes * sizeof(int));
+  int *routing_rank = (int *)malloc(num_nodes * sizeof(int));
+  if (new_to_old == NULL || routing_rank == NULL) {
+    free(new_to_old);
+    free(routing_rank);
+    free(interior_order);
+    free(state);
+    free_chain_index(index);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for chain renumbering.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  int next_rank = 0;
+  for (int v = 0; v < num_core; v++) {
+    if (state[v] == NODE_KEPT) {
+      routing_rank[v] = next_rank;
+      new_to_old[next_rank++] = v;
+    }
+  }
+  memcpy(new_to_old + num_routing, interior_order, num_assigned * sizeof(int));
+  for (int v = num_core; v < num_nodes; v++) {
+    new_to_old[v] = v;
+  }
+  free(interior_order);
+  free(state);
+
+  for (int c = 0; c < index->num_chains; c++) {
+    Chain *chain = &index->chains[c];
+    chain->from = routing_rank[chain->from];
+    chain->to = routing_rank[chain->to];
+    chain->first += num_routing;
+  }
+  free(routing_rank);
+  index->num_routing_nodes = num_routing;
+  index->num_interior_nodes = num_assigned;
+
+  error_code_t err_code = apply_node_permutation(graph, new_to_old, err_info);
+  free(new_to_old);
+  if (err_code == ERR_SUCCESS) {
+    err_code = build_routing_csr(graph, index, err_info);
+  }
+  if (err_code != ERR_SUCCESS) {
+    free_chain_index(index);
+    return err_code;
+  }
+
+  graph->chains = index;
+  return ERR_SUCCESS;
+}
+
+bool is_chain_interior(const Graph *graph, int node_index) {
+  const ChainIndex *index = graph->chains;
+  return index != NULL && node_index >= index->num_routing_nodes &&
+         node_index < index->num_routing_nodes + index->num_interior_nodes;
+}
+
+// ================
+// Query support
+// ================
+
+/**
+ * Returns the cost from the chain start to a position on the chain, where
+ * -1 is the 'from' end and num_interior is the 'to' end.
+ */
+static inline uint32_t chain_position_cost(const ChainIndex *index, const Chain *chain, WeightMetric metric, int position) {
+  if (position < 0) return 0;
+  if (position >= chain->num_interior) return chain->total[metric];
+  return index->prefix[metric][chain->first + position - index->num_routing_nodes];
+}
+
+error_code_t chain_seed_source(const Graph *graph, WeightMetric metric, int source_index, DijkstraResult *result, MinHeap *heap, error_info_t *err_info) {
+  const ChainIndex *index = graph->chains;
+  int c = index->interior_chain[source_index - index->num_routing_nodes];
+  const Chain *chain = &index->chains[c];
+  uint32_t offset = chain_position_cost(index, chain, metric, source_index - chain->first);
+
+  // A source on an avoided chain reaches nothing but itself
+  if (is_road_class_avoided(graph, chain->highway_type)) {
+    result->visited[source_index] = true;
+    result->settled_count = 1;
+    return ERR_SUCCESS;
+  }
+
+  // Chain ends reached along the chain; a loop chain takes the cheaper side
+  uint32_t to_cost = chain->total[metric] - offset;
+  if (!chain->one_way && chain->from == chain->to && offset < to_cost) to_cost = offset;
+
+  result->distances[chain->to] = to_cost;
+  if (result->predecessors != NULL) result->predecessors[chain->to] = source_index;
+  error_code_t err_code = insert_heap(heap, chain->to, to_cost, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  if (!chain->one_way && chain->from != chain->to) {
+    result->distances[chain->from] = offset;
+    if (result->predecessors != NULL) result->predecessors[chain->from] = source_index;
+    err_code = insert_heap(heap, chain->from, offset, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+
+  // The source itself is final and has no adjacency to relax
+  result->visited[source_index] = true;
+  result->settled_count = 1;
+  return ERR_SUCCESS;
+}
+
+uint32_t chain_target_cost(const Graph *graph, WeightMetric metric, const DijkstraResult *result, int target_index, int *predecessor) {
+  const ChainIndex *index = graph->chains;
+  int c = index->interior_chain[target_index - index->num_routing_nodes];
+  const Chain *chain = &index->chains[c];
+  int position = target_index - chain->first;
+  uint32_t offset = chain_position_cost(index, chain, metric, position);
+  const uint32_t *distances = result->distances;
+
+  uint32_t best = WEIGHT_INFINITY;
+  *predecessor = -1;
+  if (is_road_class_avoided(graph, chain->highway_type)) return best;
+
+  // Entering at the chain start
+  if (result->visited[chain->from] && distances[chain->from] != WEIGHT_INFINITY) {
+    best = distances[chain->from] + offset;
+    *predecessor = chain->from;
+  }
+
+  // Entering at the chain end (bidirectional chains only)
+  if (!chain->one_way && result->visited[chain->to] && distances[chain->to] != WEIGHT_INFINITY) {
+    uint32_t cost = distances[chain->to] + (chain->total[metric] - offset);
+    if (cost < best) {
+      best = cost;
+      *predecessor = chain->to;
+    }
+  }
+
+  // Staying on the chain of the source
+  int source_index = result->source_index;
+  if (is_chain_interior(graph, source_index) &&
+      index->interior_chain[source_index - index->num_routing_nodes] == c) {
+    int source_position = source_index - chain->first;
+    uint32_t source_offset = chain_position_cost(index, chain, metric, source_position);
+    if (source_position < position || !chain->one_way) {
+      uint32_t cost = source_position < position ? offset - source_offset : source_offset - offset;
+      if (cost < best) {
+        best = cost;
+        *predecessor = source_index;
+      }
+    }
+  }
+
+  return best;
+}
+
+void chain_fill_tree(const Graph *graph, WeightMetric metric, DijkstraResult *result) {
+  const ChainIndex *index = graph->chains;
+
+  for (int c = 0; c < index->num_chains; c++) {
+    const Chain *chain = &index->chains[c];
+    for (int k = 0; k < chain->num_interior; k++) {
+      int node_index = chain->first + k;
+      if (node_index == result->source_index) continue;
+
+      int via;
+      uint32_t cost = chain_target_cost(graph, metric, result, node_index, &via);
+      if (cost == WEIGHT_INFINITY) continue;
+
+      result->distances[node_index] = cost;
+      result->visited[node_index] = true;
+      if (result->predecessors == NULL) continue;
+
+      // Predecessor is the adjacent chain node on the side the cost comes from;
+      // the ends of a loop chain coincide and are told apart by the cost
+      bool from_start;
+      if (via != chain->from && via != chain->to) {
+        from_start = via < node_index;
+      } else if (chain->from != chain->to) {
+        from_start = via == chain->from;
+      } else {
+        from_start = cost == result->distances[chain->from] + chain_position_cost(index, chain, metric, k);
+      }
+      if (from_start) {
+        result->predecessors[node_index] = k > 0 ? node_index - 1 : chain->from;
+      } else {
+        result->predecessors[node_index] = k + 1 < chain->num_interior ? node_index + 1 : chain->to;
+      }
+    }
+  }
+}
+
+/**
+ * Lists the interior nodes strictly between two positions of a chain if the
+ * step cost matches travelling between them along the chain.
+ *
+ * @return Number of nodes listed, or -1 if the step does not fit
+ */
+static int expand_chain_positions(const ChainIndex *index, const Chain *chain, WeightMetric metric, uint32_t step_cost, uint32_t base_cost, int from_position, int to_position, int *nodes, uint32_t *costs) {
+  bool forward = from_position < to_position;
+  if (from_position == to_position || (!forward && chain->one_way)) return -1;
+
+  uint32_t from_offset = chain_position_cost(index, chain, metric, from_position);
+  uint32_t to_offset = chain_position_cost(index, chain, metric, to_position);
+  if (step_cost != (forward ? to_offset - from_offset : from_offset - to_offset)) return -1;
+
+  int count = 0;
+  int step = forward ? 1 : -1;
+  for (int k = from_position + step; k != to_position; k += step) {
+    uint32_t offset = chain_position_cost(index, chain, metric, k);
+    if (nodes != NULL) nodes[count] = chain->first + k;
+    if (costs != NULL) costs[count] = base_cost + (forward ? offset - from_offset : from_offset - offset);
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Collects the positions a node can take on a chain: its interior position,
+ * -1 as the chain start and num_interior as the chain end.
+ */
+static int chain_positions(const Chain *chain, int node_index, bool interior, int positions[2]) {
+  if (interior) {
+    positions[0] = node_index - chain->first;
+    return 1;
+  }
+  int count = 0;
+  if (node_index == chain->from) positions[count++] = -1;
+  if (node_index == chain->to) positions[count++] = chain->num_interior;
+  return count;
+}
+
+/**
+ * Expands a step along one chain, trying every position pair of its ends.
+ */
+static int expand_chain_step(const Graph *graph, int c, WeightMetric metric, const uint32_t *distances, int from_index, int to_index, int *nodes, uint32_t *costs) {
+  const ChainIndex *index = graph->chains;
+  const Chain *chain = &index->chains[c];
+  int from_positions[2], to_positions[2];
+  int num_from = chain_positions(chain, from_index, is_chain_interior(graph, from_index), from_positions);
+  int num_to = chain_positions(chain, to_index, is_chain_interior(graph, to_index), to_positions);
+  uint32_t step_cost = distances[to_index] - distances[from_index];
+
+  for (int i = 0; i < num_from; i++) {
+    for (int j = 0; j < num_to; j++) {
+      int count = expand_chain_positions(index, chain, metric, step_cost, distances[from_index],
+                                         from_positions[i], to_positions[j], nodes, costs);
+      if (count >= 0) return count;
+    }
+  }
+  return -1;
+}
+
+int chain_expand_step(const Graph *graph, WeightMetric metric, const uint32_t *distances, int from_index, int to_index, int *nodes, uint32_t *costs) {
+  const ChainIndex *index = graph->chains;
+  bool from_interior = is_chain_interior(graph, from_index);
+  bool to_interior = is_chain_interior(graph, to_index);
+
+  // Steps touching an interior node stay on that node's chain
+  if (from_interior || to_interior) {
+    int c = index->interior_chain[(from_interior ? from_index : to_index) - index->num_routing_nodes];
+    if (from_interior && to_interior && index->interior_chain[to_index - index->num_routing_nodes] != c) return -1;
+    return expand_chain_step(graph, c, metric, distances, from_index, to_index, nodes, costs);
+  }
+
+  // Routing step: a direct edge, or a chain shortcut with a matching weight
+  uint32_t step_cost = distances[to_index] - distances[from_index];
+  const Arc *arcs = graph->adj_arcs[metric];
+  const uint64_t *avoided_arcs = road_filter_arcs(graph);
+  int chain_match = -1;
+  for (edge_index_t i = graph->adj_offsets[from_index]; i < graph->adj_offsets[from_index + 1]; i++) {
+    if (arcs[i].target != to_index || arcs[i].weight != step_cost) continue;
+    if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+    if (graph->adj_indices[i] >= 0) return 0;
+    if (chain_match < 0) chain_match = ADJ_INDEX_CHAIN(graph->adj_indices[i]);
+  }
+  if (chain_match < 0) return -1;
+  return expand_chain_step(graph, chain_match, metric, distances, from_index, to_index, nodes, costs);
+}
+
+int chain_expand_arc(const Graph *graph, WeightMetric metric, int from_index, edge_index_t arc_index, uint32_t from_cost, int *nodes, uint32_t *costs) {
+  edge_index_t edge_index = graph->adj_indices[arc_index];
+  if (edge_index >= 0) return 0; // Direct edge
+
+  const ChainIndex *index = graph->chains;
+  const Chain *chain = &index->chains[ADJ_INDEX_CHAIN(edge_index)];
+  bool forward = from_index == chain->from;
+  int from_position = forward ? -1 : chain->num_interior;
+  int to_position = forward ? chain->num_interior : -1;
+  return expand_chain_positions(index, chain, metric, chain->total[metric], from_cost,
+                                from_position, to_position, nodes, costs);
+}
+
+uint32_t chain_span_cost(const Graph *graph, WeightMetric metric, int chain_index, int from_position, int to_position) {
+  const ChainIndex *index = graph->chains;
+  const Chain *chain = &index->chains[chain_index];
+  if (from_position == to_position || (from_position > to_position && chain->one_way)) return WEIGHT_INFINITY;
+
+  uint32_t from_offset = chain_position_cost(index, chain, metric, from_position);
+  uint32_t to_offset = chain_position_cost(index, chain, metric, to_position);
+  return from_position < to_position ? to_offset - from_offset : from_offset - to_offset;
+}
+
+int chain_expand_span(const Graph *graph, WeightMetric metric, int chain_index, int from_position, int to_position, uint32_t from_cost, int *nodes, uint32_t *costs) {
+  uint32_t span_cost = chain_span_cost(graph, metric, chain_index, from_position, to_position);
+  if (span_cost == WEIGHT_INFINITY) return -1;
+
+  const ChainIndex *index = graph->chains;
+  return expand_chain_positions(index, &index->chains[chain_index], metric, span_cost, from_cost,
+                                from_position, to_position, nodes, costs);
+}
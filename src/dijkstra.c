@@ -1,223 +1,372 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
 #include "dijkstra.h"
+#include "min_heap.h"
+#include "contract.h"
+#include "components.h"
+#include "prune.h"
+#include "roadclass.h"
+#include "weighting.h"
+#include "traffic.h"
 
 #define INFINITY_DBL DBL_MAX
 
 // =================
-// MinHeap Data Structures
+// Specialized Search Kernels
 // =================
 
-typedef struct {
-  int node_index;
-  double distance;
-} HeapNode;
-
-typedef struct {
-  HeapNode *nodes;
-  int size;
-  int capacity;
-} MinHeap;
+// One kernel per (road filter, target, predecessor tracking) combination,
+// generated from dijkstra_kernel.inc so the hot loop carries no flag checks;
+// the filtered kernels only run while road classes are avoided
+
+#define KERNEL_NAME dijkstra_kernel_tree
+#define KERNEL_HAS_TARGET 0
+#define KERNEL_TRACK_PREDECESSORS 0
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 0
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_tree_pred
+#define KERNEL_HAS_TARGET 0
+#define KERNEL_TRACK_PREDECESSORS 1
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 0
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_target
+#define KERNEL_HAS_TARGET 1
+#define KERNEL_TRACK_PREDECESSORS 0
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 0
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_target_pred
+#define KERNEL_HAS_TARGET 1
+#define KERNEL_TRACK_PREDECESSORS 1
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 0
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_tree_filtered
+#define KERNEL_HAS_TARGET 0
+#define KERNEL_TRACK_PREDECESSORS 0
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 1
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_tree_pred_filtered
+#define KERNEL_HAS_TARGET 0
+#define KERNEL_TRACK_PREDECESSORS 1
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 1
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_target_filtered
+#define KERNEL_HAS_TARGET 1
+#define KERNEL_TRACK_PREDECESSORS 0
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 1
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_target_pred_filtered
+#define KERNEL_HAS_TARGET 1
+#define KERNEL_TRACK_PREDECESSORS 1
+#define KERNEL_TARGET_SET 0
+#define KERNEL_FILTERED 1
+#include "dijkstra_kernel.inc"
+
+// Multi-target searches stop on a set of targets and always record paths
+#define KERNEL_NAME dijkstra_kernel_target_set_pred
+#define KERNEL_HAS_TARGET 0
+#define KERNEL_TRACK_PREDECESSORS 1
+#define KERNEL_TARGET_SET 1
+#define KERNEL_FILTERED 0
+#include "dijkstra_kernel.inc"
+
+#define KERNEL_NAME dijkstra_kernel_target_set_pred_filtered
+#define KERNEL_HAS_TARGET 0
+#define KERNEL_TRACK_PREDECESSORS 1
+#define KERNEL_TARGET_SET 1
+#define KERNEL_FILTERED 1
+#include "dijkstra_kernel.inc"
+
+typedef error_code_t (*DijkstraKernelFn)(const Graph *graph, const Arc *arcs, MinHeap *heap, DijkstraResult *result, error_info_t *err_info);
+
+// Dispatch table indexed by [filtered][has_target][track_predecessors]
+static const DijkstraKernelFn DIJKSTRA_KERNELS[2][2][2] = {
+  {
+    { dijkstra_kernel_tree, dijkstra_kernel_tree_pred },
+    { dijkstra_kernel_target, dijkstra_kernel_target_pred },
+  },
+  {
+    { dijkstra_kernel_tree_filtered, dijkstra_kernel_tree_pred_filtered },
+    { dijkstra_kernel_target_filtered, dijkstra_kernel_target_pred_filtered },
+  },
+};
 
 // =================
-// MinHeap Function Prototypes
+// Search Building Blocks
 // =================
 
 /**
- * Creates a new min-heap with specified capacity.
- * 
- * @param heap Pointer to heap pointer to initialize
- * @param capacity Maximum number of elements the heap can hold
- * @param err_info Error reporting structure
- * @return ERR_SUCCESS on success, error code otherwise
- * 
- * @pre heap and err_info must be non-NULL
- * @pre capacity must be positive
- * @post On success: *heap points to a valid MinHeap structure
- *       On failure: *heap is undefined
- * @note The caller must call free_heap() to free allocated memory
+ * Records the final cost of a node reached without the search kernel
+ * (chain interiors and dead-end tree nodes).
  */
-static error_code_t create_heap(MinHeap **heap, int capacity, error_info_t *err_info) {
-  // Null check for err_info is already done in the caller function
-  CHECK_NULL(heap, err_info);
-
-  if (capacity <= 0) {
-    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Heap capacity must be positive.");
-    return ERR_INVALID_ARGUMENT;
-  }
-
-  *heap = (MinHeap *)malloc(sizeof(MinHeap));
-  CHECK_ALLOCATION(*heap, err_info);
+static void settle_off_core(DijkstraResult *result, int node_index, uint32_t cost, int predecessor) {
+  result->distances[node_index] = cost;
+  result->visited[node_index] = true;
+  if (result->predecessors != NULL) result->predecessors[node_index] = predecessor;
+}
 
-  (*heap)->nodes = (HeapNode *)malloc(capacity * sizeof(HeapNode));
-  if ((*heap)->nodes == NULL) {
-    free(*heap);
-    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for heap nodes.");
-    return ERR_MEMORY_ALLOCATION;
+/**
+ * Relaxes the arcs of the node a target kernel stopped at. The kernel breaks
+ * before relaxing its target, so this is what lets a later run continue the
+ * same search.
+ */
+static error_code_t expand_stopped_node(const Graph *graph, const Arc *arcs, MinHeap *heap, DijkstraResult *result, int node_index, error_info_t *err_info) {
+  const uint64_t *avoided_arcs = road_filter_arcs(graph);
+  uint32_t current_distance = result->distances[node_index];
+  for (edge_index_t i = graph->adj_offsets[node_index]; i < graph->adj_offsets[node_index + 1]; i++) {
+    if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+    int neighbor = arcs[i].target;
+    if (result->visited[neighbor]) continue;
+
+    uint64_t new_distance = (uint64_t)current_distance + arcs[i].weight;
+    if (new_distance < result->distances[neighbor]) {
+      result->distances[neighbor] = (uint32_t)new_distance;
+      if (result->predecessors != NULL) result->predecessors[neighbor] = node_index;
+      error_code_t err_code = insert_heap(heap, neighbor, (uint32_t)new_distance, err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+    }
   }
-
-  (*heap)->size = 0;
-  (*heap)->capacity = capacity;
-
   return ERR_SUCCESS;
 }
 
 /**
- * Frees memory allocated for MinHeap structure.
- * 
- * @param heap Pointer to MinHeap structure to free
- * 
- * @pre None
- * @post All allocated memory in heap is freed
- * @note Safe to call with NULL pointer
+ * Settles a routing node, continuing the search where the previous target
+ * kernel run stopped.
+ *
+ * @param stopped_index In: node the previous run stopped at without relaxing
+ *        its arcs, or -1. Out: the same for this run
  */
-static void free_heap(MinHeap *heap) {
-  if (heap == NULL) return;
-  free(heap->nodes);
-  free(heap);
+static error_code_t settle_routing_node(const Graph *graph, const Arc *arcs, MinHeap *heap, bool track_predecessors, int *stopped_index, DijkstraResult *result, int node_index, error_info_t *err_info) {
+  if (result->visited[node_index]) return ERR_SUCCESS;
+
+  error_code_t err_code;
+  if (*stopped_index >= 0) {
+    err_code = expand_stopped_node(graph, arcs, heap, result, *stopped_index, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+    *stopped_index = -1;
+  }
+
+  result->target_index = node_index;
+  result->target_found = false;
+  err_code = DIJKSTRA_KERNELS[road_filter_arcs(graph) != NULL][1][track_predecessors ? 1 : 0](graph, arcs, heap, result, err_info);
+  if (err_code == ERR_SUCCESS && result->target_found) *stopped_index = node_index;
+  return err_code;
 }
 
 /**
- * Swaps two heap nodes.
- * 
- * @param a Pointer to first heap node
- * @param b Pointer to second heap node
- * 
- * @pre a and b must be non-NULL
- * @post Contents of a and b are swapped
+ * Settles a core node. Kernels only see routing nodes: a chain interior is
+ * resolved from the chain ends it can be entered from.
  */
-static void swap_heap_nodes(HeapNode *a, HeapNode *b) {
-  HeapNode tmp = *a;
-  *a = *b;
-  *b = tmp;
+static error_code_t settle_core_node(const Graph *graph, const Arc *arcs, WeightMetric metric, MinHeap *heap, bool track_predecessors, int *stopped_index, DijkstraResult *result, int node_index, error_info_t *err_info) {
+  if (!is_chain_interior(graph, node_index)) {
+    return settle_routing_node(graph, arcs, heap, track_predecessors, stopped_index, result, node_index, err_info);
+  }
+  if (result->visited[node_index]) return ERR_SUCCESS;
+
+  const ChainIndex *index = graph->chains;
+  const Chain *chain = &index->chains[index->interior_chain[node_index - index->num_routing_nodes]];
+  int ends[2] = { chain->from, chain->to };
+  int num_ends = (chain->one_way || chain->from == chain->to) ? 1 : 2;
+
+  for (int k = 0; k < num_ends; k++) {
+    error_code_t err_code = settle_routing_node(graph, arcs, heap, track_predecessors, stopped_index, result, ends[k], err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+
+  int predecessor;
+  uint32_t cost = chain_target_cost(graph, metric, result, node_index, &predecessor);
+  if (cost != WEIGHT_INFINITY) settle_off_core(result, node_index, cost, predecessor);
+  return ERR_SUCCESS;
 }
 
 /**
- * Checks if the heap is empty.
- * 
- * @param heap Pointer to MinHeap structure
- * @return true if heap is empty, false otherwise
- * 
- * @pre heap must be non-NULL
+ * Resolves a target of a search that may already have settled it. A pruned
+ * target is reached through the root of its dead-end tree, or along the tree
+ * when the source hangs off the same tree.
+ *
+ * @post result->target_index is target_index and result->target_found tells
+ *       whether it is reached
  */
-static bool is_heap_empty(MinHeap *heap) {
-  return (heap->size == 0);
+static error_code_t resolve_target(const Graph *graph, const Arc *arcs, WeightMetric metric, MinHeap *heap, bool track_predecessors, int *stopped_index, DijkstraResult *result, int target_index, error_info_t *err_info) {
+  error_code_t err_code = ERR_SUCCESS;
+  int source_index = result->source_index;
+  int root_index = prune_tree_root(graph, target_index);
+
+  if (!result->visited[target_index]) {
+    if (root_index != target_index && root_index == prune_tree_root(graph, source_index)) {
+      // Source and target share a dead-end tree: every route follows the tree path
+      uint32_t cost = prune_tree_path_cost(graph, metric, source_index, target_index);
+      if (cost != WEIGHT_INFINITY) settle_off_core(result, target_index, cost, source_index);
+    } else {
+      err_code = settle_core_node(graph, arcs, metric, heap, track_predecessors, stopped_index, result, root_index, err_info);
+      if (err_code == ERR_SUCCESS && root_index != target_index && result->visited[root_index]) {
+        uint32_t link_cost = prune_tree_path_cost(graph, metric, root_index, target_index);
+        if (link_cost != WEIGHT_INFINITY) {
+          settle_off_core(result, target_index, result->distances[root_index] + link_cost, root_index);
+        }
+      }
+    }
+  }
+
+  result->target_index = target_index;
+  result->target_found = result->visited[target_index];
+  return err_code;
 }
 
 /**
- * Maintains the min-heap property by bubbling down from given index.
- * 
- * @param heap Pointer to MinHeap structure
- * @param idx Index to start heapify from
- * 
- * @pre heap must be non-NULL and valid
- * @pre idx must be within valid range
- * @post Min-heap property is maintained
+ * Queues the start of a search: a pruned source climbs its tree to the core,
+ * a contracted source starts from the ends of its chain.
  */
-static void min_heapify(MinHeap *heap, int idx) {
-  int smallest = idx;
-  int left = 2 * idx + 1;
-  int right = 2 * idx + 2;
-
-  if (left < heap->size && heap->nodes[left].distance < heap->nodes[smallest].distance) {
-    smallest = left;
-  }
-  if (right < heap->size && heap->nodes[right].distance < heap->nodes[smallest].distance) {
-    smallest = right;
+static error_code_t seed_search(const Graph *graph, WeightMetric metric, int source_index, MinHeap *heap, DijkstraResult *result, error_info_t *err_info) {
+  if (is_pruned_node(graph, source_index)) {
+    uint32_t root_cost = prune_seed_source(graph, metric, source_index, result);
+    if (root_cost == WEIGHT_INFINITY) return ERR_SUCCESS;
+    return insert_heap(heap, prune_tree_root(graph, source_index), root_cost, err_info);
   }
-  
-  if (smallest != idx) {
-    swap_heap_nodes(&heap->nodes[idx], &heap->nodes[smallest]);
-    min_heapify(heap, smallest);
+  if (is_chain_interior(graph, source_index)) {
+    return chain_seed_source(graph, metric, source_index, result, heap, err_info);
   }
+  return insert_heap(heap, source_index, 0, err_info);
 }
 
 /**
- * Inserts a new node into the min-heap.
- * 
- * @param heap Pointer to MinHeap structure
- * @param node_index Index of the node to insert
- * @param distance Distance value for the node
- * @param err_info Error reporting structure
- * @return ERR_SUCCESS on success, error code otherwise
- * 
- * @pre heap and err_info must be non-NULL
- * @pre heap must have available capacity
- * @post Node is inserted and min-heap property is maintained
+ * Allocates and initializes the arrays of a search result.
+ *
+ * @post On success: every node is unreached except the source at cost 0
+ *       On failure: nothing is left allocated
  */
-static error_code_t insert_heap(MinHeap *heap, int node_index, double distance, error_info_t *err_info) {
-  // Null check for err_info is already done in the caller function
-  CHECK_NULL(heap, err_info);
-
-  if (heap->size >= heap->capacity) {
-    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Heap is full, cannot insert new node.");
+static error_code_t init_search_result(const Graph *graph, int source_index, int target_index, DijkstraMode mode, bool track_predecessors, DijkstraResult *result, error_info_t *err_info) {
+  // Initialize distance array
+  result->distances = (uint32_t *)malloc(graph->num_nodes * sizeof(uint32_t));
+  if (result->distances == NULL) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for distances.");
     return ERR_MEMORY_ALLOCATION;
   }
 
-  int i = heap->size++;
-  heap->nodes[i].node_index = node_index;
-  heap->nodes[i].distance = distance;
+  // Initialize predecessor array (only when paths will be extracted)
+  result->predecessors = NULL;
+  if (track_predecessors) {
+    result->predecessors = (int *)malloc(graph->num_nodes * sizeof(int));
+    if (result->predecessors == NULL) {
+      free(result->distances);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for predecessors.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    for (int i = 0; i < graph->num_nodes; i++) {
+      result->predecessors[i] = -1;
+    }
+  }
 
-  while (i != 0 && heap->nodes[(i - 1) / 2].distance > heap->nodes[i].distance) {
-    swap_heap_nodes(&heap->nodes[i], &heap->nodes[(i - 1) / 2]);
-    i = (i - 1) / 2;
+  // Initialize visited array
+  result->visited = (bool *)calloc(graph->num_nodes, sizeof(bool));
+  if (result->visited == NULL) {
+    free(result->distances);
+    free(result->predecessors);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for visited nodes.");
+    return ERR_MEMORY_ALLOCATION;
   }
 
+  // Initialize distances with default values
+  for (int i = 0; i < graph->num_nodes; i++) {
+    result->distances[i] = WEIGHT_INFINITY;
+  }
+
+  // Set source node distance to zero and initialize result structure
+  result->distances[source_index] = 0;
+  result->source_index = source_index;
+  result->target_index = target_index;
+  result->num_nodes = graph->num_nodes;
+  result->settled_count = 0;
+  result->target_found = false;
+  result->mode = mode;
   return ERR_SUCCESS;
 }
 
+// =================
+// Dijkstra's Algorithm Implementation
+// =================
+
 /**
- * Extracts the minimum node from the heap.
+ * Runs Dijkstra's algorithm from a source index, optionally stopping at a target.
  * 
- * @param heap Pointer to MinHeap structure
- * @param min_node Pointer to store the extracted minimum node
+ * @param graph Pointer to the graph structure
+ * @param source_index Index of the source node
+ * @param target_index Index of the target node, or -1 to settle every reachable node
+ * @param mode Algorithm mode (shortest distance or fastest time)
+ * @param track_predecessors Whether to record predecessors for path extraction
+ * @param result Pointer to store the algorithm results
  * @param err_info Error reporting structure
  * @return ERR_SUCCESS on success, error code otherwise
  * 
- * @pre heap, min_node, and err_info must be non-NULL
- * @post Minimum node is extracted and min-heap property is maintained
- * @note If heap is empty, min_node is set to invalid values
+ * @pre All pointers must be non-NULL, indices and mode must already be validated
+ * @post On success: result contains distances, visited, settled count and, if
+ *       tracked, predecessors (NULL otherwise)
+ *       On failure: result memory is freed
  */
-static error_code_t extract_min(MinHeap *heap, HeapNode *min_node, error_info_t *err_info) {
-  // Null check for err_info is already done in the caller function
-  CHECK_NULL(heap, err_info);
-  CHECK_NULL(min_node, err_info);
-
-  if (is_heap_empty(heap)) {
-    min_node->node_index = -1;
-    min_node->distance = INFINITY_DBL;
+static error_code_t run_dijkstra(Graph *graph, int source_index, int target_index, DijkstraMode mode, bool track_predecessors, DijkstraResult *result, error_info_t *err_info) {
+  error_code_t err_code = init_search_result(graph, source_index, target_index, mode, track_predecessors, result, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  // Targets ruled out by the component index are answered without a search
+  if (target_index >= 0 && !component_may_reach(graph, source_index, target_index)) {
     return ERR_SUCCESS;
   }
 
-  if (heap->size == 1) {
-    *min_node = heap->nodes[0];
-    heap->size--;
-    return ERR_SUCCESS;
+  // Create and initialize priority queue (min-heap)
+  MinHeap *heap;
+  err_code = create_heap(&heap, graph->num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free_dijkstra_result(result);
+    return err_code;
+  }
+
+  // Select the packed adjacency stream for the requested mode, pinned for the search
+  int ticket = traffic_read_begin(graph);
+  WeightMetric metric = dijkstra_mode_metric(mode);
+  const Arc *arcs = dijkstra_mode_arcs(graph, mode);
+
+  err_code = seed_search(graph, metric, source_index, heap, result, err_info);
+  if (err_code == ERR_SUCCESS && target_index >= 0) {
+    int stopped_index = -1;
+    err_code = resolve_target(graph, arcs, metric, heap, track_predecessors, &stopped_index, result, target_index, err_info);
+  } else if (err_code == ERR_SUCCESS) {
+    // No target: settle the whole core, then derive chain interiors and trees
+    err_code = DIJKSTRA_KERNELS[road_filter_arcs(graph) != NULL][0][track_predecessors ? 1 : 0](graph, arcs, heap, result, err_info);
+    if (err_code == ERR_SUCCESS && graph->chains != NULL) chain_fill_tree(graph, metric, result);
+    if (err_code == ERR_SUCCESS && graph->pruned != NULL) prune_fill_tree(graph, metric, result);
   }
+  traffic_read_end(graph, ticket);
 
-  *min_node = heap->nodes[0];
-  heap->nodes[0] = heap->nodes[heap->size - 1];
-  heap->size--;
-  
-  min_heapify(heap, 0);
+  free_heap(heap);
+  if (err_code != ERR_SUCCESS) {
+    free_dijkstra_result(result);
+    return err_code;
+  }
   return ERR_SUCCESS;
 }
 
-// =================
-// Dijkstra's Algorithm Implementation
-// =================
-
 error_code_t dijkstra_shortest_path(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info) {
   // Input validation - ensure all required parameters are provided
   CHECK_NULL(err_info, err_info);
   CHECK_NULL(graph, err_info);
   CHECK_NULL(result, err_info);
 
-  if (mode != DIJKSTRA_SHORTEST_DISTANCE && mode != DIJKSTRA_FASTEST_TIME) {
-    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid Dijkstra mode.");
-    return ERR_INVALID_ARGUMENT;
-  }
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
   if (source_node_id == target_node_id) {
     SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
     return ERR_INVALID_ARGUMENT;
@@ -231,152 +380,284 @@ error_code_t dijkstra_shortest_path(Graph *graph, uint32_t source_node_id, uint3
   err_code = find_node_index(graph, target_node_id, &target_index, err_info);
   if (err_code != ERR_SUCCESS) return err_code;
 
-  // Initialize distance array
-  result->distances = (double *)malloc(graph->num_nodes * sizeof(double));
-  if (result->distances == NULL) {
-    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for distances.");
-    return ERR_MEMORY_ALLOCATION;
-  }
+  return run_dijkstra(graph, source_index, target_index, mode, true, result, err_info);
+}
 
-  // Initialize predecessor array
-  result->predecessors = (int *)malloc(graph->num_nodes * sizeof(int));
-  if (result->predecessors == NULL) {
-    free(result->distances);
-    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for predecessors.");
-    return ERR_MEMORY_ALLOCATION;
-  }
+error_code_t dijkstra_shortest_cost(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info) {
+  // Input validation - ensure all required parameters are provided
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(result, err_info);
 
-  // Initialize visited array
-  result->visited = (bool *)malloc(graph->num_nodes * sizeof(bool));
-  if (result->visited == NULL) {
-    free(result->distances);
-    free(result->predecessors);
-    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for visited nodes.");
-    return ERR_MEMORY_ALLOCATION;
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+  if (source_node_id == target_node_id) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
   }
 
-  // Initialize all arrays with default values
-  for (int i = 0; i < graph->num_nodes; i++) {
-    result->distances[i] = INFINITY_DBL;
-    result->predecessors[i] = -1;
-    result->visited[i] = false;
-  }
+  int source_index, target_index;
+  error_code_t err_code;
+  err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
 
-  // Set source node distance to zero and initialize result structure
-  result->distances[source_index] = 0.0;
-  result->source_index = source_index;
-  result->target_index = target_index;
-  result->num_nodes = graph->num_nodes;
-  result->target_found = false;
+  // Same search without predecessor bookkeeping
+  return run_dijkstra(graph, source_index, target_index, mode, false, result, err_info);
+}
 
-  // Create and initialize priority queue (min-heap)
-  MinHeap *heap;
-  err_code = create_heap(&heap, graph->num_nodes, err_info);
+error_code_t dijkstra_shortest_path_tree(Graph *graph, uint32_t source_node_id, DijkstraMode mode, DijkstraResult *result, error_info_t *err_info) {
+  // Input validation - ensure all required parameters are provided
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(result, err_info);
+
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+
+  int source_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  // No target: the search settles every node reachable from the source
+  return run_dijkstra(graph, source_index, -1, mode, true, result, err_info);
+}
+
+// =================
+// Search Sessions
+// =================
+
+error_code_t dijkstra_session_open(Graph *graph, uint32_t source_node_id, DijkstraMode mode, DijkstraSession *session, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(session, err_info);
+
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+
+  int source_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  session->graph = graph;
+  session->heap = NULL;
+  session->stopped_index = -1;
+  session->weight_version = __atomic_load_n(&graph->weight_version, __ATOMIC_ACQUIRE);
+  err_code = init_search_result(graph, source_index, -1, mode, true, &session->result, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  err_code = create_heap(&session->heap, graph->num_nodes, err_info);
   if (err_code != ERR_SUCCESS) {
-    free_dijkstra_result(result);
+    session->heap = NULL;
+    dijkstra_session_close(session);
     return err_code;
   }
 
-  err_code = insert_heap(heap, source_index, 0.0, err_info);
+  err_code = seed_search(graph, dijkstra_mode_metric(mode), source_index, session->heap, &session->result, err_info);
   if (err_code != ERR_SUCCESS) {
-    free_heap(heap);
-    free_dijkstra_result(result);
+    dijkstra_session_close(session);
     return err_code;
   }
+  return ERR_SUCCESS;
+}
 
-  // Main Dijkstra algorithm loop
-  while (!is_heap_empty(heap)) {
-    HeapNode min_node;
-    err_code = extract_min(heap, &min_node, err_info);
-    if (err_code != ERR_SUCCESS) {
-      free_heap(heap);
-      free_dijkstra_result(result);
-      return err_code;
-    }
+error_code_t dijkstra_session_query(DijkstraSession *session, uint32_t target_node_id, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(session, err_info);
 
-    int current_index = min_node.node_index;
+  Graph *graph = session->graph;
+  DijkstraResult *result = &session->result;
+  int target_index;
+  error_code_t err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  if (target_index == result->source_index) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
+  }
 
-    // Skip if node already visited
-    if (result->visited[current_index]) continue;
-    result->visited[current_index] = true;
+  // The version is checked inside the section, so the pinned streams are the
+  // ones the suspended search started on
+  int ticket = traffic_read_begin(graph);
+  if (__atomic_load_n(&graph->weight_version, __ATOMIC_ACQUIRE) != session->weight_version) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Graph weights changed since the session was opened.");
+    err_code = ERR_INVALID_ARGUMENT;
+  } else if (!component_may_reach(graph, result->source_index, target_index)) {
+    // Targets ruled out by the component index leave the suspended search untouched
+    result->target_index = target_index;
+    result->target_found = false;
+  } else {
+    WeightMetric metric = dijkstra_mode_metric(result->mode);
+    err_code = resolve_target(graph, dijkstra_mode_arcs(graph, result->mode), metric, session->heap, true,
+                              &session->stopped_index, result, target_index, err_info);
+  }
+  traffic_read_end(graph, ticket);
+  return err_code;
+}
 
-    // Check if target node is reached
-    if (current_index == target_index) {
-      result->target_found = true;
-      break;
+void dijkstra_session_close(DijkstraSession *session) {
+  if (session == NULL) return;
+
+  free_heap(session->heap);
+  free_dijkstra_result(&session->result);
+  session->heap = NULL;
+  session->result.distances = NULL;
+  session->result.predecessors = NULL;
+  session->result.visited = NULL;
+}
+
+// =================
+// Multi-Source Search
+// =================
+
+/**
+ * Follows predecessors back to the node a path starts from.
+ */
+static int find_path_origin(const DijkstraResult *result, int node_index) {
+  while (result->predecessors[node_index] != -1) {
+    node_index = result->predecessors[node_index];
+  }
+  return node_index;
+}
+
+/**
+ * Resolves a node ID for a multi-source search. Kernels only settle routing
+ * nodes, so tree and chain nodes of a pruned or contracted graph are refused.
+ */
+static error_code_t find_routing_node(Graph *graph, uint32_t node_id, int *node_index, error_info_t *err_info) {
+  error_code_t err_code = find_node_index(graph, node_id, node_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  if (is_pruned_node(graph, *node_index) || is_chain_interior(graph, *node_index)) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Multi-source search nodes must be routing nodes of a pruned or contracted graph.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Flags the targets of a multi-source search and counts those that some
+ * source may reach according to the component index.
+ */
+static error_code_t mark_search_targets(Graph *graph, const int *source_indices, int num_sources, const uint32_t *target_node_ids, int num_targets, bool *is_target, int *num_reachable, error_info_t *err_info) {
+  *num_reachable = 0;
+  for (int t = 0; t < num_targets; t++) {
+    int target_index;
+    error_code_t err_code = find_routing_node(graph, target_node_ids[t], &target_index, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+    if (is_target[target_index]) continue; // Listed twice
+
+    is_target[target_index] = true;
+    for (int s = 0; s < num_sources; s++) {
+      if (component_may_reach(graph, source_indices[s], target_index)) {
+        (*num_reachable)++;
+        break;
+      }
     }
+  }
+  return ERR_SUCCESS;
+}
+
+error_code_t dijkstra_multi_search(Graph *graph, const DijkstraSource *sources, int num_sources, const uint32_t *target_node_ids, int num_targets, DijkstraMode mode, bool all_targets, DijkstraResult *result, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(sources, err_info);
+  CHECK_NULL(target_node_ids, err_info);
+  CHECK_NULL(result, err_info);
 
-    // Process all adjacent edges using CSR representation
-    int start_idx, end_idx;
-    err_code = get_adjacent_edges_csr(graph, current_index, &start_idx, &end_idx, err_info);
-    if (err_code != ERR_SUCCESS) {
-      free_heap(heap);
-      free_dijkstra_result(result);
-      return err_code;
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+  if (num_sources <= 0 || num_targets <= 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Multi-source search needs at least one source and one target.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int *source_indices = (int *)malloc(num_sources * sizeof(int));
+  CHECK_ALLOCATION(source_indices, err_info);
+  error_code_t err_code = ERR_SUCCESS;
+  for (int s = 0; s < num_sources && err_code == ERR_SUCCESS; s++) {
+    if (sources[s].offset == WEIGHT_INFINITY) {
+      SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source offset must be below WEIGHT_INFINITY.");
+      err_code = ERR_INVALID_ARGUMENT;
+    } else {
+      err_code = find_routing_node(graph, sources[s].node_id, &source_indices[s], err_info);
     }
+  }
+  if (err_code != ERR_SUCCESS) {
+    free(source_indices);
+    return err_code;
+  }
 
-    for (int i = start_idx; i < end_idx; i++) {
-      int edge_idx = graph->adj_indices[i];
-      Edge *edge = &graph->edges[edge_idx];
-
-      // Determine neighbor node index
-      int neighbor = -1;
-      int from_index, to_index;
-      err_code = find_node_index(graph, edge->from_node, &from_index, err_info);
-      if (err_code != ERR_SUCCESS) {
-        free_heap(heap);
-        free_dijkstra_result(result);
-        return err_code;
-      }
-      err_code = find_node_index(graph, edge->to_node, &to_index, err_info);
-      if (err_code != ERR_SUCCESS) {
-        free_heap(heap);
-        free_dijkstra_result(result);
-        return err_code;
-      }
+  err_code = init_search_result(graph, source_indices[0], -1, mode, true, result, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free(source_indices);
+    return err_code;
+  }
+  result->distances[source_indices[0]] = WEIGHT_INFINITY; // Set with the other offsets below
+
+  // One target flag per node
+  bool *is_target = (bool *)calloc(graph->num_nodes, sizeof(bool));
+  MinHeap *heap = NULL;
+  if (is_target == NULL) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for target flags.");
+    err_code = ERR_MEMORY_ALLOCATION;
+  }
 
-      if (from_index == current_index) {
-        neighbor = to_index;
-      } else if (to_index == current_index && !edge->one_way) {
-        neighbor = from_index;
-      }
+  int num_reachable = 0;
+  if (err_code == ERR_SUCCESS) {
+    err_code = mark_search_targets(graph, source_indices, num_sources, target_node_ids, num_targets,
+                                   is_target, &num_reachable, err_info);
+  }
+  if (err_code == ERR_SUCCESS && num_reachable > 0) {
+    err_code = create_heap(&heap, graph->num_nodes, err_info);
+    if (err_code != ERR_SUCCESS) heap = NULL;
+  }
 
-      // Skip invalid or already visited neighbors
-      if (neighbor == -1 || neighbor < 0 || neighbor >= graph->num_nodes) continue;
-      if (result->visited[neighbor]) continue;
-
-      // Calculate new distance based on selected mode
-      double new_distance;
-      if (mode == DIJKSTRA_FASTEST_TIME) {
-        // Calculate travel time in minutes
-        if (edge->speed_limit <= 0) {
-          SET_ERROR(err_info, ERR_INVALID_DATA, "Edge speed must be positive for travel time calculation.");
-          free_heap(heap);
-          free_dijkstra_result(result);
-          return ERR_INVALID_DATA;
-        }
-        double length_km = edge->length / 1000.0; // Convert length to kilometers
-        double travel_time = (length_km / edge->speed_limit) * 60.0; // Convert to minutes
-        new_distance = result->distances[current_index] + travel_time;
-      } else {
-        new_distance = result->distances[current_index] + edge->length;
-      }
+  // Queue every source at its offset; repeated nodes keep the cheapest one
+  for (int s = 0; s < num_sources && err_code == ERR_SUCCESS && heap != NULL; s++) {
+    int source_index = source_indices[s];
+    if (sources[s].offset >= result->distances[source_index]) continue;
+    result->distances[source_index] = sources[s].offset;
+    err_code = insert_heap(heap, source_index, sources[s].offset, err_info);
+  }
 
-      // Update distance if a shorter path is found
-      if (new_distance < result->distances[neighbor]) {
-        result->distances[neighbor] = new_distance;
-        result->predecessors[neighbor] = current_index;
-        err_code = insert_heap(heap, neighbor, new_distance, err_info);
-        if (err_code != ERR_SUCCESS) {
-          free_heap(heap);
-          free_dijkstra_result(result);
-          return err_code;
-        }
-      }
+  if (err_code == ERR_SUCCESS && heap != NULL) {
+    int ticket = traffic_read_begin(graph);
+    const Arc *arcs = dijkstra_mode_arcs(graph, mode);
+    int remaining_targets = all_targets ? num_reachable : 1;
+    if (road_filter_arcs(graph) != NULL) {
+      err_code = dijkstra_kernel_target_set_pred_filtered(graph, arcs, heap, is_target, remaining_targets, result, err_info);
+    } else {
+      err_code = dijkstra_kernel_target_set_pred(graph, arcs, heap, is_target, remaining_targets, result, err_info);
     }
+    traffic_read_end(graph, ticket);
+  }
+  if (err_code == ERR_SUCCESS && result->target_found) {
+    result->source_index = find_path_origin(result, result->target_index);
   }
 
   free_heap(heap);
+  free(is_target);
+  free(source_indices);
+  if (err_code != ERR_SUCCESS) {
+    free_dijkstra_result(result);
+    return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+error_code_t dijkstra_select_target(Graph *graph, DijkstraResult *result, uint32_t target_node_id, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(result, err_info);
+
+  int target_index;
+  error_code_t err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  if (result->predecessors == NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Dijkstra result was computed without predecessors.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  result->target_index = target_index;
+  result->target_found = result->visited[target_index];
+  if (result->target_found) result->source_index = find_path_origin(result, target_index);
   return ERR_SUCCESS;
 }
 
@@ -400,7 +681,118 @@ error_code_t get_shortest_distance(DijkstraResult *result, double *distance, err
     return ERR_SUCCESS;
   }
 
-  *distance = result->distances[result->target_index];
+  *distance = dijkstra_cost_value(result->mode, result->distances[result->target_index]);
+  return ERR_SUCCESS;
+}
+
+error_code_t check_dijkstra_mode(const Graph *graph, DijkstraMode mode, error_info_t *err_info) {
+  if (mode == DIJKSTRA_SHORTEST_DISTANCE || mode == DIJKSTRA_FASTEST_TIME) return ERR_SUCCESS;
+  if (!DIJKSTRA_IS_WEIGHTING_MODE(mode)) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid Dijkstra mode.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->weightings == NULL || DIJKSTRA_WEIGHTING_PROFILE(mode) >= graph->weightings->num_profiles) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Unknown weighting profile.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  return ERR_SUCCESS;
+}
+
+WeightMetric dijkstra_mode_metric(DijkstraMode mode) {
+  return mode == DIJKSTRA_SHORTEST_DISTANCE ? WEIGHT_DISTANCE : WEIGHT_TIME;
+}
+
+const Arc *dijkstra_mode_arcs(const Graph *graph, DijkstraMode mode) {
+  int stream = DIJKSTRA_IS_WEIGHTING_MODE(mode) ? WEIGHT_NUM_METRICS + DIJKSTRA_WEIGHTING_PROFILE(mode) : (int)dijkstra_mode_metric(mode);
+  const Arc *arcs = traffic_section_arcs(graph, stream);
+  if (arcs != NULL) return arcs;
+
+  // Outside a read section: traffic batches publish streams with release stores (see traffic.c)
+  if (DIJKSTRA_IS_WEIGHTING_MODE(mode)) {
+    return __atomic_load_n(&graph->weightings->arcs[DIJKSTRA_WEIGHTING_PROFILE(mode)], __ATOMIC_ACQUIRE);
+  }
+  return __atomic_load_n(&graph->adj_arcs[dijkstra_mode_metric(mode)], __ATOMIC_ACQUIRE);
+}
+
+double dijkstra_cost_value(DijkstraMode mode, uint32_t cost) {
+  if (dijkstra_mode_metric(mode) == WEIGHT_TIME) return cost / WEIGHT_TIME_UNITS_PER_MINUTE;
+  return (double)cost;
+}
+
+/**
+ * Expands one predecessor step of a pruned or contracted graph into the
+ * nodes it passes through (see prune_expand_step() and chain_expand_step()).
+ */
+static int expand_path_step(const Graph *graph, WeightMetric metric, const uint32_t *distances, int from_index, int to_index, int *nodes, uint32_t *costs) {
+  if (is_pruned_node(graph, from_index) || is_pruned_node(graph, to_index)) {
+    return prune_expand_step(graph, metric, distances, from_index, to_index, nodes, costs);
+  }
+  if (graph->chains != NULL) {
+    return chain_expand_step(graph, metric, distances, from_index, to_index, nodes, costs);
+  }
+  return 0; // Direct edge between core nodes
+}
+
+/**
+ * Extracts a path on a pruned or contracted graph, expanding every tree
+ * step, chain shortcut and partial chain step back into the nodes it passes
+ * through. The costs of the restored nodes are written to result->distances.
+ */
+static error_code_t get_expanded_path(Graph *graph, DijkstraResult *result, int *path_length, int **path, error_info_t *err_info) {
+  WeightMetric metric = dijkstra_mode_metric(result->mode);
+
+  // First pass: count path nodes including restored chain interiors
+  int length = 1;
+  int max_step = 0;
+  int current_index = result->target_index;
+  while (current_index != result->source_index) {
+    int previous_index = result->predecessors[current_index];
+    if (previous_index == -1) {
+      SET_ERROR(err_info, ERR_NOT_FOUND, "Path to source node not found in Dijkstra result.");
+      *path_length = 0;
+      return ERR_NOT_FOUND;
+    }
+    int count = expand_path_step(graph, metric, result->distances, previous_index, current_index, NULL, NULL);
+    if (count < 0) {
+      SET_ERROR(err_info, ERR_INVALID_DATA, "Path step matches no arc, chain or tree path of the graph.");
+      *path_length = 0;
+      return ERR_INVALID_DATA;
+    }
+    if (count > max_step) max_step = count;
+    length += count + 1;
+    current_index = previous_index;
+  }
+
+  *path = (int *)malloc(length * sizeof(int));
+  int *step_nodes = (int *)malloc((max_step + 1) * sizeof(int));
+  uint32_t *step_costs = (uint32_t *)malloc((max_step + 1) * sizeof(uint32_t));
+  if (*path == NULL || step_nodes == NULL || step_costs == NULL) {
+    free(*path);
+    free(step_nodes);
+    free(step_costs);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for path.");
+    *path_length = 0;
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Second pass: fill the path backwards from the target
+  int position = length - 1;
+  current_index = result->target_index;
+  (*path)[position--] = current_index;
+  while (current_index != result->source_index) {
+    int previous_index = result->predecessors[current_index];
+    int count = expand_path_step(graph, metric, result->distances, previous_index, current_index, step_nodes, step_costs);
+    for (int k = count - 1; k >= 0; k--) {
+      (*path)[position--] = step_nodes[k];
+      result->distances[step_nodes[k]] = step_costs[k];
+    }
+    (*path)[position--] = previous_index;
+    current_index = previous_index;
+  }
+
+  free(step_nodes);
+  free(step_costs);
+  *path_length = length;
   return ERR_SUCCESS;
 }
 
@@ -416,6 +808,15 @@ error_code_t get_shortest_path(Graph *graph, DijkstraResult *result, int *path_l
     *path_length = 0;
     return ERR_NOT_FOUND;
   }
+  if (result->predecessors == NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Dijkstra result was computed without predecessors.");
+    *path_length = 0;
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    return get_expanded_path(graph, result, path_length, path, err_info);
+  }
 
   // Calculate path length by backtracking from target to source
   int length = 0;
@@ -451,3 +852,106 @@ error_code_t get_shortest_path(Graph *graph, DijkstraResult *result, int *path_l
   *path_length = length;
   return ERR_SUCCESS;
 }
+
+// =================
+// Stamped Search
+// =================
+
+error_code_t stamped_search_init(StampedSearch *search, int num_nodes, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(search, err_info);
+
+  memset(search, 0, sizeof(StampedSearch));
+  search->num_nodes = num_nodes;
+  search->cost = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  search->pred_arc = (edge_index_t *)alloc_array(num_nodes, sizeof(edge_index_t));
+  search->pred_node = (int *)alloc_array(num_nodes, sizeof(int));
+  search->stamp = (uint32_t *)calloc(num_nodes > 0 ? num_nodes : 1, sizeof(uint32_t));
+  search->closed = (uint32_t *)calloc(num_nodes > 0 ? num_nodes : 1, sizeof(uint32_t));
+  if (search->cost == NULL || search->pred_arc == NULL || search->pred_node == NULL ||
+      search->stamp == NULL || search->closed == NULL) {
+    stamped_search_free(search);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for search workspace.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  error_code_t err_code = create_heap(&search->heap, num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    search->heap = NULL;
+    stamped_search_free(search);
+  }
+  return err_code;
+}
+
+void stamped_search_free(StampedSearch *search) {
+  if (search == NULL) return;
+
+  free(search->cost);
+  free(search->pred_arc);
+  free(search->pred_node);
+  free(search->stamp);
+  free(search->closed);
+  free_heap(search->heap);
+  memset(search, 0, sizeof(StampedSearch));
+}
+
+void stamped_search_begin(StampedSearch *search) {
+  if (++search->search_id == 0) {
+    memset(search->stamp, 0, search->num_nodes * sizeof(uint32_t));
+    memset(search->closed, 0, search->num_nodes * sizeof(uint32_t));
+    search->search_id = 1;
+  }
+  clear_heap(search->heap);
+}
+
+error_code_t stamped_search_seed(StampedSearch *search, int node_index, uint32_t cost, error_info_t *err_info) {
+  if (search->stamp[node_index] == search->search_id && search->cost[node_index] <= cost) return ERR_SUCCESS;
+
+  search->stamp[node_index] = search->search_id;
+  search->cost[node_index] = cost;
+  search->pred_arc[node_index] = -1;
+  search->pred_node[node_index] = -1;
+  return insert_heap(search->heap, node_index, cost, err_info);
+}
+
+error_code_t stamped_search_run(StampedSearch *search, const Graph *graph, const Arc *arcs, const uint64_t *avoided_arcs, uint32_t bound, StampedStopFunc stop, void *context, bool *stopped, error_info_t *err_info) {
+  const edge_index_t *adj_offsets = graph->adj_offsets;
+  uint32_t id = search->search_id;
+  MinHeap *heap = search->heap;
+  error_code_t err_code = ERR_SUCCESS;
+  if (stopped != NULL) *stopped = false;
+
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+
+    int v = min_node.node_index;
+    if (search->closed[v] == id) continue;
+    search->closed[v] = id;
+    search->settled_count++;
+    if (stop != NULL && stop(context, v)) {
+      if (stopped != NULL) *stopped = true;
+      break;
+    }
+
+    uint32_t current_cost = search->cost[v];
+    for (edge_index_t i = adj_offsets[v]; i < adj_offsets[v + 1] && err_code == ERR_SUCCESS; i++) {
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+      int w = arcs[i].target;
+      if (search->closed[w] == id) continue;
+
+      // Closed roads weigh WEIGHT_INFINITY, so their sums exceed any bound
+      uint64_t sum = (uint64_t)current_cost + arcs[i].weight;
+      if (sum > bound) continue;
+      if (search->stamp[w] != id || sum < search->cost[w]) {
+        search->stamp[w] = id;
+        search->cost[w] = (uint32_t)sum;
+        search->pred_arc[w] = i;
+        search->pred_node[w] = v;
+        err_code = insert_heap(heap, w, (uint32_t)sum, err_info);
+      }
+    }
+  }
+  return err_code;
+}
@@ -1,6 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include "graph.h"
+#include "contract.h"
+#include "components.h"
+#include "prune.h"
+#include "turns.h"
+#include "timedep.h"
+#include "traffic.h"
+#include "roadclass.h"
+#include "weighting.h"
 
 // ================
 // Hash table functions
@@ -120,7 +130,12 @@ error_code_t lookup_node_hash(NodeHashTable *node_hash, uint32_t node_id, int *o
 // Graph functions
 // ================
 
-error_code_t create_graph(Graph **graph, int num_nodes, int num_edges, error_info_t *err_info) {
+void *alloc_array(size_t count, size_t elem_size) {
+  if (elem_size != 0 && count > SIZE_MAX / elem_size) return NULL;
+  return malloc(count * elem_size);
+}
+
+error_code_t create_graph(Graph **graph, int num_nodes, edge_index_t num_edges, error_info_t *err_info) {
   CHECK_NULL(err_info, err_info);
   CHECK_NULL(graph, err_info);
 
@@ -129,66 +144,87 @@ error_code_t create_graph(Graph **graph, int num_nodes, int num_edges, error_inf
     return ERR_INVALID_ARGUMENT;
   }
 
-  // Allocate memory for the graph structure
-  *graph = malloc(sizeof(Graph));
-  CHECK_ALLOCATION(*graph, err_info);
+  // Every edge takes up to two adjacency slots, addressed by edge_index_t
+  if (num_edges > EDGE_INDEX_MAX / 2) {
+#ifdef GRAPH_INDEX64
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "too many edges for 64-bit edge indices.");
+#else
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "too many edges for 32-bit edge indices, rebuild with INDEX64=1.");
+#endif
+    return ERR_INVALID_ARGUMENT;
+  }
+  size_t num_slots = 2 * (size_t)num_edges;
 
-  // Allocate memory for nodes array
-  (*graph)->nodes = (Node *)malloc(num_nodes * sizeof(Node));
-  if ((*graph)->nodes == NULL) {
-    free(*graph);
+  // Allocate memory for the graph structure (zeroed so a partial graph can be freed)
+  *graph = calloc(1, sizeof(Graph));
+  CHECK_ALLOCATION(*graph, err_info);
+  Graph *g = *graph;
+
+  // Allocate memory for the compact node arrays (IDs and fixed-point coordinates)
+  g->node_ids = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  g->node_lat = (int32_t *)alloc_array(num_nodes, sizeof(int32_t));
+  g->node_lon = (int32_t *)alloc_array(num_nodes, sizeof(int32_t));
+  if (g->node_ids == NULL || g->node_lat == NULL || g->node_lon == NULL) {
+    free_graph(g);
     SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "failed to allocate memory for nodes.");
     return ERR_MEMORY_ALLOCATION;
   }
 
-  // Allocate memory for edges array
-  (*graph)->edges = (Edge *)malloc(num_edges * sizeof(Edge));
-  if ((*graph)->edges == NULL) {
-    free((*graph)->nodes);
-    free(*graph);
+  // Allocate memory for the edge columns
+  g->edge_from = (int *)alloc_array(num_edges, sizeof(int));
+  g->edge_to = (int *)alloc_array(num_edges, sizeof(int));
+  g->edge_length = (uint32_t *)alloc_array(num_edges, sizeof(uint32_t));
+  g->edge_speed = (uint16_t *)alloc_array(num_edges, sizeof(uint16_t));
+  g->edge_highway = (uint8_t *)alloc_array(num_edges, sizeof(uint8_t));
+  g->edge_one_way = (uint8_t *)alloc_array(num_edges, sizeof(uint8_t));
+  if (g->edge_from == NULL || g->edge_to == NULL || g->edge_length == NULL ||
+      g->edge_speed == NULL || g->edge_highway == NULL || g->edge_one_way == NULL) {
+    free_graph(g);
     SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "failed to allocate memory for edges.");
     return ERR_MEMORY_ALLOCATION;
   }
 
   // Allocate memory for CSR adjacency offsets (num_nodes + 1 for boundary)
-  (*graph)->adj_offsets = (int *)malloc((num_nodes + 1) * sizeof(int));
-  if ((*graph)->adj_offsets == NULL) {
-    free((*graph)->edges);
-    free((*graph)->nodes);
-    free(*graph);
+  g->adj_offsets = (edge_index_t *)alloc_array((size_t)num_nodes + 1, sizeof(edge_index_t));
+  if (g->adj_offsets == NULL) {
+    free_graph(g);
     SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "failed to allocate memory for adjacency offsets.");
     return ERR_MEMORY_ALLOCATION;
   }
 
-  // Allocate memory for CSR adjacency indices (worst case: all edges bidirectional)
-  (*graph)->adj_indices = (int *)malloc(num_edges * 2 * sizeof(int));
-  if ((*graph)->adj_indices == NULL) {
-    free((*graph)->adj_offsets);
-    free((*graph)->edges);
-    free((*graph)->nodes);
-    free(*graph);
+  // Allocate memory for CSR adjacency indices and packed arcs (worst case: all edges bidirectional)
+  g->adj_indices = (edge_index_t *)alloc_array(num_slots, sizeof(edge_index_t));
+  if (g->adj_indices == NULL) {
+    free_graph(g);
     SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "failed to allocate memory for adjacency indices.");
     return ERR_MEMORY_ALLOCATION;
   }
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    g->adj_arcs[m] = (Arc *)alloc_array(num_slots, sizeof(Arc));
+    if (g->adj_arcs[m] == NULL) {
+      free_graph(g);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "failed to allocate memory for adjacency arcs.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+  }
 
-  // Create node hash table with load factor 0.50
-  int hash_size = (num_nodes > HASH_TABLE_SIZE) ? num_nodes * 2 : HASH_TABLE_SIZE;
-  error_code_t err_code = create_node_hash_table(&(*graph)->node_hash, hash_size, err_info);
+  // Create node hash table with load factor 0.50, capped at INT_MAX buckets
+  // (chaining absorbs the higher load of graphs above INT_MAX / 2 nodes)
+  size_t hash_size = (num_nodes > HASH_TABLE_SIZE) ? 2 * (size_t)num_nodes : HASH_TABLE_SIZE;
+  if (hash_size > INT_MAX) hash_size = INT_MAX;
+  error_code_t err_code = create_node_hash_table(&g->node_hash, (int)hash_size, err_info);
   if (err_code != ERR_SUCCESS) {
-    free((*graph)->adj_indices);
-    free((*graph)->adj_offsets);
-    free((*graph)->edges);
-    free((*graph)->nodes);
-    free(*graph);
+    g->node_hash = NULL;
+    free_graph(g);
     return err_code;
   }
 
   // Initialize CSR offsets array to zero
-  memset((*graph)->adj_offsets, 0, (num_nodes + 1) * sizeof(int));
+  memset(g->adj_offsets, 0, ((size_t)num_nodes + 1) * sizeof(edge_index_t));
 
   // Set graph dimensions
-  (*graph)->num_nodes = num_nodes;
-  (*graph)->num_edges = num_edges;
+  g->num_nodes = num_nodes;
+  g->num_edges = num_edges;
 
   return ERR_SUCCESS;
 }
@@ -197,11 +233,30 @@ void free_graph(Graph *graph) {
   if (graph == NULL) return;
 
   // Free all allocated memory components
-  free(graph->nodes);
-  free(graph->edges);
+  free(graph->node_ids);
+  free(graph->node_lat);
+  free(graph->node_lon);
+  free(graph->edge_from);
+  free(graph->edge_to);
+  free(graph->edge_length);
+  free(graph->edge_speed);
+  free(graph->edge_highway);
+  free(graph->edge_one_way);
   free(graph->adj_offsets);
   free(graph->adj_indices);
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    free(graph->adj_arcs[m]);
+  }
   free_node_hash_table(graph->node_hash);
+  free_chain_index(graph->chains);
+  free_component_index(graph->components);
+  free_prune_index(graph->pruned);
+  free_turn_index(graph->turns);
+  free_time_profiles(graph->profiles);
+  free_traffic_overlay(graph->traffic);
+  free_road_filter(graph->filter);
+  free_weighting_set(graph->weightings);
+  drop_reverse_index(graph);
   free(graph);
 }
 
@@ -221,39 +276,61 @@ error_code_t find_node_index(Graph *graph, uint32_t node_id, int *out_index, err
 // CSR representation functions
 // =================
 
+// Fallback speeds in km/h indexed by HighwayType, used for zero speed limits
+static const uint16_t HIGHWAY_FALLBACK_SPEED[HIGHWAY_NUM_TYPES] = {
+  30,   // HIGHWAY_UNKNOWN
+  110,  // HIGHWAY_MOTORWAY
+  90,   // HIGHWAY_TRUNK
+  70,   // HIGHWAY_PRIMARY
+  60,   // HIGHWAY_SECONDARY
+  50,   // HIGHWAY_TERTIARY
+  40,   // HIGHWAY_UNCLASSIFIED
+  30,   // HIGHWAY_RESIDENTIAL
+  20    // HIGHWAY_SERVICE
+};
+
+uint16_t highway_fallback_speed(uint8_t highway_type) {
+  if (highway_type >= HIGHWAY_NUM_TYPES) highway_type = HIGHWAY_UNKNOWN;
+  return HIGHWAY_FALLBACK_SPEED[highway_type];
+}
+
+uint32_t travel_time_ms(uint32_t length_m, uint16_t speed_kmh) {
+  // meters / (km/h) = 3.6 s = 3600 ms per unit
+  double time_ms = length_m * 3600.0 / speed_kmh + 0.5;
+  if (time_ms >= (double)(WEIGHT_INFINITY - 1)) return WEIGHT_INFINITY - 1;
+  return (uint32_t)time_ms;
+}
+
+uint32_t compute_edge_weight(const Graph *graph, edge_index_t edge_idx, WeightMetric metric) {
+  uint32_t length = graph->edge_length[edge_idx];
+  if (metric != WEIGHT_TIME) return length;
+
+  uint16_t speed = graph->edge_speed[edge_idx];
+  if (speed == 0) speed = highway_fallback_speed(graph->edge_highway[edge_idx]);
+  return travel_time_ms(length, speed);
+}
+
 error_code_t build_csr_representation(Graph *graph, error_info_t *err_info) {
   // Null error check is already done in load_graph_from_binary
+  drop_reverse_index(graph);
+  drop_traffic_overlay(graph);
   
   // Allocate temporary array to count node degrees
   int *degree = (int *)calloc(graph->num_nodes, sizeof(int));
   CHECK_ALLOCATION(degree, err_info);
 
-  error_code_t err_code = 0;
+  // Edges of pruned dead-end trees stay out of the adjacency lists
+  int num_core = graph->pruned != NULL ? graph->pruned->num_core_nodes : graph->num_nodes;
 
   // First pass: count degrees for each node
-  for (int i = 0; i < graph->num_edges; i++) {
-    Edge *edge = &graph->edges[i];
-
-    // Get array indices for source and destination nodes
-    int from_index, to_index;
-    err_code = find_node_index(graph, edge->from_node, &from_index, err_info);
-    if (err_code != ERR_SUCCESS) {
-      free(degree);
-      return err_code;
-    }
-    err_code = find_node_index(graph, edge->to_node, &to_index, err_info);
-    if (err_code != ERR_SUCCESS) {
-      free(degree);
-      return err_code;
-    }
+  for (edge_index_t i = 0; i < graph->num_edges; i++) {
+    if (graph->edge_from[i] >= num_core || graph->edge_to[i] >= num_core) continue;
 
     // Count outgoing edges for source node
-    if (from_index >= 0) {
-      degree[from_index] += 1;
-    }
+    degree[graph->edge_from[i]] += 1;
     // Count incoming edges for destination node (if bidirectional)
-    if (!edge->one_way && to_index >= 0) {
-      degree[to_index] += 1;
+    if (!graph->edge_one_way[i]) {
+      degree[graph->edge_to[i]] += 1;
     }
   }
 
@@ -266,42 +343,115 @@ error_code_t build_csr_representation(Graph *graph, error_info_t *err_info) {
   // Reset degree array for second pass
   memset(degree, 0, graph->num_nodes * sizeof(int));
 
-  // Second pass: populate adjacency indices
-  for (int i = 0; i < graph->num_edges; i++) {
-    Edge *edge = &graph->edges[i];
-
-    // Get array indices for source and destination nodes
-    int from_index, to_index;
-    err_code = find_node_index(graph, edge->from_node, &from_index, err_info);
-    if (err_code != ERR_SUCCESS) {
-      free(degree);
-      return err_code;
-    }
-    err_code = find_node_index(graph, edge->to_node, &to_index, err_info);
-    if (err_code != ERR_SUCCESS) {
-      free(degree);
-      return err_code;
+  // Second pass: populate adjacency indices and the packed arc streams
+  for (edge_index_t i = 0; i < graph->num_edges; i++) {
+    int from_index = graph->edge_from[i];
+    int to_index = graph->edge_to[i];
+    if (from_index >= num_core || to_index >= num_core) continue;
+
+    // Add edge to source node's adjacency list
+    edge_index_t pos = graph->adj_offsets[from_index] + degree[from_index];
+    graph->adj_indices[pos] = i;
+    for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+      graph->adj_arcs[m][pos].target = to_index;
+      graph->adj_arcs[m][pos].weight = compute_edge_weight(graph, i, (WeightMetric)m);
     }
+    degree[from_index] += 1;
 
-    // Add edge index to source node's adjacency list
-    if (from_index >= 0) {
-      int pos = graph->adj_offsets[from_index] + degree[from_index];
-      graph->adj_indices[pos] = i;
-      degree[from_index] += 1;
-    }
-    // Add edge index to destination node's adjacency list (if bidirectional)
-    if (!edge->one_way && to_index >= 0) {
-      int pos = graph->adj_offsets[to_index] + degree[to_index];
+    // Add edge to destination node's adjacency list (if bidirectional)
+    if (!graph->edge_one_way[i]) {
+      pos = graph->adj_offsets[to_index] + degree[to_index];
       graph->adj_indices[pos] = i;
+      for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+        graph->adj_arcs[m][pos].target = from_index;
+        graph->adj_arcs[m][pos].weight = compute_edge_weight(graph, i, (WeightMetric)m);
+      }
       degree[to_index] += 1;
     }
   }
 
   free(degree);
+  error_code_t err_code = rebuild_road_filter(graph, NULL, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  return compile_weighting_arcs(graph, err_info);
+}
+
+/**
+ * Frees a reverse index (NULL is allowed).
+ */
+static void free_reverse_index(ReverseIndex *index) {
+  if (index == NULL) return;
+
+  free(index->in_offsets);
+  free(index->in_arcs);
+  free(index->arc_tail);
+  free(index);
+}
+
+void drop_reverse_index(Graph *graph) {
+  if (graph == NULL || graph->reverse == NULL) return;
+
+  free_reverse_index(graph->reverse);
+  graph->reverse = NULL;
+}
+
+error_code_t get_reverse_index(Graph *graph, const ReverseIndex **reverse, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(reverse, err_info);
+
+  // Queries on several threads may ask at once: the index is published
+  // with a compare-and-swap, and a thread that loses the race uses the winner's
+  ReverseIndex *published = __atomic_load_n(&graph->reverse, __ATOMIC_ACQUIRE);
+  if (published != NULL) {
+    *reverse = published;
+    return ERR_SUCCESS;
+  }
+
+  int num_nodes = graph->num_nodes;
+  edge_index_t num_arcs = graph->adj_offsets[num_nodes];
+  size_t arc_slots = num_arcs > 0 ? (size_t)num_arcs : 1;
+  ReverseIndex *index = (ReverseIndex *)calloc(1, sizeof(ReverseIndex));
+  CHECK_ALLOCATION(index, err_info);
+  index->in_offsets = (edge_index_t *)calloc((size_t)num_nodes + 1, sizeof(edge_index_t));
+  index->in_arcs = (edge_index_t *)alloc_array(arc_slots, sizeof(edge_index_t));
+  index->arc_tail = (int *)alloc_array(arc_slots, sizeof(int));
+  if (index->in_offsets == NULL || index->in_arcs == NULL || index->arc_tail == NULL) {
+    free_reverse_index(index);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for reverse arcs.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Count incoming arcs per head node (any metric and traffic buffer has the same targets)
+  const Arc *arcs = __atomic_load_n(&graph->adj_arcs[WEIGHT_DISTANCE], __ATOMIC_ACQUIRE);
+  for (int u = 0; u < num_nodes; u++) {
+    for (edge_index_t i = graph->adj_offsets[u]; i < graph->adj_offsets[u + 1]; i++) {
+      index->arc_tail[i] = u;
+      index->in_offsets[arcs[i].target + 1]++;
+    }
+  }
+  for (int v = 0; v < num_nodes; v++) {
+    index->in_offsets[v + 1] += index->in_offsets[v];
+  }
+
+  // Fill by advancing each head's start, then shift the starts back
+  for (edge_index_t i = 0; i < num_arcs; i++) {
+    index->in_arcs[index->in_offsets[arcs[i].target]++] = i;
+  }
+  for (int v = num_nodes; v > 0; v--) {
+    index->in_offsets[v] = index->in_offsets[v - 1];
+  }
+  index->in_offsets[0] = 0;
+
+  if (!__atomic_compare_exchange_n(&graph->reverse, &published, index, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    free_reverse_index(index);
+    index = published;
+  }
+  *reverse = index;
   return ERR_SUCCESS;
 }
 
-error_code_t get_adjacent_edges_csr(Graph *graph, int node_index, int *start_idx, int *end_idx, error_info_t *err_info) {
+error_code_t get_adjacent_edges_csr(Graph *graph, int node_index, edge_index_t *start_idx, edge_index_t *end_idx, error_info_t *err_info) {
   // Null error check is already done in calling function
   
   // Validate node index bounds
@@ -0,0 +1,729 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kpaths.h"
+#include "min_heap.h"
+#include "contract.h"
+#include "components.h"
+#include "prune.h"
+#include "roadclass.h"
+#include "traffic.h"
+
+// ================
+// Search workspace
+// ================
+
+/**
+ * A route as CSR arc positions, which tells parallel arcs apart.
+ */
+typedef struct {
+  edge_index_t *arcs;       // Arc positions from source to target
+  int num_arcs;             // Number of arcs
+  uint32_t cost;            // Total cost
+  int deviation;            // First arc position where it leaves the route it was spurred from
+} ArcPath;
+
+/**
+ * State shared by all searches of one k-shortest paths query. Per-node spur
+ * search fields are only valid where stamp (or closed, blocked) equals the
+ * current search ID, so a new search starts by incrementing the ID.
+ */
+typedef struct {
+  Graph *graph;
+  const Arc *arcs;
+  RouteEnds ends;           // Virtual arcs joining off-core endpoints to the routing graph
+  int source_index;
+  int target_index;
+  uint32_t *to_target;      // Exact cost to the target without removals, WEIGHT_INFINITY if unreachable
+  edge_index_t *next_arc;   // First arc of a shortest path to the target, -1 if none
+  uint32_t *cost;           // Spur search cost from the spur node
+  edge_index_t *pred_arc;   // Arc a node was reached by
+  int *pred_node;           // Node that arc leaves
+  int *stamp;               // Search that set cost and predecessors
+  int *closed;              // Search that settled the node
+  int *blocked;             // Search that removed the node (root path nodes)
+  int search_id;
+  MinHeap *heap;
+  int settled_count;
+} YenWorkspace;
+
+static void free_workspace(YenWorkspace *ws) {
+  free(ws->to_target);
+  free(ws->next_arc);
+  free(ws->cost);
+  free(ws->pred_arc);
+  free(ws->pred_node);
+  free(ws->stamp);
+  free(ws->closed);
+  free(ws->blocked);
+  free_heap(ws->heap);
+}
+
+static error_code_t init_workspace(YenWorkspace *ws, Graph *graph, DijkstraMode mode, int source_index, int target_index, error_info_t *err_info) {
+  int num_nodes = graph->num_nodes;
+  memset(ws, 0, sizeof(YenWorkspace));
+  ws->graph = graph;
+  ws->arcs = dijkstra_mode_arcs(graph, mode);
+  resolve_route_ends(graph, mode, source_index, target_index, true, &ws->ends);
+  ws->source_index = source_index;
+  ws->target_index = target_index;
+
+  ws->to_target = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  ws->next_arc = (edge_index_t *)alloc_array(num_nodes, sizeof(edge_index_t));
+  ws->cost = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  ws->pred_arc = (edge_index_t *)alloc_array(num_nodes, sizeof(edge_index_t));
+  ws->pred_node = (int *)alloc_array(num_nodes, sizeof(int));
+  ws->stamp = (int *)calloc(num_nodes, sizeof(int));
+  ws->closed = (int *)calloc(num_nodes, sizeof(int));
+  ws->blocked = (int *)calloc(num_nodes, sizeof(int));
+  if (ws->to_target == NULL || ws->next_arc == NULL || ws->cost == NULL || ws->pred_arc == NULL ||
+      ws->pred_node == NULL || ws->stamp == NULL || ws->closed == NULL || ws->blocked == NULL) {
+    free_workspace(ws);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for k-shortest paths workspace.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  error_code_t err_code = create_heap(&ws->heap, num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    ws->heap = NULL;
+    free_workspace(ws);
+    return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+// ================
+// Reverse shortest path tree
+// ================
+
+/**
+ * Lowers the cost to the target of the node an arc leaves.
+ */
+static inline error_code_t relax_tree_arc(YenWorkspace *ws, int u, edge_index_t arc, uint64_t new_cost, error_info_t *err_info) {
+  if (new_cost >= ws->to_target[u]) return ERR_SUCCESS;
+  ws->to_target[u] = (uint32_t)new_cost;
+  ws->next_arc[u] = arc;
+  return insert_heap(ws->heap, u, (uint32_t)new_cost, err_info);
+}
+
+/**
+ * Computes the exact cost from every node to the target with a backward
+ * search over the incoming arcs.
+ */
+static error_code_t build_reverse_tree(YenWorkspace *ws, error_info_t *err_info) {
+  const ReverseIndex *reverse;
+  error_code_t err_code = get_reverse_index(ws->graph, &reverse, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  const uint64_t *avoided_arcs = road_filter_arcs(ws->graph);
+  const RouteEnds *ends = &ws->ends;
+  int num_nodes = ws->graph->num_nodes;
+  for (int i = 0; i < num_nodes; i++) {
+    ws->to_target[i] = WEIGHT_INFINITY;
+    ws->next_arc[i] = -1;
+  }
+  ws->to_target[ws->target_index] = 0;
+
+  // Entries are only queued on improvement, so a stale entry has a higher cost
+  MinHeap *heap = ws->heap;
+  clear_heap(heap);
+  err_code = insert_heap(heap, ws->target_index, 0, err_info);
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    int v = min_node.node_index;
+    if (min_node.distance > ws->to_target[v]) continue;
+    ws->settled_count++;
+
+    for (edge_index_t j = reverse->in_offsets[v]; j < reverse->in_offsets[v + 1] && err_code == ERR_SUCCESS; j++) {
+      edge_index_t arc = reverse->in_arcs[j];
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, arc)) continue;
+      if (ends->num_cut_arcs > 0 && is_cut_arc(ends, arc)) continue;
+      err_code = relax_tree_arc(ws, reverse->arc_tail[arc], arc, (uint64_t)min_node.distance + ws->arcs[arc].weight, err_info);
+    }
+    for (int k = 0; k < ROUTE_NUM_VIRTUAL_ARCS && ends->has_virtual_arcs && err_code == ERR_SUCCESS; k++) {
+      if (ends->head[k] != v) continue;
+      err_code = relax_tree_arc(ws, ends->tail[k], ends->first_virtual_arc + k, (uint64_t)min_node.distance + ends->cost[k], err_info);
+    }
+  }
+  return err_code;
+}
+
+// ================
+// Spur searches
+// ================
+
+/**
+ * Returns the node an arc path reaches after its first count arcs.
+ */
+static inline int path_node(const YenWorkspace *ws, const ArcPath *path, int count) {
+  return count == 0 ? ws->source_index : route_arc_target(&ws->ends, ws->arcs, path->arcs[count - 1]);
+}
+
+static bool is_blocked_arc(const edge_index_t *blocked_arcs, int num_blocked_arcs, edge_index_t arc) {
+  for (int i = 0; i < num_blocked_arcs; i++) {
+    if (blocked_arcs[i] == arc) return true;
+  }
+  return false;
+}
+
+/**
+ * Relaxes one arc of a spur search, skipping nodes that are settled,
+ * blocked or cannot reach the target.
+ */
+static inline error_code_t relax_spur_arc(YenWorkspace *ws, int id, int v, edge_index_t arc, int w, uint32_t weight, error_info_t *err_info) {
+  if (ws->closed[w] == id || ws->blocked[w] == id || ws->to_target[w] == WEIGHT_INFINITY) return ERR_SUCCESS;
+
+  uint64_t sum = (uint64_t)ws->cost[v] + weight;
+  if (sum >= WEIGHT_INFINITY) return ERR_SUCCESS;
+  uint32_t new_cost = (uint32_t)sum;
+  if (ws->stamp[w] == id && new_cost >= ws->cost[w]) return ERR_SUCCESS;
+
+  ws->stamp[w] = id;
+  ws->cost[w] = new_cost;
+  ws->pred_arc[w] = arc;
+  ws->pred_node[w] = v;
+  return insert_heap(ws->heap, w, new_cost + ws->to_target[w], err_info);
+}
+
+/**
+ * Runs an A* search from a spur node to the target with the reverse tree
+ * costs as potentials, avoiding nodes blocked for the current search ID and
+ * the given arcs out of the spur node.
+ *
+ * @param limit Spur path costs at or above limit are not needed
+ * @return true if the target was reached below limit (its cost is ws->cost[target])
+ */
+static bool spur_search(YenWorkspace *ws, int spur_index, uint32_t limit, const edge_index_t *blocked_arcs, int num_blocked_arcs, error_info_t *err_info, error_code_t *err_code) {
+  const edge_index_t *adj_offsets = ws->graph->adj_offsets;
+  const Arc *arcs = ws->arcs;
+  const uint64_t *avoided_arcs = road_filter_arcs(ws->graph);
+  const RouteEnds *ends = &ws->ends;
+  int id = ws->search_id;
+  MinHeap *heap = ws->heap;
+
+  clear_heap(heap);
+  ws->stamp[spur_index] = id;
+  ws->cost[spur_index] = 0;
+  ws->pred_node[spur_index] = -1;
+  *err_code = insert_heap(heap, spur_index, ws->to_target[spur_index], err_info);
+
+  while (*err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    *err_code = extract_min(heap, &min_node, err_info);
+    if (*err_code != ERR_SUCCESS) return false;
+
+    // Keys are lower bounds on the spur path cost through the node
+    if (min_node.distance >= limit) return false;
+    int v = min_node.node_index;
+    if (ws->closed[v] == id) continue;
+    ws->closed[v] = id;
+    ws->settled_count++;
+    if (v == ws->target_index) return true;
+
+    for (edge_index_t i = adj_offsets[v]; i < adj_offsets[v + 1] && *err_code == ERR_SUCCESS; i++) {
+      if (v == spur_index && is_blocked_arc(blocked_arcs, num_blocked_arcs, i)) continue;
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+      if (ends->num_cut_arcs > 0 && is_cut_arc(ends, i)) continue;
+      *err_code = relax_spur_arc(ws, id, v, i, arcs[i].target, arcs[i].weight, err_info);
+    }
+    for (int k = 0; k < ROUTE_NUM_VIRTUAL_ARCS && ends->has_virtual_arcs && *err_code == ERR_SUCCESS; k++) {
+      edge_index_t arc = ends->first_virtual_arc + k;
+      if (ends->tail[k] != v) continue;
+      if (v == spur_index && is_blocked_arc(blocked_arcs, num_blocked_arcs, arc)) continue;
+      *err_code = relax_spur_arc(ws, id, v, arc, ends->head[k], ends->cost[k], err_info);
+    }
+  }
+  return false;
+}
+
+// ================
+// Candidate routes
+// ================
+
+/**
+ * Sorted candidate routes, trimmed to the number of routes still needed.
+ */
+typedef struct {
+  ArcPath *items;
+  int count;
+  int capacity;
+} CandidateList;
+
+static bool same_arc_path(const ArcPath *a, const ArcPath *b) {
+  return a->cost == b->cost && a->num_arcs == b->num_arcs &&
+         memcmp(a->arcs, b->arcs, a->num_arcs * sizeof(edge_index_t)) == 0;
+}
+
+/**
+ * Returns the cost a new candidate must stay below to matter: the cost of
+ * the last candidate once enough are queued, WEIGHT_INFINITY otherwise.
+ */
+static uint32_t candidate_limit(const CandidateList *list, int needed) {
+  return list->count >= needed ? list->items[needed - 1].cost : WEIGHT_INFINITY;
+}
+
+/**
+ * Inserts a candidate after those of equal cost and drops the ones past the
+ * number still needed. Takes ownership of path->arcs.
+ */
+static error_code_t add_candidate(CandidateList *list, ArcPath *path, int needed, error_info_t *err_info) {
+  for (int i = 0; i < list->count; i++) {
+    if (same_arc_path(&list->items[i], path)) {
+      free(path->arcs);
+      return ERR_SUCCESS;
+    }
+  }
+
+  if (list->count == list->capacity) {
+    int capacity = list->capacity > 0 ? 2 * list->capacity : 16;
+    ArcPath *items = (ArcPath *)realloc(list->items, capacity * sizeof(ArcPath));
+    if (items == NULL) {
+      free(path->arcs);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for candidate routes.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    list->items = items;
+    list->capacity = capacity;
+  }
+
+  int position = list->count;
+  while (position > 0 && list->items[position - 1].cost > path->cost) position--;
+  memmove(&list->items[position + 1], &list->items[position], (list->count - position) * sizeof(ArcPath));
+  list->items[position] = *path;
+  list->count++;
+
+  while (list->count > needed) {
+    free(list->items[--list->count].arcs);
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Builds the candidate made of the first spur_position arcs of a route and
+ * the spur path found by the last spur search.
+ */
+static error_code_t make_spur_candidate(const YenWorkspace *ws, const ArcPath *route, int spur_position, uint32_t root_cost, ArcPath *candidate, error_info_t *err_info) {
+  int spur_index = path_node(ws, route, spur_position);
+  int spur_arcs = 0;
+  for (int v = ws->target_index; v != spur_index; v = ws->pred_node[v]) spur_arcs++;
+
+  candidate->num_arcs = spur_position + spur_arcs;
+  candidate->cost = root_cost + ws->cost[ws->target_index];
+  candidate->deviation = spur_position;
+  candidate->arcs = (edge_index_t *)alloc_array(candidate->num_arcs, sizeof(edge_index_t));
+  CHECK_ALLOCATION(candidate->arcs, err_info);
+
+  memcpy(candidate->arcs, route->arcs, spur_position * sizeof(edge_index_t));
+  int position = candidate->num_arcs;
+  for (int v = ws->target_index; v != spur_index; v = ws->pred_node[v]) {
+    candidate->arcs[--position] = ws->pred_arc[v];
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Spurs off every node of the last accepted route from its deviation point
+ * on (earlier spur nodes were covered when its parent was accepted).
+ */
+static error_code_t spur_from_route(YenWorkspace *ws, const ArcPath *accepted, int num_accepted, CandidateList *candidates, int needed, int *spur_searches, error_info_t *err_info) {
+  const ArcPath *route = &accepted[num_accepted - 1];
+  edge_index_t *blocked_arcs = (edge_index_t *)alloc_array(num_accepted, sizeof(edge_index_t));
+  CHECK_ALLOCATION(blocked_arcs, err_info);
+
+  uint32_t root_cost = 0;
+  for (int i = 0; i < route->deviation; i++) {
+    root_cost += route_arc_weight(&ws->ends, ws->arcs, route->arcs[i]);
+  }
+
+  error_code_t err_code = ERR_SUCCESS;
+  for (int i = route->deviation; i < route->num_arcs && err_code == ERR_SUCCESS; i++) {
+    int spur_index = path_node(ws, route, i);
+    uint32_t spur_root_cost = root_cost;
+    root_cost += route_arc_weight(&ws->ends, ws->arcs, route->arcs[i]);
+
+    // Even the unrestricted remaining cost cannot beat the queued candidates
+    uint32_t limit = candidate_limit(candidates, needed);
+    if (spur_root_cost >= limit || ws->to_target[spur_index] >= limit - spur_root_cost) continue;
+
+    // Remove the root path and the arcs accepted routes with this root take next
+    ws->search_id++;
+    for (int j = 0; j < i; j++) {
+      ws->blocked[path_node(ws, route, j)] = ws->search_id;
+    }
+    int num_blocked_arcs = 0;
+    for (int p = 0; p < num_accepted; p++) {
+      const ArcPath *other = &accepted[p];
+      if (other->num_arcs > i && memcmp(other->arcs, route->arcs, i * sizeof(edge_index_t)) == 0) {
+        blocked_arcs[num_blocked_arcs++] = other->arcs[i];
+      }
+    }
+
+    (*spur_searches)++;
+    if (!spur_search(ws, spur_index, limit - spur_root_cost, blocked_arcs, num_blocked_arcs, err_info, &err_code)) continue;
+
+    ArcPath candidate;
+    err_code = make_spur_candidate(ws, route, i, spur_root_cost, &candidate, err_info);
+    if (err_code == ERR_SUCCESS) err_code = add_candidate(candidates, &candidate, needed, err_info);
+  }
+
+  free(blocked_arcs);
+  return err_code;
+}
+
+// ================
+// Route endpoints
+// ================
+
+static void set_virtual_arc(RouteEnds *ends, int k, int tail, int head, uint32_t cost, int chain, int from_position, int to_position) {
+  ends->tail[k] = tail;
+  ends->head[k] = head;
+  ends->cost[k] = cost;
+  ends->chain[k] = chain;
+  ends->from_position[k] = from_position;
+  ends->to_position[k] = to_position;
+  ends->has_virtual_arcs = true;
+}
+
+/**
+ * Returns the chain of a chain interior node and its position on it.
+ */
+static int interior_chain(const Graph *graph, int node_index, int *position) {
+  const ChainIndex *index = graph->chains;
+  int c = index->interior_chain[node_index - index->num_routing_nodes];
+  *position = node_index - index->chains[c].first;
+  return c;
+}
+
+/**
+ * Adds the virtual arcs from an endpoint onto the routing graph (exits) or
+ * from the routing graph to it (entries). With avoid_index set, chain spans
+ * running through that node are left out.
+ */
+static void add_access_arcs(const Graph *graph, WeightMetric metric, int node_index, bool exits, int avoid_index, RouteEnds *ends) {
+  int base = exits ? ROUTE_EXIT_ARC : ROUTE_ENTRY_ARC;
+  if (is_pruned_node(graph, node_index)) {
+    int root = prune_tree_root(graph, node_index);
+    int from_index = exits ? node_index : root;
+    int to_index = exits ? root : node_index;
+    uint32_t cost = prune_tree_path_cost(graph, metric, from_index, to_index);
+    if (cost != WEIGHT_INFINITY) set_virtual_arc(ends, base, from_index, to_index, cost, -1, 0, 0);
+    return;
+  }
+  if (!is_chain_interior(graph, node_index)) return;
+
+  int position;
+  int c = interior_chain(graph, node_index, &position);
+  const Chain *chain = &graph->chains->chains[c];
+  if (is_road_class_avoided(graph, chain->highway_type)) return;
+
+  int avoid_position = -2;
+  if (avoid_index >= 0 && is_chain_interior(graph, avoid_index)) {
+    int other_position;
+    if (interior_chain(graph, avoid_index, &other_position) == c) avoid_position = other_position;
+  }
+
+  // Spans to or from the chain end (position num_interior) and start (-1)
+  int end_positions[2] = { chain->num_interior, -1 };
+  int end_nodes[2] = { chain->to, chain->from };
+  for (int k = 0; k < 2; k++) {
+    int from_position = exits ? position : end_positions[k];
+    int to_position = exits ? end_positions[k] : position;
+    uint32_t cost = chain_span_cost(graph, metric, c, from_position, to_position);
+    if (cost == WEIGHT_INFINITY) continue;
+    if ((avoid_position > from_position && avoid_position < to_position) ||
+        (avoid_position < from_position && avoid_position > to_position && avoid_position >= 0)) {
+      continue;
+    }
+    if (exits) set_virtual_arc(ends, base + k, node_index, end_nodes[k], cost, c, from_position, to_position);
+    else set_virtual_arc(ends, base + k, end_nodes[k], node_index, cost, c, from_position, to_position);
+  }
+}
+
+/**
+ * Cuts the routing arcs of the chain holding a chain interior endpoint.
+ */
+static void cut_endpoint_chain(const Graph *graph, int node_index, RouteEnds *ends) {
+  if (!is_chain_interior(graph, node_index)) return;
+
+  int position;
+  int c = interior_chain(graph, node_index, &position);
+  const Chain *chain = &graph->chains->chains[c];
+  int ends_of_chain[2] = { chain->from, chain->to };
+  for (int e = 0; e < (chain->from == chain->to ? 1 : 2); e++) {
+    int u = ends_of_chain[e];
+    for (edge_index_t i = graph->adj_offsets[u]; i < graph->adj_offsets[u + 1]; i++) {
+      if (graph->adj_indices[i] != CHAIN_ADJ_INDEX(c) || is_cut_arc(ends, i)) continue;
+      if (ends->num_cut_arcs < ROUTE_MAX_CUT_ARCS) ends->cut_arcs[ends->num_cut_arcs++] = i;
+    }
+  }
+}
+
+void resolve_route_ends(const Graph *graph, DijkstraMode mode, int source_index, int target_index, bool loopless, RouteEnds *ends) {
+  WeightMetric metric = dijkstra_mode_metric(mode);
+  memset(ends, 0, sizeof(RouteEnds));
+  ends->source_index = source_index;
+  ends->target_index = target_index;
+  ends->first_virtual_arc = graph->adj_offsets[graph->num_nodes];
+  for (int k = 0; k < ROUTE_NUM_VIRTUAL_ARCS; k++) {
+    ends->tail[k] = -1;
+    ends->head[k] = -1;
+    ends->cost[k] = WEIGHT_INFINITY;
+    ends->chain[k] = -1;
+  }
+
+  // Endpoints on one dead-end tree: the tree path, plus for shortest paths the way through the root
+  int root = prune_tree_root(graph, source_index);
+  if (root == prune_tree_root(graph, target_index) &&
+      (is_pruned_node(graph, source_index) || is_pruned_node(graph, target_index))) {
+    uint32_t cost = prune_tree_path_cost(graph, metric, source_index, target_index);
+    if (cost != WEIGHT_INFINITY) set_virtual_arc(ends, ROUTE_DIRECT_ARC, source_index, target_index, cost, -1, 0, 0);
+    ends->has_virtual_arcs = true;
+    if (loopless) {
+      ends->direct_only = true;
+      return;
+    }
+  }
+
+  // Endpoints on one chain: the span between them
+  if (is_chain_interior(graph, source_index) && is_chain_interior(graph, target_index)) {
+    int source_position, target_position;
+    int c = interior_chain(graph, source_index, &source_position);
+    if (interior_chain(graph, target_index, &target_position) == c &&
+        !is_road_class_avoided(graph, graph->chains->chains[c].highway_type)) {
+      uint32_t cost = chain_span_cost(graph, metric, c, source_position, target_position);
+      if (cost != WEIGHT_INFINITY) {
+        set_virtual_arc(ends, ROUTE_DIRECT_ARC, source_index, target_index, cost, c, source_position, target_position);
+      }
+    }
+  }
+
+  add_access_arcs(graph, metric, source_index, true, loopless ? target_index : -1, ends);
+  add_access_arcs(graph, metric, target_index, false, loopless ? source_index : -1, ends);
+  if (loopless) {
+    cut_endpoint_chain(graph, source_index, ends);
+    cut_endpoint_chain(graph, target_index, ends);
+  }
+}
+
+// ================
+// Route output
+// ================
+
+/**
+ * Expands one arc of a route into the nodes it passes through, like
+ * chain_expand_arc() but also for virtual arcs.
+ */
+static int expand_route_arc(const Graph *graph, WeightMetric metric, const RouteEnds *ends, int from_index, edge_index_t arc, uint32_t from_cost, int *nodes, uint32_t *costs) {
+  if (ends != NULL && is_virtual_arc(ends, arc)) {
+    int k = (int)(arc - ends->first_virtual_arc);
+    if (ends->chain[k] >= 0) {
+      return chain_expand_span(graph, metric, ends->chain[k], ends->from_position[k], ends->to_position[k], from_cost, nodes, costs);
+    }
+    return prune_expand_path(graph, metric, ends->tail[k], ends->head[k], from_cost, nodes, costs);
+  }
+  return graph->chains != NULL ? chain_expand_arc(graph, metric, from_index, arc, from_cost, nodes, costs) : 0;
+}
+
+error_code_t build_route_path(const Graph *graph, DijkstraMode mode, const RouteEnds *ends, int source_index, const edge_index_t *arcs, int num_arcs, RoutePath *route, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(route, err_info);
+
+  WeightMetric metric = dijkstra_mode_metric(mode);
+  const Arc *metric_arcs = dijkstra_mode_arcs(graph, mode);
+  bool expanded = graph->chains != NULL || (ends != NULL && ends->has_virtual_arcs);
+
+  int length = num_arcs + 1;
+  if (expanded) {
+    int from_index = source_index;
+    for (int i = 0; i < num_arcs; i++) {
+      length += expand_route_arc(graph, metric, ends, from_index, arcs[i], 0, NULL, NULL);
+      from_index = ends != NULL ? route_arc_target(ends, metric_arcs, arcs[i]) : metric_arcs[arcs[i]].target;
+    }
+  }
+
+  route->nodes = (int *)alloc_array(length, sizeof(int));
+  route->costs = (uint32_t *)alloc_array(length, sizeof(uint32_t));
+  if (route->nodes == NULL || route->costs == NULL) {
+    free(route->nodes);
+    free(route->costs);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for route.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  int position = 0;
+  uint32_t cost = 0;
+  int from_index = source_index;
+  route->nodes[position] = source_index;
+  route->costs[position++] = 0;
+  for (int i = 0; i < num_arcs; i++) {
+    if (expanded) {
+      position += expand_route_arc(graph, metric, ends, from_index, arcs[i], cost,
+                                   &route->nodes[position], &route->costs[position]);
+    }
+    if (ends != NULL) {
+      cost += route_arc_weight(ends, metric_arcs, arcs[i]);
+      from_index = route_arc_target(ends, metric_arcs, arcs[i]);
+    } else {
+      cost += metric_arcs[arcs[i]].weight;
+      from_index = metric_arcs[arcs[i]].target;
+    }
+    route->nodes[position] = from_index;
+    route->costs[position++] = cost;
+  }
+  route->length = length;
+  return ERR_SUCCESS;
+}
+
+// ================
+// K-shortest paths
+// ================
+
+/**
+ * Runs Yen's algorithm on the routing graph, collecting up to k arc paths.
+ */
+static error_code_t run_yen(YenWorkspace *ws, int k, ArcPath *accepted, int *num_accepted, int *spur_searches, error_info_t *err_info) {
+  *num_accepted = 0;
+  if (ws->to_target[ws->source_index] == WEIGHT_INFINITY) return ERR_SUCCESS;
+
+  // The shortest route follows the reverse tree
+  ArcPath *first = &accepted[0];
+  first->num_arcs = 0;
+  for (int v = ws->source_index; v != ws->target_index; v = route_arc_target(&ws->ends, ws->arcs, ws->next_arc[v])) {
+    first->num_arcs++;
+  }
+  first->arcs = (edge_index_t *)alloc_array(first->num_arcs, sizeof(edge_index_t));
+  CHECK_ALLOCATION(first->arcs, err_info);
+  first->num_arcs = 0;
+  for (int v = ws->source_index; v != ws->target_index; v = route_arc_target(&ws->ends, ws->arcs, ws->next_arc[v])) {
+    first->arcs[first->num_arcs++] = ws->next_arc[v];
+  }
+  first->cost = ws->to_target[ws->source_index];
+  first->deviation = 0;
+  *num_accepted = 1;
+
+  CandidateList candidates = { NULL, 0, 0 };
+  error_code_t err_code = ERR_SUCCESS;
+  while (*num_accepted < k) {
+    int needed = k - *num_accepted;
+    err_code = spur_from_route(ws, accepted, *num_accepted, &candidates, needed, spur_searches, err_info);
+    if (err_code != ERR_SUCCESS || candidates.count == 0) break;
+
+    // Accept the cheapest candidate
+    accepted[(*num_accepted)++] = candidates.items[0];
+    memmove(&candidates.items[0], &candidates.items[1], (candidates.count - 1) * sizeof(ArcPath));
+    candidates.count--;
+  }
+
+  for (int i = 0; i < candidates.count; i++) {
+    free(candidates.items[i].arcs);
+  }
+  free(candidates.items);
+  return err_code;
+}
+
+void free_k_shortest_paths(KShortestPaths *paths) {
+  if (paths == NULL) return;
+
+  for (int i = 0; i < paths->num_paths; i++) {
+    free(paths->paths[i].nodes);
+    free(paths->paths[i].costs);
+  }
+  free(paths->paths);
+  paths->paths = NULL;
+  paths->num_paths = 0;
+}
+
+error_code_t find_k_shortest_paths(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, int k, DijkstraMode mode, KShortestPaths *paths, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(paths, err_info);
+
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+  if (k <= 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Number of routes must be positive.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (source_node_id == target_node_id) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int source_index, target_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  paths->paths = NULL;
+  paths->num_paths = 0;
+  paths->mode = mode;
+  paths->spur_searches = 0;
+  paths->settled_count = 0;
+  if (!component_may_reach(graph, source_index, target_index)) return ERR_SUCCESS;
+
+  // The spur searches and the route costs read the stream of one batch
+  int ticket = traffic_read_begin(graph);
+  YenWorkspace ws;
+  err_code = init_workspace(&ws, graph, mode, source_index, target_index, err_info);
+  if (err_code != ERR_SUCCESS) {
+    traffic_read_end(graph, ticket);
+    return err_code;
+  }
+
+  ArcPath *accepted = (ArcPath *)alloc_array(k, sizeof(ArcPath));
+  if (accepted == NULL) {
+    free_workspace(&ws);
+    traffic_read_end(graph, ticket);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for routes.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Endpoints on one dead-end tree have a single loopless route
+  int num_accepted = 0;
+  if (ws.ends.direct_only) {
+    edge_index_t direct_arc = ws.ends.first_virtual_arc + ROUTE_DIRECT_ARC;
+    if (ws.ends.cost[ROUTE_DIRECT_ARC] != WEIGHT_INFINITY) {
+      accepted[0].arcs = (edge_index_t *)alloc_array(1, sizeof(edge_index_t));
+      if (accepted[0].arcs == NULL) {
+        SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for routes.");
+        err_code = ERR_MEMORY_ALLOCATION;
+      } else {
+        accepted[0].arcs[0] = direct_arc;
+        accepted[0].num_arcs = 1;
+        accepted[0].cost = ws.ends.cost[ROUTE_DIRECT_ARC];
+        accepted[0].deviation = 0;
+        num_accepted = 1;
+      }
+    }
+  } else {
+    err_code = build_reverse_tree(&ws, err_info);
+  }
+  if (err_code == ERR_SUCCESS && !ws.ends.direct_only) {
+    err_code = run_yen(&ws, k, accepted, &num_accepted, &paths->spur_searches, err_info);
+  }
+
+  if (err_code == ERR_SUCCESS && num_accepted > 0) {
+    paths->paths = (RoutePath *)alloc_array(num_accepted, sizeof(RoutePath));
+    if (paths->paths == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for routes.");
+      err_code = ERR_MEMORY_ALLOCATION;
+    }
+  }
+  for (int i = 0; i < num_accepted && err_code == ERR_SUCCESS; i++) {
+    err_code = build_route_path(graph, mode, &ws.ends, source_index, accepted[i].arcs, accepted[i].num_arcs, &paths->paths[i], err_info);
+    if (err_code == ERR_SUCCESS) paths->num_paths++;
+  }
+
+  paths->settled_count = ws.settled_count;
+  for (int i = 0; i < num_accepted; i++) {
+    free(accepted[i].arcs);
+  }
+  free(accepted);
+  free_workspace(&ws);
+  traffic_read_end(graph, ticket);
+  if (err_code != ERR_SUCCESS) free_k_shortest_paths(paths);
+  return err_code;
+}
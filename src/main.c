@@ -6,22 +6,223 @@
 #include "bin_loader.h"
 #include "dijkstra.h"
 #include "graph.h"
+#include "reorder.h"
+#include "contract.h"
+#include "components.h"
+#include "prune.h"
+#include "kpaths.h"
+#include "alternatives.h"
+#include "turns.h"
+#include "timedep.h"
+#include "traffic.h"
+#include "roadclass.h"
+#include "weighting.h"
+#include "pareto.h"
+#include "waypoints.h"
+#include "tsp.h"
 #include "utils.h"
 
+// Upper bound on positional arguments (files, node IDs or -c, GPX output)
+#define MAX_POSITIONAL_ARGS 5
+
+// =================
+// Route listing
+// =================
+
+/**
+ * Prints routes with their cost and exports route n > 1 next to the GPX file
+ * (the first route is the one already exported).
+ */
+static error_code_t print_routes(Graph *graph, const RoutePath *routes, int num_routes, const char *gpx_file, DijkstraMode mode, error_info_t *err_info) {
+  for (int i = 0; i < num_routes; i++) {
+    const RoutePath *route = &routes[i];
+    char value_buffer[64];
+    format_distance(dijkstra_cost_value(mode, route->costs[route->length - 1]), value_buffer, sizeof(value_buffer), mode, err_info);
+    printf("  %d. %s, %d nodes\n", i + 1, value_buffer, route->length);
+
+    if (gpx_file && i > 0) {
+      char route_file[1024];
+      error_code_t err_code = format_route_filename(gpx_file, i + 1, route_file, sizeof(route_file), err_info);
+      if (err_code == ERR_SUCCESS) {
+        err_code = export_path_costs_to_gpx(graph, route->nodes, route->costs, route->length, route_file, mode, err_info);
+      }
+      if (err_code != ERR_SUCCESS) return err_code;
+      printf("     Exported to GPX file: %s\n", route_file);
+    }
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Prints the routes of a Pareto front with both costs and exports route n
+ * next to the GPX file, timed along the route.
+ */
+static error_code_t print_pareto_routes(Graph *graph, const ParetoFront *front, const char *gpx_file, error_info_t *err_info) {
+  for (int i = 0; i < front->num_routes; i++) {
+    const ParetoRoute *route = &front->routes[i];
+    char distance_buffer[64], time_buffer[64];
+    int last = route->length - 1;
+    format_distance(dijkstra_cost_value(DIJKSTRA_SHORTEST_DISTANCE, route->distances[last]), distance_buffer,
+                    sizeof(distance_buffer), DIJKSTRA_SHORTEST_DISTANCE, err_info);
+    format_distance(dijkstra_cost_value(DIJKSTRA_FASTEST_TIME, route->times[last]), time_buffer,
+                    sizeof(time_buffer), DIJKSTRA_FASTEST_TIME, err_info);
+    printf("  %d. %s, %s, %d nodes\n", i + 1, distance_buffer, time_buffer, route->length);
+
+    if (gpx_file) {
+      char route_file[1024];
+      error_code_t err_code = format_route_filename(gpx_file, i + 1, route_file, sizeof(route_file), err_info);
+      if (err_code == ERR_SUCCESS) {
+        err_code = export_path_costs_to_gpx(graph, route->nodes, route->times, route->length, route_file, DIJKSTRA_FASTEST_TIME, err_info);
+      }
+      if (err_code != ERR_SUCCESS) return err_code;
+      printf("     Exported to GPX file: %s\n", route_file);
+    }
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Prints a waypoint route leg by leg.
+ */
+static void print_waypoint_route(const WaypointRoute *route, const uint32_t *stop_ids, DijkstraMode mode, error_info_t *err_info) {
+  char value_buffer[64];
+  for (int leg = 0; leg + 1 < route->num_stops; leg++) {
+    if (leg == route->unreachable_leg) {
+      printf("  %u -> %u: no route\n", stop_ids[route->stop_order[leg]], stop_ids[route->stop_order[leg + 1]]);
+      return;
+    }
+    format_distance(dijkstra_cost_value(mode, route->leg_costs[leg]), value_buffer, sizeof(value_buffer), mode, err_info);
+    printf("  %u -> %u: %s\n", stop_ids[route->stop_order[leg]], stop_ids[route->stop_order[leg + 1]], value_buffer);
+  }
+
+  const RoutePath *path = &route->path;
+  format_distance(dijkstra_cost_value(mode, path->costs[path->length - 1]), value_buffer, sizeof(value_buffer), mode, err_info);
+  printf("Path contains %d nodes, total %s.\n", path->length, value_buffer);
+  if (route->input_order_cost > 0) {
+    format_distance(dijkstra_cost_value(mode, route->input_order_cost), value_buffer, sizeof(value_buffer), mode, err_info);
+    printf("Stops in the given order: %s\n", value_buffer);
+  }
+}
+
 // =================
 // Main function
 // =================
 
 int main(int argc, char *argv[]) {
-  // Check command line arguments - minimum required: program nodes_file edges_file
-  if (argc < 3) {
+  // Separate "--option value" pairs from positional arguments
+  const char *args[MAX_POSITIONAL_ARGS];
+  int num_args = 0;
+  NodeOrder node_order = NODE_ORDER_HILBERT;
+  bool prune = false;
+  bool contract = false;
+  int num_routes = 1;
+  int num_alternatives = 0;
+  const char *turns_file = NULL;
+  const char *profiles_file = NULL;
+  const char *traffic_file = NULL;
+  const char *avoid_text = NULL;
+  uint16_t avoided_classes = 0;
+  const char *weightings_file = NULL;
+  double pareto_epsilon = -1.0; // Negative: no Pareto routes
+  const char *via_text = NULL;
+  bool reorder_stops = false;
+  bool round_trip = false;
+  bool time_dependent = false;
+  uint32_t departure_ms = 0;
+  error_info_t err_info;
+  error_code_t err_code;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--order") == 0 && i + 1 < argc) {
+      err_code = parse_node_order(argv[++i], &node_order, &err_info);
+      if (err_code != ERR_SUCCESS) {
+        print_error(&err_info);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--prune") == 0) {
+      prune = true;
+    } else if (strcmp(argv[i], "--contract") == 0) {
+      contract = true;
+    } else if (strcmp(argv[i], "--paths") == 0 && i + 1 < argc) {
+      num_routes = atoi(argv[++i]);
+      if (num_routes <= 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--turns") == 0 && i + 1 < argc) {
+      turns_file = argv[++i];
+    } else if (strcmp(argv[i], "--profiles") == 0 && i + 1 < argc) {
+      profiles_file = argv[++i];
+    } else if (strcmp(argv[i], "--traffic") == 0 && i + 1 < argc) {
+      traffic_file = argv[++i];
+    } else if (strcmp(argv[i], "--avoid") == 0 && i + 1 < argc) {
+      avoid_text = argv[++i];
+      err_code = parse_road_classes(avoid_text, &avoided_classes, &err_info);
+      if (err_code != ERR_SUCCESS) {
+        print_error(&err_info);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--pareto") == 0 && i + 1 < argc) {
+      char *end;
+      pareto_epsilon = strtod(argv[++i], &end);
+      if (*end != '\0' || !(pareto_epsilon >= 0.0)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--via") == 0 && i + 1 < argc) {
+      via_text = argv[++i];
+    } else if (strcmp(argv[i], "--reorder") == 0) {
+      reorder_stops = true;
+    } else if (strcmp(argv[i], "--round-trip") == 0) {
+      round_trip = true;
+    } else if (strcmp(argv[i], "--weightings") == 0 && i + 1 < argc) {
+      weightings_file = argv[++i];
+    } else if (strcmp(argv[i], "--depart") == 0 && i + 1 < argc) {
+      err_code = parse_time_of_day(argv[++i], &departure_ms, &err_info);
+      if (err_code != ERR_SUCCESS) {
+        print_error(&err_info);
+        return EXIT_FAILURE;
+      }
+      time_dependent = true;
+    } else if (strcmp(argv[i], "--alternatives") == 0 && i + 1 < argc) {
+      num_alternatives = atoi(argv[++i]);
+      if (num_alternatives <= 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strncmp(argv[i], "--", 2) == 0 || num_args >= MAX_POSITIONAL_ARGS) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    } else {
+      args[num_args++] = argv[i];
+    }
+  }
+
+  // Check command line arguments - minimum required: nodes_file edges_file
+  // Both route listings export to the same _<n> GPX files, so only one may be asked for.
+  // Turn-aware routing needs one arc per edge and is not combined with route listings
+  // Time-dependent routing likewise needs one arc per edge and also stands alone; profiles need a departure
+  // Live traffic updates the arcs of individual edges, so chains and pruned trees cannot hold them
+  // Pruned trees merge edges of different classes, so road classes cannot be avoided on them
+  // Weighting profiles compile one cost per edge, which chains and pruned trees do not keep
+  // Pareto routes need one arc per edge and are exported to the same _<n> GPX files as route listings
+  // A waypoint route replaces the GPX file like turn-aware and time-dependent routes, so it stands apart from them;
+  // a round trip orders every stop itself, so it does not take --reorder
+  bool turn_conflict = turns_file != NULL && (prune || contract || num_routes > 1 || num_alternatives > 0);
+  bool time_conflict = time_dependent && (prune || contract || num_routes > 1 || num_alternatives > 0 || turns_file != NULL);
+  bool pareto_conflict = pareto_epsilon >= 0.0 && (prune || contract || num_routes > 1 || num_alternatives > 0);
+  bool via_conflict = via_text != NULL ? (turns_file != NULL || time_dependent || (reorder_stops && round_trip))
+                                       : (reorder_stops || round_trip);
+  if (num_args < 2 || (num_routes > 1 && num_alternatives > 0) || turn_conflict || time_conflict || pareto_conflict || via_conflict ||
+      (profiles_file != NULL && !time_dependent) || (traffic_file != NULL && (prune || contract)) ||
+      (avoid_text != NULL && prune) || (weightings_file != NULL && (prune || contract))) {
     print_usage(argv[0]);
     return EXIT_FAILURE;
   }
 
   // Parse command line arguments
-  const char *nodes_file = argv[1];
-  const char *edges_file = argv[2];
+  const char *nodes_file = args[0];
+  const char *edges_file = args[1];
 
   // Initialize variables for different execution modes
   bool coordinate_mode = false;
@@ -30,15 +231,15 @@ int main(int argc, char *argv[]) {
   const char *gpx_file = NULL;
 
   // Parse optional arguments to determine execution mode
-  if (argc >= 4 && strcmp(argv[3], "-c") == 0) {
+  if (num_args >= 3 && strcmp(args[2], "-c") == 0) {
     // Coordinate mode: user will input coordinates interactively
     coordinate_mode = true;
-    gpx_file = (argc >= 5) ? argv[4] : NULL;
-  } else if (argc >= 5) {
+    gpx_file = (num_args >= 4) ? args[3] : NULL;
+  } else if (num_args >= 4) {
     // Direct node ID mode: source and target specified as arguments
-    source_id = (uint32_t)atoi(argv[3]);
-    target_id = (uint32_t)atoi(argv[4]);
-    gpx_file = (argc >= 6) ? argv[5] : NULL;
+    source_id = (uint32_t)atoi(args[2]);
+    target_id = (uint32_t)atoi(args[3]);
+    gpx_file = (num_args >= 5) ? args[4] : NULL;
   } else {
     // Invalid arguments provided
     print_usage(argv[0]);
@@ -51,10 +252,6 @@ int main(int argc, char *argv[]) {
   printf("  Nodes: %s\n", nodes_file);
   printf("  Edges: %s\n", edges_file);
 
-  // Initialize error handling system
-  error_info_t err_info;
-  error_code_t err_code;
-
   // Load the graph from binary files into memory
   Graph *graph = NULL;
   err_code = load_graph_from_binary(&graph, nodes_file, edges_file, &err_info);
@@ -63,19 +260,179 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  // Resolve turn restrictions against the loaded edges (reordering keeps them)
+  if (turns_file) {
+    printf("Loading turn restrictions from %s...\n", turns_file);
+    err_code = load_turn_restrictions(graph, turns_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Attach travel time profiles (keyed by edge index, so reordering keeps them)
+  if (profiles_file) {
+    printf("Loading travel time profiles from %s...\n", profiles_file);
+    err_code = load_time_profiles(graph, profiles_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Lay out nodes for cache locality (node IDs are unaffected)
+  if (node_order != NODE_ORDER_FILE) {
+    printf("Reordering nodes (%s order)...\n", node_order_name(node_order));
+    err_code = reorder_graph_nodes(graph, node_order, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Overlay live speeds (after reordering, which rebuilds the arcs from edges.bin)
+  if (traffic_file) {
+    printf("Applying live traffic from %s...\n", traffic_file);
+    err_code = load_traffic_updates(graph, traffic_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Compile weighting profiles into arc streams (reordering would recompile them)
+  if (weightings_file) {
+    printf("Loading weighting profiles from %s...\n", weightings_file);
+    err_code = load_weighting_profiles(graph, weightings_file, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Move dead-end trees out of the routing graph (after reordering, which needs the full topology)
+  if (prune) {
+    printf("Pruning dead-end trees...\n");
+    err_code = prune_dead_end_trees(graph, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Collapse degree-2 chains (after reordering and pruning)
+  if (contract) {
+    printf("Contracting degree-2 chains...\n");
+    err_code = contract_degree2_chains(graph, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Mark the arcs of avoided road classes (after contraction, whose chains have a single class)
+  if (avoid_text) {
+    printf("Avoiding road classes: %s...\n", avoid_text);
+    err_code = set_avoided_road_classes(graph, avoided_classes, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
   // Display comprehensive graph statistics and memory usage
   printf("\n=== GRAPH SUMMARY ===\n");
   printf("Total nodes: %d\n", graph->num_nodes);
-  printf("Total edges: %d\n", graph->num_edges);
+  printf("Total edges: %lld\n", (long long)graph->num_edges);
+  if (graph->components != NULL) {
+    printf("Strongly connected components: %d (largest %d nodes, %.1f%%), %d weakly connected\n",
+        graph->components->num_components, graph->components->largest_size,
+        100.0 * graph->components->largest_size / graph->num_nodes, graph->components->num_groups);
+  }
+  if (graph->pruned != NULL) {
+    printf("Core nodes: %d (%d on dead-end trees)\n",
+        graph->pruned->num_core_nodes, graph->pruned->num_pruned_nodes);
+  }
+  if (graph->chains != NULL) {
+    printf("Routing nodes: %d (%d chains contracted)\n",
+        graph->chains->num_routing_nodes, graph->chains->num_chains);
+  }
+  if (graph->pruned != NULL || graph->chains != NULL) {
+    printf("Routing arcs: %lld\n", (long long)graph->adj_offsets[graph->num_nodes]);
+  }
+  if (graph->turns != NULL) {
+    printf("Turn restrictions: %d at %d junctions (%d records ignored)\n",
+        graph->turns->num_entries, graph->turns->num_via_nodes, graph->turns->num_ignored);
+  }
+  if (graph->profiles != NULL && graph->profiles->num_profiles > 0) {
+    printf("Travel time profiles: %d (%d breakpoints) on %lld edges\n", graph->profiles->num_profiles,
+        (int)graph->profiles->profile_offsets[graph->profiles->num_profiles], (long long)graph->profiles->num_assigned);
+  }
+  if (graph->traffic != NULL) {
+    printf("Live traffic: %d edge updates (%lld arcs) in %u batch(es)\n", graph->traffic->last_batch_edges,
+        (long long)graph->traffic->last_batch_arcs, graph->traffic->num_batches);
+  }
+  if (graph->filter != NULL) {
+    printf("Avoided road classes: %s (%lld of %lld arcs)\n", avoid_text,
+        (long long)graph->filter->num_avoided_arcs, (long long)graph->adj_offsets[graph->num_nodes]);
+  }
+  if (graph->weightings != NULL) {
+    printf("Weighting profiles: %d\n", graph->weightings->num_profiles);
+  }
   printf("Memory usage:\n");
-  printf("  Nodes: %.2f MB\n", (double)(graph->num_nodes * 
-        sizeof(Node)) / (1024 * 1024));
-  printf("  Edges: %.2f MB\n", (double)(graph->num_edges *
-        sizeof(Edge)) / (1024 * 1024));
-  printf("  CSR: %.2f MB\n", (double)((graph->num_nodes + graph->num_edges) *
-        sizeof(int)) / (1024 * 1024));
+  printf("  Nodes: %.2f MB\n", (double)(graph->num_nodes *
+        (sizeof(uint32_t) + 2 * sizeof(int32_t))) / (1024 * 1024));
+  printf("  Edges: %.2f MB\n", ((double)graph->num_edges *
+        (2 * sizeof(int) + sizeof(uint32_t) + sizeof(uint16_t) + 2 * sizeof(uint8_t))) / (1024 * 1024));
+  double num_slots = (double)graph->adj_offsets[graph->num_nodes];
+  printf("  CSR: %.2f MB\n", ((graph->num_nodes + 1 + num_slots) * sizeof(edge_index_t) +
+        num_slots * WEIGHT_NUM_METRICS * sizeof(Arc)) / (1024 * 1024));
   printf("  Hash Table: %.2f MB\n", (double)(graph->node_hash->size *
         sizeof(NodeHashEntry *)) / (1024 * 1024));
+  if (graph->components != NULL) {
+    printf("  Components: %.2f MB\n", ((double)graph->num_nodes * sizeof(int) +
+          (double)graph->components->num_components * sizeof(int)) / (1024 * 1024));
+  }
+  if (graph->pruned != NULL) {
+    printf("  Dead-end trees: %.2f MB\n", (double)graph->pruned->num_pruned_nodes *
+          (3 * sizeof(int) + 2 * WEIGHT_NUM_METRICS * sizeof(uint32_t)) / (1024 * 1024));
+  }
+  if (graph->chains != NULL) {
+    int num_interior = graph->chains->num_interior_nodes;
+    printf("  Chains: %.2f MB\n", ((double)graph->chains->num_chains * sizeof(Chain) +
+          (double)num_interior * (sizeof(int) + WEIGHT_NUM_METRICS * sizeof(uint32_t))) / (1024 * 1024));
+  }
+  if (graph->turns != NULL) {
+    printf("  Turn restrictions: %.2f MB\n", ((double)(graph->num_nodes + 1) * sizeof(int) +
+          (double)graph->turns->num_entries * sizeof(TurnEntry)) / (1024 * 1024));
+  }
+  if (graph->profiles != NULL && graph->profiles->num_profiles > 0) {
+    int num_profiles = graph->profiles->num_profiles;
+    printf("  Travel time profiles: %.2f MB\n", ((double)graph->num_edges * sizeof(uint16_t) +
+          (double)(num_profiles + 1) * sizeof(uint32_t) + (double)num_profiles * sizeof(uint16_t) +
+          (double)graph->profiles->profile_offsets[num_profiles] * sizeof(ProfilePoint)) / (1024 * 1024));
+  }
+  if (graph->traffic != NULL) {
+    printf("  Live traffic: %.2f MB\n", (2.0 * graph->num_edges * (WEIGHT_NUM_METRICS + graph->traffic->num_weighting_spares) * sizeof(Arc) +
+          (double)graph->num_edges * sizeof(uint16_t) +
+          (double)graph->traffic->stale_capacity * sizeof(edge_index_t)) / (1024 * 1024));
+  }
+  if (graph->filter != NULL) {
+    printf("  Road class filter: %.2f MB\n", (double)(HIGHWAY_NUM_TYPES + 1) *
+          graph->filter->num_words * sizeof(uint64_t) / (1024 * 1024));
+  }
+  if (graph->weightings != NULL) {
+    printf("  Weighting profiles: %.2f MB\n", (double)graph->weightings->num_profiles *
+          (num_slots * sizeof(Arc) + sizeof(WeightingProfile)) / (1024 * 1024));
+  }
 
   // Display hash table performance statistics
   print_hash_table_stats(graph);
@@ -90,20 +447,24 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  // Prompt user to choose Dijkstra algorithm mode
+  // Prompt user to choose Dijkstra algorithm mode (weighting profiles follow the built-in modes)
   char buffer[32];
   int dijkstra_mode;
+  int num_choices = 2 + (graph->weightings != NULL ? graph->weightings->num_profiles : 0);
   printf("\nChoose Dijkstra mode:\n");
   printf("  1. Dijkstra shortest distance\n");
   printf("  2. Dijkstra fastest path\n");
-  printf("Enter choice (1 or 2): ");
+  for (int p = 0; p + 2 < num_choices; p++) {
+    printf("  %d. Weighting profile %s\n", p + 3, graph->weightings->profiles[p].name);
+  }
+  printf("Enter choice (1 to %d): ", num_choices);
 
   // Read and validate user input for Dijkstra mode
   if (fgets(buffer, sizeof(buffer), stdin)) {
     buffer[strcspn(buffer, "\n")] = 0; // Remove newline character
     if (sscanf(buffer, "%d", &dijkstra_mode) != 1 || 
-        (dijkstra_mode != 1 && dijkstra_mode != 2)) {
-      fprintf(stderr, "Invalid choice. Please enter 1 or 2.\n");
+        dijkstra_mode < 1 || dijkstra_mode > num_choices) {
+      fprintf(stderr, "Invalid choice. Please enter a number from 1 to %d.\n", num_choices);
       free_graph(graph);
       return EXIT_FAILURE;
     }
@@ -112,7 +473,7 @@ int main(int argc, char *argv[]) {
     free_graph(graph);
     return EXIT_FAILURE;
   }
-  DijkstraMode mode = (DijkstraMode)dijkstra_mode;
+  DijkstraMode mode = dijkstra_mode > 2 ? DIJKSTRA_WEIGHTING_MODE(dijkstra_mode - 3) : (DijkstraMode)dijkstra_mode;
 
   // Execute Dijkstra's algorithm to find shortest path
   printf("\n=== RUNNING DIJKSTRA ===\n");
@@ -160,7 +521,10 @@ int main(int argc, char *argv[]) {
       printf("Path contains %d nodes.\n", path_length);
 
       // Display results with appropriate units based on mode
-      if (mode == DIJKSTRA_FASTEST_TIME) {
+      if (DIJKSTRA_IS_WEIGHTING_MODE(mode)) {
+        printf("Total cost (%s): %.2f weighted minutes\n",
+            graph->weightings->profiles[DIJKSTRA_WEIGHTING_PROFILE(mode)].name, distance);
+      } else if (mode == DIJKSTRA_FASTEST_TIME) {
         if (distance >= 60) {
           printf("Total time: %.2f Hours\n", distance / 60.0);
         } else {
@@ -174,8 +538,9 @@ int main(int argc, char *argv[]) {
         }
       }
 
-      // Export path to GPX file if filename was provided
-      if (gpx_file) {
+      // Export path to GPX file if filename was provided (turn-aware, time-dependent and waypoint routes replace it)
+      bool replaced = turns_file != NULL || (time_dependent && mode == DIJKSTRA_FASTEST_TIME) || via_text != NULL;
+      if (gpx_file && !replaced) {
         err_code = export_path_to_gpx(graph, path, path_length, gpx_file, mode, &result, &err_info);
         if (err_code != ERR_SUCCESS) {
           print_error(&err_info);
@@ -189,6 +554,210 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // Route again obeying turn restrictions; the route may differ from the one above
+  if (turns_file && result.target_found) {
+    printf("\n=== TURN-RESTRICTED ROUTE ===\n");
+    TurnRoute turn_route;
+    err_code = turn_shortest_path(graph, NULL, source_id, target_id, mode, &turn_route, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+
+    if (!turn_route.target_found) {
+      printf("No route to the target obeys the turn restrictions.\n");
+    } else {
+      const RoutePath *route = &turn_route.path;
+      char value_buffer[64];
+      format_distance(dijkstra_cost_value(mode, route->costs[route->length - 1]), value_buffer, sizeof(value_buffer), mode, &err_info);
+      printf("Path contains %d nodes, total %s.\n", route->length, value_buffer);
+      if (gpx_file) {
+        err_code = export_path_costs_to_gpx(graph, route->nodes, route->costs, route->length, gpx_file, mode, &err_info);
+        if (err_code == ERR_SUCCESS) printf("Path exported to GPX file: %s\n", gpx_file);
+      }
+    }
+    printf("Settled arc labels: %d\n", turn_route.settled_count);
+    free_turn_route(&turn_route);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Route again with the travel times of the departure time; the route may differ from the one above
+  if (time_dependent && result.target_found) {
+    printf("\n=== TIME-DEPENDENT ROUTE ===\n");
+    if (mode != DIJKSTRA_FASTEST_TIME) {
+      printf("Departure times only apply to the fastest path mode.\n");
+    } else {
+      DijkstraResult td_result;
+      err_code = dijkstra_time_dependent(graph, source_id, target_id, departure_ms, true, &td_result, &err_info);
+      if (err_code != ERR_SUCCESS) {
+        print_error(&err_info);
+        free_dijkstra_result(&result);
+        free_graph(graph);
+        return EXIT_FAILURE;
+      }
+
+      int path_length = 0;
+      int *path = NULL;
+      if (td_result.target_found) {
+        err_code = get_shortest_path(graph, &td_result, &path_length, &path, &err_info);
+      }
+      if (err_code == ERR_SUCCESS && path_length > 0) {
+        uint32_t duration = td_result.distances[td_result.target_index];
+        uint32_t arrival_s = (uint32_t)(((uint64_t)departure_ms + duration) % PROFILE_DAY_MS / 1000);
+        char value_buffer[64];
+        format_distance(dijkstra_cost_value(mode, duration), value_buffer, sizeof(value_buffer), mode, &err_info);
+        printf("Departure %02u:%02u:%02u, arrival %02u:%02u:%02u\n", departure_ms / 3600000, departure_ms / 60000 % 60,
+            departure_ms / 1000 % 60, arrival_s / 3600, arrival_s / 60 % 60, arrival_s % 60);
+        printf("Path contains %d nodes, total %s.\n", path_length, value_buffer);
+        if (gpx_file) {
+          err_code = export_path_to_gpx(graph, path, path_length, gpx_file, mode, &td_result, &err_info);
+          if (err_code == ERR_SUCCESS) printf("Path exported to GPX file: %s\n", gpx_file);
+        }
+      }
+      printf("Settled nodes: %d\n", td_result.settled_count);
+      free(path);
+      free_dijkstra_result(&td_result);
+      if (err_code != ERR_SUCCESS) {
+        print_error(&err_info);
+        free_dijkstra_result(&result);
+        free_graph(graph);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Route again through the waypoints, stitching the legs into one path
+  if (via_text && result.target_found) {
+    printf("\n=== WAYPOINT ROUTE ===\n");
+    uint32_t *via_ids = NULL;
+    int num_vias = 0;
+    uint32_t *stop_ids = NULL;
+    err_code = parse_node_list(via_text, &via_ids, &num_vias, &err_info);
+    if (err_code == ERR_SUCCESS) {
+      stop_ids = (uint32_t *)alloc_array(num_vias + 2, sizeof(uint32_t));
+      if (stop_ids == NULL) {
+        SET_ERROR(&err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for waypoints.");
+        err_code = ERR_MEMORY_ALLOCATION;
+      }
+    }
+
+    // A round trip visits every stop, the target included, and returns to the source
+    TspTour tour;
+    WaypointRoute *route = &tour.route;
+    if (err_code == ERR_SUCCESS) {
+      stop_ids[0] = source_id;
+      memcpy(&stop_ids[1], via_ids, num_vias * sizeof(uint32_t));
+      stop_ids[num_vias + 1] = target_id;
+      if (round_trip) {
+        err_code = find_tsp_tour(graph, stop_ids, num_vias + 2, mode, NULL, &tour, &err_info);
+      } else {
+        err_code = find_waypoint_route(graph, stop_ids, num_vias + 2, mode, reorder_stops, route, &err_info);
+      }
+    }
+    if (err_code == ERR_SUCCESS) {
+      print_waypoint_route(route, stop_ids, mode, &err_info);
+      if (round_trip) {
+        char value_buffer[64];
+        format_distance(dijkstra_cost_value(mode, (uint32_t)tour.stats.initial_cost), value_buffer, sizeof(value_buffer), mode, &err_info);
+        printf("Nearest neighbour order: %s, improved by %d 2-opt/Or-opt moves\n", value_buffer, tour.stats.improvements);
+      }
+      if (gpx_file && route->unreachable_leg < 0) {
+        err_code = export_path_costs_to_gpx(graph, route->path.nodes, route->path.costs, route->path.length, gpx_file, mode, &err_info);
+        if (err_code == ERR_SUCCESS) printf("Path exported to GPX file: %s\n", gpx_file);
+      }
+      printf("Settled nodes: %d\n", route->settled_count);
+      free_tsp_tour(&tour);
+    }
+    free(via_ids);
+    free(stop_ids);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // List loopless alternatives when more than one route was requested
+  if (num_routes > 1 && result.target_found) {
+    printf("\n=== ALTERNATIVE ROUTES ===\n");
+    KShortestPaths routes;
+    err_code = find_k_shortest_paths(graph, source_id, target_id, num_routes, mode, &routes, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+
+    err_code = print_routes(graph, routes.paths, routes.num_paths, gpx_file, mode, &err_info);
+    printf("Spur searches: %d, settled nodes: %d\n", routes.spur_searches, routes.settled_count);
+    free_k_shortest_paths(&routes);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // List via-node alternatives that differ enough from the shortest route
+  if (num_alternatives > 0 && result.target_found) {
+    printf("\n=== ALTERNATIVE ROUTES ===\n");
+    AlternativeRoutes routes;
+    err_code = find_alternative_routes(graph, source_id, target_id, num_alternatives, mode, NULL, &routes, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+
+    err_code = print_routes(graph, routes.paths, routes.num_paths, gpx_file, mode, &err_info);
+    printf("Plateaus: %d (%d admissible), settled nodes: %d\n", routes.num_plateaus, routes.num_admissible, routes.settled_count);
+    free_alternative_routes(&routes);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // List the routes trading distance against travel time
+  if (pareto_epsilon >= 0.0 && result.target_found) {
+    printf("\n=== PARETO ROUTES (distance vs. time) ===\n");
+    ParetoParams params;
+    default_pareto_params(&params);
+    params.epsilon = pareto_epsilon;
+    ParetoFront front;
+    err_code = find_pareto_routes(graph, source_id, target_id, &params, &front, &err_info);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+
+    err_code = print_pareto_routes(graph, &front, gpx_file, &err_info);
+    printf("Labels: %d created, %d settled%s\n", front.num_labels, front.settled_count,
+        front.truncated ? " (label budget exhausted, fastest routes missing)" : "");
+    free_pareto_front(&front);
+    if (err_code != ERR_SUCCESS) {
+      print_error(&err_info);
+      free_dijkstra_result(&result);
+      free_graph(graph);
+      return EXIT_FAILURE;
+    }
+  }
+
   // Clean up all allocated resources
   free_dijkstra_result(&result);
   free_graph(graph);
@@ -0,0 +1,989 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "matching.h"
+#include "dijkstra.h"
+#include "roadclass.h"
+#include "traffic.h"
+#include "utils.h"
+
+// M_PI is not part of strict C99 <math.h>
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define METERS_PER_DEGREE 111320.0
+
+// Entry or exit nodes of one candidate set: two per candidate on two-way edges
+#define MAX_EDGE_ENDS (2 * MATCH_MAX_CANDIDATES)
+
+// ================
+// Edge Grid
+// ================
+
+/**
+ * Cell range covering a bounding box in COORD_SCALE units, clamped to the
+ * grid. Returns false if the box misses the grid.
+ */
+static bool grid_cell_range(const EdgeGrid *grid, double min_lat, double max_lat, double min_lon, double max_lon,
+                            int *row0, int *row1, int *col0, int *col1) {
+  double r0 = floor((min_lat - grid->min_lat) / grid->cell_lat);
+  double r1 = floor((max_lat - grid->min_lat) / grid->cell_lat);
+  double c0 = floor((min_lon - grid->min_lon) / grid->cell_lon);
+  double c1 = floor((max_lon - grid->min_lon) / grid->cell_lon);
+  if (r1 < 0 || c1 < 0 || r0 >= grid->rows || c0 >= grid->cols) return false;
+
+  *row0 = r0 < 0 ? 0 : (int)r0;
+  *row1 = r1 >= grid->rows ? grid->rows - 1 : (int)r1;
+  *col0 = c0 < 0 ? 0 : (int)c0;
+  *col1 = c1 >= grid->cols ? grid->cols - 1 : (int)c1;
+  return true;
+}
+
+static void edge_bounds(const Graph *graph, edge_index_t e, double *min_lat, double *max_lat, double *min_lon, double *max_lon) {
+  int32_t lat_a = graph->node_lat[graph->edge_from[e]], lat_b = graph->node_lat[graph->edge_to[e]];
+  int32_t lon_a = graph->node_lon[graph->edge_from[e]], lon_b = graph->node_lon[graph->edge_to[e]];
+  *min_lat = lat_a < lat_b ? lat_a : lat_b;
+  *max_lat = lat_a < lat_b ? lat_b : lat_a;
+  *min_lon = lon_a < lon_b ? lon_a : lon_b;
+  *max_lon = lon_a < lon_b ? lon_b : lon_a;
+}
+
+void free_edge_grid(EdgeGrid *grid) {
+  if (grid == NULL) return;
+
+  free(grid->cell_offsets);
+  free(grid->cell_edges);
+  free(grid);
+}
+
+error_code_t build_edge_grid(const Graph *graph, double cell_size_m, EdgeGrid **grid, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(grid, err_info);
+
+  if (graph->num_nodes <= 0 || !(cell_size_m > 0.0)) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "An edge grid needs nodes and a positive cell size.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int32_t min_lat = graph->node_lat[0], max_lat = graph->node_lat[0];
+  int32_t min_lon = graph->node_lon[0], max_lon = graph->node_lon[0];
+  for (int i = 1; i < graph->num_nodes; i++) {
+    if (graph->node_lat[i] < min_lat) min_lat = graph->node_lat[i];
+    if (graph->node_lat[i] > max_lat) max_lat = graph->node_lat[i];
+    if (graph->node_lon[i] < min_lon) min_lon = graph->node_lon[i];
+    if (graph->node_lon[i] > max_lon) max_lon = graph->node_lon[i];
+  }
+
+  // Square cells at the middle latitude, grown until there are no more cells than edges
+  double mid_lat = coord_to_degrees((int32_t)(((int64_t)min_lat + max_lat) / 2));
+  double lon_scale = cos(mid_lat * M_PI / 180.0);
+  if (lon_scale < 0.01) lon_scale = 0.01;
+  double cell_lat = cell_size_m / METERS_PER_DEGREE * COORD_SCALE;
+  double max_cells = graph->num_edges > 0 ? (double)graph->num_edges : 1.0;
+  double rows, cols;
+  while (true) {
+    rows = floor(((double)max_lat - min_lat) / cell_lat) + 1;
+    cols = floor(((double)max_lon - min_lon) / (cell_lat / lon_scale)) + 1;
+    if (rows * cols <= max_cells && rows * cols < INT_MAX) break;
+    cell_lat *= 2;
+  }
+
+  EdgeGrid *g = (EdgeGrid *)calloc(1, sizeof(EdgeGrid));
+  CHECK_ALLOCATION(g, err_info);
+  g->min_lat = min_lat;
+  g->min_lon = min_lon;
+  g->cell_lat = cell_lat;
+  g->cell_lon = cell_lat / lon_scale;
+  g->rows = (int)rows;
+  g->cols = (int)cols;
+
+  int num_cells = g->rows * g->cols;
+  g->cell_offsets = (edge_index_t *)calloc((size_t)num_cells + 1, sizeof(edge_index_t));
+  if (g->cell_offsets == NULL) {
+    free_edge_grid(g);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for edge grid.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Count the cells of every edge, then scatter the edges into them
+  int64_t total = 0;
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    double e_min_lat, e_max_lat, e_min_lon, e_max_lon;
+    int row0, row1, col0, col1;
+    edge_bounds(graph, e, &e_min_lat, &e_max_lat, &e_min_lon, &e_max_lon);
+    grid_cell_range(g, e_min_lat, e_max_lat, e_min_lon, e_max_lon, &row0, &row1, &col0, &col1);
+    for (int r = row0; r <= row1; r++) {
+      for (int c = col0; c <= col1; c++) {
+        g->cell_offsets[r * g->cols + c + 1]++;
+      }
+    }
+    total += (int64_t)(row1 - row0 + 1) * (col1 - col0 + 1);
+  }
+  if (total > EDGE_INDEX_MAX) {
+    free_edge_grid(g);
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Edge grid entries exceed the edge index range; build with INDEX64=1.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  for (int c = 0; c < num_cells; c++) {
+    g->cell_offsets[c + 1] += g->cell_offsets[c];
+  }
+
+  g->cell_edges = (edge_index_t *)alloc_array(total > 0 ? (size_t)total : 1, sizeof(edge_index_t));
+  edge_index_t *fill = (edge_index_t *)alloc_array(num_cells, sizeof(edge_index_t));
+  if (g->cell_edges == NULL || fill == NULL) {
+    free(fill);
+    free_edge_grid(g);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for edge grid.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  memcpy(fill, g->cell_offsets, num_cells * sizeof(edge_index_t));
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    double e_min_lat, e_max_lat, e_min_lon, e_max_lon;
+    int row0, row1, col0, col1;
+    edge_bounds(graph, e, &e_min_lat, &e_max_lat, &e_min_lon, &e_max_lon);
+    grid_cell_range(g, e_min_lat, e_max_lat, e_min_lon, e_max_lon, &row0, &row1, &col0, &col1);
+    for (int r = row0; r <= row1; r++) {
+      for (int c = col0; c <= col1; c++) {
+        g->cell_edges[fill[r * g->cols + c]++] = e;
+      }
+    }
+  }
+
+  free(fill);
+  *grid = g;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Workspace
+// ================
+
+/**
+ * A candidate position of a fix and its Viterbi state.
+ */
+typedef struct {
+  edge_index_t edge;        // Candidate edge
+  double offset;            // Position along the edge from edge_from (0) to edge_to (1)
+  double distance_m;        // Distance from the fix
+  GeoPoint position;        // Projection of the fix onto the edge
+  double emission;          // Log-likelihood of the fix seen from this position
+  double score;             // Log-likelihood of the best sequence ending here
+  int back;                 // Candidate of the previous matched fix on that sequence, -1 at a segment start
+} Candidate;
+
+/**
+ * A node a candidate position is left or entered by, and the meters between them.
+ */
+typedef struct {
+  int node;
+  double cost_m;
+} EdgeEnd;
+
+/**
+ * Search state of one thread. Target fields are only valid where
+ * target_stamp equals target_id, and an edge was listed for the current fix
+ * where edge_stamp equals edge_id; every ID restarts after clearing its
+ * stamps when it wraps.
+ */
+struct MatchWorkspace {
+  const Graph *graph;
+  const Arc *arcs;          // Distance arcs of the trace being matched
+  const uint64_t *avoided_arcs; // Road filter of the trace being matched
+  StampedSearch search;     // Meters from the search source
+  int num_targets;          // Targets the current search still has to settle
+  int *target_slot;         // Entry slot of a target node
+  uint32_t *target_stamp;   // Transition that made the node a target
+  uint32_t target_id;
+  uint32_t *edge_stamp;     // Fix that last listed the edge
+  uint32_t edge_id;
+
+  // Per-trace state, grown to the longest trace matched so far
+  Candidate *candidates;    // Candidates of fix p are candidates[first_candidate[p]..first_candidate[p + 1])
+  int *first_candidate;
+  int *chosen;              // Decoded candidate per fix, -1 if unmatched
+  int point_capacity;       // Fixes the per-trace arrays hold
+  int candidate_capacity;   // Candidates per fix the candidate array holds
+
+  // Transition state
+  int entry_nodes[MAX_EDGE_ENDS];
+  uint32_t slot_cost[MAX_EDGE_ENDS][MAX_EDGE_ENDS]; // Meters from exit slot to entry slot
+  double route_m[MATCH_MAX_CANDIDATES * MATCH_MAX_CANDIDATES];
+
+  // Route of the last traced transition, path_length arcs
+  int *path_nodes;
+  edge_index_t *path_edges;
+  int path_length;
+  int path_capacity;
+};
+
+void free_match_workspace(MatchWorkspace *ws) {
+  if (ws == NULL) return;
+
+  stamped_search_free(&ws->search);
+  free(ws->target_slot);
+  free(ws->target_stamp);
+  free(ws->edge_stamp);
+  free(ws->candidates);
+  free(ws->first_candidate);
+  free(ws->chosen);
+  free(ws->path_nodes);
+  free(ws->path_edges);
+  free(ws);
+}
+
+error_code_t create_match_workspace(const Graph *graph, MatchWorkspace **workspace, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(workspace, err_info);
+
+  MatchWorkspace *ws = (MatchWorkspace *)calloc(1, sizeof(MatchWorkspace));
+  CHECK_ALLOCATION(ws, err_info);
+  int num_nodes = graph->num_nodes;
+  size_t num_edges = graph->num_edges > 0 ? (size_t)graph->num_edges : 1;
+  ws->graph = graph;
+
+  ws->target_slot = (int *)alloc_array(num_nodes, sizeof(int));
+  ws->target_stamp = (uint32_t *)calloc(num_nodes, sizeof(uint32_t));
+  ws->edge_stamp = (uint32_t *)calloc(num_edges, sizeof(uint32_t));
+  if (ws->target_slot == NULL || ws->target_stamp == NULL || ws->edge_stamp == NULL) {
+    free_match_workspace(ws);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for match workspace.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  error_code_t err_code = stamped_search_init(&ws->search, num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free_match_workspace(ws);
+    return err_code;
+  }
+
+  *workspace = ws;
+  return ERR_SUCCESS;
+}
+
+static uint32_t next_target_id(MatchWorkspace *ws) {
+  if (++ws->target_id == 0) {
+    memset(ws->target_stamp, 0, ws->graph->num_nodes * sizeof(uint32_t));
+    ws->target_id = 1;
+  }
+  return ws->target_id;
+}
+
+static uint32_t next_edge_id(MatchWorkspace *ws) {
+  if (++ws->edge_id == 0) {
+    memset(ws->edge_stamp, 0, (ws->graph->num_edges > 0 ? (size_t)ws->graph->num_edges : 1) * sizeof(uint32_t));
+    ws->edge_id = 1;
+  }
+  return ws->edge_id;
+}
+
+/**
+ * Grows the per-trace arrays to num_points fixes of max_candidates candidates.
+ */
+static error_code_t reserve_trace_state(MatchWorkspace *ws, int num_points, int max_candidates, error_info_t *err_info) {
+  if (num_points <= ws->point_capacity && max_candidates <= ws->candidate_capacity) return ERR_SUCCESS;
+
+  int points = num_points > ws->point_capacity ? num_points : ws->point_capacity;
+  int per_point = max_candidates > ws->candidate_capacity ? max_candidates : ws->candidate_capacity;
+  free(ws->candidates);
+  free(ws->first_candidate);
+  free(ws->chosen);
+  ws->candidates = (Candidate *)alloc_array((size_t)points * per_point, sizeof(Candidate));
+  ws->first_candidate = (int *)alloc_array((size_t)points + 1, sizeof(int));
+  ws->chosen = (int *)alloc_array(points, sizeof(int));
+  if (ws->candidates == NULL || ws->first_candidate == NULL || ws->chosen == NULL) {
+    free(ws->candidates);
+    free(ws->first_candidate);
+    free(ws->chosen);
+    ws->candidates = NULL;
+    ws->first_candidate = NULL;
+    ws->chosen = NULL;
+    ws->point_capacity = 0;
+    ws->candidate_capacity = 0;
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for trace candidates.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  ws->point_capacity = points;
+  ws->candidate_capacity = per_point;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Candidates
+// ================
+
+/**
+ * Projects a fix onto an edge in a planar frame around the fix, which is
+ * accurate to well under a meter within a search radius.
+ */
+static void project_onto_edge(const Graph *graph, edge_index_t e, const GeoPoint *fix, double lon_scale, Candidate *candidate) {
+  double meters_lon = METERS_PER_DEGREE * lon_scale;
+  double ay = (coord_to_degrees(graph->node_lat[graph->edge_from[e]]) - fix->latitude) * METERS_PER_DEGREE;
+  double ax = (coord_to_degrees(graph->node_lon[graph->edge_from[e]]) - fix->longitude) * meters_lon;
+  double by = (coord_to_degrees(graph->node_lat[graph->edge_to[e]]) - fix->latitude) * METERS_PER_DEGREE;
+  double bx = (coord_to_degrees(graph->node_lon[graph->edge_to[e]]) - fix->longitude) * meters_lon;
+
+  double dx = bx - ax, dy = by - ay;
+  double length2 = dx * dx + dy * dy;
+  double t = length2 > 0.0 ? -(ax * dx + ay * dy) / length2 : 0.0;
+  if (t < 0.0) t = 0.0;
+  if (t > 1.0) t = 1.0;
+
+  double qx = ax + t * dx, qy = ay + t * dy;
+  candidate->edge = e;
+  candidate->offset = t;
+  candidate->distance_m = sqrt(qx * qx + qy * qy);
+  candidate->position.latitude = fix->latitude + qy / METERS_PER_DEGREE;
+  candidate->position.longitude = fix->longitude + qx / meters_lon;
+}
+
+/**
+ * Lists the edges within the search radius of a fix, nearest first, keeping
+ * at most params->max_candidates. Edges of avoided road classes are skipped.
+ *
+ * @return Number of candidates written
+ */
+static int find_candidates(MatchWorkspace *ws, const EdgeGrid *grid, const GeoPoint *fix, const MatchParams *params, Candidate *candidates) {
+  const Graph *graph = ws->graph;
+  double lon_scale = cos(fix->latitude * M_PI / 180.0);
+  if (lon_scale < 0.01) lon_scale = 0.01;
+  double radius_lat = params->search_radius_m / METERS_PER_DEGREE * COORD_SCALE;
+  double radius_lon = radius_lat / lon_scale;
+  double lat = fix->latitude * COORD_SCALE;
+  double lon = fix->longitude * COORD_SCALE;
+
+  int row0, row1, col0, col1;
+  if (!grid_cell_range(grid, lat - radius_lat, lat + radius_lat, lon - radius_lon, lon + radius_lon,
+                       &row0, &row1, &col0, &col1)) {
+    return 0;
+  }
+
+  // Edges spanning several cells are listed in each; the stamp visits them once
+  uint32_t id = next_edge_id(ws);
+  int max_candidates = params->max_candidates;
+  int count = 0;
+  for (int r = row0; r <= row1; r++) {
+    for (int c = col0; c <= col1; c++) {
+      int cell = r * grid->cols + c;
+      for (edge_index_t k = grid->cell_offsets[cell]; k < grid->cell_offsets[cell + 1]; k++) {
+        edge_index_t e = grid->cell_edges[k];
+        if (ws->edge_stamp[e] == id) continue;
+        ws->edge_stamp[e] = id;
+        if (is_road_class_avoided(graph, graph->edge_highway[e])) continue;
+
+        Candidate candidate;
+        project_onto_edge(graph, e, fix, lon_scale, &candidate);
+        if (candidate.distance_m > params->search_radius_m) continue;
+        if (count == max_candidates && candidate.distance_m >= candidates[count - 1].distance_m) continue;
+
+        // Insertion into the sorted candidate list
+        int pos = count < max_candidates ? count++ : max_candidates - 1;
+        while (pos > 0 && candidates[pos - 1].distance_m > candidate.distance_m) {
+          candidates[pos] = candidates[pos - 1];
+          pos--;
+        }
+        candidates[pos] = candidate;
+      }
+    }
+  }
+
+  // Gaussian noise: the constant factor is the same for every candidate and dropped
+  for (int i = 0; i < count; i++) {
+    double z = candidates[i].distance_m / params->sigma_m;
+    candidates[i].emission = -0.5 * z * z;
+  }
+  return count;
+}
+
+// ================
+// Transitions
+// ================
+
+/**
+ * Nodes a position is left by: edge_to ahead, and edge_from behind on
+ * two-way edges.
+ *
+ * @return Number of ends written
+ */
+static int exit_ends(const Graph *graph, const Candidate *candidate, EdgeEnd *ends) {
+  double length = graph->edge_length[candidate->edge];
+  ends[0].node = graph->edge_to[candidate->edge];
+  ends[0].cost_m = (1.0 - candidate->offset) * length;
+  if (graph->edge_one_way[candidate->edge]) return 1;
+  ends[1].node = graph->edge_from[candidate->edge];
+  ends[1].cost_m = candidate->offset * length;
+  return 2;
+}
+
+/**
+ * Nodes a position is entered by: edge_from, and edge_to on two-way edges.
+ *
+ * @return Number of ends written
+ */
+static int entry_ends(const Graph *graph, const Candidate *candidate, EdgeEnd *ends) {
+  double length = graph->edge_length[candidate->edge];
+  ends[0].node = graph->edge_from[candidate->edge];
+  ends[0].cost_m = candidate->offset * length;
+  if (graph->edge_one_way[candidate->edge]) return 1;
+  ends[1].node = graph->edge_to[candidate->edge];
+  ends[1].cost_m = (1.0 - candidate->offset) * length;
+  return 2;
+}
+
+/**
+ * Meters from one position to another without leaving their edge, INFINITY
+ * if they are on different edges or the move runs against a one-way edge.
+ */
+static double same_edge_route(const Graph *graph, const Candidate *from, const Candidate *to) {
+  if (from->edge != to->edge) return INFINITY;
+  double delta = to->offset - from->offset;
+  if (delta < 0.0 && graph->edge_one_way[from->edge]) return INFINITY;
+  return fabs(delta) * graph->edge_length[from->edge];
+}
+
+/**
+ * Longest route searched between two fixes this far apart.
+ */
+static uint32_t transition_bound(const MatchParams *params, double great_circle_m) {
+  double limit = params->max_route_factor * great_circle_m + 2.0 * params->search_radius_m;
+  return limit < (double)(WEIGHT_INFINITY - 1) ? (uint32_t)ceil(limit) : WEIGHT_INFINITY - 1;
+}
+
+static bool is_last_target(void *context, int node_index) {
+  MatchWorkspace *ws = (MatchWorkspace *)context;
+  return ws->target_stamp[node_index] == ws->target_id && --ws->num_targets == 0;
+}
+
+/**
+ * Runs a search over the stamped workspace that stops once num_targets
+ * nodes of the current target set are settled, or every node within bound is.
+ */
+static error_code_t run_bounded_search(MatchWorkspace *ws, int source_index, int num_targets, uint32_t bound, error_info_t *err_info) {
+  ws->num_targets = num_targets;
+  stamped_search_begin(&ws->search);
+  error_code_t err_code = stamped_search_seed(&ws->search, source_index, 0, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  return stamped_search_run(&ws->search, ws->graph, ws->arcs, ws->avoided_arcs, bound, is_last_target, ws, NULL, err_info);
+}
+
+/**
+ * Marks the entry nodes of a position as targets of a new target set.
+ *
+ * @return Number of distinct entry nodes
+ */
+static int mark_entry_targets(MatchWorkspace *ws, const EdgeEnd *ends, int num_ends, int *slots, int num_slots) {
+  uint32_t target_id = ws->target_id;
+  for (int k = 0; k < num_ends; k++) {
+    int node = ends[k].node;
+    if (ws->target_stamp[node] != target_id) {
+      ws->target_stamp[node] = target_id;
+      ws->target_slot[node] = num_slots;
+      ws->entry_nodes[num_slots++] = node;
+    }
+    slots[k] = ws->target_slot[node];
+  }
+  return num_slots;
+}
+
+/**
+ * Fills ws->route_m with the meters from every candidate of one fix to every
+ * candidate of the next, INFINITY where no route within bound exists. One
+ * search runs per distinct exit node, towards every distinct entry node.
+ */
+static error_code_t compute_transitions(MatchWorkspace *ws, const Candidate *from, int num_from, const Candidate *to, int num_to, uint32_t bound, error_info_t *err_info) {
+  const Graph *graph = ws->graph;
+  EdgeEnd entries[MATCH_MAX_CANDIDATES][2];
+  int entry_slot[MATCH_MAX_CANDIDATES][2];
+  int num_entries[MATCH_MAX_CANDIDATES];
+  next_target_id(ws);
+  int num_slots = 0;
+  for (int j = 0; j < num_to; j++) {
+    num_entries[j] = entry_ends(graph, &to[j], entries[j]);
+    num_slots = mark_entry_targets(ws, entries[j], num_entries[j], entry_slot[j], num_slots);
+  }
+
+  EdgeEnd exits[MATCH_MAX_CANDIDATES][2];
+  int exit_slot[MATCH_MAX_CANDIDATES][2];
+  int num_exits[MATCH_MAX_CANDIDATES];
+  int exit_nodes[MAX_EDGE_ENDS];
+  int num_exit_nodes = 0;
+  for (int i = 0; i < num_from; i++) {
+    num_exits[i] = exit_ends(graph, &from[i], exits[i]);
+    for (int k = 0; k < num_exits[i]; k++) {
+      int node = exits[i][k].node;
+      int s = 0;
+      while (s < num_exit_nodes && exit_nodes[s] != node) s++;
+      exit_slot[i][k] = s;
+      if (s < num_exit_nodes) continue;
+
+      exit_nodes[num_exit_nodes++] = node;
+      error_code_t err_code = run_bounded_search(ws, node, num_slots, bound, err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+      for (int t = 0; t < num_slots; t++) {
+        int entry = ws->entry_nodes[t];
+        ws->slot_cost[s][t] = stamped_search_settled(&ws->search, entry) ? ws->search.cost[entry] : WEIGHT_INFINITY;
+      }
+    }
+  }
+
+  for (int i = 0; i < num_from; i++) {
+    for (int j = 0; j < num_to; j++) {
+      double best = same_edge_route(graph, &from[i], &to[j]);
+      for (int a = 0; a < num_exits[i]; a++) {
+        for (int b = 0; b < num_entries[j]; b++) {
+          uint32_t cost = ws->slot_cost[exit_slot[i][a]][entry_slot[j][b]];
+          if (cost == WEIGHT_INFINITY) continue;
+          double route = exits[i][a].cost_m + cost + entries[j][b].cost_m;
+          if (route < best) best = route;
+        }
+      }
+      ws->route_m[i * num_to + j] = best <= bound ? best : INFINITY;
+    }
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Copies the search path from source_index to target_index into ws->path_*.
+ */
+static error_code_t extract_path(MatchWorkspace *ws, int source_index, int target_index, error_info_t *err_info) {
+  int length = 0;
+  for (int v = target_index; v != source_index; v = ws->search.pred_node[v]) {
+    length++;
+  }
+
+  if (length + 1 > ws->path_capacity) {
+    int capacity = ws->path_capacity * 2 > length + 1 ? ws->path_capacity * 2 : length + 1;
+    free(ws->path_nodes);
+    free(ws->path_edges);
+    ws->path_nodes = (int *)alloc_array(capacity, sizeof(int));
+    ws->path_edges = (edge_index_t *)alloc_array(capacity, sizeof(edge_index_t));
+    if (ws->path_nodes == NULL || ws->path_edges == NULL) {
+      free(ws->path_nodes);
+      free(ws->path_edges);
+      ws->path_nodes = NULL;
+      ws->path_edges = NULL;
+      ws->path_capacity = 0;
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for matched route.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    ws->path_capacity = capacity;
+  }
+
+  int v = target_index;
+  ws->path_nodes[length] = v;
+  for (int k = length; k > 0; k--) {
+    ws->path_edges[k - 1] = ws->graph->adj_indices[ws->search.pred_arc[v]];
+    v = ws->search.pred_node[v];
+    ws->path_nodes[k - 1] = v;
+  }
+  ws->path_length = length;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Finds the route between two decoded positions and keeps it in ws->path_*;
+ * path_length is -1 if the best move stays on their common edge.
+ */
+static error_code_t trace_route(MatchWorkspace *ws, const Candidate *from, const Candidate *to, uint32_t bound, error_info_t *err_info) {
+  const Graph *graph = ws->graph;
+  double best = same_edge_route(graph, from, to);
+  ws->path_length = -1;
+
+  EdgeEnd entries[2];
+  int entry_slot[2];
+  int num_entries = entry_ends(graph, to, entries);
+  next_target_id(ws);
+  int num_slots = mark_entry_targets(ws, entries, num_entries, entry_slot, 0);
+
+  EdgeEnd exits[2];
+  int num_exits = exit_ends(graph, from, exits);
+  for (int a = 0; a < num_exits; a++) {
+    error_code_t err_code = run_bounded_search(ws, exits[a].node, num_slots, bound, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+    for (int b = 0; b < num_entries; b++) {
+      int entry = entries[b].node;
+      if (!stamped_search_settled(&ws->search, entry)) continue;
+      double route = exits[a].cost_m + ws->search.cost[entry] + entries[b].cost_m;
+      if (route < best) {
+        best = route;
+        err_code = extract_path(ws, exits[a].node, entry, err_info);
+        if (err_code != ERR_SUCCESS) return err_code;
+      }
+    }
+  }
+  return ERR_SUCCESS;
+}
+
+// ================
+// Matching
+// ================
+
+void default_match_params(MatchParams *params) {
+  params->search_radius_m = 50.0;
+  params->max_candidates = 8;
+  params->sigma_m = 5.0;
+  params->beta_m = 5.0;
+  params->max_route_factor = 4.0;
+}
+
+void free_matched_trace(MatchedTrace *trace) {
+  if (trace == NULL) return;
+
+  free(trace->points);
+  free(trace->edges);
+  free(trace->geometry);
+  memset(trace, 0, sizeof(MatchedTrace));
+}
+
+/**
+ * Output arrays of a trace being assembled.
+ */
+typedef struct {
+  MatchedTrace *trace;
+  int edge_capacity;
+  int geometry_capacity;
+} TraceBuilder;
+
+static error_code_t append_edge(TraceBuilder *builder, edge_index_t edge, error_info_t *err_info) {
+  MatchedTrace *trace = builder->trace;
+  if (trace->num_edges > 0 && trace->edges[trace->num_edges - 1] == edge) return ERR_SUCCESS;
+
+  if (trace->num_edges == builder->edge_capacity) {
+    int capacity = builder->edge_capacity > 0 ? builder->edge_capacity * 2 : 64;
+    edge_index_t *edges = (edge_index_t *)realloc(trace->edges, (size_t)capacity * sizeof(edge_index_t));
+    if (edges == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for matched edges.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    trace->edges = edges;
+    builder->edge_capacity = capacity;
+  }
+  trace->edges[trace->num_edges++] = edge;
+  return ERR_SUCCESS;
+}
+
+static error_code_t append_geometry(TraceBuilder *builder, double latitude, double longitude, error_info_t *err_info) {
+  MatchedTrace *trace = builder->trace;
+  if (trace->geometry_length == builder->geometry_capacity) {
+    int capacity = builder->geometry_capacity > 0 ? builder->geometry_capacity * 2 : 64;
+    GeoPoint *geometry = (GeoPoint *)realloc(trace->geometry, (size_t)capacity * sizeof(GeoPoint));
+    if (geometry == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for matched geometry.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    trace->geometry = geometry;
+    builder->geometry_capacity = capacity;
+  }
+  trace->geometry[trace->geometry_length].latitude = latitude;
+  trace->geometry[trace->geometry_length].longitude = longitude;
+  trace->geometry_length++;
+  return ERR_SUCCESS;
+}
+
+static double fix_distance_m(const GeoPoint *a, const GeoPoint *b) {
+  return haversine_distance(a->latitude, a->longitude, b->latitude, b->longitude) * 1000.0;
+}
+
+/**
+ * Forward Viterbi pass: lists the candidates of every fix and scores the most
+ * likely sequence ending at each. Fixes without candidates are skipped, and
+ * a fix none of whose candidates can be reached starts a new segment.
+ */
+static error_code_t viterbi_forward(MatchWorkspace *ws, const EdgeGrid *grid, const GeoPoint *points, int num_points, const MatchParams *params, error_info_t *err_info) {
+  int *first = ws->first_candidate;
+  int prev = -1;
+  first[0] = 0;
+  for (int p = 0; p < num_points; p++) {
+    Candidate *candidates = &ws->candidates[first[p]];
+    int count = find_candidates(ws, grid, &points[p], params, candidates);
+    first[p + 1] = first[p] + count;
+    if (count == 0) continue;
+
+    bool connected = false;
+    if (prev >= 0) {
+      const Candidate *prev_candidates = &ws->candidates[first[prev]];
+      int num_prev = first[prev + 1] - first[prev];
+      double great_circle = fix_distance_m(&points[prev], &points[p]);
+      error_code_t err_code = compute_transitions(ws, prev_candidates, num_prev, candidates, count,
+                                                  transition_bound(params, great_circle), err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+
+      // Transition log-likelihood: exponential in the route/great-circle length difference
+      for (int j = 0; j < count; j++) {
+        double best = -INFINITY;
+        int back = -1;
+        for (int i = 0; i < num_prev; i++) {
+          double route = ws->route_m[i * count + j];
+          if (isinf(route)) continue;
+          double score = prev_candidates[i].score - fabs(route - great_circle) / params->beta_m;
+          if (score > best) {
+            best = score;
+            back = first[prev] + i;
+          }
+        }
+        candidates[j].score = best + candidates[j].emission;
+        candidates[j].back = back;
+        if (back >= 0) connected = true;
+      }
+    }
+
+    if (!connected) {
+      for (int j = 0; j < count; j++) {
+        candidates[j].score = candidates[j].emission;
+        candidates[j].back = -1;
+      }
+    }
+    prev = p;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Backtracks from the best candidate of the last matched fix; at a segment
+ * start, the best candidate of the previous matched fix ends the segment
+ * before it.
+ */
+static void viterbi_backtrack(MatchWorkspace *ws, int num_points) {
+  const int *first = ws->first_candidate;
+  int current = -1;
+  for (int p = num_points - 1; p >= 0; p--) {
+    ws->chosen[p] = -1;
+    if (first[p] == first[p + 1]) continue;
+
+    if (current < 0) {
+      current = first[p];
+      for (int c = first[p] + 1; c < first[p + 1]; c++) {
+        if (ws->candidates[c].score > ws->candidates[current].score) current = c;
+      }
+    }
+    ws->chosen[p] = current;
+    current = ws->candidates[current].back;
+  }
+}
+
+/**
+ * Joins the decoded positions with the routes between them into the matched
+ * points, edges and geometry of the trace.
+ */
+static error_code_t assemble_trace(MatchWorkspace *ws, const GeoPoint *points, int num_points, const MatchParams *params, MatchedTrace *trace, error_info_t *err_info) {
+  const Graph *graph = ws->graph;
+  trace->points = (MatchedPoint *)alloc_array(num_points, sizeof(MatchedPoint));
+  CHECK_ALLOCATION(trace->points, err_info);
+  trace->num_points = num_points;
+
+  TraceBuilder builder = { trace, 0, 0 };
+  int prev = -1;
+  for (int p = 0; p < num_points; p++) {
+    MatchedPoint *matched = &trace->points[p];
+    if (ws->chosen[p] < 0) {
+      matched->edge = -1;
+      matched->offset = 0.0;
+      matched->position = points[p];
+      matched->distance_m = 0.0;
+      matched->geometry_index = -1;
+      matched->starts_segment = false;
+      trace->num_unmatched++;
+      continue;
+    }
+
+    const Candidate *candidate = &ws->candidates[ws->chosen[p]];
+    matched->starts_segment = candidate->back < 0;
+    error_code_t err_code;
+    if (matched->starts_segment) {
+      trace->num_segments++;
+    } else {
+      const Candidate *from = &ws->candidates[ws->chosen[prev]];
+      uint32_t bound = transition_bound(params, fix_distance_m(&points[prev], &points[p]));
+      err_code = trace_route(ws, from, candidate, bound, err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+      for (int k = 0; k <= ws->path_length; k++) {
+        int node = ws->path_nodes[k];
+        err_code = append_geometry(&builder, coord_to_degrees(graph->node_lat[node]), coord_to_degrees(graph->node_lon[node]), err_info);
+        if (err_code == ERR_SUCCESS && k < ws->path_length) err_code = append_edge(&builder, ws->path_edges[k], err_info);
+        if (err_code != ERR_SUCCESS) return err_code;
+      }
+    }
+
+    err_code = append_edge(&builder, candidate->edge, err_info);
+    if (err_code == ERR_SUCCESS) {
+      err_code = append_geometry(&builder, candidate->position.latitude, candidate->position.longitude, err_info);
+    }
+    if (err_code != ERR_SUCCESS) return err_code;
+
+    matched->edge = candidate->edge;
+    matched->offset = candidate->offset;
+    matched->position = candidate->position;
+    matched->distance_m = candidate->distance_m;
+    matched->geometry_index = trace->geometry_length - 1;
+    prev = p;
+  }
+  return ERR_SUCCESS;
+}
+
+error_code_t match_trace(Graph *graph, const EdgeGrid *grid, MatchWorkspace *workspace, const GeoPoint *points, int num_points, const MatchParams *params, MatchedTrace *trace, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(grid, err_info);
+  CHECK_NULL(workspace, err_info);
+  CHECK_NULL(points, err_info);
+  CHECK_NULL(trace, err_info);
+
+  MatchParams defaults;
+  if (params == NULL) {
+    default_match_params(&defaults);
+    params = &defaults;
+  }
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Map matching needs a graph that is neither pruned nor contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (workspace->graph != graph) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Match workspace was created for another graph.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (num_points <= 0 || num_points > INT_MAX / MATCH_MAX_CANDIDATES) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Number of trace points out of range.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (params->max_candidates < 1 || params->max_candidates > MATCH_MAX_CANDIDATES ||
+      !(params->search_radius_m > 0.0) || !(params->sigma_m > 0.0) || !(params->beta_m > 0.0) ||
+      !(params->max_route_factor >= 1.0)) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid map matching parameters.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  memset(trace, 0, sizeof(MatchedTrace));
+  error_code_t err_code = reserve_trace_state(workspace, num_points, params->max_candidates, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  workspace->search.settled_count = 0;
+
+  // Road filters and traffic batches replace these streams between traces
+  int ticket = traffic_read_begin(graph);
+  workspace->arcs = dijkstra_mode_arcs(graph, DIJKSTRA_SHORTEST_DISTANCE);
+  workspace->avoided_arcs = road_filter_arcs(graph);
+
+  err_code = viterbi_forward(workspace, grid, points, num_points, params, err_info);
+  if (err_code == ERR_SUCCESS) {
+    viterbi_backtrack(workspace, num_points);
+    err_code = assemble_trace(workspace, points, num_points, params, trace, err_info);
+    if (err_code != ERR_SUCCESS) free_matched_trace(trace);
+  }
+  traffic_read_end(graph, ticket);
+  if (err_code != ERR_SUCCESS) return err_code;
+  trace->settled_count = workspace->search.settled_count;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Batches
+// ================
+
+/**
+ * Work shared by the threads of a batch: traces are handed out in order
+ * under the lock.
+ */
+typedef struct {
+  Graph *graph;
+  const EdgeGrid *grid;
+  MatchJob *jobs;
+  int num_jobs;
+  const MatchParams *params;
+  int next_job;
+  pthread_mutex_t lock;
+} MatchBatch;
+
+/**
+ * A thread of a batch and the workspace it reuses for every trace.
+ */
+typedef struct {
+  MatchBatch *batch;
+  MatchWorkspace *workspace;
+} MatchWorker;
+
+static void *match_worker(void *arg) {
+  MatchWorker *worker = (MatchWorker *)arg;
+  MatchBatch *batch = worker->batch;
+  while (true) {
+    pthread_mutex_lock(&batch->lock);
+    int j = batch->next_job++;
+    pthread_mutex_unlock(&batch->lock);
+    if (j >= batch->num_jobs) break;
+
+    MatchJob *job = &batch->jobs[j];
+    job->err_code = match_trace(batch->graph, batch->grid, worker->workspace, job->points, job->num_points,
+                                batch->params, &job->trace, &job->err_info);
+  }
+  return NULL;
+}
+
+error_code_t match_trace_batch(Graph *graph, const EdgeGrid *grid, MatchJob *jobs, int num_jobs, const MatchParams *params, int num_threads, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(grid, err_info);
+  CHECK_NULL(jobs, err_info);
+
+  if (num_jobs <= 0 || num_threads < 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "A trace batch needs at least one job and a non-negative thread count.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (num_threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = online > 0 ? (int)online : 1;
+  }
+  if (num_threads > num_jobs) num_threads = num_jobs;
+
+  MatchWorker *workers = (MatchWorker *)calloc(num_threads, sizeof(MatchWorker));
+  CHECK_ALLOCATION(workers, err_info);
+
+  MatchBatch batch;
+  batch.graph = graph;
+  batch.grid = grid;
+  batch.jobs = jobs;
+  batch.num_jobs = num_jobs;
+  batch.params = params;
+  batch.next_job = 0;
+  error_code_t err_code = ERR_SUCCESS;
+  for (int t = 0; t < num_threads && err_code == ERR_SUCCESS; t++) {
+    workers[t].batch = &batch;
+    err_code = create_match_workspace(graph, &workers[t].workspace, err_info);
+  }
+  if (err_code == ERR_SUCCESS && pthread_mutex_init(&batch.lock, NULL) != 0) {
+    SET_ERROR(err_info, ERR_OPERATION_FAILED, "Failed to initialize trace batch lock.");
+    err_code = ERR_OPERATION_FAILED;
+  }
+  if (err_code != ERR_SUCCESS) {
+    for (int t = 0; t < num_threads; t++) {
+      free_match_workspace(workers[t].workspace);
+    }
+    free(workers);
+    return err_code;
+  }
+
+  // The calling thread works too; threads that fail to start leave their share to the others
+  pthread_t *threads = (pthread_t *)alloc_array(num_threads, sizeof(pthread_t));
+  int num_started = 0;
+  for (int t = 1; t < num_threads && threads != NULL; t++) {
+    if (pthread_create(&threads[num_started], NULL, match_worker, &workers[t]) == 0) num_started++;
+  }
+  match_worker(&workers[0]);
+  for (int t = 0; t < num_started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  for (int t = 0; t < num_threads; t++) {
+    free_match_workspace(workers[t].workspace);
+  }
+  free(threads);
+  free(workers);
+  pthread_mutex_destroy(&batch.lock);
+  return ERR_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "min_heap.h"
+
+error_code_t create_heap(MinHeap **heap, int capacity, error_info_t *err_info) {
+  // Null check for err_info is already done in the caller function
+  CHECK_NULL(heap, err_info);
+
+  if (capacity <= 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Heap capacity must be positive.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  *heap = (MinHeap *)malloc(sizeof(MinHeap));
+  CHECK_ALLOCATION(*heap, err_info);
+
+  (*heap)->nodes = (HeapNode *)malloc((size_t)capacity * sizeof(HeapNode));
+  if ((*heap)->nodes == NULL) {
+    free(*heap);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for heap nodes.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  (*heap)->size = 0;
+  (*heap)->capacity = capacity;
+
+  return ERR_SUCCESS;
+}
+
+void free_heap(MinHeap *heap) {
+  if (heap == NULL) return;
+  free(heap->nodes);
+  free(heap);
+}
+
+/**
+ * Swaps two heap nodes.
+ * 
+ * @param a Pointer to first heap node
+ * @param b Pointer to second heap node
+ * 
+ * @pre a and b must be non-NULL
+ * @post Contents of a and b are swapped
+ */
+static void swap_heap_nodes(HeapNode *a, HeapNode *b) {
+  HeapNode tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+bool is_heap_empty(MinHeap *heap) {
+  return (heap->size == 0);
+}
+
+void clear_heap(MinHeap *heap) {
+  heap->size = 0;
+}
+
+/**
+ * Maintains the min-heap property by bubbling down from given index.
+ * 
+ * @param heap Pointer to MinHeap structure
+ * @param idx Index to start heapify from
+ * 
+ * @pre heap must be non-NULL and valid
+ * @pre idx must be within valid range
+ * @post Min-heap property is maintained
+ */
+static void min_heapify(MinHeap *heap, int idx) {
+  int smallest = idx;
+  int left = 2 * idx + 1;
+  int right = 2 * idx + 2;
+
+  if (left < heap->size && heap->nodes[left].distance < heap->nodes[smallest].distance) {
+    smallest = left;
+  }
+  if (right < heap->size && heap->nodes[right].distance < heap->nodes[smallest].distance) {
+    smallest = right;
+  }
+  
+  if (smallest != idx) {
+    swap_heap_nodes(&heap->nodes[idx], &heap->nodes[smallest]);
+    min_heapify(heap, smallest);
+  }
+}
+
+error_code_t insert_heap(MinHeap *heap, int node_index, uint32_t distance, error_info_t *err_info) {
+  // Null check for err_info is already done in the caller function
+  CHECK_NULL(heap, err_info);
+
+  if (heap->size >= heap->capacity) {
+    // Grow the heap: with lazy deletion a node can be queued more than once,
+    // and arc-keyed searches queue more entries than there are nodes
+    if (heap->capacity == INT_MAX) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Heap is full, cannot insert new node.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    size_t capacity = 2 * (size_t)heap->capacity;
+    if (capacity > INT_MAX) capacity = INT_MAX;
+    if (capacity > SIZE_MAX / sizeof(HeapNode)) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Heap is full, cannot insert new node.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    HeapNode *nodes = (HeapNode *)realloc(heap->nodes, capacity * sizeof(HeapNode));
+    if (nodes == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Heap is full, cannot insert new node.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    heap->nodes = nodes;
+    heap->capacity = (int)capacity;
+  }
+
+  int i = heap->size++;
+  heap->nodes[i].node_index = node_index;
+  heap->nodes[i].distance = distance;
+
+  while (i != 0 && heap->nodes[(i - 1) / 2].distance > heap->nodes[i].distance) {
+    swap_heap_nodes(&heap->nodes[i], &heap->nodes[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+
+  return ERR_SUCCESS;
+}
+
+error_code_t extract_min(MinHeap *heap, HeapNode *min_node, error_info_t *err_info) {
+  // Null check for err_info is already done in the caller function
+  CHECK_NULL(heap, err_info);
+  CHECK_NULL(min_node, err_info);
+
+  if (is_heap_empty(heap)) {
+    min_node->node_index = -1;
+    min_node->distance = UINT32_MAX;
+    return ERR_SUCCESS;
+  }
+
+  if (heap->size == 1) {
+    *min_node = heap->nodes[0];
+    heap->size--;
+    return ERR_SUCCESS;
+  }
+
+  *min_node = heap->nodes[0];
+  heap->nodes[0] = heap->nodes[heap->size - 1];
+  heap->size--;
+  
+  min_heapify(heap, 0);
+  return ERR_SUCCESS;
+}
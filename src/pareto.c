@@ -0,0 +1,395 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pareto.h"
+#include "min_heap.h"
+#include "dijkstra.h"
+#include "components.h"
+#include "roadclass.h"
+#include "traffic.h"
+
+// ================
+// Label arena
+// ================
+
+/**
+ * A partial route: its two costs, the node it ends at and the label it
+ * extends. Labels are addressed by arena index, which the heap queues.
+ */
+typedef struct {
+  uint32_t distance;        // Meters from the source
+  uint32_t time;            // Milliseconds from the source
+  int node;                 // Node the partial route ends at
+  int parent;               // Label of the route one arc shorter, -1 at the source
+} ParetoLabel;
+
+/**
+ * Every label of one search, freed together. Indices stay valid when the
+ * arena grows.
+ */
+typedef struct {
+  ParetoLabel *labels;
+  int count;
+  int capacity;
+} LabelArena;
+
+/**
+ * Appends a label to the arena, doubling it when full.
+ *
+ * @return Index of the new label, -1 if the arena cannot grow
+ */
+static int push_label(LabelArena *arena, uint32_t distance, uint32_t time, int node, int parent) {
+  if (arena->count == arena->capacity) {
+    int capacity = arena->capacity > 0 ? 2 * arena->capacity : 1024;
+    ParetoLabel *labels = (ParetoLabel *)realloc(arena->labels, (size_t)capacity * sizeof(ParetoLabel));
+    if (labels == NULL) return -1;
+    arena->labels = labels;
+    arena->capacity = capacity;
+  }
+
+  ParetoLabel *label = &arena->labels[arena->count];
+  label->distance = distance;
+  label->time = time;
+  label->node = node;
+  label->parent = parent;
+  return arena->count++;
+}
+
+// ================
+// Search workspace
+// ================
+
+typedef struct {
+  Graph *graph;
+  const ReverseIndex *reverse;
+  const Arc *distance_arcs;
+  const Arc *time_arcs;
+  const uint64_t *avoided_arcs;
+  int source_index;
+  int target_index;
+  double epsilon;
+  uint32_t *remaining_distance; // Exact distance to the target
+  uint32_t *remaining_time;     // Exact travel time to the target
+  uint32_t *best_time;      // Smallest time settled at each node
+  LabelArena arena;
+  MinHeap *heap;
+  int *front;               // Target labels on the front, by increasing distance
+  int num_front;
+  int settled_count;
+} ParetoWorkspace;
+
+static void free_workspace(ParetoWorkspace *ws) {
+  free(ws->remaining_distance);
+  free(ws->remaining_time);
+  free(ws->best_time);
+  free(ws->arena.labels);
+  free(ws->front);
+  free_heap(ws->heap);
+}
+
+static error_code_t init_workspace(ParetoWorkspace *ws, Graph *graph, int source_index, int target_index, double epsilon, error_info_t *err_info) {
+  int num_nodes = graph->num_nodes;
+  memset(ws, 0, sizeof(ParetoWorkspace));
+  ws->graph = graph;
+  ws->distance_arcs = dijkstra_mode_arcs(graph, DIJKSTRA_SHORTEST_DISTANCE);
+  ws->time_arcs = dijkstra_mode_arcs(graph, DIJKSTRA_FASTEST_TIME);
+  ws->avoided_arcs = road_filter_arcs(graph);
+  ws->source_index = source_index;
+  ws->target_index = target_index;
+  ws->epsilon = epsilon;
+
+  error_code_t err_code = get_reverse_index(graph, &ws->reverse, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  ws->remaining_distance = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  ws->remaining_time = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  ws->best_time = (uint32_t *)alloc_array(num_nodes, sizeof(uint32_t));
+  if (ws->remaining_distance == NULL || ws->remaining_time == NULL || ws->best_time == NULL) {
+    free_workspace(ws);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for Pareto search workspace.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  err_code = create_heap(&ws->heap, num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    ws->heap = NULL;
+    free_workspace(ws);
+    return err_code;
+  }
+
+  for (int i = 0; i < num_nodes; i++) {
+    ws->remaining_distance[i] = WEIGHT_INFINITY;
+    ws->remaining_time[i] = WEIGHT_INFINITY;
+    ws->best_time[i] = WEIGHT_INFINITY;
+  }
+  return ERR_SUCCESS;
+}
+
+// ================
+// Bound searches
+// ================
+
+/**
+ * Computes the exact cost from every node to the target in one metric with
+ * a backward search over the incoming arcs.
+ */
+static error_code_t search_remaining(ParetoWorkspace *ws, const Arc *arcs, uint32_t *remaining, error_info_t *err_info) {
+  const ReverseIndex *reverse = ws->reverse;
+  MinHeap *heap = ws->heap;
+
+  clear_heap(heap);
+  remaining[ws->target_index] = 0;
+  error_code_t err_code = insert_heap(heap, ws->target_index, 0, err_info);
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    int v = min_node.node_index;
+    if (min_node.distance > remaining[v]) continue;
+    ws->settled_count++;
+
+    for (edge_index_t j = reverse->in_offsets[v]; j < reverse->in_offsets[v + 1]; j++) {
+      edge_index_t arc = reverse->in_arcs[j];
+      if (ws->avoided_arcs != NULL && is_arc_avoided(ws->avoided_arcs, arc)) continue;
+      int u = reverse->arc_tail[arc];
+      uint64_t new_cost = (uint64_t)min_node.distance + arcs[arc].weight;
+      if (new_cost < remaining[u]) {
+        remaining[u] = (uint32_t)new_cost;
+        err_code = insert_heap(heap, u, (uint32_t)new_cost, err_info);
+        if (err_code != ERR_SUCCESS) break;
+      }
+    }
+  }
+  return err_code;
+}
+
+// ================
+// Label-setting search
+// ================
+
+/**
+ * Tells whether a label with the given time at a node is dominated: a label
+ * settled there earlier is no longer and no slower, or the fastest target
+ * label found so far, which is no longer than any completion, is at most
+ * (1 + epsilon) times slower than the fastest possible completion.
+ */
+static inline bool is_dominated(const ParetoWorkspace *ws, int node, uint64_t time) {
+  if (ws->best_time[node] <= time) return true;
+  uint32_t target_time = ws->best_time[ws->target_index];
+  return target_time != WEIGHT_INFINITY &&
+         (double)target_time <= (1.0 + ws->epsilon) * (double)(time + ws->remaining_time[node]);
+}
+
+/**
+ * Records a settled target label on the front. A label as long as the last
+ * front route is faster (or it would be dominated), so it replaces that route.
+ */
+static error_code_t add_front_label(ParetoWorkspace *ws, int label, error_info_t *err_info) {
+  const ParetoLabel *labels = ws->arena.labels;
+  if (ws->num_front > 0 && labels[ws->front[ws->num_front - 1]].distance == labels[label].distance) {
+    ws->front[ws->num_front - 1] = label;
+    return ERR_SUCCESS;
+  }
+
+  int *front = (int *)realloc(ws->front, (size_t)(ws->num_front + 1) * sizeof(int));
+  CHECK_ALLOCATION(front, err_info);
+  ws->front = front;
+  ws->front[ws->num_front++] = label;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Settles labels by distance plus remaining distance until no label can
+ * reach the target undominated or the label budget runs out.
+ */
+static error_code_t search_front(ParetoWorkspace *ws, int max_labels, bool *truncated, error_info_t *err_info) {
+  const edge_index_t *adj_offsets = ws->graph->adj_offsets;
+  const Arc *distance_arcs = ws->distance_arcs;
+  const Arc *time_arcs = ws->time_arcs;
+  const uint32_t *remaining_distance = ws->remaining_distance;
+  LabelArena *arena = &ws->arena;
+  MinHeap *heap = ws->heap;
+
+  // Once a target label is this fast, every other label is dominated
+  double fastest_time = (1.0 + ws->epsilon) * (double)ws->remaining_time[ws->source_index];
+
+  clear_heap(heap);
+  int source_label = push_label(arena, 0, 0, ws->source_index, -1);
+  if (source_label < 0) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for Pareto labels.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  error_code_t err_code = insert_heap(heap, source_label, remaining_distance[ws->source_index], err_info);
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    int label = min_node.node_index;
+    ParetoLabel current = arena->labels[label];
+    int v = current.node;
+    if (is_dominated(ws, v, current.time)) continue;
+    ws->best_time[v] = current.time;
+    ws->settled_count++;
+
+    if (v == ws->target_index) {
+      err_code = add_front_label(ws, label, err_info);
+      if ((double)current.time <= fastest_time) break;
+      continue;
+    }
+
+    for (edge_index_t i = adj_offsets[v]; i < adj_offsets[v + 1]; i++) {
+      if (ws->avoided_arcs != NULL && is_arc_avoided(ws->avoided_arcs, i)) continue;
+      int w = distance_arcs[i].target;
+      if (remaining_distance[w] == WEIGHT_INFINITY) continue;
+
+      // Closed roads weigh WEIGHT_INFINITY, so their sums never fit
+      uint64_t new_distance = (uint64_t)current.distance + distance_arcs[i].weight;
+      uint64_t new_time = (uint64_t)current.time + time_arcs[i].weight;
+      uint64_t key = new_distance + remaining_distance[w];
+      if (key >= WEIGHT_INFINITY || new_time >= WEIGHT_INFINITY) continue;
+      if (is_dominated(ws, w, new_time)) continue;
+
+      if (arena->count >= max_labels) {
+        *truncated = true;
+        return err_code;
+      }
+      int next = push_label(arena, (uint32_t)new_distance, (uint32_t)new_time, w, label);
+      if (next < 0) {
+        SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for Pareto labels.");
+        return ERR_MEMORY_ALLOCATION;
+      }
+      err_code = insert_heap(heap, next, (uint32_t)key, err_info);
+      if (err_code != ERR_SUCCESS) break;
+    }
+  }
+  return err_code;
+}
+
+// ================
+// Route output
+// ================
+
+/**
+ * Unwinds a target label into a route.
+ */
+static error_code_t build_pareto_route(const LabelArena *arena, int label, ParetoRoute *route, error_info_t *err_info) {
+  int length = 0;
+  for (int l = label; l >= 0; l = arena->labels[l].parent) length++;
+
+  route->nodes = (int *)alloc_array(length, sizeof(int));
+  route->distances = (uint32_t *)alloc_array(length, sizeof(uint32_t));
+  route->times = (uint32_t *)alloc_array(length, sizeof(uint32_t));
+  if (route->nodes == NULL || route->distances == NULL || route->times == NULL) {
+    free(route->nodes);
+    free(route->distances);
+    free(route->times);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for route.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  int position = length;
+  for (int l = label; l >= 0; l = arena->labels[l].parent) {
+    position--;
+    route->nodes[position] = arena->labels[l].node;
+    route->distances[position] = arena->labels[l].distance;
+    route->times[position] = arena->labels[l].time;
+  }
+  route->length = length;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Pareto routing
+// ================
+
+void default_pareto_params(ParetoParams *params) {
+  if (params == NULL) return;
+
+  params->epsilon = 0.0;
+  params->max_labels = PARETO_DEFAULT_MAX_LABELS;
+}
+
+void free_pareto_front(ParetoFront *front) {
+  if (front == NULL) return;
+
+  for (int i = 0; i < front->num_routes; i++) {
+    free(front->routes[i].nodes);
+    free(front->routes[i].distances);
+    free(front->routes[i].times);
+  }
+  free(front->routes);
+  front->routes = NULL;
+  front->num_routes = 0;
+}
+
+error_code_t find_pareto_routes(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, const ParetoParams *params, ParetoFront *front, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(front, err_info);
+
+  if (source_node_id == target_node_id) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Pareto routing needs a graph that is neither pruned nor contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  ParetoParams defaults;
+  if (params == NULL) {
+    default_pareto_params(&defaults);
+    params = &defaults;
+  }
+  if (!(params->epsilon >= 0.0) || params->max_labels <= 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Pareto epsilon cannot be negative and the label budget must be positive.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int source_index, target_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  front->routes = NULL;
+  front->num_routes = 0;
+  front->num_labels = 0;
+  front->settled_count = 0;
+  front->truncated = false;
+  if (!component_may_reach(graph, source_index, target_index)) return ERR_SUCCESS;
+
+  // The distance and time streams come from one batch
+  int ticket = traffic_read_begin(graph);
+  ParetoWorkspace ws;
+  err_code = init_workspace(&ws, graph, source_index, target_index, params->epsilon, err_info);
+  if (err_code != ERR_SUCCESS) {
+    traffic_read_end(graph, ticket);
+    return err_code;
+  }
+
+  err_code = search_remaining(&ws, ws.distance_arcs, ws.remaining_distance, err_info);
+  if (err_code == ERR_SUCCESS) err_code = search_remaining(&ws, ws.time_arcs, ws.remaining_time, err_info);
+  if (err_code == ERR_SUCCESS && ws.remaining_distance[source_index] != WEIGHT_INFINITY) {
+    err_code = search_front(&ws, params->max_labels, &front->truncated, err_info);
+  }
+
+  if (err_code == ERR_SUCCESS && ws.num_front > 0) {
+    front->routes = (ParetoRoute *)alloc_array(ws.num_front, sizeof(ParetoRoute));
+    if (front->routes == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for routes.");
+      err_code = ERR_MEMORY_ALLOCATION;
+    }
+  }
+  for (int i = 0; i < ws.num_front && err_code == ERR_SUCCESS; i++) {
+    err_code = build_pareto_route(&ws.arena, ws.front[i], &front->routes[i], err_info);
+    if (err_code == ERR_SUCCESS) front->num_routes++;
+  }
+
+  front->num_labels = ws.arena.count;
+  front->settled_count = ws.settled_count;
+  free_workspace(&ws);
+  traffic_read_end(graph, ticket);
+  if (err_code != ERR_SUCCESS) free_pareto_front(front);
+  return err_code;
+}
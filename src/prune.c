@@ -0,0 +1,451 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prune.h"
+#include "reorder.h"
+#include "roadclass.h"
+#include "weighting.h"
+
+// ================
+// Tree helpers
+// ================
+
+/**
+ * Returns the depth of a node below its root (0 for core nodes).
+ */
+static inline int tree_depth(const PruneIndex *index, int node_index) {
+  return node_index < index->num_core_nodes ? 0 : index->depth[node_index - index->num_core_nodes];
+}
+
+/**
+ * Returns the tree parent of a pruned node.
+ */
+static inline int tree_parent(const PruneIndex *index, int node_index) {
+  return index->parent[node_index - index->num_core_nodes];
+}
+
+/**
+ * Adds a link cost to a running tree path cost, saturating below WEIGHT_INFINITY.
+ */
+static inline uint32_t add_link_cost(uint32_t cost, uint32_t link) {
+  uint64_t sum = (uint64_t)cost + link;
+  return sum >= WEIGHT_INFINITY ? WEIGHT_INFINITY - 1 : (uint32_t)sum;
+}
+
+/**
+ * Walks two nodes of the same tree up to their lowest common ancestor,
+ * summing link costs upwards from from_index and downwards to to_index.
+ *
+ * @return The common ancestor, or -1 if a link cannot be travelled in the needed direction
+ */
+static int tree_path(const PruneIndex *index, WeightMetric metric, int from_index, int to_index, uint32_t *up_cost, uint32_t *down_cost) {
+  int num_core = index->num_core_nodes;
+  int a = from_index;
+  int b = to_index;
+  *up_cost = 0;
+  *down_cost = 0;
+
+  while (a != b) {
+    if (tree_depth(index, a) >= tree_depth(index, b) && a >= num_core) {
+      uint32_t link = index->link_up[metric][a - num_core];
+      if (link == WEIGHT_INFINITY) return -1;
+      *up_cost = add_link_cost(*up_cost, link);
+      a = tree_parent(index, a);
+    } else if (b >= num_core) {
+      uint32_t link = index->link_down[metric][b - num_core];
+      if (link == WEIGHT_INFINITY) return -1;
+      *down_cost = add_link_cost(*down_cost, link);
+      b = tree_parent(index, b);
+    } else {
+      return -1; // Two different core nodes
+    }
+  }
+  return a;
+}
+
+// ================
+// Pruning
+// ================
+
+/**
+ * Allocates an empty prune index for num_pruned pruned nodes.
+ */
+static PruneIndex *create_prune_index(int num_core, int num_pruned) {
+  PruneIndex *index = (PruneIndex *)calloc(1, sizeof(PruneIndex));
+  if (index == NULL) return NULL;
+
+  size_t count = num_pruned > 0 ? (size_t)num_pruned : 1;
+  index->num_core_nodes = num_core;
+  index->num_pruned_nodes = num_pruned;
+  index->parent = (int *)alloc_array(count, sizeof(int));
+  index->root = (int *)alloc_array(count, sizeof(int));
+  index->depth = (int *)alloc_array(count, sizeof(int));
+  bool ok = index->parent != NULL && index->root != NULL && index->depth != NULL;
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    index->link_up[m] = (uint32_t *)alloc_array(count, sizeof(uint32_t));
+    index->link_down[m] = (uint32_t *)alloc_array(count, sizeof(uint32_t));
+    ok = ok && index->link_up[m] != NULL && index->link_down[m] != NULL;
+  }
+  if (!ok) {
+    free_prune_index(index);
+    return NULL;
+  }
+  return index;
+}
+
+void free_prune_index(PruneIndex *pruned) {
+  if (pruned == NULL) return;
+
+  free(pruned->parent);
+  free(pruned->root);
+  free(pruned->depth);
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    free(pruned->link_up[m]);
+    free(pruned->link_down[m]);
+  }
+  free(pruned);
+}
+
+/**
+ * Peels nodes with at most one distinct neighbour until none is left, ignoring
+ * edge direction and self-loops. A node left without neighbours when its turn
+ * comes stays in the core as the root of a tree-shaped fragment.
+ *
+ * @param parent Output: neighbour towards the core of every peeled node
+ * @param peel_order Output: peeled nodes in peel order (children before parents)
+ * @return Number of peeled nodes, or -1 on allocation failure
+ */
+static int peel_dead_ends(const Graph *graph, int *parent, int *peel_order) {
+  int num_nodes = graph->num_nodes;
+  edge_index_t *offsets = (edge_index_t *)calloc((size_t)num_nodes + 1, sizeof(edge_index_t));
+  int *degree = (int *)calloc(num_nodes, sizeof(int));
+  int *stamp = (int *)malloc(num_nodes * sizeof(int));
+  int *queue = (int *)malloc(num_nodes * sizeof(int));
+  uint8_t *peeled = (uint8_t *)calloc(num_nodes, sizeof(uint8_t));
+  if (offsets == NULL || degree == NULL || stamp == NULL || queue == NULL || peeled == NULL) {
+    free(offsets);
+    free(degree);
+    free(stamp);
+    free(queue);
+    free(peeled);
+    return -1;
+  }
+
+  // Undirected neighbour lists, self-loops left out
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    if (graph->edge_from[e] == graph->edge_to[e]) continue;
+    offsets[graph->edge_from[e] + 1]++;
+    offsets[graph->edge_to[e] + 1]++;
+  }
+  for (int v = 0; v < num_nodes; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  int *neighbors = (int *)alloc_array(offsets[num_nodes] > 0 ? (size_t)offsets[num_nodes] : 1, sizeof(int));
+  edge_index_t *fill = (edge_index_t *)alloc_array((size_t)num_nodes, sizeof(edge_index_t));
+  if (neighbors == NULL || fill == NULL) {
+    free(neighbors);
+    free(fill);
+    free(offsets);
+    free(degree);
+    free(stamp);
+    free(queue);
+    free(peeled);
+    return -1;
+  }
+  memcpy(fill, offsets, num_nodes * sizeof(edge_index_t));
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    int a = graph->edge_from[e];
+    int b = graph->edge_to[e];
+    if (a == b) continue;
+    neighbors[fill[a]++] = b;
+    neighbors[fill[b]++] = a;
+  }
+  free(fill);
+
+  // Parallel edges count as one neighbour
+  for (int v = 0; v < num_nodes; v++) {
+    stamp[v] = -1;
+  }
+  int queue_head = 0;
+  int queue_tail = 0;
+  for (int v = 0; v < num_nodes; v++) {
+    for (edge_index_t i = offsets[v]; i < offsets[v + 1]; i++) {
+      if (stamp[neighbors[i]] != v) {
+        stamp[neighbors[i]] = v;
+        degree[v]++;
+      }
+    }
+    if (degree[v] <= 1) queue[queue_tail++] = v;
+  }
+  free(stamp);
+
+  // Every node is queued at most once: initially, or when its degree drops to one
+  int num_peeled = 0;
+  while (queue_head < queue_tail) {
+    int v = queue[queue_head++];
+    if (degree[v] == 0) continue;
+
+    int p = -1;
+    for (edge_index_t i = offsets[v]; i < offsets[v + 1] && p < 0; i++) {
+      if (!peeled[neighbors[i]]) p = neighbors[i];
+    }
+    peeled[v] = 1;
+    degree[v] = 0;
+    parent[v] = p;
+    peel_order[num_peeled++] = v;
+    if (--degree[p] == 1) queue[queue_tail++] = p;
+  }
+
+  free(neighbors);
+  free(offsets);
+  free(degree);
+  free(queue);
+  free(peeled);
+  return num_peeled;
+}
+
+/**
+ * Fills parents, roots, depths and link costs of a renumbered graph whose
+ * pruned nodes follow the core with parents before children.
+ */
+static void build_prune_index(const Graph *graph, PruneIndex *index, const int *old_parent, const int *new_to_old, const int *old_to_new) {
+  int num_core = index->num_core_nodes;
+
+  for (int k = 0; k < index->num_pruned_nodes; k++) {
+    int p = old_to_new[old_parent[new_to_old[num_core + k]]];
+    index->parent[k] = p;
+    index->root[k] = p < num_core ? p : index->root[p - num_core];
+    index->depth[k] = p < num_core ? 1 : index->depth[p - num_core] + 1;
+    for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+      index->link_up[m][k] = WEIGHT_INFINITY;
+      index->link_down[m][k] = WEIGHT_INFINITY;
+    }
+  }
+
+  // Every edge touching a pruned node links it to its parent or to a child
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    int from_index = graph->edge_from[e];
+    int to_index = graph->edge_to[e];
+    if (from_index == to_index) continue;
+
+    int child = (from_index >= num_core && tree_parent(index, from_index) == to_index) ? from_index : to_index;
+    if (child < num_core) continue;
+    bool child_first = child == from_index;
+    bool both_ways = !graph->edge_one_way[e];
+
+    for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+      uint32_t weight = compute_edge_weight(graph, e, (WeightMetric)m);
+      uint32_t *up = &index->link_up[m][child - num_core];
+      uint32_t *down = &index->link_down[m][child - num_core];
+      if ((child_first || both_ways) && weight < *up) *up = weight;
+      if ((!child_first || both_ways) && weight < *down) *down = weight;
+    }
+  }
+}
+
+error_code_t prune_dead_end_trees(Graph *graph, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+
+  if (graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Graph is already pruned.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->chains != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Prune the graph before contracting it.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->filter != NULL && graph->filter->avoided_classes != 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Prune the graph before avoiding road classes.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->weightings != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Weighting profiles need a graph that is not pruned.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int num_nodes = graph->num_nodes;
+  int *parent = (int *)malloc(num_nodes * sizeof(int));
+  int *peel_order = (int *)malloc(num_nodes * sizeof(int));
+  int *new_to_old = (int *)malloc(num_nodes * sizeof(int));
+  int *old_to_new = (int *)malloc(num_nodes * sizeof(int));
+  if (parent == NULL || peel_order == NULL || new_to_old == NULL || old_to_new == NULL) {
+    free(parent);
+    free(peel_order);
+    free(new_to_old);
+    free(old_to_new);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for dead-end pruning.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  for (int v = 0; v < num_nodes; v++) {
+    parent[v] = -1;
+  }
+  int num_pruned = peel_dead_ends(graph, parent, peel_order);
+  int num_core = num_nodes - num_pruned;
+  PruneIndex *index = num_pruned >= 0 ? create_prune_index(num_core, num_pruned) : NULL;
+  if (index == NULL) {
+    free(parent);
+    free(peel_order);
+    free(new_to_old);
+    free(old_to_new);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for dead-end trees.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Core nodes keep their relative order, trees follow parents first
+  int next = 0;
+  for (int v = 0; v < num_nodes; v++) {
+    if (parent[v] < 0) new_to_old[next++] = v;
+  }
+  for (int k = num_pruned - 1; k >= 0; k--) {
+    new_to_old[next++] = peel_order[k];
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    old_to_new[new_to_old[i]] = i;
+  }
+  free(peel_order);
+
+  error_code_t err_code = apply_node_permutation(graph, new_to_old, err_info);
+  if (err_code == ERR_SUCCESS) {
+    build_prune_index(graph, index, parent, new_to_old, old_to_new);
+    graph->pruned = index;
+    err_code = build_csr_representation(graph, err_info);
+    if (err_code != ERR_SUCCESS) graph->pruned = NULL;
+  }
+  free(parent);
+  free(new_to_old);
+  free(old_to_new);
+
+  if (err_code != ERR_SUCCESS) {
+    free_prune_index(index);
+    return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+bool is_pruned_node(const Graph *graph, int node_index) {
+  return graph->pruned != NULL && node_index >= graph->pruned->num_core_nodes;
+}
+
+int prune_tree_root(const Graph *graph, int node_index) {
+  if (!is_pruned_node(graph, node_index)) return node_index;
+  return graph->pruned->root[node_index - graph->pruned->num_core_nodes];
+}
+
+// ================
+// Query support
+// ================
+
+uint32_t prune_tree_path_cost(const Graph *graph, WeightMetric metric, int from_index, int to_index) {
+  if (prune_tree_root(graph, from_index) != prune_tree_root(graph, to_index)) return WEIGHT_INFINITY;
+
+  uint32_t up_cost, down_cost;
+  if (tree_path(graph->pruned, metric, from_index, to_index, &up_cost, &down_cost) < 0) return WEIGHT_INFINITY;
+  return add_link_cost(up_cost, down_cost);
+}
+
+uint32_t prune_seed_source(const Graph *graph, WeightMetric metric, int source_index, DijkstraResult *result) {
+  const PruneIndex *index = graph->pruned;
+  int num_core = index->num_core_nodes;
+  uint32_t cost = 0;
+  int current = source_index;
+
+  result->visited[source_index] = true;
+  result->settled_count += 1;
+
+  // Ancestors are only reachable along the tree and keep their tree cost
+  while (current >= num_core) {
+    uint32_t link = index->link_up[metric][current - num_core];
+    if (link == WEIGHT_INFINITY) return WEIGHT_INFINITY;
+
+    int p = tree_parent(index, current);
+    cost = add_link_cost(cost, link);
+    result->distances[p] = cost;
+    if (result->predecessors != NULL) result->predecessors[p] = current;
+    if (p >= num_core) {
+      result->visited[p] = true;
+      result->settled_count += 1;
+    }
+    current = p;
+  }
+  return cost;
+}
+
+void prune_fill_tree(const Graph *graph, WeightMetric metric, DijkstraResult *result) {
+  const PruneIndex *index = graph->pruned;
+  int num_core = index->num_core_nodes;
+
+  // Parents come before children, so one pass reaches every tree node
+  for (int k = 0; k < index->num_pruned_nodes; k++) {
+    int node_index = num_core + k;
+    int p = index->parent[k];
+    uint32_t link = index->link_down[metric][k];
+    if (result->visited[node_index] || !result->visited[p] || link == WEIGHT_INFINITY) continue;
+
+    result->distances[node_index] = add_link_cost(result->distances[p], link);
+    result->visited[node_index] = true;
+    if (result->predecessors != NULL) result->predecessors[node_index] = p;
+  }
+}
+
+/**
+ * Lists the nodes strictly between two nodes of a tree path whose common
+ * ancestor and end costs are known.
+ */
+static int expand_tree_path(const PruneIndex *index, WeightMetric metric, int from_index, int to_index, int ancestor, uint32_t from_cost, uint32_t to_cost, int *nodes, uint32_t *costs) {
+  int num_core = index->num_core_nodes;
+
+  // Up from from_index to the common ancestor (listed unless it is to_index)
+  int count = 0;
+  uint32_t cost = from_cost;
+  int current = from_index;
+  while (current != ancestor) {
+    cost += index->link_up[metric][current - num_core];
+    current = tree_parent(index, current);
+    if (current == to_index) break;
+    if (nodes != NULL) nodes[count] = current;
+    if (costs != NULL) costs[count] = cost;
+    count++;
+  }
+
+  // Down to to_index, filled backwards while walking up from it
+  if (to_index != ancestor) {
+    int num_down = tree_depth(index, to_index) - tree_depth(index, ancestor) - 1;
+    cost = to_cost;
+    current = to_index;
+    for (int k = num_down - 1; k >= 0; k--) {
+      cost -= index->link_down[metric][current - num_core];
+      current = tree_parent(index, current);
+      if (nodes != NULL) nodes[count + k] = current;
+      if (costs != NULL) costs[count + k] = cost;
+    }
+    count += num_down;
+  }
+  return count;
+}
+
+int prune_expand_step(const Graph *graph, WeightMetric metric, const uint32_t *distances, int from_index, int to_index, int *nodes, uint32_t *costs) {
+  const PruneIndex *index = graph->pruned;
+  if (prune_tree_root(graph, from_index) != prune_tree_root(graph, to_index)) return -1;
+
+  uint32_t up_cost, down_cost;
+  int ancestor = tree_path(index, metric, from_index, to_index, &up_cost, &down_cost);
+  if (ancestor < 0) return -1;
+  uint32_t base_cost = distances[from_index];
+  if ((uint64_t)base_cost + up_cost + down_cost != distances[to_index]) return -1;
+
+  return expand_tree_path(index, metric, from_index, to_index, ancestor, base_cost, distances[to_index], nodes, costs);
+}
+
+int prune_expand_path(const Graph *graph, WeightMetric metric, int from_index, int to_index, uint32_t from_cost, int *nodes, uint32_t *costs) {
+  const PruneIndex *index = graph->pruned;
+  if (prune_tree_root(graph, from_index) != prune_tree_root(graph, to_index)) return -1;
+
+  uint32_t up_cost, down_cost;
+  int ancestor = tree_path(index, metric, from_index, to_index, &up_cost, &down_cost);
+  if (ancestor < 0) return -1;
+  uint32_t to_cost = add_link_cost(add_link_cost(from_cost, up_cost), down_cost);
+
+  return expand_tree_path(index, metric, from_index, to_index, ancestor, from_cost, to_cost, nodes, costs);
+}
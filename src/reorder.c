@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reorder.h"
+#include "components.h"
+#include "prune.h"
+#include "turns.h"
+
+// Hilbert curve resolution: coordinates are quantized to a 2^16 x 2^16 grid
+#define HILBERT_ORDER_BITS 16
+
+/**
+ * Sort key pairing a node index with its position along the curve.
+ */
+typedef struct {
+  uint64_t key;
+  int node_index;
+} OrderKey;
+
+// ================
+// Order parsing
+// ================
+
+error_code_t parse_node_order(const char *name, NodeOrder *order, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(name, err_info);
+  CHECK_NULL(order, err_info);
+
+  if (strcmp(name, "file") == 0 || strcmp(name, "none") == 0) {
+    *order = NODE_ORDER_FILE;
+  } else if (strcmp(name, "hilbert") == 0) {
+    *order = NODE_ORDER_HILBERT;
+  } else if (strcmp(name, "bfs") == 0) {
+    *order = NODE_ORDER_BFS;
+  } else {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Unknown node order (expected file, hilbert or bfs).");
+    return ERR_INVALID_ARGUMENT;
+  }
+  return ERR_SUCCESS;
+}
+
+const char *node_order_name(NodeOrder order) {
+  switch (order) {
+    case NODE_ORDER_HILBERT:
+      return "hilbert";
+    case NODE_ORDER_BFS:
+      return "bfs";
+    case NODE_ORDER_FILE:
+    default:
+      return "file";
+  }
+}
+
+// ================
+// Hilbert order
+// ================
+
+/**
+ * Maps a cell of an n x n grid to its distance along the Hilbert curve.
+ * 
+ * @param n Grid side, a power of two
+ * @param x Column of the cell
+ * @param y Row of the cell
+ * @return Position of the cell along the curve, in [0, n * n)
+ */
+static uint64_t hilbert_index(uint32_t n, uint32_t x, uint32_t y) {
+  uint64_t d = 0;
+  for (uint32_t s = n / 2; s > 0; s /= 2) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += (uint64_t)s * s * ((3 * rx) ^ ry);
+
+    // Rotate the quadrant so the sub-curve is traversed in the right direction
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      uint32_t tmp = x;
+      x = y;
+      y = tmp;
+    }
+  }
+  return d;
+}
+
+static int compare_order_key(const void *a, const void *b) {
+  const OrderKey *ka = (const OrderKey *)a;
+  const OrderKey *kb = (const OrderKey *)b;
+  if (ka->key < kb->key) return -1;
+  if (ka->key > kb->key) return 1;
+  return ka->node_index - kb->node_index;
+}
+
+static error_code_t compute_hilbert_order(Graph *graph, int *new_to_old, error_info_t *err_info) {
+  // Bounding box of all coordinates (fixed-point, no conversion needed)
+  int32_t min_lat = graph->node_lat[0], max_lat = min_lat;
+  int32_t min_lon = graph->node_lon[0], max_lon = min_lon;
+  for (int i = 1; i < graph->num_nodes; i++) {
+    if (graph->node_lat[i] < min_lat) min_lat = graph->node_lat[i];
+    if (graph->node_lat[i] > max_lat) max_lat = graph->node_lat[i];
+    if (graph->node_lon[i] < min_lon) min_lon = graph->node_lon[i];
+    if (graph->node_lon[i] > max_lon) max_lon = graph->node_lon[i];
+  }
+
+  OrderKey *keys = (OrderKey *)malloc(graph->num_nodes * sizeof(OrderKey));
+  CHECK_ALLOCATION(keys, err_info);
+
+  // Quantize coordinates to the curve grid, keeping the aspect ratio
+  uint32_t side = 1u << HILBERT_ORDER_BITS;
+  int64_t lat_span = (int64_t)max_lat - min_lat;
+  int64_t lon_span = (int64_t)max_lon - min_lon;
+  int64_t span = lat_span > lon_span ? lat_span : lon_span;
+  for (int i = 0; i < graph->num_nodes; i++) {
+    uint32_t x = span > 0 ? (uint32_t)(((int64_t)graph->node_lon[i] - min_lon) * (side - 1) / span) : 0;
+    uint32_t y = span > 0 ? (uint32_t)(((int64_t)graph->node_lat[i] - min_lat) * (side - 1) / span) : 0;
+    keys[i].key = hilbert_index(side, x, y);
+    keys[i].node_index = i;
+  }
+
+  qsort(keys, graph->num_nodes, sizeof(OrderKey), compare_order_key);
+  for (int i = 0; i < graph->num_nodes; i++) {
+    new_to_old[i] = keys[i].node_index;
+  }
+
+  free(keys);
+  return ERR_SUCCESS;
+}
+
+// ================
+// BFS order
+// ================
+
+static error_code_t compute_bfs_order(Graph *graph, int *new_to_old, error_info_t *err_info) {
+  bool *seen = (bool *)calloc(graph->num_nodes, sizeof(bool));
+  CHECK_ALLOCATION(seen, err_info);
+
+  // new_to_old doubles as the BFS queue: nodes are appended in visiting order
+  int head = 0;
+  int tail = 0;
+  for (int root = 0; root < graph->num_nodes; root++) {
+    if (seen[root]) continue;
+    seen[root] = true;
+    new_to_old[tail++] = root;
+
+    while (head < tail) {
+      int current = new_to_old[head++];
+      for (edge_index_t i = graph->adj_offsets[current]; i < graph->adj_offsets[current + 1]; i++) {
+        int neighbor = graph->adj_arcs[WEIGHT_DISTANCE][i].target;
+        if (!seen[neighbor]) {
+          seen[neighbor] = true;
+          new_to_old[tail++] = neighbor;
+        }
+      }
+    }
+  }
+
+  free(seen);
+  return ERR_SUCCESS;
+}
+
+// ================
+// Permutation
+// ================
+
+error_code_t compute_node_order(Graph *graph, NodeOrder order, int *new_to_old, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(new_to_old, err_info);
+
+  switch (order) {
+    case NODE_ORDER_HILBERT:
+      return compute_hilbert_order(graph, new_to_old, err_info);
+    case NODE_ORDER_BFS:
+      return compute_bfs_order(graph, new_to_old, err_info);
+    case NODE_ORDER_FILE:
+      for (int i = 0; i < graph->num_nodes; i++) {
+        new_to_old[i] = i;
+      }
+      return ERR_SUCCESS;
+    default:
+      SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid node order.");
+      return ERR_INVALID_ARGUMENT;
+  }
+}
+
+error_code_t apply_node_permutation(Graph *graph, const int *new_to_old, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(new_to_old, err_info);
+
+  // Chain interiors must stay contiguous after contraction
+  if (graph->chains != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Cannot reorder a contracted graph, reorder before contraction.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  // Pruned trees are stored parents first behind the core and may not move
+  if (graph->pruned != NULL) {
+    for (int i = graph->pruned->num_core_nodes; i < graph->num_nodes; i++) {
+      if (new_to_old[i] != i) {
+        SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Cannot move pruned nodes, reorder before pruning.");
+        return ERR_INVALID_ARGUMENT;
+      }
+    }
+  }
+
+  int *old_to_new = (int *)malloc(graph->num_nodes * sizeof(int));
+  CHECK_ALLOCATION(old_to_new, err_info);
+
+  uint32_t *node_ids = (uint32_t *)malloc(graph->num_nodes * sizeof(uint32_t));
+  int32_t *node_lat = (int32_t *)malloc(graph->num_nodes * sizeof(int32_t));
+  int32_t *node_lon = (int32_t *)malloc(graph->num_nodes * sizeof(int32_t));
+  if (node_ids == NULL || node_lat == NULL || node_lon == NULL) {
+    free(node_ids);
+    free(node_lat);
+    free(node_lon);
+    free(old_to_new);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for reordered nodes.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  // Move node data to their new positions
+  for (int i = 0; i < graph->num_nodes; i++) {
+    node_ids[i] = graph->node_ids[new_to_old[i]];
+    node_lat[i] = graph->node_lat[new_to_old[i]];
+    node_lon[i] = graph->node_lon[new_to_old[i]];
+    old_to_new[new_to_old[i]] = i;
+  }
+  free(graph->node_ids);
+  free(graph->node_lat);
+  free(graph->node_lon);
+  graph->node_ids = node_ids;
+  graph->node_lat = node_lat;
+  graph->node_lon = node_lon;
+
+  // Edge endpoints are stored as node indices and follow their nodes
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    graph->edge_from[e] = old_to_new[graph->edge_from[e]];
+    graph->edge_to[e] = old_to_new[graph->edge_to[e]];
+  }
+
+  // Node IDs keep mapping to the same node: only the stored index changes
+  NodeHashTable *node_hash = graph->node_hash;
+  for (int b = 0; b < node_hash->size; b++) {
+    for (NodeHashEntry *entry = node_hash->buckets[b]; entry != NULL; entry = entry->next) {
+      entry->node_index = old_to_new[entry->node_index];
+    }
+  }
+
+  // Components are a per-node property and follow their nodes
+  if (graph->components != NULL) {
+    int *node_component = (int *)malloc(graph->num_nodes * sizeof(int));
+    if (node_component == NULL) {
+      free(old_to_new);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for reordered components.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    for (int i = 0; i < graph->num_nodes; i++) {
+      node_component[i] = graph->components->node_component[new_to_old[i]];
+    }
+    free(graph->components->node_component);
+    graph->components->node_component = node_component;
+  }
+
+  // Turn restrictions are grouped by via node and follow it
+  if (graph->turns != NULL) {
+    error_code_t err_code = permute_turn_index(graph->turns, graph->num_nodes, new_to_old, err_info);
+    if (err_code != ERR_SUCCESS) {
+      free(old_to_new);
+      return err_code;
+    }
+  }
+
+  // Tree links may point at moved core nodes
+  if (graph->pruned != NULL) {
+    for (int k = 0; k < graph->pruned->num_pruned_nodes; k++) {
+      graph->pruned->parent[k] = old_to_new[graph->pruned->parent[k]];
+      graph->pruned->root[k] = old_to_new[graph->pruned->root[k]];
+    }
+  }
+  free(old_to_new);
+
+  // Adjacency lists are rebuilt against the new node indices
+  return build_csr_representation(graph, err_info);
+}
+
+error_code_t reorder_graph_nodes(Graph *graph, NodeOrder order, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+
+  if (order == NODE_ORDER_FILE) return ERR_SUCCESS;
+
+  int *new_to_old = (int *)malloc(graph->num_nodes * sizeof(int));
+  CHECK_ALLOCATION(new_to_old, err_info);
+
+  error_code_t err_code = compute_node_order(graph, order, new_to_old, err_info);
+  if (err_code == ERR_SUCCESS) {
+    err_code = apply_node_permutation(graph, new_to_old, err_info);
+  }
+
+  free(new_to_old);
+  return err_code;
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "roadclass.h"
+#include "contract.h"
+
+// Longest class name accepted by parse_road_classes()
+#define MAX_CLASS_NAME 16
+
+// Class names indexed by HighwayType
+static const char *ROAD_CLASS_NAMES[HIGHWAY_NUM_TYPES] = {
+  "unknown", "motorway", "trunk", "primary", "secondary",
+  "tertiary", "unclassified", "residential", "service"
+};
+
+// ================
+// Class sets
+// ================
+
+error_code_t parse_road_classes(const char *text, uint16_t *classes, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(text, err_info);
+  CHECK_NULL(classes, err_info);
+
+  uint16_t parsed = 0;
+  const char *start = text;
+  for (;;) {
+    const char *end = strchr(start, ',');
+    size_t length = end != NULL ? (size_t)(end - start) : strlen(start);
+    char name[MAX_CLASS_NAME + 1];
+    bool known = length > 0 && length <= MAX_CLASS_NAME;
+    if (known) {
+      memcpy(name, start, length);
+      name[length] = '\0';
+      if (strcmp(name, "major") == 0) {
+        parsed |= ROAD_CLASSES_MAJOR;
+      } else if (strcmp(name, "minor") == 0) {
+        parsed |= ROAD_CLASSES_MINOR;
+      } else {
+        int type = 0;
+        while (type < HIGHWAY_NUM_TYPES && strcmp(name, ROAD_CLASS_NAMES[type]) != 0) type++;
+        known = type < HIGHWAY_NUM_TYPES;
+        if (known) parsed |= ROAD_CLASS_BIT(type);
+      }
+    }
+    if (!known) {
+      SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Unknown road class (expected motorway, trunk, primary, secondary, tertiary, unclassified, residential, service, unknown, major or minor).");
+      return ERR_INVALID_ARGUMENT;
+    }
+    if (end == NULL) break;
+    start = end + 1;
+  }
+
+  *classes = parsed;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Filter bitsets
+// ================
+
+void free_road_filter(RoadFilter *filter) {
+  if (filter == NULL) return;
+
+  for (int c = 0; c < HIGHWAY_NUM_TYPES; c++) {
+    free(filter->class_arcs[c]);
+  }
+  free(filter->avoided_arcs);
+  free(filter);
+}
+
+/**
+ * ORs the bitsets of the avoided classes into the avoided arc set, freeing
+ * the set when no class is avoided.
+ */
+static error_code_t combine_class_arcs(RoadFilter *filter, error_info_t *err_info) {
+  if (filter->avoided_classes == 0) {
+    free(filter->avoided_arcs);
+    filter->avoided_arcs = NULL;
+    filter->num_avoided_arcs = 0;
+    return ERR_SUCCESS;
+  }
+
+  if (filter->avoided_arcs == NULL) {
+    filter->avoided_arcs = (uint64_t *)alloc_array(filter->num_words, sizeof(uint64_t));
+    CHECK_ALLOCATION(filter->avoided_arcs, err_info);
+  }
+
+  uint64_t *avoided = filter->avoided_arcs;
+  memset(avoided, 0, filter->num_words * sizeof(uint64_t));
+  for (int c = 0; c < HIGHWAY_NUM_TYPES; c++) {
+    if (!(filter->avoided_classes & ROAD_CLASS_BIT(c))) continue;
+    const uint64_t *class_arcs = filter->class_arcs[c];
+    for (size_t w = 0; w < filter->num_words; w++) {
+      avoided[w] |= class_arcs[w];
+    }
+  }
+
+  edge_index_t count = 0;
+  for (size_t w = 0; w < filter->num_words; w++) {
+    count += (edge_index_t)__builtin_popcountll(avoided[w]);
+  }
+  filter->num_avoided_arcs = count;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Marks every CSR arc in the bitset of its class. Direct edges take the
+ * class of the edge, chain arcs the class shared by the chain's edges.
+ */
+static error_code_t fill_class_arcs(const Graph *graph, const ChainIndex *chains, RoadFilter *filter, error_info_t *err_info) {
+  edge_index_t num_arcs = graph->adj_offsets[graph->num_nodes];
+  size_t num_words = ((size_t)num_arcs + 63) / 64;
+  if (num_words == 0) num_words = 1;
+
+  for (int c = 0; c < HIGHWAY_NUM_TYPES; c++) {
+    free(filter->class_arcs[c]);
+    filter->class_arcs[c] = (uint64_t *)calloc(num_words, sizeof(uint64_t));
+    CHECK_ALLOCATION(filter->class_arcs[c], err_info);
+  }
+  free(filter->avoided_arcs);
+  filter->avoided_arcs = NULL;
+  filter->num_words = num_words;
+
+  for (edge_index_t i = 0; i < num_arcs; i++) {
+    edge_index_t edge_index = graph->adj_indices[i];
+    uint8_t highway_type = edge_index >= 0 ? graph->edge_highway[edge_index] :
+                                             chains->chains[ADJ_INDEX_CHAIN(edge_index)].highway_type;
+    filter->class_arcs[road_class_of(highway_type)][(size_t)i >> 6] |= (uint64_t)1 << ((size_t)i & 63);
+  }
+  return combine_class_arcs(filter, err_info);
+}
+
+error_code_t set_avoided_road_classes(Graph *graph, uint16_t classes, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+
+  if ((classes & ~ROAD_CLASSES_ALL) != 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Unknown road class in the avoided classes.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (classes != 0 && graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Road classes cannot be avoided on a pruned graph.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  RoadFilter *filter = graph->filter;
+  if (filter == NULL) {
+    filter = (RoadFilter *)calloc(1, sizeof(RoadFilter));
+    CHECK_ALLOCATION(filter, err_info);
+    filter->avoided_classes = classes;
+    error_code_t err_code = fill_class_arcs(graph, graph->chains, filter, err_info);
+    if (err_code != ERR_SUCCESS) {
+      free_road_filter(filter);
+      return err_code;
+    }
+    graph->filter = filter;
+  } else {
+    uint16_t previous = filter->avoided_classes;
+    filter->avoided_classes = classes;
+    error_code_t err_code = combine_class_arcs(filter, err_info);
+    if (err_code != ERR_SUCCESS) {
+      filter->avoided_classes = previous;
+      return err_code;
+    }
+  }
+
+  graph->weight_version++;
+  return ERR_SUCCESS;
+}
+
+error_code_t rebuild_road_filter(Graph *graph, const ChainIndex *chains, error_info_t *err_info) {
+  if (graph->filter == NULL) return ERR_SUCCESS;
+  return fill_class_arcs(graph, chains, graph->filter, err_info);
+}
@@ -0,0 +1,552 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "timedep.h"
+#include "min_heap.h"
+#include "components.h"
+#include "roadclass.h"
+#include "traffic.h"
+#include "utils.h"
+
+// Milliseconds per profile minute
+#define PROFILE_MINUTE_MS 60000u
+
+// Assignment records read per chunk while loading
+#define ASSIGNMENT_CHUNK 4096
+
+// Shrinks the A* lower bound slightly so floating point rounding in the
+// great-circle distances cannot make it overestimate
+#define BOUND_SAFETY 0.999999
+
+/**
+ * Assignment record as stored in the profile file.
+ */
+typedef struct {
+  uint32_t edge_index;
+  uint32_t profile_id;
+} ProfileAssignment;
+
+// ================
+// Profile evaluation
+// ================
+
+/**
+ * Returns the interpolated factor of a profile at a time of day, in
+ * 1/PROFILE_FACTOR_ONE units. Breakpoints wrap around midnight, so the last
+ * one connects to the first one of the next day.
+ */
+static double profile_factor(const TimeProfiles *profiles, int profile, uint32_t time_of_day_ms) {
+  const ProfilePoint *points = &profiles->points[profiles->profile_offsets[profile]];
+  int count = (int)(profiles->profile_offsets[profile + 1] - profiles->profile_offsets[profile]);
+  if (count == 1) return points[0].factor;
+
+  // Last breakpoint at or before the time, -1 if the time is before the first one
+  int low = 0, high = count - 1, k = -1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (points[mid].minute * PROFILE_MINUTE_MS <= time_of_day_ms) {
+      k = mid;
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  double t = time_of_day_ms;
+  double t0, t1;
+  const ProfilePoint *from, *to;
+  if (k < 0) {
+    from = &points[count - 1];
+    to = &points[0];
+    t0 = (double)from->minute * PROFILE_MINUTE_MS - PROFILE_DAY_MS;
+    t1 = (double)to->minute * PROFILE_MINUTE_MS;
+  } else if (k == count - 1) {
+    from = &points[count - 1];
+    to = &points[0];
+    t0 = (double)from->minute * PROFILE_MINUTE_MS;
+    t1 = (double)to->minute * PROFILE_MINUTE_MS + PROFILE_DAY_MS;
+  } else {
+    from = &points[k];
+    to = &points[k + 1];
+    t0 = (double)from->minute * PROFILE_MINUTE_MS;
+    t1 = (double)to->minute * PROFILE_MINUTE_MS;
+  }
+  return from->factor + (to->factor - (double)from->factor) * (t - t0) / (t1 - t0);
+}
+
+uint32_t profile_travel_time(const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms, uint32_t time_of_day_ms) {
+  if (profiles == NULL || profiles->edge_profile[edge_idx] == 0 || free_flow_ms == WEIGHT_INFINITY) return free_flow_ms;
+
+  double factor = profile_factor(profiles, profiles->edge_profile[edge_idx] - 1, time_of_day_ms % PROFILE_DAY_MS);
+  double time_ms = ceil((double)free_flow_ms * factor / PROFILE_FACTOR_ONE);
+  if (time_ms >= (double)(WEIGHT_INFINITY - 1)) return WEIGHT_INFINITY - 1;
+  return (uint32_t)time_ms;
+}
+
+error_code_t parse_time_of_day(const char *text, uint32_t *time_of_day_ms, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(text, err_info);
+  CHECK_NULL(time_of_day_ms, err_info);
+
+  int hours = -1, minutes = -1, seconds = 0;
+  int length = 0, seconds_length = 0;
+  bool valid = sscanf(text, "%d:%d%n", &hours, &minutes, &length) == 2;
+  if (valid && text[length] == ':') {
+    valid = sscanf(text + length + 1, "%d%n", &seconds, &seconds_length) == 1;
+    length += 1 + seconds_length;
+  }
+  if (!valid || text[length] != '\0' || hours < 0 || hours > 23 || minutes < 0 || minutes > 59 || seconds < 0 || seconds > 59) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid time of day (expected HH:MM or HH:MM:SS).");
+    return ERR_INVALID_ARGUMENT;
+  }
+  *time_of_day_ms = (uint32_t)((hours * 60 + minutes) * 60 + seconds) * 1000u;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Profile loading
+// ================
+
+void free_time_profiles(TimeProfiles *profiles) {
+  if (profiles == NULL) return;
+
+  free(profiles->profile_offsets);
+  free(profiles->points);
+  free(profiles->min_factor);
+  free(profiles->max_fall);
+  free(profiles->edge_profile);
+  free(profiles);
+}
+
+/**
+ * Reads the profile pool and records for each profile its smallest factor and
+ * its steepest fall (factor units per millisecond), which bounds the edges it
+ * may be assigned to under FIFO.
+ */
+static error_code_t read_profile_pool(FILE *file, TimeProfiles *profiles, error_info_t *err_info) {
+  uint32_t num_profiles;
+  if (fread(&num_profiles, sizeof(uint32_t), 1, file) != 1) {
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read number of travel time profiles.");
+    return ERR_FILE_READ;
+  }
+  if (num_profiles > UINT16_MAX) {
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Too many travel time profiles (at most 65535).");
+    return ERR_INVALID_DATA;
+  }
+
+  uint32_t *offsets = (uint32_t *)realloc(profiles->profile_offsets, ((size_t)num_profiles + 1) * sizeof(uint32_t));
+  CHECK_ALLOCATION(offsets, err_info);
+  profiles->profile_offsets = offsets;
+  uint16_t *min_factor = (uint16_t *)realloc(profiles->min_factor, (num_profiles > 0 ? num_profiles : 1) * sizeof(uint16_t));
+  CHECK_ALLOCATION(min_factor, err_info);
+  profiles->min_factor = min_factor;
+  double *max_fall = (double *)realloc(profiles->max_fall, (num_profiles > 0 ? num_profiles : 1) * sizeof(double));
+  CHECK_ALLOCATION(max_fall, err_info);
+  profiles->max_fall = max_fall;
+  profiles->num_profiles = (int)num_profiles;
+  profiles->profile_offsets[0] = 0;
+
+  uint32_t capacity = 0;
+  for (uint32_t p = 0; p < num_profiles; p++) {
+    uint32_t count;
+    if (fread(&count, sizeof(uint32_t), 1, file) != 1) {
+      SET_ERROR(err_info, ERR_FILE_READ, "Failed to read travel time profile.");
+      return ERR_FILE_READ;
+    }
+    if (count == 0 || count > PROFILE_MINUTES_PER_DAY) {
+      SET_ERROR(err_info, ERR_INVALID_DATA, "Travel time profile needs 1 to 1440 breakpoints.");
+      return ERR_INVALID_DATA;
+    }
+
+    uint32_t start = profiles->profile_offsets[p];
+    if (start + count > capacity) {
+      uint32_t new_capacity = capacity > 0 ? 2 * capacity : 1024;
+      while (new_capacity < start + count) new_capacity *= 2;
+      ProfilePoint *points = (ProfilePoint *)realloc(profiles->points, (size_t)new_capacity * sizeof(ProfilePoint));
+      CHECK_ALLOCATION(points, err_info);
+      profiles->points = points;
+      capacity = new_capacity;
+    }
+    ProfilePoint *points = &profiles->points[start];
+    if (fread(points, sizeof(ProfilePoint), count, file) != count) {
+      SET_ERROR(err_info, ERR_FILE_READ, "Failed to read travel time profile breakpoints.");
+      return ERR_FILE_READ;
+    }
+
+    uint16_t smallest = UINT16_MAX;
+    double fall = 0.0;
+    for (uint32_t k = 0; k < count; k++) {
+      if (points[k].minute >= PROFILE_MINUTES_PER_DAY || (k > 0 && points[k].minute <= points[k - 1].minute)) {
+        SET_ERROR(err_info, ERR_INVALID_DATA, "Travel time profile breakpoints must be increasing minutes of the day.");
+        return ERR_INVALID_DATA;
+      }
+      if (points[k].factor == 0) {
+        SET_ERROR(err_info, ERR_INVALID_DATA, "Travel time profile factors must be positive.");
+        return ERR_INVALID_DATA;
+      }
+      if (points[k].factor < smallest) smallest = points[k].factor;
+
+      // Segment to the next breakpoint, the last one wrapping to the first
+      const ProfilePoint *next = &points[k + 1 < count ? k + 1 : 0];
+      uint32_t span = k + 1 < count ? next->minute - points[k].minute :
+                                      next->minute + PROFILE_MINUTES_PER_DAY - points[k].minute;
+      if (count > 1 && next->factor < points[k].factor) {
+        double segment_fall = (double)(points[k].factor - next->factor) / ((double)span * PROFILE_MINUTE_MS);
+        if (segment_fall > fall) fall = segment_fall;
+      }
+    }
+    profiles->min_factor[p] = smallest;
+    profiles->max_fall[p] = fall;
+    profiles->profile_offsets[p + 1] = start + count;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Reads the edge assignments, rejecting edges whose profile falls faster
+ * than their free-flow time allows under FIFO.
+ */
+static error_code_t read_profile_assignments(FILE *file, const Graph *graph, TimeProfiles *profiles, error_info_t *err_info) {
+  uint32_t num_assignments;
+  if (fread(&num_assignments, sizeof(uint32_t), 1, file) != 1) {
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read number of profile assignments.");
+    return ERR_FILE_READ;
+  }
+
+  ProfileAssignment chunk[ASSIGNMENT_CHUNK];
+  uint32_t remaining = num_assignments;
+  while (remaining > 0) {
+    size_t count = remaining < ASSIGNMENT_CHUNK ? remaining : ASSIGNMENT_CHUNK;
+    if (fread(chunk, sizeof(ProfileAssignment), count, file) != count) {
+      SET_ERROR(err_info, ERR_FILE_READ, "Failed to read profile assignments.");
+      return ERR_FILE_READ;
+    }
+    for (size_t k = 0; k < count; k++) {
+      if ((uint64_t)chunk[k].edge_index >= (uint64_t)graph->num_edges || chunk[k].profile_id >= (uint32_t)profiles->num_profiles) {
+        SET_ERROR(err_info, ERR_INVALID_DATA, "Profile assignment names an unknown edge or profile.");
+        return ERR_INVALID_DATA;
+      }
+
+      if (profiles->edge_profile[chunk[k].edge_index] == 0) profiles->num_assigned++;
+      profiles->edge_profile[chunk[k].edge_index] = (uint16_t)(chunk[k].profile_id + 1);
+      uint32_t free_flow = compute_edge_weight(graph, chunk[k].edge_index, WEIGHT_TIME);
+      error_code_t err_code = check_profile_travel_time(profiles, chunk[k].edge_index, free_flow, err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+    }
+    remaining -= (uint32_t)count;
+  }
+  return ERR_SUCCESS;
+}
+
+error_code_t check_profile_travel_time(const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(profiles, err_info);
+  if (profiles->edge_profile[edge_idx] == 0 || free_flow_ms == WEIGHT_INFINITY) return ERR_SUCCESS;
+
+  // Travel time falls by free_flow * fall / PROFILE_FACTOR_ONE per millisecond at most
+  if ((double)free_flow_ms * profiles->max_fall[profiles->edge_profile[edge_idx] - 1] > PROFILE_FACTOR_ONE) {
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Travel time profile breaks FIFO on an assigned edge.");
+    return ERR_INVALID_DATA;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Returns the fastest travel time per meter of great-circle distance of an
+ * edge over the day, INFINITY for zero-length or closed edges.
+ */
+static double edge_ms_per_meter(Graph *graph, const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms) {
+  double meters = node_distance_km(graph, graph->edge_from[edge_idx], graph->edge_to[edge_idx]) * 1000.0;
+  if (meters <= 0.0 || free_flow_ms == WEIGHT_INFINITY) return INFINITY;
+
+  double factor = PROFILE_FACTOR_ONE;
+  if (profiles != NULL && profiles->edge_profile[edge_idx] != 0) factor = profiles->min_factor[profiles->edge_profile[edge_idx] - 1];
+  return free_flow_ms * factor / PROFILE_FACTOR_ONE / meters;
+}
+
+double edge_speed_bound(Graph *graph, const TimeProfiles *profiles, edge_index_t edge_idx, uint32_t free_flow_ms) {
+  return edge_ms_per_meter(graph, profiles, edge_idx, free_flow_ms) * BOUND_SAFETY;
+}
+
+void lower_profile_speed_bound(TimeProfiles *profiles, double ms_per_meter) {
+  if (profiles == NULL) return;
+
+  // Queries read the bound while batches lower it
+  double bound;
+  __atomic_load(&profiles->min_ms_per_meter, &bound, __ATOMIC_ACQUIRE);
+  while (ms_per_meter < bound) {
+    if (__atomic_compare_exchange(&profiles->min_ms_per_meter, &bound, &ms_per_meter, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) break;
+  }
+}
+
+/**
+ * Returns the smallest travel time per meter of great-circle distance over
+ * all edges, with every edge at its fastest profile factor. Under live
+ * traffic the current arc weights count as well as the edges.bin ones.
+ */
+static double compute_speed_bound(Graph *graph, const TimeProfiles *profiles) {
+  double bound = INFINITY;
+  for (edge_index_t i = 0; i < graph->num_edges; i++) {
+    double ms_per_meter = edge_ms_per_meter(graph, profiles, i, compute_edge_weight(graph, i, WEIGHT_TIME));
+    if (ms_per_meter < bound) bound = ms_per_meter;
+  }
+  if (__atomic_load_n(&graph->traffic, __ATOMIC_ACQUIRE) != NULL) {
+    const Arc *arcs = dijkstra_mode_arcs(graph, DIJKSTRA_FASTEST_TIME);
+    for (edge_index_t i = 0; i < graph->adj_offsets[graph->num_nodes]; i++) {
+      if (graph->adj_indices[i] < 0) continue;
+      double ms_per_meter = edge_ms_per_meter(graph, profiles, graph->adj_indices[i], arcs[i].weight);
+      if (ms_per_meter < bound) bound = ms_per_meter;
+    }
+  }
+  return isinf(bound) ? 0.0 : bound * BOUND_SAFETY;
+}
+
+/**
+ * Checks the profiled edges against their live travel times (see
+ * check_profile_travel_time()).
+ */
+static error_code_t check_live_travel_times(const Graph *graph, const TimeProfiles *profiles, error_info_t *err_info) {
+  const Arc *arcs = graph->adj_arcs[WEIGHT_TIME];
+  for (edge_index_t i = 0; i < graph->adj_offsets[graph->num_nodes]; i++) {
+    if (graph->adj_indices[i] < 0) continue;
+    error_code_t err_code = check_profile_travel_time(profiles, graph->adj_indices[i], arcs[i].weight, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Allocates an empty profile pool with every edge at free flow.
+ */
+static error_code_t create_free_flow_profiles(const Graph *graph, TimeProfiles **profiles, error_info_t *err_info) {
+  TimeProfiles *created = (TimeProfiles *)calloc(1, sizeof(TimeProfiles));
+  CHECK_ALLOCATION(created, err_info);
+  created->profile_offsets = (uint32_t *)calloc(1, sizeof(uint32_t));
+  created->edge_profile = (uint16_t *)calloc(graph->num_edges > 0 ? (size_t)graph->num_edges : 1, sizeof(uint16_t));
+  if (created->profile_offsets == NULL || created->edge_profile == NULL) {
+    free_time_profiles(created);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for edge profiles.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  *profiles = created;
+  return ERR_SUCCESS;
+}
+
+error_code_t attach_free_flow_profiles(Graph *graph, TimeProfiles **profiles, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(profiles, err_info);
+
+  *profiles = __atomic_load_n(&graph->profiles, __ATOMIC_ACQUIRE);
+  if (*profiles != NULL) return ERR_SUCCESS;
+
+  TimeProfiles *free_flow;
+  error_code_t err_code = create_free_flow_profiles(graph, &free_flow, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  free_flow->min_ms_per_meter = compute_speed_bound(graph, free_flow);
+
+  // Of threads racing to attach them, the first one wins
+  if (__atomic_compare_exchange_n(&graph->profiles, profiles, free_flow, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    *profiles = free_flow;
+  } else {
+    free_time_profiles(free_flow);
+  }
+  return ERR_SUCCESS;
+}
+
+error_code_t load_time_profiles(Graph *graph, const char *filename, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(filename, err_info);
+
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    SET_ERROR(err_info, ERR_FILE_NOT_FOUND, "Failed to open travel time profile file.");
+    return ERR_FILE_NOT_FOUND;
+  }
+
+  TimeProfiles *profiles;
+  error_code_t err_code = create_free_flow_profiles(graph, &profiles, err_info);
+  if (err_code != ERR_SUCCESS) {
+    fclose(file);
+    return err_code;
+  }
+
+  err_code = read_profile_pool(file, profiles, err_info);
+  if (err_code == ERR_SUCCESS) err_code = read_profile_assignments(file, graph, profiles, err_info);
+  fclose(file);
+  if (err_code == ERR_SUCCESS && graph->traffic != NULL) err_code = check_live_travel_times(graph, profiles, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free_time_profiles(profiles);
+    return err_code;
+  }
+
+  profiles->min_ms_per_meter = compute_speed_bound(graph, profiles);
+  free_time_profiles(graph->profiles);
+  graph->profiles = profiles;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Time-dependent search
+// ================
+
+/**
+ * Allocates the arrays of a search result with every node unreached except
+ * the source.
+ */
+static error_code_t init_time_dependent_result(const Graph *graph, int source_index, int target_index, DijkstraResult *result, error_info_t *err_info) {
+  result->distances = (uint32_t *)alloc_array(graph->num_nodes, sizeof(uint32_t));
+  result->predecessors = (int *)alloc_array(graph->num_nodes, sizeof(int));
+  result->visited = (bool *)calloc(graph->num_nodes, sizeof(bool));
+  if (result->distances == NULL || result->predecessors == NULL || result->visited == NULL) {
+    free(result->distances);
+    free(result->predecessors);
+    free(result->visited);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for search result.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  for (int i = 0; i < graph->num_nodes; i++) {
+    result->distances[i] = WEIGHT_INFINITY;
+    result->predecessors[i] = -1;
+  }
+
+  result->distances[source_index] = 0;
+  result->source_index = source_index;
+  result->target_index = target_index;
+  result->num_nodes = graph->num_nodes;
+  result->settled_count = 0;
+  result->target_found = false;
+  result->mode = DIJKSTRA_FASTEST_TIME;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Returns the lower bound on the remaining travel time from a node, computing
+ * it on first use.
+ */
+static inline uint32_t node_potential(Graph *graph, uint32_t *potential, double ms_per_meter, int node_index, int target_index) {
+  if (potential[node_index] == WEIGHT_INFINITY) {
+    double bound = node_distance_km(graph, node_index, target_index) * 1000.0 * ms_per_meter;
+    potential[node_index] = bound < (double)(WEIGHT_INFINITY - 1) ? (uint32_t)bound : WEIGHT_INFINITY - 1;
+  }
+  return potential[node_index];
+}
+
+error_code_t dijkstra_time_dependent(Graph *graph, uint32_t source_node_id, uint32_t target_node_id, uint32_t departure_ms, bool goal_directed, DijkstraResult *result, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(result, err_info);
+
+  if (source_node_id == target_node_id) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Time-dependent routing needs a graph that is neither pruned nor contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int source_index, target_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  err_code = init_time_dependent_result(graph, source_index, target_index, result, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  if (!component_may_reach(graph, source_index, target_index)) return ERR_SUCCESS;
+
+  // A* keeps its lower bound with the profiles, so a graph without any gets
+  // free-flow profiles. Traffic batches lower the bound before publishing, so
+  // it covers the streams pinned here when read after them
+  int ticket = traffic_read_begin(graph);
+  TimeProfiles *graph_profiles = __atomic_load_n(&graph->profiles, __ATOMIC_ACQUIRE);
+  if (goal_directed && graph_profiles == NULL) {
+    err_code = attach_free_flow_profiles(graph, &graph_profiles, err_info);
+    if (err_code != ERR_SUCCESS) {
+      traffic_read_end(graph, ticket);
+      free_dijkstra_result(result);
+      return err_code;
+    }
+  }
+
+  // Without assigned edges every travel time is static
+  const TimeProfiles *profiles = graph_profiles != NULL && graph_profiles->num_assigned > 0 ? graph_profiles : NULL;
+  const Arc *arcs = dijkstra_mode_arcs(graph, DIJKSTRA_FASTEST_TIME);
+  const edge_index_t *adj_offsets = graph->adj_offsets;
+  const edge_index_t *adj_indices = graph->adj_indices;
+  const uint64_t *avoided_arcs = road_filter_arcs(graph);
+  departure_ms %= PROFILE_DAY_MS;
+
+  // A* potentials are computed when a node is first reached
+  uint32_t *potential = NULL;
+  double ms_per_meter = 0.0;
+  if (goal_directed) {
+    __atomic_load(&graph_profiles->min_ms_per_meter, &ms_per_meter, __ATOMIC_ACQUIRE);
+    potential = (uint32_t *)alloc_array(graph->num_nodes, sizeof(uint32_t));
+    if (potential == NULL) {
+      traffic_read_end(graph, ticket);
+      free_dijkstra_result(result);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for A* potentials.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    for (int i = 0; i < graph->num_nodes; i++) {
+      potential[i] = WEIGHT_INFINITY;
+    }
+  }
+
+  MinHeap *heap;
+  err_code = create_heap(&heap, graph->num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    traffic_read_end(graph, ticket);
+    free(potential);
+    free_dijkstra_result(result);
+    return err_code;
+  }
+  uint32_t source_key = goal_directed ? node_potential(graph, potential, ms_per_meter, source_index, target_index) : 0;
+  err_code = insert_heap(heap, source_index, source_key, err_info);
+
+  // Keys are arrival cost plus potential; entries are only queued on
+  // improvement, so a stale entry has a higher key than its node's label
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    int u = min_node.node_index;
+    uint32_t cost_u = result->distances[u];
+    uint64_t key_u = (uint64_t)cost_u + (goal_directed ? potential[u] : 0);
+    if (key_u > WEIGHT_INFINITY - 1) key_u = WEIGHT_INFINITY - 1;
+    if (min_node.distance > key_u) continue;
+    result->visited[u] = true;
+    result->settled_count++;
+    if (u == target_index) {
+      result->target_found = true;
+      break;
+    }
+
+    uint32_t clock = (uint32_t)(((uint64_t)departure_ms + cost_u) % PROFILE_DAY_MS);
+    for (edge_index_t i = adj_offsets[u]; i < adj_offsets[u + 1]; i++) {
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+      int v = arcs[i].target;
+      uint64_t new_cost = (uint64_t)cost_u + profile_travel_time(profiles, adj_indices[i], arcs[i].weight, clock);
+      if (new_cost >= result->distances[v]) continue;
+
+      result->distances[v] = (uint32_t)new_cost;
+      result->predecessors[v] = u;
+      uint64_t key = new_cost + (goal_directed ? node_potential(graph, potential, ms_per_meter, v, target_index) : 0);
+      err_code = insert_heap(heap, v, key < WEIGHT_INFINITY - 1 ? (uint32_t)key : WEIGHT_INFINITY - 1, err_info);
+      if (err_code != ERR_SUCCESS) break;
+    }
+  }
+
+  traffic_read_end(graph, ticket);
+  free_heap(heap);
+  free(potential);
+  if (err_code != ERR_SUCCESS) {
+    free_dijkstra_result(result);
+    return err_code;
+  }
+  return ERR_SUCCESS;
+}
@@ -0,0 +1,435 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include "traffic.h"
+#include "timedep.h"
+#include "weighting.h"
+
+// ================
+// Overlay management
+// ================
+
+/**
+ * Frees the spare weighting profile streams of an overlay.
+ */
+static void free_weighting_spares(TrafficOverlay *traffic) {
+  if (traffic->weighting_spare != NULL) {
+    for (int p = 0; p < traffic->num_weighting_spares; p++) {
+      free(traffic->weighting_spare[p]);
+    }
+  }
+  free(traffic->weighting_spare);
+  traffic->weighting_spare = NULL;
+  traffic->num_weighting_spares = 0;
+}
+
+void free_traffic_overlay(TrafficOverlay *traffic) {
+  if (traffic == NULL) return;
+
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    free(traffic->spare[m]);
+  }
+  free_weighting_spares(traffic);
+  free(traffic->live_speed);
+  free(traffic->stale);
+  free(traffic);
+}
+
+void drop_traffic_overlay(Graph *graph) {
+  if (graph == NULL || graph->traffic == NULL) return;
+
+  free_traffic_overlay(graph->traffic);
+  graph->traffic = NULL;
+  graph->weight_version++;
+}
+
+void drop_traffic_weightings(Graph *graph) {
+  if (graph == NULL || graph->traffic == NULL) return;
+
+  free_weighting_spares(graph->traffic);
+}
+
+/**
+ * Attaches an overlay whose spare streams copy the current arcs. The spare
+ * streams have the capacity of adj_arcs, so they can take its place for good.
+ */
+static error_code_t create_overlay(Graph *graph, error_info_t *err_info) {
+  TrafficOverlay *traffic = (TrafficOverlay *)calloc(1, sizeof(TrafficOverlay));
+  CHECK_ALLOCATION(traffic, err_info);
+
+  size_t num_slots = 2 * (size_t)graph->num_edges;
+  size_t num_arcs = (size_t)graph->adj_offsets[graph->num_nodes];
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    traffic->spare[m] = (Arc *)alloc_array(num_slots, sizeof(Arc));
+    if (traffic->spare[m] == NULL) {
+      free_traffic_overlay(traffic);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for traffic arcs.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    memcpy(traffic->spare[m], graph->adj_arcs[m], num_arcs * sizeof(Arc));
+  }
+
+  // Every byte 0xFF makes every speed TRAFFIC_SPEED_RESTORE
+  size_t num_edges = graph->num_edges > 0 ? (size_t)graph->num_edges : 1;
+  traffic->live_speed = (uint16_t *)alloc_array(num_edges, sizeof(uint16_t));
+  if (traffic->live_speed == NULL) {
+    free_traffic_overlay(traffic);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for traffic speeds.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  memset(traffic->live_speed, 0xFF, num_edges * sizeof(uint16_t));
+
+  __atomic_store_n(&graph->traffic, traffic, __ATOMIC_RELEASE);
+  return ERR_SUCCESS;
+}
+
+/**
+ * Gives the overlay a spare stream per weighting profile, copying the
+ * current streams. Nothing changes unless every stream is allocated.
+ */
+static error_code_t reserve_weighting_spares(Graph *graph, TrafficOverlay *traffic, error_info_t *err_info) {
+  const WeightingSet *weightings = graph->weightings;
+  if (weightings == NULL || traffic->weighting_spare != NULL) return ERR_SUCCESS;
+
+  Arc **spares = (Arc **)calloc(weightings->num_profiles, sizeof(Arc *));
+  CHECK_ALLOCATION(spares, err_info);
+  size_t num_slots = 2 * (size_t)graph->num_edges;
+  size_t num_arcs = (size_t)graph->adj_offsets[graph->num_nodes];
+  for (int p = 0; p < weightings->num_profiles; p++) {
+    spares[p] = (Arc *)alloc_array(num_slots > 0 ? num_slots : 1, sizeof(Arc));
+    if (spares[p] == NULL) {
+      for (int q = 0; q < p; q++) free(spares[q]);
+      free(spares);
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for traffic arcs.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    memcpy(spares[p], weightings->arcs[p], num_arcs * sizeof(Arc));
+  }
+
+  traffic->weighting_spare = spares;
+  traffic->num_weighting_spares = weightings->num_profiles;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Grows the stale position list to hold a batch (at most two arcs per update).
+ */
+static error_code_t reserve_stale(TrafficOverlay *traffic, int num_updates, error_info_t *err_info) {
+  size_t needed = 2 * (size_t)num_updates;
+  if (needed <= traffic->stale_capacity) return ERR_SUCCESS;
+
+  size_t capacity = traffic->stale_capacity > 0 ? traffic->stale_capacity : 256;
+  while (capacity < needed) capacity *= 2;
+  edge_index_t *stale = (edge_index_t *)alloc_array(capacity, sizeof(edge_index_t));
+  CHECK_ALLOCATION(stale, err_info);
+  memcpy(stale, traffic->stale, traffic->num_stale * sizeof(edge_index_t));
+  free(traffic->stale);
+  traffic->stale = stale;
+  traffic->stale_capacity = capacity;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Read sections
+// ================
+
+/**
+ * Read section open on the calling thread. The outermost section of a thread
+ * pins the streams it entered with, so every query inside it routes on one
+ * batch even when it loads its streams at different times.
+ */
+typedef struct {
+  const Graph *graph;       // Graph the streams are pinned for, NULL outside sections
+  int depth;                // Sections open on this thread for that graph
+  int ticket;               // Buffer parity the outermost section is counted under
+  const Arc *metric_arcs[WEIGHT_NUM_METRICS]; // Pinned built-in streams
+  const Arc *profile_arcs[WEIGHTING_MAX_PROFILES]; // Pinned weighting profile streams
+  int num_profiles;         // Profiles pinned
+} ReadSection;
+
+static __thread ReadSection read_section;
+
+// Tickets besides the buffer parity of an outermost section
+#define TICKET_NONE (-1)    // No graph, or a section nested in one for the same graph
+#define TICKET_UNPINNED 2   // Plus the parity: counted, but nested in a section for another graph
+
+/**
+ * Counts a reader under the current buffer parity and, if pin is set, pins
+ * the streams of that generation. Generations are even while no batch is
+ * being published; a batch makes it odd for the few stores of its swap.
+ */
+static int enter_generation(Graph *graph, bool pin) {
+  for (;;) {
+    uint32_t generation = __atomic_load_n(&graph->arc_generation, __ATOMIC_SEQ_CST);
+    if (generation & 1) {
+      sched_yield();
+      continue;
+    }
+    int parity = (int)((generation >> 1) & 1);
+    __atomic_add_fetch(&graph->arc_readers[parity], 1, __ATOMIC_SEQ_CST);
+    if (pin) {
+      for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+        read_section.metric_arcs[m] = __atomic_load_n(&graph->adj_arcs[m], __ATOMIC_ACQUIRE);
+      }
+      const WeightingSet *weightings = graph->weightings;
+      read_section.num_profiles = weightings != NULL ? weightings->num_profiles : 0;
+      for (int p = 0; p < read_section.num_profiles; p++) {
+        read_section.profile_arcs[p] = __atomic_load_n(&weightings->arcs[p], __ATOMIC_ACQUIRE);
+      }
+    }
+
+    // Counting under a generation a batch has since replaced would not hold
+    // back the batch after it, and pinned streams could mix two batches
+    if (__atomic_load_n(&graph->arc_generation, __ATOMIC_SEQ_CST) == generation) return parity;
+    __atomic_sub_fetch(&graph->arc_readers[parity], 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+int traffic_read_begin(Graph *graph) {
+  if (graph == NULL) return TICKET_NONE;
+
+  if (read_section.graph == graph) {
+    read_section.depth++;
+    return TICKET_NONE;
+  }
+  if (read_section.graph != NULL) return TICKET_UNPINNED + enter_generation(graph, false);
+
+  int ticket = enter_generation(graph, true);
+  read_section.graph = graph;
+  read_section.depth = 1;
+  read_section.ticket = ticket;
+  return ticket;
+}
+
+void traffic_read_end(Graph *graph, int ticket) {
+  if (graph == NULL) return;
+
+  if (ticket >= TICKET_UNPINNED) {
+    __atomic_sub_fetch(&graph->arc_readers[ticket - TICKET_UNPINNED], 1, __ATOMIC_RELEASE);
+    return;
+  }
+  if (--read_section.depth > 0) return;
+
+  read_section.graph = NULL;
+  __atomic_sub_fetch(&graph->arc_readers[read_section.ticket], 1, __ATOMIC_RELEASE);
+}
+
+const Arc *traffic_section_arcs(const Graph *graph, int stream) {
+  if (read_section.graph != graph) return NULL;
+  if (stream < WEIGHT_NUM_METRICS) return read_section.metric_arcs[stream];
+  if (stream - WEIGHT_NUM_METRICS >= read_section.num_profiles) return NULL;
+  return read_section.profile_arcs[stream - WEIGHT_NUM_METRICS];
+}
+
+/**
+ * Waits until the read sections entered before the current streams were
+ * published have ended: only they may hold the streams the next batch
+ * recycles as its spares.
+ */
+static void wait_for_readers(Graph *graph) {
+  uint32_t previous = ((__atomic_load_n(&graph->arc_generation, __ATOMIC_SEQ_CST) >> 1) + 1) & 1;
+  while (__atomic_load_n(&graph->arc_readers[previous], __ATOMIC_SEQ_CST) != 0) {
+    sched_yield();
+  }
+}
+
+// ================
+// Batch publication
+// ================
+
+/**
+ * Computes the weights of an edge under a live speed.
+ */
+static void live_weights(const Graph *graph, const TrafficUpdate *update, uint32_t weights[WEIGHT_NUM_METRICS]) {
+  edge_index_t edge_idx = (edge_index_t)update->edge_index;
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    if (update->speed_kmh == TRAFFIC_SPEED_CLOSED) {
+      weights[m] = WEIGHT_INFINITY;
+    } else if (update->speed_kmh == TRAFFIC_SPEED_RESTORE || m != WEIGHT_TIME) {
+      weights[m] = compute_edge_weight(graph, edge_idx, (WeightMetric)m);
+    } else {
+      weights[m] = travel_time_ms(graph->edge_length[edge_idx], update->speed_kmh);
+    }
+  }
+}
+
+/**
+ * Writes the weights and profile costs of an edge into the spare streams at
+ * every arc it owns in the adjacency lists of its endpoints, recording the
+ * positions. Returns the number of arcs written.
+ */
+static int write_edge_arcs(Graph *graph, edge_index_t edge_idx, const uint32_t weights[WEIGHT_NUM_METRICS], const uint32_t *profile_costs) {
+  TrafficOverlay *traffic = graph->traffic;
+  int from_index = graph->edge_from[edge_idx];
+  int to_index = graph->edge_to[edge_idx];
+  int written = 0;
+
+  // A bidirectional edge owns one arc at each endpoint (both at the same node for a self-loop)
+  int ends[2] = { from_index, to_index };
+  int num_ends = (graph->edge_one_way[edge_idx] || to_index == from_index) ? 1 : 2;
+  for (int k = 0; k < num_ends; k++) {
+    for (edge_index_t i = graph->adj_offsets[ends[k]]; i < graph->adj_offsets[ends[k] + 1]; i++) {
+      if (graph->adj_indices[i] != edge_idx) continue;
+      for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+        traffic->spare[m][i].weight = weights[m];
+      }
+      for (int p = 0; p < traffic->num_weighting_spares; p++) {
+        traffic->weighting_spare[p][i].weight = profile_costs[p];
+      }
+      traffic->stale[traffic->num_stale++] = i;
+      written++;
+    }
+  }
+  return written;
+}
+
+error_code_t apply_traffic_updates(Graph *graph, const TrafficUpdate *updates, int num_updates, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  if (num_updates < 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Number of traffic updates must be non-negative.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (num_updates > 0) CHECK_NULL(updates, err_info);
+
+  // Chains and pruned trees hide edges from the adjacency lists
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Live traffic needs a graph that is neither pruned nor contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  // Validate the whole batch before touching any weight
+  TimeProfiles *profiles = __atomic_load_n(&graph->profiles, __ATOMIC_ACQUIRE);
+  for (int k = 0; k < num_updates; k++) {
+    if ((uint64_t)updates[k].edge_index >= (uint64_t)graph->num_edges || updates[k].reserved != 0) {
+      SET_ERROR(err_info, ERR_INVALID_DATA, "Traffic update names an unknown edge or sets its reserved field.");
+      return ERR_INVALID_DATA;
+    }
+    if (profiles != NULL && profiles->num_assigned > 0) {
+      uint32_t weights[WEIGHT_NUM_METRICS];
+      live_weights(graph, &updates[k], weights);
+      error_code_t err_code = check_profile_travel_time(profiles, (edge_index_t)updates[k].edge_index, weights[WEIGHT_TIME], err_info);
+      if (err_code != ERR_SUCCESS) return err_code;
+    }
+  }
+
+  // The A* bound of time-dependent queries is kept admissible batch by batch
+  // from here on, so it needs profiles to live in before the first batch
+  if (profiles == NULL) {
+    error_code_t err_code = attach_free_flow_profiles(graph, &profiles, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+
+  if (graph->traffic == NULL) {
+    error_code_t err_code = create_overlay(graph, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+  TrafficOverlay *traffic = graph->traffic;
+  error_code_t err_code = reserve_stale(traffic, num_updates, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = reserve_weighting_spares(graph, traffic, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  WeightingSet *weightings = graph->weightings;
+
+  // Bring the spare streams up to date with the previous batch, once no
+  // query can still read them
+  wait_for_readers(graph);
+  for (size_t k = 0; k < traffic->num_stale; k++) {
+    edge_index_t i = traffic->stale[k];
+    for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+      traffic->spare[m][i] = graph->adj_arcs[m][i];
+    }
+    for (int p = 0; p < traffic->num_weighting_spares; p++) {
+      traffic->weighting_spare[p][i] = weightings->arcs[p][i];
+    }
+  }
+  traffic->num_stale = 0;
+
+  // Write this batch into the spare streams
+  size_t arcs_written = 0;
+  double batch_bound = INFINITY;
+  for (int k = 0; k < num_updates; k++) {
+    edge_index_t edge_idx = (edge_index_t)updates[k].edge_index;
+    uint32_t weights[WEIGHT_NUM_METRICS];
+    uint32_t profile_costs[WEIGHTING_MAX_PROFILES];
+    live_weights(graph, &updates[k], weights);
+    for (int p = 0; p < traffic->num_weighting_spares; p++) {
+      profile_costs[p] = weighting_live_cost(graph, &weightings->profiles[p], edge_idx, updates[k].speed_kmh);
+    }
+    traffic->live_speed[edge_idx] = updates[k].speed_kmh;
+    arcs_written += (size_t)write_edge_arcs(graph, edge_idx, weights, profile_costs);
+    double bound = edge_speed_bound(graph, profiles, edge_idx, weights[WEIGHT_TIME]);
+    if (bound < batch_bound) batch_bound = bound;
+  }
+
+  // Lower the A* bound before the streams it must cover are published
+  lower_profile_speed_bound(profiles, batch_bound);
+
+  // Publish: queries starting from now read the new streams, and the
+  // release stores make the written weights visible with them. The odd
+  // generation keeps read sections from pinning half of the swap
+  __atomic_add_fetch(&graph->arc_generation, 1, __ATOMIC_SEQ_CST);
+  for (int m = 0; m < WEIGHT_NUM_METRICS; m++) {
+    Arc *published = traffic->spare[m];
+    traffic->spare[m] = graph->adj_arcs[m];
+    __atomic_store_n(&graph->adj_arcs[m], published, __ATOMIC_RELEASE);
+  }
+  for (int p = 0; p < traffic->num_weighting_spares; p++) {
+    Arc *published = traffic->weighting_spare[p];
+    traffic->weighting_spare[p] = weightings->arcs[p];
+    __atomic_store_n(&weightings->arcs[p], published, __ATOMIC_RELEASE);
+  }
+  __atomic_add_fetch(&graph->weight_version, 1, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&graph->arc_generation, 1, __ATOMIC_SEQ_CST);
+
+  traffic->num_batches++;
+  traffic->last_batch_edges = num_updates;
+  traffic->last_batch_arcs = arcs_written;
+  return ERR_SUCCESS;
+}
+
+error_code_t load_traffic_updates(Graph *graph, const char *filename, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(filename, err_info);
+
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    SET_ERROR(err_info, ERR_FILE_NOT_FOUND, "Failed to open traffic file.");
+    return ERR_FILE_NOT_FOUND;
+  }
+
+  uint32_t num_updates;
+  if (fread(&num_updates, sizeof(uint32_t), 1, file) != 1) {
+    fclose(file);
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read number of traffic updates.");
+    return ERR_FILE_READ;
+  }
+  if (num_updates > (uint32_t)INT32_MAX / 2) {
+    fclose(file);
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Too many traffic updates in one batch.");
+    return ERR_INVALID_DATA;
+  }
+
+  TrafficUpdate *updates = (TrafficUpdate *)alloc_array(num_updates > 0 ? num_updates : 1, sizeof(TrafficUpdate));
+  if (updates == NULL) {
+    fclose(file);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for traffic updates.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  if (fread(updates, sizeof(TrafficUpdate), num_updates, file) != num_updates) {
+    free(updates);
+    fclose(file);
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read traffic updates.");
+    return ERR_FILE_READ;
+  }
+  fclose(file);
+
+  error_code_t err_code = apply_traffic_updates(graph, updates, (int)num_updates, err_info);
+  free(updates);
+  return err_code;
+}
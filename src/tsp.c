@@ -0,0 +1,402 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "tsp.h"
+#include "traffic.h"
+
+// ================
+// Tour state
+// ================
+
+/**
+ * A visiting order with fixed first and last entries (equal for a round
+ * trip) and the prefix costs that make every move O(1) to evaluate.
+ */
+typedef struct {
+  const uint32_t *matrix;
+  int num_stops;
+  int *tour;                // Stop positions in visiting order
+  int length;               // Entries in tour
+  int64_t *forward;         // forward[k]: cost of tour[0] -> ... -> tour[k]
+  int64_t *backward;        // backward[k]: cost of tour[k] -> ... -> tour[0] against the tour
+  int *buffer;              // Scratch order for Or-opt moves
+} TourState;
+
+static inline int64_t stop_cost(const TourState *ts, int from, int to) {
+  return ts->matrix[(size_t)from * ts->num_stops + to];
+}
+
+static void update_prefix_costs(TourState *ts) {
+  const int *tour = ts->tour;
+  ts->forward[0] = 0;
+  ts->backward[0] = 0;
+  for (int k = 1; k < ts->length; k++) {
+    ts->forward[k] = ts->forward[k - 1] + stop_cost(ts, tour[k - 1], tour[k]);
+    ts->backward[k] = ts->backward[k - 1] + stop_cost(ts, tour[k], tour[k - 1]);
+  }
+}
+
+static double monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// ================
+// Construction
+// ================
+
+/**
+ * Builds the nearest neighbour order: from the first stop, always visit the
+ * cheapest stop not visited yet.
+ */
+static void nearest_neighbour_order(TourState *ts, bool round_trip, bool *visited) {
+  int num_stops = ts->num_stops;
+  int last = round_trip ? 0 : num_stops - 1;
+  memset(visited, 0, num_stops * sizeof(bool));
+  visited[0] = true;
+  visited[last] = true;
+
+  ts->tour[0] = 0;
+  for (int position = 1; position + 1 < ts->length; position++) {
+    int from = ts->tour[position - 1];
+    int best = -1;
+    for (int s = 0; s < num_stops; s++) {
+      if (!visited[s] && (best < 0 || stop_cost(ts, from, s) < stop_cost(ts, from, best))) best = s;
+    }
+    visited[best] = true;
+    ts->tour[position] = best;
+  }
+  ts->tour[ts->length - 1] = last;
+}
+
+// ================
+// Improvement moves
+// ================
+
+typedef enum {
+  MOVE_NONE,
+  MOVE_TWO_OPT,             // Reverse tour[i..j]
+  MOVE_OR_OPT,              // Move tour[i..j] after tour[k]
+  MOVE_OR_OPT_REVERSED      // Same, reversed
+} MoveType;
+
+typedef struct {
+  MoveType type;
+  int i, j, k;
+  int64_t delta;            // Cost change, negative for improvements
+} Move;
+
+/**
+ * Finds the best 2-opt move. Reversing tour[i..j] swaps the direction its
+ * inner arcs are travelled in, which the backward prefix costs price.
+ */
+static void best_two_opt(const TourState *ts, Move *best) {
+  const int *tour = ts->tour;
+  const int64_t *forward = ts->forward;
+  const int64_t *backward = ts->backward;
+  for (int i = 1; i + 1 < ts->length; i++) {
+    for (int j = i + 1; j + 1 < ts->length; j++) {
+      int64_t delta = stop_cost(ts, tour[i - 1], tour[j]) + (backward[j] - backward[i]) +
+                      stop_cost(ts, tour[i], tour[j + 1]) - (forward[j + 1] - forward[i - 1]);
+      if (delta < best->delta) {
+        best->type = MOVE_TWO_OPT;
+        best->i = i;
+        best->j = j;
+        best->delta = delta;
+      }
+    }
+  }
+}
+
+/**
+ * Finds the best Or-opt move: a segment of up to three stops moved between
+ * two other consecutive stops, in either direction.
+ */
+static void best_or_opt(const TourState *ts, Move *best) {
+  const int *tour = ts->tour;
+  const int64_t *forward = ts->forward;
+  const int64_t *backward = ts->backward;
+  for (int i = 1; i + 1 < ts->length; i++) {
+    for (int j = i; j < i + 3 && j + 1 < ts->length; j++) {
+      int64_t removed = stop_cost(ts, tour[i - 1], tour[i]) + stop_cost(ts, tour[j], tour[j + 1]) -
+                        stop_cost(ts, tour[i - 1], tour[j + 1]);
+      int64_t reversal = (backward[j] - backward[i]) - (forward[j] - forward[i]);
+
+      for (int k = 0; k + 1 < ts->length; k++) {
+        if (k >= i - 1 && k <= j) continue;
+        int64_t opened = stop_cost(ts, tour[k], tour[k + 1]);
+        int64_t delta = stop_cost(ts, tour[k], tour[i]) + stop_cost(ts, tour[j], tour[k + 1]) - opened - removed;
+        if (delta < best->delta) {
+          best->type = MOVE_OR_OPT;
+          best->i = i;
+          best->j = j;
+          best->k = k;
+          best->delta = delta;
+        }
+        if (j == i) continue;
+        delta = stop_cost(ts, tour[k], tour[j]) + stop_cost(ts, tour[i], tour[k + 1]) + reversal - opened - removed;
+        if (delta < best->delta) {
+          best->type = MOVE_OR_OPT_REVERSED;
+          best->i = i;
+          best->j = j;
+          best->k = k;
+          best->delta = delta;
+        }
+      }
+    }
+  }
+}
+
+static void apply_move(TourState *ts, const Move *move) {
+  int *tour = ts->tour;
+  if (move->type == MOVE_TWO_OPT) {
+    for (int a = move->i, b = move->j; a < b; a++, b--) {
+      int swap = tour[a];
+      tour[a] = tour[b];
+      tour[b] = swap;
+    }
+    return;
+  }
+
+  int position = 0;
+  for (int x = 0; x < ts->length; x++) {
+    if (x >= move->i && x <= move->j) continue;
+    ts->buffer[position++] = tour[x];
+    if (x != move->k) continue;
+    for (int y = 0; y <= move->j - move->i; y++) {
+      ts->buffer[position++] = move->type == MOVE_OR_OPT ? tour[move->i + y] : tour[move->j - y];
+    }
+  }
+  memcpy(tour, ts->buffer, ts->length * sizeof(int));
+}
+
+// ================
+// Stop ordering
+// ================
+
+void default_tsp_params(TspParams *params) {
+  if (params == NULL) return;
+
+  params->round_trip = true;
+  params->time_limit_ms = 0.0;
+}
+
+error_code_t solve_stop_order(const uint32_t *matrix, int num_stops, const TspParams *params, int *order, TspStats *stats, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(matrix, err_info);
+  CHECK_NULL(order, err_info);
+
+  TspParams defaults;
+  if (params == NULL) {
+    default_tsp_params(&defaults);
+    params = &defaults;
+  }
+  if (num_stops <= 0 || !(params->time_limit_ms >= 0.0)) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Stop ordering needs at least one stop and a non-negative time limit.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  double start_ms = monotonic_ms();
+  TourState ts;
+  ts.matrix = matrix;
+  ts.num_stops = num_stops;
+  ts.tour = order;
+  ts.length = params->round_trip ? num_stops + 1 : num_stops;
+  ts.forward = (int64_t *)alloc_array(ts.length, sizeof(int64_t));
+  ts.backward = (int64_t *)alloc_array(ts.length, sizeof(int64_t));
+  ts.buffer = (int *)alloc_array(ts.length, sizeof(int));
+  bool *visited = (bool *)alloc_array(num_stops, sizeof(bool));
+  if (ts.forward == NULL || ts.backward == NULL || ts.buffer == NULL || visited == NULL) {
+    free(ts.forward);
+    free(ts.backward);
+    free(ts.buffer);
+    free(visited);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for stop ordering.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  nearest_neighbour_order(&ts, params->round_trip, visited);
+  update_prefix_costs(&ts);
+  TspStats local;
+  if (stats == NULL) stats = &local;
+  stats->initial_cost = (uint64_t)ts.forward[ts.length - 1];
+  stats->improvements = 0;
+  stats->timed_out = false;
+
+  // Best-improvement descent over both neighbourhoods
+  while (true) {
+    if (params->time_limit_ms > 0.0 && monotonic_ms() - start_ms >= params->time_limit_ms) {
+      stats->timed_out = true;
+      break;
+    }
+    Move best = { MOVE_NONE, 0, 0, 0, 0 };
+    best_two_opt(&ts, &best);
+    best_or_opt(&ts, &best);
+    if (best.type == MOVE_NONE) break;
+
+    apply_move(&ts, &best);
+    update_prefix_costs(&ts);
+    stats->improvements++;
+  }
+  stats->cost = (uint64_t)ts.forward[ts.length - 1];
+
+  free(ts.forward);
+  free(ts.backward);
+  free(ts.buffer);
+  free(visited);
+  return ERR_SUCCESS;
+}
+
+// ================
+// Tours on the road graph
+// ================
+
+void free_tsp_tour(TspTour *tour) {
+  if (tour == NULL) return;
+
+  free_waypoint_route(&tour->route);
+}
+
+error_code_t find_tsp_tour(Graph *graph, const uint32_t *stop_ids, int num_stops, DijkstraMode mode, const TspParams *params, TspTour *tour, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(stop_ids, err_info);
+  CHECK_NULL(tour, err_info);
+
+  TspParams defaults;
+  if (params == NULL) {
+    default_tsp_params(&defaults);
+    params = &defaults;
+  }
+  if (num_stops < 2 || num_stops >= WAYPOINT_MAX_STOPS) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Number of tour stops out of range.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  // The legs are routed on the batch the matrix was computed on
+  int ticket = traffic_read_begin(graph);
+  uint32_t *matrix = NULL;
+  int settled_count = 0;
+  error_code_t err_code = compute_stop_matrix(graph, stop_ids, num_stops, mode, &matrix, &settled_count, err_info);
+  if (err_code != ERR_SUCCESS) {
+    traffic_read_end(graph, ticket);
+    return err_code;
+  }
+
+  int length = params->round_trip ? num_stops + 1 : num_stops;
+  int *order = (int *)alloc_array(length, sizeof(int));
+  uint32_t *ordered_ids = (uint32_t *)alloc_array(length, sizeof(uint32_t));
+  if (order == NULL || ordered_ids == NULL) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for tour.");
+    err_code = ERR_MEMORY_ALLOCATION;
+  }
+  if (err_code == ERR_SUCCESS) err_code = solve_stop_order(matrix, num_stops, params, order, &tour->stats, err_info);
+
+  // Route the legs in the solved order; they are the matrix entries' paths
+  if (err_code == ERR_SUCCESS) {
+    for (int i = 0; i < length; i++) {
+      ordered_ids[i] = stop_ids[order[i]];
+    }
+    err_code = find_waypoint_route(graph, ordered_ids, length, mode, false, &tour->route, err_info);
+  }
+  if (err_code == ERR_SUCCESS) {
+    WaypointRoute *route = &tour->route;
+    for (int i = 0; i < length; i++) {
+      route->stop_order[i] = order[route->stop_order[i]];
+    }
+    uint64_t input_cost = 0;
+    for (int i = 0; i + 1 < length; i++) {
+      input_cost += matrix[(size_t)i * num_stops + (i + 1) % num_stops];
+    }
+    route->input_order_cost = input_cost < WEIGHT_INFINITY ? (uint32_t)input_cost : WEIGHT_INFINITY;
+    route->settled_count += settled_count;
+  }
+
+  traffic_read_end(graph, ticket);
+  free(matrix);
+  free(order);
+  free(ordered_ids);
+  return err_code;
+}
+
+// ================
+// Batches
+// ================
+
+/**
+ * Work shared by the threads of a batch: jobs are handed out in order under
+ * the lock.
+ */
+typedef struct {
+  Graph *graph;
+  TspJob *jobs;
+  int num_jobs;
+  DijkstraMode mode;
+  const TspParams *params;
+  int next_job;
+  pthread_mutex_t lock;
+} TspBatch;
+
+static void *tsp_worker(void *arg) {
+  TspBatch *batch = (TspBatch *)arg;
+  while (true) {
+    pthread_mutex_lock(&batch->lock);
+    int j = batch->next_job++;
+    pthread_mutex_unlock(&batch->lock);
+    if (j >= batch->num_jobs) break;
+
+    TspJob *job = &batch->jobs[j];
+    job->err_code = find_tsp_tour(batch->graph, job->stop_ids, job->num_stops, batch->mode, batch->params,
+                                  &job->tour, &job->err_info);
+  }
+  return NULL;
+}
+
+error_code_t solve_tsp_batch(Graph *graph, TspJob *jobs, int num_jobs, DijkstraMode mode, const TspParams *params, int num_threads, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(jobs, err_info);
+
+  if (num_jobs <= 0 || num_threads < 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "A tour batch needs at least one job and a non-negative thread count.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (num_threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = online > 0 ? (int)online : 1;
+  }
+  if (num_threads > num_jobs) num_threads = num_jobs;
+
+  TspBatch batch;
+  batch.graph = graph;
+  batch.jobs = jobs;
+  batch.num_jobs = num_jobs;
+  batch.mode = mode;
+  batch.params = params;
+  batch.next_job = 0;
+  if (pthread_mutex_init(&batch.lock, NULL) != 0) {
+    SET_ERROR(err_info, ERR_OPERATION_FAILED, "Failed to initialize tour batch lock.");
+    return ERR_OPERATION_FAILED;
+  }
+
+  // The calling thread works too; threads that fail to start leave their share to the others
+  pthread_t *threads = (pthread_t *)alloc_array(num_threads, sizeof(pthread_t));
+  int num_started = 0;
+  for (int t = 1; t < num_threads && threads != NULL; t++) {
+    if (pthread_create(&threads[num_started], NULL, tsp_worker, &batch) == 0) num_started++;
+  }
+  tsp_worker(&batch);
+  for (int t = 0; t < num_started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  free(threads);
+  pthread_mutex_destroy(&batch.lock);
+  return ERR_SUCCESS;
+}
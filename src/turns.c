@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "turns.h"
+#include "min_heap.h"
+#include "components.h"
+#include "roadclass.h"
+#include "traffic.h"
+
+// Default cost of turning back along the arrival edge: free by distance, 30 s by time
+#define DEFAULT_U_TURN_DISTANCE 0
+#define DEFAULT_U_TURN_TIME 30000
+
+// ================
+// Turn index
+// ================
+
+/**
+ * A resolved restriction waiting to be grouped by its via node.
+ */
+typedef struct {
+  int via_index;
+  TurnEntry entry;
+} PendingTurn;
+
+/**
+ * Growable list of resolved restrictions.
+ */
+typedef struct {
+  PendingTurn *items;
+  int count;
+  int capacity;
+} PendingList;
+
+static error_code_t add_pending(PendingList *list, int via_index, edge_index_t from_edge, edge_index_t to_edge, uint8_t type, error_info_t *err_info) {
+  if (list->count == list->capacity) {
+    int capacity = list->capacity > 0 ? 2 * list->capacity : 256;
+    PendingTurn *items = (PendingTurn *)realloc(list->items, capacity * sizeof(PendingTurn));
+    CHECK_ALLOCATION(items, err_info);
+    list->items = items;
+    list->capacity = capacity;
+  }
+  PendingTurn *item = &list->items[list->count++];
+  item->via_index = via_index;
+  item->entry.from_edge = from_edge;
+  item->entry.to_edge = to_edge;
+  item->entry.type = type;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Resolves a restriction record into one pending entry per pair of parallel
+ * edges from -> via and via -> to. Returns the number of entries added.
+ */
+static int resolve_restriction(Graph *graph, const TurnRestriction *record, PendingList *list, error_info_t *err_info, error_code_t *err_code) {
+  error_info_t lookup_err;
+  int from_index, via_index, to_index;
+  if (lookup_node_hash(graph->node_hash, record->from_node, &from_index, &lookup_err) != ERR_SUCCESS ||
+      lookup_node_hash(graph->node_hash, record->via_node, &via_index, &lookup_err) != ERR_SUCCESS ||
+      lookup_node_hash(graph->node_hash, record->to_node, &to_index, &lookup_err) != ERR_SUCCESS) {
+    return 0;
+  }
+
+  // Without pruning or contraction every arc is one edge
+  const Arc *arcs = graph->adj_arcs[WEIGHT_DISTANCE];
+  int added = 0;
+  for (edge_index_t i = graph->adj_offsets[from_index]; i < graph->adj_offsets[from_index + 1]; i++) {
+    if (arcs[i].target != via_index) continue;
+    for (edge_index_t j = graph->adj_offsets[via_index]; j < graph->adj_offsets[via_index + 1]; j++) {
+      if (arcs[j].target != to_index) continue;
+      *err_code = add_pending(list, via_index, graph->adj_indices[i], graph->adj_indices[j], record->type, err_info);
+      if (*err_code != ERR_SUCCESS) return added;
+      added++;
+    }
+  }
+  return added;
+}
+
+/**
+ * Groups resolved restrictions by via node with a counting sort.
+ */
+static error_code_t group_by_via_node(const PendingList *list, int num_nodes, TurnIndex *index, error_info_t *err_info) {
+  index->via_offsets = (int *)calloc((size_t)num_nodes + 1, sizeof(int));
+  index->entries = (TurnEntry *)alloc_array(list->count > 0 ? list->count : 1, sizeof(TurnEntry));
+  if (index->via_offsets == NULL || index->entries == NULL) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for turn restrictions.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  for (int k = 0; k < list->count; k++) {
+    index->via_offsets[list->items[k].via_index + 1]++;
+  }
+  index->num_via_nodes = 0;
+  for (int v = 0; v < num_nodes; v++) {
+    if (index->via_offsets[v + 1] > 0) index->num_via_nodes++;
+    index->via_offsets[v + 1] += index->via_offsets[v];
+  }
+
+  // Fill by advancing each via node's start, then shift the starts back
+  for (int k = 0; k < list->count; k++) {
+    index->entries[index->via_offsets[list->items[k].via_index]++] = list->items[k].entry;
+  }
+  for (int v = num_nodes; v > 0; v--) {
+    index->via_offsets[v] = index->via_offsets[v - 1];
+  }
+  index->via_offsets[0] = 0;
+  index->num_entries = list->count;
+  return ERR_SUCCESS;
+}
+
+void free_turn_index(TurnIndex *turns) {
+  if (turns == NULL) return;
+
+  free(turns->via_offsets);
+  free(turns->entries);
+  free(turns);
+}
+
+error_code_t load_turn_restrictions(Graph *graph, const char *filename, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(filename, err_info);
+
+  // Routing arcs of a pruned or contracted graph no longer map to single edges
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Load turn restrictions before pruning or contracting the graph.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    SET_ERROR(err_info, ERR_FILE_NOT_FOUND, "Failed to open turn restriction file.");
+    return ERR_FILE_NOT_FOUND;
+  }
+
+  uint32_t num_records;
+  if (fread(&num_records, sizeof(uint32_t), 1, file) != 1) {
+    fclose(file);
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read number of turn restrictions.");
+    return ERR_FILE_READ;
+  }
+  if (num_records > INT32_MAX) {
+    fclose(file);
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Too many turn restrictions.");
+    return ERR_INVALID_DATA;
+  }
+
+  TurnRestriction *records = (TurnRestriction *)alloc_array(num_records > 0 ? num_records : 1, sizeof(TurnRestriction));
+  if (records == NULL) {
+    fclose(file);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for turn restriction records.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  size_t records_read = fread(records, sizeof(TurnRestriction), num_records, file);
+  fclose(file);
+  if (records_read != num_records) {
+    free(records);
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read turn restrictions.");
+    return ERR_FILE_READ;
+  }
+
+  TurnIndex *index = (TurnIndex *)calloc(1, sizeof(TurnIndex));
+  if (index == NULL) {
+    free(records);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for turn restrictions.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  index->u_turn_cost[WEIGHT_DISTANCE] = DEFAULT_U_TURN_DISTANCE;
+  index->u_turn_cost[WEIGHT_TIME] = DEFAULT_U_TURN_TIME;
+
+  PendingList pending = { NULL, 0, 0 };
+  error_code_t err_code = ERR_SUCCESS;
+  for (uint32_t r = 0; r < num_records && err_code == ERR_SUCCESS; r++) {
+    if (records[r].type != TURN_RESTRICTION_NO && records[r].type != TURN_RESTRICTION_ONLY) {
+      SET_ERROR(err_info, ERR_INVALID_DATA, "Unknown turn restriction type.");
+      err_code = ERR_INVALID_DATA;
+      break;
+    }
+    if (resolve_restriction(graph, &records[r], &pending, err_info, &err_code) == 0) index->num_ignored++;
+  }
+  free(records);
+
+  if (err_code == ERR_SUCCESS) err_code = group_by_via_node(&pending, graph->num_nodes, index, err_info);
+  free(pending.items);
+  if (err_code != ERR_SUCCESS) {
+    free_turn_index(index);
+    return err_code;
+  }
+
+  free_turn_index(graph->turns);
+  graph->turns = index;
+  return ERR_SUCCESS;
+}
+
+error_code_t set_u_turn_cost(Graph *graph, WeightMetric metric, uint32_t cost, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+
+  if (graph->turns == NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "No turn restrictions loaded.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (metric < 0 || metric >= WEIGHT_NUM_METRICS) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid weight metric.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  graph->turns->u_turn_cost[metric] = cost;
+  return ERR_SUCCESS;
+}
+
+error_code_t permute_turn_index(TurnIndex *turns, int num_nodes, const int *new_to_old, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(turns, err_info);
+  CHECK_NULL(new_to_old, err_info);
+
+  int *via_offsets = (int *)alloc_array((size_t)num_nodes + 1, sizeof(int));
+  TurnEntry *entries = (TurnEntry *)alloc_array(turns->num_entries > 0 ? turns->num_entries : 1, sizeof(TurnEntry));
+  if (via_offsets == NULL || entries == NULL) {
+    free(via_offsets);
+    free(entries);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for reordered turn restrictions.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  via_offsets[0] = 0;
+  for (int v = 0; v < num_nodes; v++) {
+    int old = new_to_old[v];
+    int count = turns->via_offsets[old + 1] - turns->via_offsets[old];
+    memcpy(&entries[via_offsets[v]], &turns->entries[turns->via_offsets[old]], count * sizeof(TurnEntry));
+    via_offsets[v + 1] = via_offsets[v] + count;
+  }
+
+  free(turns->via_offsets);
+  free(turns->entries);
+  turns->via_offsets = via_offsets;
+  turns->entries = entries;
+  return ERR_SUCCESS;
+}
+
+// ================
+// Edge-based search
+// ================
+
+/**
+ * Returns the extra cost of leaving a junction on out_edge after arriving on
+ * in_edge: 0, the U-turn cost, or WEIGHT_INFINITY for a banned turn.
+ */
+static inline uint32_t turn_cost(const TurnIndex *turns, uint32_t u_turn_cost, int via_index, edge_index_t in_edge, edge_index_t out_edge) {
+  if (turns != NULL && turns->via_offsets[via_index] != turns->via_offsets[via_index + 1]) {
+    bool has_only = false;
+    bool only_match = false;
+    for (int k = turns->via_offsets[via_index]; k < turns->via_offsets[via_index + 1]; k++) {
+      const TurnEntry *entry = &turns->entries[k];
+      if (entry->from_edge != in_edge) continue;
+      if (entry->type == TURN_RESTRICTION_ONLY) {
+        has_only = true;
+        if (entry->to_edge == out_edge) only_match = true;
+      } else if (entry->to_edge == out_edge) {
+        return WEIGHT_INFINITY;
+      }
+    }
+    if (has_only && !only_match) return WEIGHT_INFINITY;
+  }
+  return out_edge == in_edge ? u_turn_cost : 0;
+}
+
+void free_turn_route(TurnRoute *route) {
+  if (route == NULL) return;
+
+  free(route->path.nodes);
+  free(route->path.costs);
+  route->path.nodes = NULL;
+  route->path.costs = NULL;
+  route->path.length = 0;
+}
+
+/**
+ * Builds the route ending with an arc from the arc predecessors; node costs
+ * are the arc labels, so they include turn costs.
+ */
+static error_code_t build_turn_route(const Arc *arcs, int source_index, const uint32_t *cost, const edge_index_t *pred, edge_index_t last_arc, RoutePath *path, error_info_t *err_info) {
+  int length = 1;
+  for (edge_index_t a = last_arc; a >= 0; a = pred[a]) length++;
+
+  path->nodes = (int *)alloc_array(length, sizeof(int));
+  path->costs = (uint32_t *)alloc_array(length, sizeof(uint32_t));
+  if (path->nodes == NULL || path->costs == NULL) {
+    free(path->nodes);
+    free(path->costs);
+    path->nodes = NULL;
+    path->costs = NULL;
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for route.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  int position = length;
+  for (edge_index_t a = last_arc; a >= 0; a = pred[a]) {
+    position--;
+    path->nodes[position] = arcs[a].target;
+    path->costs[position] = cost[a];
+  }
+  path->nodes[0] = source_index;
+  path->costs[0] = 0;
+  path->length = length;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Arc labels of the edge-based search, kept between queries. A label is only
+ * valid where its stamp equals the current search ID, so a query touches the
+ * arcs it reaches instead of clearing one label per arc.
+ */
+struct TurnWorkspace {
+  edge_index_t num_arcs;    // Arcs of the graph the workspace was sized for
+  uint32_t *cost;           // Label cost per arc
+  edge_index_t *pred;       // Arc settled before each arc, -1 at the source
+  uint32_t *stamp;          // Search ID that last wrote each label
+  uint32_t search_id;       // ID of the running search
+  MinHeap *heap;            // Queue of arc labels
+};
+
+error_code_t create_turn_workspace(const Graph *graph, TurnWorkspace **workspace, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(workspace, err_info);
+
+  // Arc labels are queued by arc position
+  edge_index_t num_arcs = graph->adj_offsets[graph->num_nodes];
+  if (num_arcs > INT_MAX) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Too many arcs for turn-aware routing.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  TurnWorkspace *ws = (TurnWorkspace *)calloc(1, sizeof(TurnWorkspace));
+  CHECK_ALLOCATION(ws, err_info);
+  size_t arc_slots = num_arcs > 0 ? (size_t)num_arcs : 1;
+  ws->num_arcs = num_arcs;
+  ws->cost = (uint32_t *)alloc_array(arc_slots, sizeof(uint32_t));
+  ws->pred = (edge_index_t *)alloc_array(arc_slots, sizeof(edge_index_t));
+  ws->stamp = (uint32_t *)calloc(arc_slots, sizeof(uint32_t));
+  if (ws->cost == NULL || ws->pred == NULL || ws->stamp == NULL) {
+    free_turn_workspace(ws);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for arc labels.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  error_code_t err_code = create_heap(&ws->heap, graph->num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) {
+    ws->heap = NULL;
+    free_turn_workspace(ws);
+    return err_code;
+  }
+
+  *workspace = ws;
+  return ERR_SUCCESS;
+}
+
+void free_turn_workspace(TurnWorkspace *workspace) {
+  if (workspace == NULL) return;
+
+  free(workspace->cost);
+  free(workspace->pred);
+  free(workspace->stamp);
+  free_heap(workspace->heap);
+  free(workspace);
+}
+
+/**
+ * Lowers the label of an arc if the new cost is cheaper and queues it.
+ */
+static inline error_code_t relax_turn_arc(TurnWorkspace *ws, edge_index_t arc, uint32_t cost, edge_index_t pred, error_info_t *err_info) {
+  if (ws->stamp[arc] == ws->search_id && ws->cost[arc] <= cost) return ERR_SUCCESS;
+
+  ws->stamp[arc] = ws->search_id;
+  ws->cost[arc] = cost;
+  ws->pred[arc] = pred;
+  return insert_heap(ws->heap, (int)arc, cost, err_info);
+}
+
+error_code_t turn_shortest_path(Graph *graph, TurnWorkspace *workspace, uint32_t source_node_id, uint32_t target_node_id, DijkstraMode mode, TurnRoute *route, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(route, err_info);
+
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+  if (source_node_id == target_node_id) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Source and target node IDs cannot be the same.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Turn-aware routing needs a graph that is neither pruned nor contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  if (workspace != NULL && workspace->num_arcs != graph->adj_offsets[graph->num_nodes]) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Turn workspace was created for a different graph.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  int source_index, target_index;
+  error_code_t err_code = find_node_index(graph, source_node_id, &source_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = find_node_index(graph, target_node_id, &target_index, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  route->path.nodes = NULL;
+  route->path.costs = NULL;
+  route->path.length = 0;
+  route->target_found = false;
+  route->mode = mode;
+  route->settled_count = 0;
+  if (!component_may_reach(graph, source_index, target_index)) return ERR_SUCCESS;
+
+  // Without a caller workspace the labels live for this query only
+  TurnWorkspace *owned = NULL;
+  if (workspace == NULL) {
+    err_code = create_turn_workspace(graph, &owned, err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+    workspace = owned;
+  }
+
+  int ticket = traffic_read_begin(graph);
+  WeightMetric metric = dijkstra_mode_metric(mode);
+  const Arc *arcs = dijkstra_mode_arcs(graph, mode);
+  const edge_index_t *adj_offsets = graph->adj_offsets;
+  const edge_index_t *adj_indices = graph->adj_indices;
+  const uint64_t *avoided_arcs = road_filter_arcs(graph);
+  const TurnIndex *turns = graph->turns;
+  uint32_t u_turn_cost = turns != NULL ? turns->u_turn_cost[metric] :
+                         (metric == WEIGHT_TIME ? DEFAULT_U_TURN_TIME : DEFAULT_U_TURN_DISTANCE);
+  if (++workspace->search_id == 0) {
+    memset(workspace->stamp, 0, (size_t)workspace->num_arcs * sizeof(uint32_t));
+    workspace->search_id = 1;
+  }
+  clear_heap(workspace->heap);
+  const uint32_t *cost = workspace->cost;
+  MinHeap *heap = workspace->heap;
+
+  // No turn is taken at the source: every arc out of it starts a label
+  for (edge_index_t i = adj_offsets[source_index]; i < adj_offsets[source_index + 1] && err_code == ERR_SUCCESS; i++) {
+    if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, i)) continue;
+    if (arcs[i].weight == WEIGHT_INFINITY) continue; // Closed by live traffic
+    err_code = relax_turn_arc(workspace, i, arcs[i].weight, -1, err_info);
+  }
+
+  // Entries are only queued on improvement, so a stale entry has a higher
+  // cost; the heap starts empty, so every entry has a label of this search
+  edge_index_t last_arc = -1;
+  while (err_code == ERR_SUCCESS && !is_heap_empty(heap)) {
+    HeapNode min_node;
+    err_code = extract_min(heap, &min_node, err_info);
+    if (err_code != ERR_SUCCESS) break;
+    edge_index_t a = min_node.node_index;
+    if (min_node.distance > cost[a]) continue;
+    route->settled_count++;
+
+    int v = arcs[a].target;
+    if (v == target_index) {
+      last_arc = a;
+      break;
+    }
+
+    edge_index_t in_edge = adj_indices[a];
+    for (edge_index_t b = adj_offsets[v]; b < adj_offsets[v + 1]; b++) {
+      if (avoided_arcs != NULL && is_arc_avoided(avoided_arcs, b)) continue;
+      uint32_t extra = turn_cost(turns, u_turn_cost, v, in_edge, adj_indices[b]);
+      if (extra == WEIGHT_INFINITY) continue;
+      uint64_t new_cost = (uint64_t)min_node.distance + extra + arcs[b].weight;
+      if (new_cost >= WEIGHT_INFINITY) continue;
+      err_code = relax_turn_arc(workspace, b, (uint32_t)new_cost, a, err_info);
+      if (err_code != ERR_SUCCESS) break;
+    }
+  }
+
+  if (err_code == ERR_SUCCESS && last_arc >= 0) {
+    err_code = build_turn_route(arcs, source_index, cost, workspace->pred, last_arc, &route->path, err_info);
+    route->target_found = err_code == ERR_SUCCESS;
+  }
+  traffic_read_end(graph, ticket);
+
+  free_turn_workspace(owned);
+  return err_code;
+}
@@ -5,6 +5,18 @@
 #include <stdint.h>
 #include <time.h>
 #include "utils.h"
+#include "components.h"
+#include "weighting.h"
+
+// M_PI is not part of strict C99 <math.h>
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Number of nearest nodes offered for selection in coordinate mode
+#define NEAREST_NODES 5
+// Candidates preselected with the fixed-point metric before exact ranking
+#define NEAREST_CANDIDATES 32
 
 // ================
 // Distance Calculation Functions
@@ -66,6 +78,11 @@ double haversine_distance(double lat1, double lon1, double lat2, double lon2) {
   return R * c; // Distance in kilometers
 }
 
+double node_distance_km(Graph *graph, int from_index, int to_index) {
+  return haversine_distance(coord_to_degrees(graph->node_lat[from_index]), coord_to_degrees(graph->node_lon[from_index]),
+                            coord_to_degrees(graph->node_lat[to_index]), coord_to_degrees(graph->node_lon[to_index]));
+}
+
 int compare_node_distance(const void *a, const void *b) {
   NodeDistance *node_a = (NodeDistance *)a;
   NodeDistance *node_b = (NodeDistance *)b;
@@ -92,8 +109,8 @@ error_code_t format_distance(double distance, char *buffer, size_t buffer_size,
     return ERR_INVALID_ARGUMENT;
   }
 
-  // Format distance based on the mode
-  if (mode == DIJKSTRA_FASTEST_TIME) {
+  // Format distance based on the mode (weighting profiles cost generalized time)
+  if (dijkstra_mode_metric(mode) == WEIGHT_TIME) {
     // Time mode: display in minutes or hours
     if (distance >= 60) {
       snprintf(buffer, buffer_size, "%.2f Hours", distance / 60.0);
@@ -171,6 +188,26 @@ void print_usage(const char *program_name) {
   printf("\nMode2:  %s <nodes.bin> <edges.bin> -c [output.gpx]\n", program_name);
   printf("  -c:  Enter coordinate mode to select source and target nodes interactively.\n");
   printf("In coordinate mode, you input source and target coordinates and the program finds the 5 nearest nodes to each coordinate.\n");
+
+  printf("\nOptions (both modes):\n");
+  printf("  --order file|hilbert|bfs:  Node memory layout applied after loading (default hilbert).\n");
+  printf("  --prune:     Route on the graph core with dead-end trees answered by tree walks.\n");
+  printf("  --contract:  Route on a graph with chains of degree-2 nodes collapsed into single arcs.\n");
+  printf("  --paths K:   Also list the K shortest loopless routes (extra GPX files get a _<n> suffix).\n");
+  printf("  --alternatives N: Also list up to N via-node alternative routes (instead of --paths).\n");
+  printf("  --turns restrictions.bin: Route obeying turn restrictions (not with --prune, --contract or route lists).\n");
+  printf("  --depart HH:MM: Also route with the travel times of this departure (fastest mode, not with --prune, --contract, --turns or route lists).\n");
+  printf("  --profiles profiles.bin: Time-dependent travel time profiles for --depart.\n");
+  printf("  --traffic traffic.bin: Live edge speeds and closures applied over edges.bin (not with --prune or --contract).\n");
+  printf("  --avoid CLASSES: Never route over these road classes, comma-separated: motorway, trunk, primary, secondary,\n");
+  printf("               tertiary, unclassified, residential, service, unknown, or major/minor (not with --prune).\n");
+  printf("  --pareto EPS: Also list the routes trading distance against travel time, within factor 1+EPS (0 for all;\n");
+  printf("               not with --prune, --contract or route lists).\n");
+  printf("  --weightings profiles.txt: Vehicle weighting profiles, offered as extra modes (not with --prune or --contract).\n");
+  printf("  --via ID,ID,...: Route through these stops between source and target as one path (not with --turns or --depart).\n");
+  printf("  --reorder:   Reorder the --via stops to shorten the route.\n");
+  printf("  --round-trip: Visit the source, the --via stops and the target in the shortest order\n");
+  printf("               found, returning to the source.\n");
 }
 
 // ================
@@ -186,36 +223,64 @@ error_code_t find_nearest_nodes(Graph *graph, double target_lat, double target_l
     return ERR_INVALID_ARGUMENT;
   }
 
-  // Allocate array for all nodes with distance calculations
-  NodeDistance *distances = malloc(graph->num_nodes * sizeof(NodeDistance));
-  CHECK_ALLOCATION(distances, err_info);
+  // Scan the fixed-point coordinates with a cheap equirectangular metric,
+  // keeping the NEAREST_CANDIDATES closest nodes sorted by that metric
+  int32_t target_lat_fixed = coord_from_degrees(target_lat);
+  int32_t target_lon_fixed = coord_from_degrees(target_lon);
+  double lon_scale = cos(target_lat * M_PI / 180.0);
 
-  // Calculate distance from target to each node
+  int candidate_index[NEAREST_CANDIDATES];
+  double candidate_metric[NEAREST_CANDIDATES];
+  int num_candidates = 0;
   for (int i = 0; i < graph->num_nodes; i++) {
-    Node *node = &graph->nodes[i];
-    distances[i].node_index = i;
-    distances[i].node_id = node->node_id;
-    distances[i].latitude = node->latitude;
-    distances[i].longitude = node->longitude;
-    distances[i].distance_km = haversine_distance(target_lat, target_lon, 
-                                               node->latitude, node->longitude);
+    double dlat = (double)((int64_t)graph->node_lat[i] - target_lat_fixed);
+    double dlon = (double)((int64_t)graph->node_lon[i] - target_lon_fixed) * lon_scale;
+    double metric = dlat * dlat + dlon * dlon;
+
+    if (num_candidates == NEAREST_CANDIDATES && metric >= candidate_metric[num_candidates - 1]) continue;
+
+    // Insertion into the sorted candidate list
+    int pos = num_candidates < NEAREST_CANDIDATES ? num_candidates++ : NEAREST_CANDIDATES - 1;
+    while (pos > 0 && candidate_metric[pos - 1] > metric) {
+      candidate_metric[pos] = candidate_metric[pos - 1];
+      candidate_index[pos] = candidate_index[pos - 1];
+      pos--;
+    }
+    candidate_metric[pos] = metric;
+    candidate_index[pos] = i;
   }
 
-  // Sort by distance to find nearest nodes
-  qsort(distances, graph->num_nodes, sizeof(NodeDistance), compare_node_distance);
+  // Rank the candidates by exact great-circle distance
+  NodeDistance distances[NEAREST_CANDIDATES];
+  for (int c = 0; c < num_candidates; c++) {
+    int i = candidate_index[c];
+    distances[c].node_index = i;
+    distances[c].node_id = graph->node_ids[i];
+    distances[c].latitude = coord_to_degrees(graph->node_lat[i]);
+    distances[c].longitude = coord_to_degrees(graph->node_lon[i]);
+    distances[c].distance_km = haversine_distance(target_lat, target_lon,
+                                                  distances[c].latitude, distances[c].longitude);
+    distances[c].main_component = in_largest_component(graph, i);
+  }
+  qsort(distances, num_candidates, sizeof(NodeDistance), compare_node_distance);
+
+  // Prefer nodes of the main component (dead-end islands and one-way traps last)
+  NodeDistance ranked[NEAREST_CANDIDATES];
+  int num_ranked = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int c = 0; c < num_candidates; c++) {
+      if (distances[c].main_component == (pass == 0)) ranked[num_ranked++] = distances[c];
+    }
+  }
+  memcpy(distances, ranked, num_candidates * sizeof(NodeDistance));
 
   // Return the 5 nearest nodes (or all nodes if less than 5)
-  *count = graph->num_nodes < 5 ? graph->num_nodes : 5;
+  *count = num_candidates < NEAREST_NODES ? num_candidates : NEAREST_NODES;
   *nodes = malloc(*count * sizeof(NodeDistance));
-  if (*nodes == NULL) {
-    free(distances);
-    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for nearest nodes.");
-    return ERR_MEMORY_ALLOCATION;
-  }
+  CHECK_ALLOCATION(*nodes, err_info);
 
   // Copy nearest nodes to output array
   memcpy(*nodes, distances, *count * sizeof(NodeDistance));
-  free(distances);
 
   return ERR_SUCCESS;
 }
@@ -234,9 +299,10 @@ error_code_t select_node_from_list(NodeDistance *nodes, int count, const char *d
   printf("Nearest nodes:\n");
 
   for (int i = 0; i < count; i++) {
-    printf("%d. Node ID %u - (%.6f, %.6f) - Distance: %.2f km\n", 
+    printf("%d. Node ID %u - (%.6f, %.6f) - Distance: %.2f km%s\n", 
            i + 1, nodes[i].node_id, 
-           nodes[i].latitude, nodes[i].longitude, nodes[i].distance_km);
+           nodes[i].latitude, nodes[i].longitude, nodes[i].distance_km,
+           nodes[i].main_component ? "" : " (outside main road network)");
   }
 
   // Get user selection with input validation
@@ -350,6 +416,35 @@ error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const
     return ERR_INVALID_ARGUMENT;
   }
 
+  // Gather the cost of every path node from the search result
+  uint32_t *costs = (uint32_t *)malloc(path_length * sizeof(uint32_t));
+  CHECK_ALLOCATION(costs, err_info);
+  for (int i = 0; i < path_length; i++) {
+    if (path[i] < 0 || path[i] >= graph->num_nodes) {
+      free(costs);
+      SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Invalid node index in path.");
+      return ERR_INVALID_ARGUMENT;
+    }
+    costs[i] = result->distances[path[i]];
+  }
+
+  error_code_t err_code = export_path_costs_to_gpx(graph, path, costs, path_length, filename, mode, err_info);
+  free(costs);
+  return err_code;
+}
+
+error_code_t export_path_costs_to_gpx(Graph *graph, const int *path, const uint32_t *costs, int path_length, const char *filename, DijkstraMode mode, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(path, err_info);
+  CHECK_NULL(costs, err_info);
+  CHECK_NULL(filename, err_info);
+
+  if (path_length <= 0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Path length must be greater than zero.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
   // Open GPX file for writing
   FILE *gpx_file = fopen(filename, "w");
   if (gpx_file == NULL) {
@@ -369,11 +464,19 @@ error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const
   // Calculate total distance/time based on mode
   double total_value = 0.0;
   const char *mode_description;
+  const char *mode_name = mode == DIJKSTRA_FASTEST_TIME ? "Fastest Time" : "Shortest Distance";
+  const char *optimized_for = mode == DIJKSTRA_FASTEST_TIME ? "travel time" : "distance";
+  bool timed = dijkstra_mode_metric(mode) == WEIGHT_TIME;
   
-  if (mode == DIJKSTRA_FASTEST_TIME) {
-    // For time mode, use the result from Dijkstra which already calculated travel time
-    total_value = result->distances[result->target_index];
+  if (timed) {
+    // For time mode, use the travel time the search already calculated
+    total_value = dijkstra_cost_value(mode, costs[path_length - 1]);
     mode_description = "Fastest Time Route";
+    if (DIJKSTRA_IS_WEIGHTING_MODE(mode) && graph->weightings != NULL) {
+      mode_description = "Weighted Route";
+      mode_name = graph->weightings->profiles[DIJKSTRA_WEIGHTING_PROFILE(mode)].name;
+      optimized_for = "the weighting profile cost";
+    }
   } else {
     // For distance mode, calculate actual geographic distance using haversine
     for (int i = 0; i < path_length - 1; i++) {
@@ -385,12 +488,8 @@ error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const
         return ERR_INVALID_ARGUMENT;
       }
       
-      Node *from = &graph->nodes[path[i]];
-      Node *to = &graph->nodes[path[i + 1]];
-      
       // Use haversine distance for accurate geographic calculation
-      double segment_distance = haversine_distance(from->latitude, from->longitude,
-                                                  to->latitude, to->longitude);
+      double segment_distance = node_distance_km(graph, path[i], path[i + 1]);
       total_value += segment_distance * 1000.0; // Convert to meters
     }
     mode_description = "Shortest Distance Route";
@@ -411,31 +510,31 @@ error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const
   fprintf(gpx_file, "  <metadata>\n");
   fprintf(gpx_file, "    <name>%s</name>\n", mode_description);
   fprintf(gpx_file, "    <desc>Route from node %u to node %u (%s) - Mode: %s</desc>\n", 
-          graph->nodes[path[0]].node_id, 
-          graph->nodes[path[path_length-1]].node_id,
+          graph->node_ids[path[0]],
+          graph->node_ids[path[path_length-1]],
           value_buffer,
-          mode == DIJKSTRA_FASTEST_TIME ? "Fastest Time" : "Shortest Distance");
+          mode_name);
   fprintf(gpx_file, "    <time>%s</time>\n", time_buffer);
   fprintf(gpx_file, "  </metadata>\n");
   
   // Write waypoints for start and end
   fprintf(gpx_file, "  <wpt lat=\"%.6f\" lon=\"%.6f\">\n", 
-          graph->nodes[path[0]].latitude, graph->nodes[path[0]].longitude);
-  fprintf(gpx_file, "    <name>Start: Node %u</name>\n", graph->nodes[path[0]].node_id);
+          coord_to_degrees(graph->node_lat[path[0]]), coord_to_degrees(graph->node_lon[path[0]]));
+  fprintf(gpx_file, "    <name>Start: Node %u</name>\n", graph->node_ids[path[0]]);
   fprintf(gpx_file, "    <desc>Route starting point</desc>\n");
   fprintf(gpx_file, "  </wpt>\n");
   
   fprintf(gpx_file, "  <wpt lat=\"%.6f\" lon=\"%.6f\">\n", 
-          graph->nodes[path[path_length-1]].latitude, graph->nodes[path[path_length-1]].longitude);
-  fprintf(gpx_file, "    <name>End: Node %u</name>\n", graph->nodes[path[path_length-1]].node_id);
+          coord_to_degrees(graph->node_lat[path[path_length-1]]), coord_to_degrees(graph->node_lon[path[path_length-1]]));
+  fprintf(gpx_file, "    <name>End: Node %u</name>\n", graph->node_ids[path[path_length-1]]);
   fprintf(gpx_file, "    <desc>Route destination</desc>\n");
   fprintf(gpx_file, "  </wpt>\n");
   
   // Start track section
   fprintf(gpx_file, "  <trk>\n");
   fprintf(gpx_file, "    <name>%s</name>\n", mode_description);
-  fprintf(gpx_file, "    <desc>Calculated using Dijkstra's algorithm - %s</desc>\n", 
-          mode == DIJKSTRA_FASTEST_TIME ? "Optimized for travel time" : "Optimized for distance");
+  fprintf(gpx_file, "    <desc>Calculated using Dijkstra's algorithm - Optimized for %s</desc>\n", 
+          optimized_for);
   fprintf(gpx_file, "    <trkseg>\n");
   
   // Write each waypoint in the path
@@ -449,26 +548,21 @@ error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const
       return ERR_INVALID_ARGUMENT;
     }
     
-    Node *node = &graph->nodes[node_index];
-    
     // Write track point with coordinates
     fprintf(gpx_file, "      <trkpt lat=\"%.6f\" lon=\"%.6f\">\n",
-            node->latitude, node->longitude);
-    fprintf(gpx_file, "        <name>Node %u</name>\n", node->node_id);
+            coord_to_degrees(graph->node_lat[node_index]), coord_to_degrees(graph->node_lon[node_index]));
+    fprintf(gpx_file, "        <name>Node %u</name>\n", graph->node_ids[node_index]);
     
     // Add cumulative distance/time information for intermediate points
     if (i > 0) {
       double cumulative_value;
-      if (mode == DIJKSTRA_FASTEST_TIME) {
-        cumulative_value = result->distances[node_index];
+      if (timed) {
+        cumulative_value = dijkstra_cost_value(mode, costs[i]);
       } else {
         // Calculate cumulative distance up to this point
         cumulative_value = 0.0;
         for (int j = 0; j < i; j++) {
-          Node *from = &graph->nodes[path[j]];
-          Node *to = &graph->nodes[path[j + 1]];
-          cumulative_value += haversine_distance(from->latitude, from->longitude,
-                                                to->latitude, to->longitude) * 1000.0;
+          cumulative_value += node_distance_km(graph, path[j], path[j + 1]) * 1000.0;
         }
       }
       
@@ -494,3 +588,20 @@ error_code_t export_path_to_gpx(Graph *graph, int *path, int path_length, const
   
   return ERR_SUCCESS;
 }
+
+error_code_t format_route_filename(const char *filename, int route_number, char *buffer, size_t buffer_size, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(filename, err_info);
+  CHECK_NULL(buffer, err_info);
+
+  // Insert the number before a ".gpx" extension, or append it
+  size_t base_length = strlen(filename);
+  if (base_length >= 4 && strcmp(filename + base_length - 4, ".gpx") == 0) base_length -= 4;
+
+  int written = snprintf(buffer, buffer_size, "%.*s_%d.gpx", (int)base_length, filename, route_number);
+  if (written < 0 || (size_t)written >= buffer_size) {
+    SET_ERROR(err_info, ERR_BUFFER_OVERFLOW, "Route filename is too long.");
+    return ERR_BUFFER_OVERFLOW;
+  }
+  return ERR_SUCCESS;
+}
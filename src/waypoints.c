@@ -0,0 +1,699 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "waypoints.h"
+#include "contract.h"
+#include "components.h"
+#include "prune.h"
+#include "roadclass.h"
+#include "traffic.h"
+
+// ================
+// Search workspace
+// ================
+
+/**
+ * State shared by every leg and matrix search of one query.
+ */
+typedef struct {
+  Graph *graph;
+  DijkstraMode mode;
+  const Arc *arcs;
+  const uint64_t *avoided_arcs;
+  StampedSearch search;     // Stamped state of the current leg or matrix search
+  int *stop_slot;           // First stop position at a node, -1 for other nodes (matrix searches only)
+  unsigned char *is_target; // Nodes the current search waits for, cleared after each search
+  int num_targets;          // Target nodes the current search still has to settle
+} WaypointWorkspace;
+
+/**
+ * Where searches from a stop start and searches to it end: the stop itself
+ * on the routing graph, otherwise the routing nodes its exit arcs lead to
+ * and its entry arcs come from (see resolve_route_ends()).
+ */
+typedef struct {
+  int exit_node[2];
+  uint32_t exit_cost[2];
+  int exit_arc[2];          // Virtual arc slot of each exit, -1 for the stop itself
+  int num_exits;
+  int entry_node[2];
+  uint32_t entry_cost[2];
+  int entry_arc[2];         // Virtual arc slot of each entry, -1 for the stop itself
+  int num_entries;
+} StopAccess;
+
+static void free_workspace(WaypointWorkspace *ws) {
+  stamped_search_free(&ws->search);
+  free(ws->stop_slot);
+  free(ws->is_target);
+}
+
+static error_code_t init_workspace(WaypointWorkspace *ws, Graph *graph, DijkstraMode mode, error_info_t *err_info) {
+  memset(ws, 0, sizeof(WaypointWorkspace));
+  ws->graph = graph;
+  ws->mode = mode;
+  ws->arcs = dijkstra_mode_arcs(graph, mode);
+  ws->avoided_arcs = road_filter_arcs(graph);
+  ws->is_target = (unsigned char *)calloc(graph->num_nodes > 0 ? graph->num_nodes : 1, sizeof(unsigned char));
+  CHECK_ALLOCATION(ws->is_target, err_info);
+  error_code_t err_code = stamped_search_init(&ws->search, graph->num_nodes, err_info);
+  if (err_code != ERR_SUCCESS) free(ws->is_target);
+  return err_code;
+}
+
+static inline bool is_off_core(const Graph *graph, int node_index) {
+  return is_pruned_node(graph, node_index) || is_chain_interior(graph, node_index);
+}
+
+/**
+ * Reads the access of a stop off the routing graph from route ends with
+ * the stop as source (exits) and as target (entries).
+ */
+static void read_stop_access(const Graph *graph, int stop_index, const RouteEnds *from_ends, const RouteEnds *to_ends, StopAccess *access) {
+  access->num_exits = 0;
+  access->num_entries = 0;
+  if (!is_off_core(graph, stop_index)) {
+    access->exit_node[0] = access->entry_node[0] = stop_index;
+    access->exit_cost[0] = access->entry_cost[0] = 0;
+    access->exit_arc[0] = access->entry_arc[0] = -1;
+    access->num_exits = access->num_entries = 1;
+    return;
+  }
+  for (int k = 0; k < 2; k++) {
+    if (from_ends != NULL && from_ends->tail[ROUTE_EXIT_ARC + k] >= 0) {
+      access->exit_node[access->num_exits] = from_ends->head[ROUTE_EXIT_ARC + k];
+      access->exit_cost[access->num_exits] = from_ends->cost[ROUTE_EXIT_ARC + k];
+      access->exit_arc[access->num_exits++] = ROUTE_EXIT_ARC + k;
+    }
+    if (to_ends != NULL && to_ends->tail[ROUTE_ENTRY_ARC + k] >= 0) {
+      access->entry_node[access->num_entries] = to_ends->tail[ROUTE_ENTRY_ARC + k];
+      access->entry_cost[access->num_entries] = to_ends->cost[ROUTE_ENTRY_ARC + k];
+      access->entry_arc[access->num_entries++] = ROUTE_ENTRY_ARC + k;
+    }
+  }
+}
+
+/**
+ * Resolves the stop IDs to node indices.
+ */
+static error_code_t find_stop_indices(Graph *graph, const uint32_t *stop_ids, int num_stops, int *stop_indices, error_info_t *err_info) {
+  for (int i = 0; i < num_stops; i++) {
+    error_code_t err_code = find_node_index(graph, stop_ids[i], &stop_indices[i], err_info);
+    if (err_code != ERR_SUCCESS) return err_code;
+  }
+  return ERR_SUCCESS;
+}
+
+// ================
+// Searches
+// ================
+
+static bool is_last_target(void *context, int node_index) {
+  WaypointWorkspace *ws = (WaypointWorkspace *)context;
+  return ws->is_target[node_index] && --ws->num_targets == 0;
+}
+
+/**
+ * Marks the entry nodes of a stop as targets of the current search.
+ *
+ * @param mark 1 to mark them, 0 to clear them after the search
+ */
+static void mark_entries(WaypointWorkspace *ws, const StopAccess *access, unsigned char mark) {
+  for (int k = 0; k < access->num_entries; k++) {
+    int node = access->entry_node[k];
+    if (ws->is_target[node] != mark) {
+      ws->is_target[node] = mark;
+      if (mark) ws->num_targets++;
+    }
+  }
+}
+
+/**
+ * Runs a search from the exits of a stop over the stamped workspace until
+ * every marked target is settled.
+ */
+static error_code_t run_search(WaypointWorkspace *ws, const StopAccess *source, error_info_t *err_info) {
+  stamped_search_begin(&ws->search);
+  error_code_t err_code = ERR_SUCCESS;
+  for (int k = 0; k < source->num_exits && err_code == ERR_SUCCESS; k++) {
+    err_code = stamped_search_seed(&ws->search, source->exit_node[k], source->exit_cost[k], err_info);
+  }
+  if (err_code != ERR_SUCCESS) return err_code;
+  return stamped_search_run(&ws->search, ws->graph, ws->arcs, ws->avoided_arcs, WEIGHT_INFINITY - 1,
+                            is_last_target, ws, NULL, err_info);
+}
+
+/**
+ * Cheapest way into a stop over the last search, WEIGHT_INFINITY if none.
+ *
+ * @param entry Set to the entry used, -1 if none (may be NULL)
+ */
+static uint32_t reached_cost(const WaypointWorkspace *ws, const StopAccess *target, int *entry) {
+  uint64_t best = WEIGHT_INFINITY;
+  if (entry != NULL) *entry = -1;
+  for (int k = 0; k < target->num_entries; k++) {
+    int node = target->entry_node[k];
+    if (!stamped_search_settled(&ws->search, node)) continue;
+    uint64_t cost = (uint64_t)ws->search.cost[node] + target->entry_cost[k];
+    if (cost < best) {
+      best = cost;
+      if (entry != NULL) *entry = k;
+    }
+  }
+  return (uint32_t)best;
+}
+
+/**
+ * Tells whether two stops lie on one chain or dead-end tree, where a direct
+ * arc may join them off the routing graph.
+ */
+static bool share_branch(const Graph *graph, int a, int b) {
+  if ((is_pruned_node(graph, a) || is_pruned_node(graph, b)) && prune_tree_root(graph, a) == prune_tree_root(graph, b)) {
+    return true;
+  }
+  if (!is_chain_interior(graph, a) || !is_chain_interior(graph, b)) return false;
+  const ChainIndex *index = graph->chains;
+  return index->interior_chain[a - index->num_routing_nodes] == index->interior_chain[b - index->num_routing_nodes];
+}
+
+/**
+ * Fills the stop-to-stop cost matrix with one search per distinct stop node.
+ */
+static error_code_t fill_stop_matrix(WaypointWorkspace *ws, const int *stop_indices, int num_stops, uint32_t *matrix, error_info_t *err_info) {
+  Graph *graph = ws->graph;
+  if (ws->stop_slot == NULL) {
+    ws->stop_slot = (int *)alloc_array(graph->num_nodes, sizeof(int));
+    CHECK_ALLOCATION(ws->stop_slot, err_info);
+    for (int v = 0; v < graph->num_nodes; v++) {
+      ws->stop_slot[v] = -1;
+    }
+  }
+  StopAccess *access = (StopAccess *)alloc_array(num_stops, sizeof(StopAccess));
+  CHECK_ALLOCATION(access, err_info);
+  for (int i = 0; i < num_stops; i++) {
+    if (ws->stop_slot[stop_indices[i]] < 0) ws->stop_slot[stop_indices[i]] = i;
+    RouteEnds ends;
+    const RouteEnds *resolved = NULL;
+    if (is_off_core(graph, stop_indices[i])) {
+      resolve_route_ends(graph, ws->mode, stop_indices[i], stop_indices[i], false, &ends);
+      resolved = &ends;
+    }
+    read_stop_access(graph, stop_indices[i], resolved, resolved, &access[i]);
+  }
+
+  error_code_t err_code = ERR_SUCCESS;
+  for (int i = 0; i < num_stops && err_code == ERR_SUCCESS; i++) {
+    int source_index = stop_indices[i];
+    int first = ws->stop_slot[source_index];
+    if (first != i) {
+      // Repeated stop: same row as its first occurrence
+      memcpy(&matrix[(size_t)i * num_stops], &matrix[(size_t)first * num_stops], num_stops * sizeof(uint32_t));
+      continue;
+    }
+
+    // Stop once the entries of every stop the component index does not rule out are settled
+    ws->num_targets = 0;
+    for (int j = 0; j < num_stops; j++) {
+      int target_index = stop_indices[j];
+      if (ws->stop_slot[target_index] == j && target_index != source_index &&
+          component_may_reach(graph, source_index, target_index)) {
+        mark_entries(ws, &access[j], 1);
+      }
+    }
+    bool searched = ws->num_targets > 0 && access[i].num_exits > 0;
+    if (searched) err_code = run_search(ws, &access[i], err_info);
+    for (int j = 0; j < num_stops; j++) {
+      mark_entries(ws, &access[j], 0);
+    }
+
+    for (int j = 0; j < num_stops; j++) {
+      int target_index = stop_indices[j];
+      uint32_t cost = WEIGHT_INFINITY;
+      if (target_index == source_index) {
+        cost = 0;
+      } else {
+        if (searched) cost = reached_cost(ws, &access[j], NULL);
+        if (share_branch(graph, source_index, target_index)) {
+          RouteEnds ends;
+          resolve_route_ends(graph, ws->mode, source_index, target_index, false, &ends);
+          if (ends.cost[ROUTE_DIRECT_ARC] < cost) cost = ends.cost[ROUTE_DIRECT_ARC];
+        }
+      }
+      matrix[(size_t)i * num_stops + j] = cost;
+    }
+  }
+
+  for (int i = 0; i < num_stops; i++) {
+    ws->stop_slot[stop_indices[i]] = -1;
+  }
+  free(access);
+  return err_code;
+}
+
+// ================
+// Stop ordering
+// ================
+
+static uint64_t order_cost(const uint32_t *matrix, int num_stops, const int *order) {
+  uint64_t total = 0;
+  for (int i = 0; i + 1 < num_stops; i++) {
+    total += matrix[(size_t)order[i] * num_stops + order[i + 1]];
+  }
+  return total;
+}
+
+static inline int64_t insertion_delta(const uint32_t *matrix, int num_stops, int from, int stop, int to) {
+  return (int64_t)matrix[(size_t)from * num_stops + stop] + matrix[(size_t)stop * num_stops + to] -
+         matrix[(size_t)from * num_stops + to];
+}
+
+/**
+ * Orders the intermediate stops by cheapest insertion between the fixed
+ * first and last stop. Each pending stop keeps its best insertion edge;
+ * inserting a stop only replaces one edge, so only stops whose best edge
+ * was that one rescan the tour.
+ *
+ * @param order Out: stop positions in visiting order
+ */
+static error_code_t cheapest_insertion(const uint32_t *matrix, int num_stops, int *order, error_info_t *err_info) {
+  int *next = (int *)alloc_array(num_stops, sizeof(int));       // Stop after each toured stop
+  int *best_from = (int *)alloc_array(num_stops, sizeof(int));  // Tour stop a pending stop goes after
+  int64_t *best_delta = (int64_t *)alloc_array(num_stops, sizeof(int64_t));
+  if (next == NULL || best_from == NULL || best_delta == NULL) {
+    free(next);
+    free(best_from);
+    free(best_delta);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for stop ordering.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  int first = 0, last = num_stops - 1;
+  next[first] = last;
+  for (int s = 1; s < last; s++) {
+    next[s] = -1; // Pending
+    best_from[s] = first;
+    best_delta[s] = insertion_delta(matrix, num_stops, first, s, last);
+  }
+
+  for (int inserted = 0; inserted < num_stops - 2; inserted++) {
+    int stop = -1;
+    for (int s = 1; s < last; s++) {
+      if (next[s] < 0 && (stop < 0 || best_delta[s] < best_delta[stop])) stop = s;
+    }
+
+    int from = best_from[stop];
+    int to = next[from];
+    next[from] = stop;
+    next[stop] = to;
+
+    for (int s = 1; s < last; s++) {
+      if (next[s] >= 0) continue;
+      if (best_from[s] == from) {
+        // Its edge is gone: rescan the tour
+        best_delta[s] = INT64_MAX;
+        for (int u = first; u != last; u = next[u]) {
+          int64_t delta = insertion_delta(matrix, num_stops, u, s, next[u]);
+          if (delta < best_delta[s]) {
+            best_delta[s] = delta;
+            best_from[s] = u;
+          }
+        }
+      } else {
+        int64_t delta = insertion_delta(matrix, num_stops, from, s, stop);
+        if (delta < best_delta[s]) {
+          best_delta[s] = delta;
+          best_from[s] = from;
+        }
+        delta = insertion_delta(matrix, num_stops, stop, s, to);
+        if (delta < best_delta[s]) {
+          best_delta[s] = delta;
+          best_from[s] = stop;
+        }
+      }
+    }
+  }
+
+  int position = 0;
+  for (int u = first; u != last; u = next[u]) order[position++] = u;
+  order[position] = last;
+
+  free(next);
+  free(best_from);
+  free(best_delta);
+  return ERR_SUCCESS;
+}
+
+// ================
+// Leg stitching
+// ================
+
+/**
+ * Collects the arcs of the route the last leg search found into the given
+ * entry: the exit arc of an off-core source, the search path and the entry
+ * arc of an off-core target.
+ */
+static error_code_t collect_leg_arcs(const WaypointWorkspace *ws, const RouteEnds *ends, const StopAccess *source, const StopAccess *target, int entry, edge_index_t **arcs, int *num_arcs, error_info_t *err_info) {
+  const StampedSearch *search = &ws->search;
+  int end_node = target->entry_node[entry];
+  int count = target->entry_arc[entry] >= 0 ? 1 : 0;
+  int seed = end_node;
+  for (; search->pred_node[seed] >= 0; seed = search->pred_node[seed]) count++;
+
+  // The search path starts at the exit that seeded its first node at that cost
+  int exit_arc = -1;
+  for (int k = 0; k < source->num_exits; k++) {
+    if (source->exit_node[k] == seed && source->exit_cost[k] == search->cost[seed]) {
+      exit_arc = source->exit_arc[k];
+      break;
+    }
+  }
+  if (exit_arc >= 0) count++;
+
+  edge_index_t *list = (edge_index_t *)alloc_array(count > 0 ? count : 1, sizeof(edge_index_t));
+  CHECK_ALLOCATION(list, err_info);
+  int position = count;
+  if (target->entry_arc[entry] >= 0) list[--position] = ends->first_virtual_arc + target->entry_arc[entry];
+  for (int v = end_node; v != seed; v = search->pred_node[v]) {
+    list[--position] = search->pred_arc[v];
+  }
+  if (exit_arc >= 0) list[--position] = ends->first_virtual_arc + exit_arc;
+
+  *arcs = list;
+  *num_arcs = count;
+  return ERR_SUCCESS;
+}
+
+/**
+ * Routes one leg from the exits of its source to the entries of its target,
+ * or over the direct arc joining stops on one chain or dead-end tree.
+ *
+ * @param leg_cost Set to the leg cost, WEIGHT_INFINITY if it has no route
+ * @param leg_path Set to the leg path when it has a route
+ */
+static error_code_t route_leg(WaypointWorkspace *ws, int from_index, int to_index, uint32_t *leg_cost, RoutePath *leg_path, error_info_t *err_info) {
+  Graph *graph = ws->graph;
+  RouteEnds ends;
+  StopAccess source, target;
+  resolve_route_ends(graph, ws->mode, from_index, to_index, false, &ends);
+  read_stop_access(graph, from_index, &ends, NULL, &source);
+  read_stop_access(graph, to_index, NULL, &ends, &target);
+
+  uint32_t best = ends.cost[ROUTE_DIRECT_ARC];
+  int entry = -1;
+  if (source.num_exits > 0 && target.num_entries > 0 && component_may_reach(graph, from_index, to_index)) {
+    ws->num_targets = 0;
+    mark_entries(ws, &target, 1);
+    error_code_t err_code = run_search(ws, &source, err_info);
+    mark_entries(ws, &target, 0);
+    if (err_code != ERR_SUCCESS) return err_code;
+
+    int reached_entry;
+    uint32_t cost = reached_cost(ws, &target, &reached_entry);
+    if (cost < best) {
+      best = cost;
+      entry = reached_entry;
+    }
+  }
+  *leg_cost = best;
+  if (best == WEIGHT_INFINITY) return ERR_SUCCESS;
+
+  if (entry < 0) {
+    edge_index_t direct_arc = ends.first_virtual_arc + ROUTE_DIRECT_ARC;
+    return build_route_path(graph, ws->mode, &ends, from_index, &direct_arc, 1, leg_path, err_info);
+  }
+  edge_index_t *arcs;
+  int num_arcs;
+  error_code_t err_code = collect_leg_arcs(ws, &ends, &source, &target, entry, &arcs, &num_arcs, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+  err_code = build_route_path(graph, ws->mode, &ends, from_index, arcs, num_arcs, leg_path, err_info);
+  free(arcs);
+  return err_code;
+}
+
+/**
+ * Appends a leg path after the last node of the route path, which it starts from.
+ *
+ * @param capacity Nodes the route path arrays hold
+ * @param offset Route cost at the start of the leg
+ */
+static error_code_t append_leg_path(RoutePath *path, int *capacity, const RoutePath *leg_path, uint32_t offset, error_info_t *err_info) {
+  int needed = path->length + leg_path->length - 1;
+  if (needed > *capacity) {
+    int new_capacity = *capacity;
+    while (new_capacity < needed) new_capacity *= 2;
+    int *nodes = (int *)realloc(path->nodes, (size_t)new_capacity * sizeof(int));
+    if (nodes != NULL) path->nodes = nodes;
+    uint32_t *costs = nodes != NULL ? (uint32_t *)realloc(path->costs, (size_t)new_capacity * sizeof(uint32_t)) : NULL;
+    if (costs == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for waypoint route.");
+      return ERR_MEMORY_ALLOCATION;
+    }
+    path->costs = costs;
+    *capacity = new_capacity;
+  }
+
+  for (int p = 1; p < leg_path->length; p++) {
+    path->nodes[path->length] = leg_path->nodes[p];
+    path->costs[path->length++] = offset + leg_path->costs[p];
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Routes every leg in visiting order and stitches the legs into one path;
+ * each stop sits where its leg ends.
+ */
+static error_code_t route_legs(WaypointWorkspace *ws, const int *stop_indices, WaypointRoute *route, error_info_t *err_info) {
+  int num_stops = route->num_stops;
+  RoutePath *path = &route->path;
+  int capacity = 1024;
+  path->nodes = (int *)alloc_array(capacity, sizeof(int));
+  path->costs = (uint32_t *)alloc_array(capacity, sizeof(uint32_t));
+  if (path->nodes == NULL || path->costs == NULL) {
+    free(path->nodes);
+    free(path->costs);
+    path->nodes = NULL;
+    path->costs = NULL;
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for waypoint route.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  path->nodes[0] = stop_indices[route->stop_order[0]];
+  path->costs[0] = 0;
+  path->length = 1;
+  route->stop_positions[0] = 0;
+
+  error_code_t err_code = ERR_SUCCESS;
+
+  uint64_t total = 0;
+  for (int leg = 0; leg + 1 < num_stops && err_code == ERR_SUCCESS; leg++) {
+    int from_index = stop_indices[route->stop_order[leg]];
+    int to_index = stop_indices[route->stop_order[leg + 1]];
+    route->leg_costs[leg] = 0;
+    if (from_index != to_index) {
+      RoutePath leg_path = { NULL, NULL, 0 };
+      err_code = route_leg(ws, from_index, to_index, &route->leg_costs[leg], &leg_path, err_info);
+      if (err_code != ERR_SUCCESS) break;
+      if (route->leg_costs[leg] == WEIGHT_INFINITY) {
+        route->leg_costs[leg] = 0;
+        route->unreachable_leg = leg;
+        break;
+      }
+      if (total + route->leg_costs[leg] >= WEIGHT_INFINITY) {
+        SET_ERROR(err_info, ERR_INVALID_DATA, "Waypoint route cost exceeds the integer cost range.");
+        err_code = ERR_INVALID_DATA;
+      } else {
+        err_code = append_leg_path(path, &capacity, &leg_path, (uint32_t)total, err_info);
+      }
+      free(leg_path.nodes);
+      free(leg_path.costs);
+    }
+    total += route->leg_costs[leg];
+    route->stop_positions[leg + 1] = path->length - 1;
+  }
+
+  if (err_code != ERR_SUCCESS || route->unreachable_leg >= 0) {
+    free(path->nodes);
+    free(path->costs);
+    path->nodes = NULL;
+    path->costs = NULL;
+    path->length = 0;
+  }
+  return err_code;
+}
+
+// ================
+// Waypoint routing
+// ================
+
+error_code_t parse_node_list(const char *text, uint32_t **ids, int *count, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(text, err_info);
+  CHECK_NULL(ids, err_info);
+  CHECK_NULL(count, err_info);
+
+  int capacity = 1;
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c == ',') capacity++;
+  }
+  *ids = (uint32_t *)alloc_array(capacity, sizeof(uint32_t));
+  CHECK_ALLOCATION(*ids, err_info);
+
+  *count = 0;
+  const char *c = text;
+  while (*count < capacity) {
+    char *end;
+    unsigned long long value = (*c >= '0' && *c <= '9') ? strtoull(c, &end, 10) : ULLONG_MAX;
+    if (value > UINT32_MAX || (*end != ',' && *end != '\0')) {
+      free(*ids);
+      *ids = NULL;
+      *count = 0;
+      SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Node lists must be comma-separated node IDs.");
+      return ERR_INVALID_ARGUMENT;
+    }
+    (*ids)[(*count)++] = (uint32_t)value;
+    c = end + 1;
+  }
+  return ERR_SUCCESS;
+}
+
+void free_waypoint_route(WaypointRoute *route) {
+  if (route == NULL) return;
+
+  free(route->path.nodes);
+  free(route->path.costs);
+  free(route->stop_order);
+  free(route->stop_positions);
+  free(route->leg_costs);
+  route->path.nodes = NULL;
+  route->path.costs = NULL;
+  route->path.length = 0;
+  route->stop_order = NULL;
+  route->stop_positions = NULL;
+  route->leg_costs = NULL;
+}
+
+/**
+ * Validates a stop list and resolves it to node indices.
+ *
+ * @param min_stops Smallest stop count accepted
+ */
+static error_code_t prepare_stops(Graph *graph, const uint32_t *stop_ids, int num_stops, int min_stops, DijkstraMode mode, int **stop_indices, error_info_t *err_info) {
+  if (check_dijkstra_mode(graph, mode, err_info) != ERR_SUCCESS) return ERR_INVALID_ARGUMENT;
+  if (num_stops < min_stops || num_stops > WAYPOINT_MAX_STOPS) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Number of waypoints out of range.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  *stop_indices = (int *)alloc_array(num_stops, sizeof(int));
+  CHECK_ALLOCATION(*stop_indices, err_info);
+  error_code_t err_code = find_stop_indices(graph, stop_ids, num_stops, *stop_indices, err_info);
+  if (err_code != ERR_SUCCESS) {
+    free(*stop_indices);
+    *stop_indices = NULL;
+  }
+  return err_code;
+}
+
+error_code_t compute_stop_matrix(Graph *graph, const uint32_t *stop_ids, int num_stops, DijkstraMode mode, uint32_t **matrix, int *settled_count, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(stop_ids, err_info);
+  CHECK_NULL(matrix, err_info);
+
+  int *stop_indices;
+  error_code_t err_code = prepare_stops(graph, stop_ids, num_stops, 1, mode, &stop_indices, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  *matrix = (uint32_t *)alloc_array((size_t)num_stops * num_stops, sizeof(uint32_t));
+  WaypointWorkspace ws;
+  if (*matrix == NULL) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for stop matrix.");
+    err_code = ERR_MEMORY_ALLOCATION;
+  } else {
+    int ticket = traffic_read_begin(graph);
+    err_code = init_workspace(&ws, graph, mode, err_info);
+    if (err_code == ERR_SUCCESS) {
+      err_code = fill_stop_matrix(&ws, stop_indices, num_stops, *matrix, err_info);
+      if (settled_count != NULL) *settled_count += ws.search.settled_count;
+      free_workspace(&ws);
+    }
+    traffic_read_end(graph, ticket);
+  }
+
+  free(stop_indices);
+  if (err_code != ERR_SUCCESS) {
+    free(*matrix);
+    *matrix = NULL;
+  }
+  return err_code;
+}
+
+error_code_t find_waypoint_route(Graph *graph, const uint32_t *stop_ids, int num_stops, DijkstraMode mode, bool reorder, WaypointRoute *route, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(stop_ids, err_info);
+  CHECK_NULL(route, err_info);
+
+  int *stop_indices;
+  error_code_t err_code = prepare_stops(graph, stop_ids, num_stops, 2, mode, &stop_indices, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  memset(route, 0, sizeof(WaypointRoute));
+  route->num_stops = num_stops;
+  route->unreachable_leg = -1;
+  route->mode = mode;
+  route->stop_order = (int *)alloc_array(num_stops, sizeof(int));
+  route->stop_positions = (int *)alloc_array(num_stops, sizeof(int));
+  route->leg_costs = (uint32_t *)alloc_array(num_stops - 1, sizeof(uint32_t));
+  if (route->stop_order == NULL || route->stop_positions == NULL || route->leg_costs == NULL) {
+    free_waypoint_route(route);
+    free(stop_indices);
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for waypoint route.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+  for (int i = 0; i < num_stops; i++) {
+    route->stop_order[i] = i;
+  }
+
+  // The stop order and the legs are found on the stream of one batch
+  int ticket = traffic_read_begin(graph);
+  WaypointWorkspace ws;
+  err_code = init_workspace(&ws, graph, mode, err_info);
+  if (err_code != ERR_SUCCESS) {
+    traffic_read_end(graph, ticket);
+    free_waypoint_route(route);
+    free(stop_indices);
+    return err_code;
+  }
+
+  // Reorder only when there are at least two intermediate stops to swap
+  if (reorder && num_stops > 3) {
+    uint32_t *matrix = (uint32_t *)alloc_array((size_t)num_stops * num_stops, sizeof(uint32_t));
+    int *order = (int *)alloc_array(num_stops, sizeof(int));
+    if (matrix == NULL || order == NULL) {
+      SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for stop matrix.");
+      err_code = ERR_MEMORY_ALLOCATION;
+    }
+    if (err_code == ERR_SUCCESS) err_code = fill_stop_matrix(&ws, stop_indices, num_stops, matrix, err_info);
+    if (err_code == ERR_SUCCESS) err_code = cheapest_insertion(matrix, num_stops, order, err_info);
+    if (err_code == ERR_SUCCESS) {
+      uint64_t input_cost = order_cost(matrix, num_stops, route->stop_order);
+      route->input_order_cost = input_cost < WEIGHT_INFINITY ? (uint32_t)input_cost : WEIGHT_INFINITY;
+      if (order_cost(matrix, num_stops, order) < input_cost) {
+        memcpy(route->stop_order, order, num_stops * sizeof(int));
+      }
+    }
+    free(matrix);
+    free(order);
+  }
+
+  if (err_code == ERR_SUCCESS) err_code = route_legs(&ws, stop_indices, route, err_info);
+
+  route->settled_count = ws.search.settled_count;
+  free_workspace(&ws);
+  traffic_read_end(graph, ticket);
+  free(stop_indices);
+  if (err_code != ERR_SUCCESS) free_waypoint_route(route);
+  return err_code;
+}
@@ -0,0 +1,374 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "weighting.h"
+#include "roadclass.h"
+#include "traffic.h"
+
+// Longest line of a profile file
+#define WEIGHTING_LINE_LENGTH 256
+
+// Edges or arcs a compiling thread takes at a time
+#define COMPILE_CHUNK 65536
+
+// ================
+// Cost evaluation
+// ================
+
+/**
+ * Computes the cost of an edge under a profile when it is driven at a speed
+ * below which the profile's caps still apply.
+ */
+static uint32_t profile_edge_cost(const Graph *graph, const WeightingProfile *profile, edge_index_t edge_idx, uint16_t speed) {
+  uint8_t road_class = road_class_of(graph->edge_highway[edge_idx]);
+  double factor = profile->class_factor[road_class];
+  if (graph->edge_one_way[edge_idx]) factor *= profile->one_way_factor;
+  if (factor <= 0.0) return WEIGHT_INFINITY;
+
+  uint32_t length = graph->edge_length[edge_idx];
+  uint16_t cap = profile->class_speed_kmh[road_class];
+  if (cap > 0 && cap < speed) speed = cap;
+  if (profile->max_speed_kmh > 0 && profile->max_speed_kmh < speed) speed = profile->max_speed_kmh;
+
+  double cost = factor * (profile->time_weight * travel_time_ms(length, speed) + profile->distance_weight * length);
+  if (cost >= (double)(WEIGHT_INFINITY - 1)) return WEIGHT_INFINITY - 1;
+  return (uint32_t)llround(cost);
+}
+
+uint32_t weighting_edge_cost(const Graph *graph, const WeightingProfile *profile, edge_index_t edge_idx) {
+  uint16_t speed = graph->edge_speed[edge_idx];
+  if (speed == 0) speed = highway_fallback_speed(graph->edge_highway[edge_idx]);
+  return profile_edge_cost(graph, profile, edge_idx, speed);
+}
+
+uint32_t weighting_live_cost(const Graph *graph, const WeightingProfile *profile, edge_index_t edge_idx, uint16_t speed_kmh) {
+  if (speed_kmh == TRAFFIC_SPEED_CLOSED) return WEIGHT_INFINITY;
+  if (speed_kmh == TRAFFIC_SPEED_RESTORE) return weighting_edge_cost(graph, profile, edge_idx);
+  return profile_edge_cost(graph, profile, edge_idx, speed_kmh);
+}
+
+// ================
+// Compilation
+// ================
+
+/**
+ * One pass of a compilation, shared by its threads: chunks of the pass are
+ * handed out in order under the lock. A pass either costs the edges under a
+ * profile or scatters those costs into the profile's arc stream.
+ */
+typedef struct {
+  const Graph *graph;
+  const WeightingProfile *profile;
+  const uint16_t *live_speed; // Live speed per edge, NULL without traffic
+  uint32_t *edge_cost;      // Cost per edge under the profile
+  Arc *arcs;                // Stream to scatter into, NULL while costing edges
+  edge_index_t count;       // Edges or arcs of the pass
+  edge_index_t next;        // First edge or arc not handed out
+  pthread_mutex_t lock;
+} CompilePass;
+
+static void *compile_worker(void *arg) {
+  CompilePass *pass = (CompilePass *)arg;
+  const Graph *graph = pass->graph;
+  const Arc *topology = graph->adj_arcs[WEIGHT_DISTANCE];
+  while (true) {
+    pthread_mutex_lock(&pass->lock);
+    edge_index_t start = pass->next;
+    edge_index_t end = pass->count - start > COMPILE_CHUNK ? start + COMPILE_CHUNK : pass->count;
+    pass->next = end;
+    pthread_mutex_unlock(&pass->lock);
+    if (start >= end) break;
+
+    if (pass->arcs == NULL) {
+      for (edge_index_t i = start; i < end; i++) {
+        pass->edge_cost[i] = pass->live_speed != NULL ? weighting_live_cost(graph, pass->profile, i, pass->live_speed[i]) :
+                                                        weighting_edge_cost(graph, pass->profile, i);
+      }
+    } else {
+      for (edge_index_t i = start; i < end; i++) {
+        pass->arcs[i].target = topology[i].target;
+        pass->arcs[i].weight = pass->edge_cost[graph->adj_indices[i]];
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Runs a pass on the calling thread and up to num_threads - 1 more; threads
+ * that fail to start leave their share to the others.
+ */
+static void run_compile_pass(CompilePass *pass, pthread_t *threads, int num_threads) {
+  pass->next = 0;
+  int num_started = 0;
+  for (int t = 1; t < num_threads && threads != NULL; t++) {
+    if (pthread_create(&threads[num_started], NULL, compile_worker, pass) == 0) num_started++;
+  }
+  compile_worker(pass);
+  for (int t = 0; t < num_started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+}
+
+error_code_t compile_weighting_arcs(Graph *graph, error_info_t *err_info) {
+  WeightingSet *weightings = graph->weightings;
+  if (weightings == NULL) return ERR_SUCCESS;
+
+  // Costs are evaluated once per edge, then scattered to the arcs of both directions;
+  // edges under live traffic are costed at their live speed
+  size_t num_edges = graph->num_edges > 0 ? (size_t)graph->num_edges : 1;
+  CompilePass pass;
+  pass.graph = graph;
+  pass.live_speed = graph->traffic != NULL ? graph->traffic->live_speed : NULL;
+  pass.edge_cost = (uint32_t *)alloc_array(num_edges, sizeof(uint32_t));
+  CHECK_ALLOCATION(pass.edge_cost, err_info);
+  if (pthread_mutex_init(&pass.lock, NULL) != 0) {
+    free(pass.edge_cost);
+    SET_ERROR(err_info, ERR_OPERATION_FAILED, "Failed to initialize weighting compilation lock.");
+    return ERR_OPERATION_FAILED;
+  }
+
+  // One thread per online processor, as long as each gets a chunk of arcs
+  edge_index_t num_arcs = graph->adj_offsets[graph->num_nodes];
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  int num_threads = online > 0 ? (int)online : 1;
+  edge_index_t num_chunks = (num_arcs + COMPILE_CHUNK - 1) / COMPILE_CHUNK;
+  if ((edge_index_t)num_threads > num_chunks) num_threads = num_chunks > 0 ? (int)num_chunks : 1;
+  pthread_t *threads = num_threads > 1 ? (pthread_t *)alloc_array(num_threads, sizeof(pthread_t)) : NULL;
+
+  for (int p = 0; p < weightings->num_profiles; p++) {
+    pass.profile = &weightings->profiles[p];
+    pass.arcs = NULL;
+    pass.count = graph->num_edges;
+    run_compile_pass(&pass, threads, num_threads);
+
+    pass.arcs = weightings->arcs[p];
+    pass.count = num_arcs;
+    run_compile_pass(&pass, threads, num_threads);
+  }
+
+  free(threads);
+  pthread_mutex_destroy(&pass.lock);
+  free(pass.edge_cost);
+  return ERR_SUCCESS;
+}
+
+// ================
+// Profile file parsing
+// ================
+
+/**
+ * Sets the defaults of a profile: fastest-time costs on every road.
+ */
+static void init_weighting_profile(WeightingProfile *profile, const char *name) {
+  memset(profile, 0, sizeof(WeightingProfile));
+  snprintf(profile->name, sizeof(profile->name), "%s", name);
+  profile->time_weight = 1.0;
+  profile->one_way_factor = 1.0;
+  for (int c = 0; c < HIGHWAY_NUM_TYPES; c++) {
+    profile->class_factor[c] = 1.0;
+  }
+}
+
+/**
+ * Applies one directive to the profile being read.
+ *
+ * @return true if the directive is known and its values are valid
+ */
+static bool apply_directive(WeightingProfile *profile, const char *keyword, const char *arg, double value, int num_fields) {
+  uint16_t classes = 0;
+  error_info_t class_err;
+  bool has_classes = num_fields >= 2 && parse_road_classes(arg, &classes, &class_err) == ERR_SUCCESS;
+
+  if (strcmp(keyword, "avoid") == 0) {
+    if (num_fields != 2 || !has_classes) return false;
+    for (int c = 0; c < HIGHWAY_NUM_TYPES; c++) {
+      if (classes & ROAD_CLASS_BIT(c)) profile->class_factor[c] = 0.0;
+    }
+    return true;
+  }
+  if (strcmp(keyword, "speed") == 0 || strcmp(keyword, "factor") == 0) {
+    if (num_fields != 3 || !has_classes || value < 0.0) return false;
+    bool speed = keyword[0] == 's';
+    if (speed && value > UINT16_MAX) return false;
+    for (int c = 0; c < HIGHWAY_NUM_TYPES; c++) {
+      if (!(classes & ROAD_CLASS_BIT(c))) continue;
+      if (speed) profile->class_speed_kmh[c] = (uint16_t)value;
+      else profile->class_factor[c] = value;
+    }
+    return true;
+  }
+
+  // Single-value directives: "time W" and friends
+  char *end = NULL;
+  double single = num_fields == 2 ? strtod(arg, &end) : -1.0;
+  if (num_fields != 2 || *end != '\0' || single < 0.0) return false;
+  if (strcmp(keyword, "time") == 0) {
+    profile->time_weight = single;
+  } else if (strcmp(keyword, "distance") == 0) {
+    profile->distance_weight = single;
+  } else if (strcmp(keyword, "one_way") == 0) {
+    profile->one_way_factor = single;
+  } else if (strcmp(keyword, "max_speed") == 0 && single <= UINT16_MAX) {
+    profile->max_speed_kmh = (uint16_t)single;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Reads every profile of a file.
+ */
+static error_code_t parse_weighting_file(FILE *file, WeightingProfile *profiles, int *num_profiles, error_info_t *err_info) {
+  char line[WEIGHTING_LINE_LENGTH];
+  *num_profiles = 0;
+
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char *comment = strchr(line, '#');
+    if (comment != NULL) *comment = '\0';
+
+    char keyword[32], arg[128];
+    double value;
+    int num_fields = sscanf(line, "%31s %127s %lf", keyword, arg, &value);
+    if (num_fields <= 0) continue; // Blank or comment line
+
+    if (strcmp(keyword, "profile") == 0) {
+      if (num_fields != 2 || strlen(arg) > WEIGHTING_NAME_LENGTH) {
+        SET_ERROR(err_info, ERR_INVALID_DATA, "Weighting profile names must be a single word of at most 31 characters.");
+        return ERR_INVALID_DATA;
+      }
+      if (*num_profiles == WEIGHTING_MAX_PROFILES) {
+        SET_ERROR(err_info, ERR_INVALID_DATA, "Too many weighting profiles in one file.");
+        return ERR_INVALID_DATA;
+      }
+      for (int p = 0; p < *num_profiles; p++) {
+        if (strcmp(profiles[p].name, arg) == 0) {
+          SET_ERROR(err_info, ERR_INVALID_DATA, "Weighting profile defined twice.");
+          return ERR_INVALID_DATA;
+        }
+      }
+      init_weighting_profile(&profiles[(*num_profiles)++], arg);
+      continue;
+    }
+
+    if (*num_profiles == 0) {
+      SET_ERROR(err_info, ERR_INVALID_DATA, "Weighting directive before the first profile line.");
+      return ERR_INVALID_DATA;
+    }
+    if (!apply_directive(&profiles[*num_profiles - 1], keyword, arg, value, num_fields)) {
+      SET_ERROR(err_info, ERR_INVALID_DATA, "Malformed weighting directive (expected time, distance, max_speed, one_way, speed, factor or avoid with non-negative values).");
+      return ERR_INVALID_DATA;
+    }
+  }
+
+  if (ferror(file)) {
+    SET_ERROR(err_info, ERR_FILE_READ, "Failed to read weighting profiles.");
+    return ERR_FILE_READ;
+  }
+  if (*num_profiles == 0) {
+    SET_ERROR(err_info, ERR_INVALID_DATA, "Weighting file defines no profile.");
+    return ERR_INVALID_DATA;
+  }
+  return ERR_SUCCESS;
+}
+
+// ================
+// Loading
+// ================
+
+void free_weighting_set(WeightingSet *weightings) {
+  if (weightings == NULL) return;
+
+  if (weightings->arcs != NULL) {
+    for (int p = 0; p < weightings->num_profiles; p++) {
+      free(weightings->arcs[p]);
+    }
+  }
+  free(weightings->arcs);
+  free(weightings->profiles);
+  free(weightings);
+}
+
+/**
+ * Allocates a weighting set with an arc stream per profile, sized like adj_arcs.
+ */
+static WeightingSet *create_weighting_set(const Graph *graph, const WeightingProfile *profiles, int num_profiles) {
+  WeightingSet *weightings = (WeightingSet *)calloc(1, sizeof(WeightingSet));
+  if (weightings == NULL) return NULL;
+
+  weightings->profiles = (WeightingProfile *)malloc(num_profiles * sizeof(WeightingProfile));
+  weightings->arcs = (Arc **)calloc(num_profiles, sizeof(Arc *));
+  weightings->num_profiles = num_profiles;
+  if (weightings->profiles == NULL || weightings->arcs == NULL) {
+    free_weighting_set(weightings);
+    return NULL;
+  }
+  memcpy(weightings->profiles, profiles, num_profiles * sizeof(WeightingProfile));
+
+  size_t num_slots = graph->num_edges > 0 ? 2 * (size_t)graph->num_edges : 1;
+  for (int p = 0; p < num_profiles; p++) {
+    weightings->arcs[p] = (Arc *)alloc_array(num_slots, sizeof(Arc));
+    if (weightings->arcs[p] == NULL) {
+      free_weighting_set(weightings);
+      return NULL;
+    }
+  }
+  return weightings;
+}
+
+error_code_t load_weighting_profiles(Graph *graph, const char *filename, error_info_t *err_info) {
+  CHECK_NULL(err_info, err_info);
+  CHECK_NULL(graph, err_info);
+  CHECK_NULL(filename, err_info);
+
+  // Chains and pruned trees keep per-metric costs of their own
+  if (graph->chains != NULL || graph->pruned != NULL) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Weighting profiles need a graph that is neither pruned nor contracted.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  FILE *file = fopen(filename, "r");
+  if (file == NULL) {
+    SET_ERROR(err_info, ERR_FILE_NOT_FOUND, "Failed to open weighting profile file.");
+    return ERR_FILE_NOT_FOUND;
+  }
+  WeightingProfile profiles[WEIGHTING_MAX_PROFILES];
+  int num_profiles;
+  error_code_t err_code = parse_weighting_file(file, profiles, &num_profiles, err_info);
+  fclose(file);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  WeightingSet *weightings = create_weighting_set(graph, profiles, num_profiles);
+  if (weightings == NULL) {
+    SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for weighting profiles.");
+    return ERR_MEMORY_ALLOCATION;
+  }
+
+  WeightingSet *previous = graph->weightings;
+  graph->weightings = weightings;
+  err_code = compile_weighting_arcs(graph, err_info);
+  if (err_code != ERR_SUCCESS) {
+    graph->weightings = previous;
+    free_weighting_set(weightings);
+    return err_code;
+  }
+  drop_traffic_weightings(graph); // The spare streams belong to the previous profiles
+  free_weighting_set(previous);
+  graph->weight_version++;
+  return ERR_SUCCESS;
+}
+
+int find_weighting_profile(const Graph *graph, const char *name) {
+  if (graph == NULL || graph->weightings == NULL || name == NULL) return -1;
+
+  for (int p = 0; p < graph->weightings->num_profiles; p++) {
+    if (strcmp(graph->weightings->profiles[p].name, name) == 0) return p;
+  }
+  return -1;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "graph.h"
+#include "dijkstra.h"
+#include "traffic.h"
+#include "turns.h"
+#include "utils.h"
+
+// =================
+// Live traffic regression checks
+// =================
+
+#define GRID_SIDE 3
+
+static int failures = 0;
+
+#define EXPECT(cond, msg) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, (msg)); \
+      failures++; \
+    } \
+  } while (0)
+
+/**
+ * Builds a bidirectional grid of GRID_SIDE x GRID_SIDE nodes with IDs 1..n.
+ */
+static Graph *build_grid(void) {
+  error_info_t err_info;
+  int side = GRID_SIDE;
+  Graph *graph = NULL;
+  if (create_graph(&graph, side * side, 2 * side * (side - 1), &err_info) != ERR_SUCCESS) {
+    print_error(&err_info);
+    exit(EXIT_FAILURE);
+  }
+
+  for (int i = 0; i < side * side; i++) {
+    graph->node_ids[i] = (uint32_t)i + 1;
+    graph->node_lat[i] = coord_from_degrees(45.0 + (i / side) * 0.001);
+    graph->node_lon[i] = coord_from_degrees(9.0 + (i % side) * 0.001);
+    insert_node_hash(graph->node_hash, (uint32_t)i + 1, i, &err_info);
+  }
+
+  edge_index_t e = 0;
+  for (int r = 0; r < side; r++) {
+    for (int c = 0; c < side; c++) {
+      int from = r * side + c;
+      int neighbors[2] = { c + 1 < side ? from + 1 : -1, r + 1 < side ? from + side : -1 };
+      for (int k = 0; k < 2; k++) {
+        if (neighbors[k] < 0) continue;
+        graph->edge_from[e] = from;
+        graph->edge_to[e] = neighbors[k];
+        graph->edge_length[e] = 100;
+        graph->edge_speed[e] = 50;
+        graph->edge_highway[e] = HIGHWAY_RESIDENTIAL;
+        graph->edge_one_way[e] = 0;
+        e++;
+      }
+    }
+  }
+
+  if (build_csr_representation(graph, &err_info) != ERR_SUCCESS) {
+    print_error(&err_info);
+    exit(EXIT_FAILURE);
+  }
+  return graph;
+}
+
+/**
+ * Closes every edge at a node, so no route may leave or reach it.
+ */
+static void close_node(Graph *graph, int node_index) {
+  error_info_t err_info;
+  TrafficUpdate updates[4];
+  int num_updates = 0;
+  for (edge_index_t e = 0; e < graph->num_edges; e++) {
+    if (graph->edge_from[e] != node_index && graph->edge_to[e] != node_index) continue;
+    updates[num_updates].edge_index = (uint32_t)e;
+    updates[num_updates].speed_kmh = TRAFFIC_SPEED_CLOSED;
+    updates[num_updates].reserved = 0;
+    num_updates++;
+  }
+  EXPECT(apply_traffic_updates(graph, updates, num_updates, &err_info) == ERR_SUCCESS, "closure batch applies");
+}
+
+/**
+ * A source whose every arc is closed reaches nothing, in either search.
+ */
+static void test_closed_source(DijkstraMode mode) {
+  error_info_t err_info;
+  Graph *graph = build_grid();
+  close_node(graph, 0);
+
+  DijkstraResult result;
+  EXPECT(dijkstra_shortest_path(graph, 1, 2, mode, &result, &err_info) == ERR_SUCCESS, "node-based search runs");
+  EXPECT(!result.target_found, "node-based search leaves a closed source");
+  free_dijkstra_result(&result);
+
+  TurnRoute route;
+  EXPECT(turn_shortest_path(graph, NULL, 1, 2, mode, &route, &err_info) == ERR_SUCCESS, "turn-aware search runs");
+  EXPECT(!route.target_found, "turn-aware search leaves a closed source");
+  free_turn_route(&route);
+
+  // The rest of the grid still routes around the closed corner
+  EXPECT(turn_shortest_path(graph, NULL, 2, 4, mode, &route, &err_info) == ERR_SUCCESS, "turn-aware search runs");
+  EXPECT(route.target_found && route.path.length == 3 && route.path.nodes[1] == 4, "turn-aware search detours around the closed corner");
+  free_turn_route(&route);
+
+  free_graph(graph);
+}
+
+int main(void) {
+  test_closed_source(DIJKSTRA_SHORTEST_DISTANCE);
+  test_closed_source(DIJKSTRA_FASTEST_TIME);
+
+  if (failures > 0) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("All traffic checks passed\n");
+  return EXIT_SUCCESS;
+}
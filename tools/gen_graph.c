@@ -0,0 +1,534 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include "graph.h"
+#include "utils.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// =================
+// Constants
+// =================
+
+#define DEFAULT_ROWS 100
+#define DEFAULT_COLS 100
+#define DEFAULT_CHAIN_MAX 3
+#define DEFAULT_ONEWAY_RATIO 0.15
+#define DEFAULT_DROP_RATIO 0.05
+#define DEFAULT_SPACING_M 150.0
+#define DEFAULT_ORIGIN_LAT 45.0
+#define DEFAULT_ORIGIN_LON 9.0
+#define DEFAULT_SEED 1
+#define METERS_PER_DEGREE 111320.0
+#define IO_BUFFER_SIZE (1 << 20)
+
+// Segment directions leaving an intersection
+#define DIR_EAST 0
+#define DIR_SOUTH 1
+
+// =================
+// Data Structures
+// =================
+
+/**
+ * Generator parameters. Every property of the output is a pure function of
+ * these values and the grid position, so nothing has to be kept in memory.
+ */
+typedef struct {
+  const char *nodes_file;       // Output path for nodes.bin
+  const char *edges_file;       // Output path for edges.bin
+  int rows;                     // Intersection rows
+  int cols;                     // Intersection columns
+  int chain_max;                // Maximum degree-2 nodes inserted per road segment
+  double oneway_ratio;          // Share of minor segments that are one-way
+  double drop_ratio;            // Share of minor segments removed from the grid
+  double zero_speed_ratio;      // Share of segments with speed_limit == 0 (bad data)
+  double spacing_m;             // Distance between intersections in meters
+  double origin_lat;            // Latitude of the north-west corner
+  double origin_lon;            // Longitude of the north-west corner
+  uint64_t seed;                // Seed for all random decisions
+} GeneratorOptions;
+
+/**
+ * Road segment between two neighbouring intersections.
+ */
+typedef struct {
+  bool present;                 // False if the segment was dropped
+  HighwayType highway_type;     // Road class derived from the grid line
+  uint16_t speed_limit;         // Speed limit in km/h
+  bool one_way;                 // True if the segment is one-way
+  bool reversed;                // One-way segment runs against the grid direction
+  int chain_length;             // Number of degree-2 nodes along the segment
+} Segment;
+
+// =================
+// Deterministic Randomness
+// =================
+
+static uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ * Returns a uniform value in [0, 1) that depends only on the seed, key and salt.
+ */
+static double hash_unit(uint64_t seed, uint64_t key, uint64_t salt) {
+  uint64_t h = mix64(seed ^ mix64(key * 0x9E3779B97F4A7C15ULL + salt));
+  return (double)(h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// =================
+// Grid Model
+// =================
+
+static uint64_t segment_key(const GeneratorOptions *options, int row, int col, int dir) {
+  return ((uint64_t)row * options->cols + col) * 2 + dir;
+}
+
+static uint32_t intersection_id(const GeneratorOptions *options, int row, int col) {
+  return 1 + (uint32_t)((uint64_t)row * options->cols + col);
+}
+
+static uint32_t chain_node_id(const GeneratorOptions *options, int row, int col, int dir, int j) {
+  uint64_t base = 1 + (uint64_t)options->rows * options->cols;
+  return (uint32_t)(base + segment_key(options, row, col, dir) * options->chain_max + j);
+}
+
+/**
+ * Classifies a grid line: every 64th line is a motorway, then trunk,
+ * primary, secondary and tertiary roads at decreasing spacing, with
+ * residential, unclassified and service streets in between.
+ */
+static HighwayType line_class(const GeneratorOptions *options, int line, uint64_t key) {
+  if (line % 64 == 0) return HIGHWAY_MOTORWAY;
+  if (line % 32 == 0) return HIGHWAY_TRUNK;
+  if (line % 16 == 0) return HIGHWAY_PRIMARY;
+  if (line % 8 == 0) return HIGHWAY_SECONDARY;
+  if (line % 4 == 0) return HIGHWAY_TERTIARY;
+
+  double u = hash_unit(options->seed, key, 1);
+  if (u < 0.15) return HIGHWAY_SERVICE;
+  if (u < 0.35) return HIGHWAY_UNCLASSIFIED;
+  return HIGHWAY_RESIDENTIAL;
+}
+
+static uint16_t class_speed(HighwayType highway_type) {
+  switch (highway_type) {
+    case HIGHWAY_MOTORWAY: return 130;
+    case HIGHWAY_TRUNK: return 110;
+    case HIGHWAY_PRIMARY: return 90;
+    case HIGHWAY_SECONDARY: return 70;
+    case HIGHWAY_TERTIARY: return 50;
+    case HIGHWAY_UNCLASSIFIED: return 50;
+    case HIGHWAY_RESIDENTIAL: return 30;
+    case HIGHWAY_SERVICE: return 20;
+    default: return 30;
+  }
+}
+
+/**
+ * Describes the segment leaving intersection (row, col) in the given direction.
+ */
+static void describe_segment(const GeneratorOptions *options, int row, int col, int dir, Segment *segment) {
+  memset(segment, 0, sizeof(Segment));
+  if (dir == DIR_EAST && col + 1 >= options->cols) return;
+  if (dir == DIR_SOUTH && row + 1 >= options->rows) return;
+
+  uint64_t key = segment_key(options, row, col, dir);
+  // East segments follow the row's road, south segments the column's road
+  uint64_t line_key = (dir == DIR_EAST) ? (uint64_t)row * 2 : (uint64_t)col * 2 + 1;
+  segment->highway_type = line_class(options, dir == DIR_EAST ? row : col, line_key);
+  bool minor = segment->highway_type >= HIGHWAY_TERTIARY;
+
+  if (minor && hash_unit(options->seed, key, 2) < options->drop_ratio) return;
+  segment->present = true;
+
+  segment->speed_limit = class_speed(segment->highway_type);
+  if (hash_unit(options->seed, key, 3) < options->zero_speed_ratio) {
+    segment->speed_limit = 0;
+  }
+
+  if (minor && hash_unit(options->seed, key, 4) < options->oneway_ratio) {
+    segment->one_way = true;
+    segment->reversed = hash_unit(options->seed, key, 5) < 0.5;
+  }
+
+  segment->chain_length = (int)(hash_unit(options->seed, key, 6) * (options->chain_max + 1));
+  if (segment->chain_length > options->chain_max) segment->chain_length = options->chain_max;
+}
+
+static void intersection_coords(const GeneratorOptions *options, int row, int col, double *lat, double *lon) {
+  double dlat = options->spacing_m / METERS_PER_DEGREE;
+  double dlon = options->spacing_m / (METERS_PER_DEGREE * cos(options->origin_lat * M_PI / 180.0));
+
+  // Perturb the grid by up to a quarter of the spacing in each direction
+  uint64_t key = (uint64_t)row * options->cols + col;
+  double jitter_lat = (hash_unit(options->seed, key, 7) - 0.5) * 0.5;
+  double jitter_lon = (hash_unit(options->seed, key, 8) - 0.5) * 0.5;
+
+  *lat = options->origin_lat - (row + jitter_lat) * dlat;
+  *lon = options->origin_lon + (col + jitter_lon) * dlon;
+}
+
+/**
+ * Computes the coordinates of the j-th point along a segment, where point 0
+ * is the start intersection and point chain_length + 1 the end intersection.
+ * Intermediate points bend sideways so chains look like curved roads.
+ */
+static void segment_point(const GeneratorOptions *options, int row, int col, int dir, const Segment *segment, int j, double *lat, double *lon) {
+  int end_row = (dir == DIR_SOUTH) ? row + 1 : row;
+  int end_col = (dir == DIR_EAST) ? col + 1 : col;
+  double lat_a, lon_a, lat_b, lon_b;
+  intersection_coords(options, row, col, &lat_a, &lon_a);
+  intersection_coords(options, end_row, end_col, &lat_b, &lon_b);
+
+  double t = (double)j / (segment->chain_length + 1);
+  *lat = lat_a + t * (lat_b - lat_a);
+  *lon = lon_a + t * (lon_b - lon_a);
+
+  if (j > 0 && j <= segment->chain_length) {
+    double bend = (hash_unit(options->seed, segment_key(options, row, col, dir), 9) - 0.5) * 0.3;
+    double offset = bend * sin(M_PI * t);
+    if (dir == DIR_EAST) {
+      *lat += offset * (options->spacing_m / METERS_PER_DEGREE);
+    } else {
+      *lon += offset * (options->spacing_m / (METERS_PER_DEGREE * cos(*lat * M_PI / 180.0)));
+    }
+  }
+}
+
+static uint32_t segment_point_id(const GeneratorOptions *options, int row, int col, int dir, const Segment *segment, int j) {
+  if (j == 0) return intersection_id(options, row, col);
+  if (j == segment->chain_length + 1) {
+    return (dir == DIR_EAST) ? intersection_id(options, row, col + 1) : intersection_id(options, row + 1, col);
+  }
+  return chain_node_id(options, row, col, dir, j - 1);
+}
+
+// =================
+// Streaming Writers
+// =================
+
+/**
+ * Opens an output file and reserves the uint32_t record count header.
+ */
+static error_code_t open_output(const char *filename, FILE **file, char **buffer, error_info_t *err_info) {
+  *file = fopen(filename, "wb");
+  if (*file == NULL) {
+    SET_ERROR(err_info, ERR_FILE_WRITE, "Failed to open output file for writing.");
+    return ERR_FILE_WRITE;
+  }
+
+  *buffer = (char *)malloc(IO_BUFFER_SIZE);
+  if (*buffer != NULL) {
+    setvbuf(*file, *buffer, _IOFBF, IO_BUFFER_SIZE);
+  }
+
+  uint32_t placeholder = 0;
+  if (fwrite(&placeholder, sizeof(uint32_t), 1, *file) != 1) {
+    fclose(*file);
+    free(*buffer);
+    SET_ERROR(err_info, ERR_FILE_WRITE, "Failed to write file header.");
+    return ERR_FILE_WRITE;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Patches the record count into the header and closes the file.
+ */
+static error_code_t close_output(FILE *file, char *buffer, uint64_t count, error_info_t *err_info) {
+  uint32_t header = (uint32_t)count;
+  bool ok = fflush(file) == 0 &&
+            fseek(file, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(uint32_t), 1, file) == 1;
+  ok = (fclose(file) == 0) && ok;
+  free(buffer);
+
+  if (!ok) {
+    SET_ERROR(err_info, ERR_FILE_WRITE, "Failed to finalize output file.");
+    return ERR_FILE_WRITE;
+  }
+  return ERR_SUCCESS;
+}
+
+static error_code_t write_node(FILE *file, uint32_t node_id, double lat, double lon, error_info_t *err_info) {
+  // Zero the struct so padding bytes are deterministic on disk
+  Node node;
+  memset(&node, 0, sizeof(Node));
+  node.node_id = node_id;
+  node.latitude = lat;
+  node.longitude = lon;
+
+  if (fwrite(&node, sizeof(Node), 1, file) != 1) {
+    SET_ERROR(err_info, ERR_FILE_WRITE, "Failed to write node record.");
+    return ERR_FILE_WRITE;
+  }
+  return ERR_SUCCESS;
+}
+
+/**
+ * Writes nodes row by row: the intersections of a row followed by the
+ * degree-2 nodes of every segment leaving that row.
+ */
+static error_code_t write_nodes(const GeneratorOptions *options, uint64_t *num_nodes, error_info_t *err_info) {
+  FILE *file;
+  char *buffer;
+  error_code_t err_code = open_output(options->nodes_file, &file, &buffer, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  uint64_t count = 0;
+  for (int row = 0; row < options->rows && err_code == ERR_SUCCESS; row++) {
+    for (int col = 0; col < options->cols && err_code == ERR_SUCCESS; col++) {
+      double lat, lon;
+      intersection_coords(options, row, col, &lat, &lon);
+      err_code = write_node(file, intersection_id(options, row, col), lat, lon, err_info);
+      count++;
+    }
+
+    for (int col = 0; col < options->cols && err_code == ERR_SUCCESS; col++) {
+      for (int dir = DIR_EAST; dir <= DIR_SOUTH && err_code == ERR_SUCCESS; dir++) {
+        Segment segment;
+        describe_segment(options, row, col, dir, &segment);
+        if (!segment.present) continue;
+
+        for (int j = 1; j <= segment.chain_length && err_code == ERR_SUCCESS; j++) {
+          double lat, lon;
+          segment_point(options, row, col, dir, &segment, j, &lat, &lon);
+          err_code = write_node(file, segment_point_id(options, row, col, dir, &segment, j), lat, lon, err_info);
+          count++;
+        }
+      }
+    }
+
+    if (options->rows >= 10 && (row + 1) % (options->rows / 10) == 0) {
+      fprintf(stderr, "  nodes: %d%%\n", (int)((row + 1) * 100LL / options->rows));
+    }
+  }
+
+  if (err_code != ERR_SUCCESS) {
+    fclose(file);
+    free(buffer);
+    return err_code;
+  }
+
+  *num_nodes = count;
+  return close_output(file, buffer, count, err_info);
+}
+
+/**
+ * Writes one edge per pair of consecutive points along every segment.
+ */
+static error_code_t write_edges(const GeneratorOptions *options, uint64_t *num_edges, error_info_t *err_info) {
+  FILE *file;
+  char *buffer;
+  error_code_t err_code = open_output(options->edges_file, &file, &buffer, err_info);
+  if (err_code != ERR_SUCCESS) return err_code;
+
+  uint64_t count = 0;
+  for (int row = 0; row < options->rows && err_code == ERR_SUCCESS; row++) {
+    for (int col = 0; col < options->cols && err_code == ERR_SUCCESS; col++) {
+      for (int dir = DIR_EAST; dir <= DIR_SOUTH && err_code == ERR_SUCCESS; dir++) {
+        Segment segment;
+        describe_segment(options, row, col, dir, &segment);
+        if (!segment.present) continue;
+
+        double prev_lat, prev_lon;
+        segment_point(options, row, col, dir, &segment, 0, &prev_lat, &prev_lon);
+        uint32_t prev_id = segment_point_id(options, row, col, dir, &segment, 0);
+
+        for (int j = 1; j <= segment.chain_length + 1; j++) {
+          double lat, lon;
+          segment_point(options, row, col, dir, &segment, j, &lat, &lon);
+          uint32_t id = segment_point_id(options, row, col, dir, &segment, j);
+
+          Edge edge;
+          memset(&edge, 0, sizeof(Edge));
+          edge.from_node = segment.reversed ? id : prev_id;
+          edge.to_node = segment.reversed ? prev_id : id;
+          double length_m = haversine_distance(prev_lat, prev_lon, lat, lon) * 1000.0;
+          edge.length = length_m < 1.0 ? 1 : (uint32_t)(length_m + 0.5);
+          edge.speed_limit = segment.speed_limit;
+          edge.highway_type = (uint8_t)segment.highway_type;
+          edge.one_way = segment.one_way ? 1 : 0;
+
+          if (fwrite(&edge, sizeof(Edge), 1, file) != 1) {
+            SET_ERROR(err_info, ERR_FILE_WRITE, "Failed to write edge record.");
+            err_code = ERR_FILE_WRITE;
+            break;
+          }
+          count++;
+
+          prev_lat = lat;
+          prev_lon = lon;
+          prev_id = id;
+        }
+      }
+    }
+
+    if (options->rows >= 10 && (row + 1) % (options->rows / 10) == 0) {
+      fprintf(stderr, "  edges: %d%%\n", (int)((row + 1) * 100LL / options->rows));
+    }
+  }
+
+  if (err_code != ERR_SUCCESS) {
+    fclose(file);
+    free(buffer);
+    return err_code;
+  }
+
+  *num_edges = count;
+  return close_output(file, buffer, count, err_info);
+}
+
+// =================
+// Command Line
+// =================
+
+static void print_generator_usage(const char *program_name) {
+  printf("Usage: %s <nodes.bin> <edges.bin> [options]\n", program_name);
+  printf("  --grid RxC            Intersection grid size (default %dx%d)\n", DEFAULT_ROWS, DEFAULT_COLS);
+  printf("  --nodes N             Pick a square grid producing about N nodes\n");
+  printf("  --chain-max K         Max degree-2 nodes per road segment (default %d)\n", DEFAULT_CHAIN_MAX);
+  printf("  --oneway-ratio P      Share of minor segments that are one-way (default %.2f)\n", DEFAULT_ONEWAY_RATIO);
+  printf("  --drop-ratio P        Share of minor segments removed (default %.2f)\n", DEFAULT_DROP_RATIO);
+  printf("  --zero-speed-ratio P  Share of segments with zero speed limit (default 0)\n");
+  printf("  --spacing M           Meters between intersections (default %.0f)\n", DEFAULT_SPACING_M);
+  printf("  --origin LAT,LON      North-west corner (default %.1f,%.1f)\n", DEFAULT_ORIGIN_LAT, DEFAULT_ORIGIN_LON);
+  printf("  --seed S              Seed for all random decisions (default %d)\n", DEFAULT_SEED);
+}
+
+static bool parse_generator_options(int argc, char *argv[], GeneratorOptions *options) {
+  if (argc < 3) return false;
+
+  options->nodes_file = argv[1];
+  options->edges_file = argv[2];
+  options->rows = DEFAULT_ROWS;
+  options->cols = DEFAULT_COLS;
+  options->chain_max = DEFAULT_CHAIN_MAX;
+  options->oneway_ratio = DEFAULT_ONEWAY_RATIO;
+  options->drop_ratio = DEFAULT_DROP_RATIO;
+  options->zero_speed_ratio = 0.0;
+  options->spacing_m = DEFAULT_SPACING_M;
+  options->origin_lat = DEFAULT_ORIGIN_LAT;
+  options->origin_lon = DEFAULT_ORIGIN_LON;
+  options->seed = DEFAULT_SEED;
+
+  double target_nodes = 0.0;
+  for (int i = 3; i < argc; i++) {
+    if (i + 1 >= argc) return false;
+    const char *value = argv[i + 1];
+
+    if (strcmp(argv[i], "--grid") == 0) {
+      if (sscanf(value, "%dx%d", &options->rows, &options->cols) != 2) return false;
+    } else if (strcmp(argv[i], "--nodes") == 0) {
+      target_nodes = atof(value);
+    } else if (strcmp(argv[i], "--chain-max") == 0) {
+      options->chain_max = atoi(value);
+    } else if (strcmp(argv[i], "--oneway-ratio") == 0) {
+      options->oneway_ratio = atof(value);
+    } else if (strcmp(argv[i], "--drop-ratio") == 0) {
+      options->drop_ratio = atof(value);
+    } else if (strcmp(argv[i], "--zero-speed-ratio") == 0) {
+      options->zero_speed_ratio = atof(value);
+    } else if (strcmp(argv[i], "--spacing") == 0) {
+      options->spacing_m = atof(value);
+    } else if (strcmp(argv[i], "--origin") == 0) {
+      if (sscanf(value, "%lf,%lf", &options->origin_lat, &options->origin_lon) != 2) return false;
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      options->seed = strtoull(value, NULL, 10);
+    } else {
+      return false;
+    }
+    i++;
+  }
+
+  if (target_nodes > 0) {
+    // Each intersection owns two segments carrying chain_max / 2 nodes on average
+    double per_intersection = 1.0 + 2.0 * (1.0 - options->drop_ratio) * options->chain_max / 2.0;
+    int side = (int)ceil(sqrt(target_nodes / per_intersection));
+    options->rows = side < 2 ? 2 : side;
+    options->cols = options->rows;
+  }
+
+  return options->rows >= 2 && options->cols >= 2 && options->chain_max >= 0 &&
+         options->spacing_m > 0 && options->oneway_ratio >= 0 && options->drop_ratio >= 0 &&
+         options->zero_speed_ratio >= 0;
+}
+
+/**
+ * Rejects grids whose IDs or record counts would not fit the binary format.
+ */
+static error_code_t validate_generator_options(const GeneratorOptions *options, error_info_t *err_info) {
+  uint64_t intersections = (uint64_t)options->rows * options->cols;
+  uint64_t id_space = 1 + intersections * (1 + 2 * (uint64_t)options->chain_max);
+  if (id_space > UINT32_MAX) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Grid too large: node IDs would not fit in uint32_t.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  // Upper bound on edges: every segment present with the longest chain
+  uint64_t max_edges = intersections * 2 * (1 + (uint64_t)options->chain_max);
+  if (max_edges > UINT32_MAX) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Grid too large: edge count would not fit in the uint32_t header.");
+    return ERR_INVALID_ARGUMENT;
+  }
+
+  if (options->origin_lat - options->rows * options->spacing_m / METERS_PER_DEGREE < -90.0) {
+    SET_ERROR(err_info, ERR_INVALID_ARGUMENT, "Grid extends beyond the south pole.");
+    return ERR_INVALID_ARGUMENT;
+  }
+  return ERR_SUCCESS;
+}
+
+// =================
+// Main function
+// =================
+
+int main(int argc, char *argv[]) {
+  GeneratorOptions options;
+  if (!parse_generator_options(argc, argv, &options)) {
+    print_generator_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  error_info_t err_info;
+  error_code_t err_code = validate_generator_options(&options, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    return EXIT_FAILURE;
+  }
+
+  printf("Generating %dx%d road grid (chain max %d, one-way %.2f, drop %.2f, seed %llu)\n",
+      options.rows, options.cols, options.chain_max, options.oneway_ratio,
+      options.drop_ratio, (unsigned long long)options.seed);
+  fflush(stdout);
+
+  uint64_t num_nodes = 0;
+  err_code = write_nodes(&options, &num_nodes, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    return EXIT_FAILURE;
+  }
+
+  uint64_t num_edges = 0;
+  err_code = write_edges(&options, &num_edges, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    return EXIT_FAILURE;
+  }
+
+  printf("Wrote %llu nodes to %s\n", (unsigned long long)num_nodes, options.nodes_file);
+  printf("Wrote %llu edges to %s\n", (unsigned long long)num_edges, options.edges_file);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "bin_loader.h"
+#include "graph.h"
+#include "matching.h"
+#include "utils.h"
+
+// =================
+// Constants
+// =================
+
+#define DEFAULT_CHUNK_TRACES 4096
+#define MAX_TRACE_ID 64
+#define MAX_LINE 256
+
+// =================
+// Data Structures
+// =================
+
+/**
+ * Command line options of the trace matcher.
+ */
+typedef struct {
+  const char *nodes_file;   // Path to nodes.bin
+  const char *edges_file;   // Path to edges.bin
+  const char *traces_file;  // CSV of trace_id,lat,lon fixes
+  const char *output_file;  // CSV of matched traces
+  MatchParams params;       // Hidden Markov model parameters
+  double cell_size_m;       // Edge grid cell side
+  int num_threads;          // Worker threads (0 for one per processor)
+  int chunk_traces;         // Traces read and matched at a time
+} MatcherOptions;
+
+/**
+ * Traces read from the input and matched together. Fixes of trace t are
+ * points[first_point[t]..first_point[t + 1]).
+ */
+typedef struct {
+  char (*ids)[MAX_TRACE_ID];
+  int *first_point;
+  int num_traces;
+  GeoPoint *points;
+  int num_points;
+  int point_capacity;
+} TraceChunk;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// =================
+// Trace Input
+// =================
+
+/**
+ * Parses "trace_id,lat,lon". Returns false for malformed lines.
+ */
+static bool parse_fix(const char *line, char *id, GeoPoint *fix) {
+  const char *comma = strchr(line, ',');
+  if (comma == NULL || comma == line || comma - line >= MAX_TRACE_ID) return false;
+  memcpy(id, line, comma - line);
+  id[comma - line] = '\0';
+
+  char *end;
+  fix->latitude = strtod(comma + 1, &end);
+  if (end == comma + 1 || *end != ',') return false;
+  const char *lon_text = end + 1;
+  fix->longitude = strtod(lon_text, &end);
+  if (end == lon_text) return false;
+  while (*end == ' ' || *end == '\r' || *end == '\n') end++;
+  return *end == '\0' && fix->latitude >= -90.0 && fix->latitude <= 90.0 &&
+         fix->longitude >= -180.0 && fix->longitude <= 180.0;
+}
+
+/**
+ * Reads up to max_traces traces. Rows of a trace must be consecutive; the
+ * first row of the next trace is kept in pending for the next chunk.
+ *
+ * @return ERR_SUCCESS with chunk->num_traces == 0 at the end of the input
+ */
+static error_code_t read_trace_chunk(FILE *in, TraceChunk *chunk, int max_traces, char *pending, bool *has_pending, long *line_number, error_info_t *err_info) {
+  chunk->num_traces = 0;
+  chunk->num_points = 0;
+  chunk->first_point[0] = 0;
+
+  char line[MAX_LINE];
+  while (true) {
+    if (*has_pending) {
+      strcpy(line, pending);
+      *has_pending = false;
+    } else {
+      if (fgets(line, sizeof(line), in) == NULL) break;
+      (*line_number)++;
+    }
+    if (line[0] == '\n' || line[0] == '\r' || line[0] == '\0') continue;
+
+    char id[MAX_TRACE_ID];
+    GeoPoint fix;
+    if (!parse_fix(line, id, &fix)) {
+      if (*line_number == 1) continue; // Header
+      char message[96];
+      snprintf(message, sizeof(message), "Malformed trace line %ld (expected trace_id,lat,lon).", *line_number);
+      SET_ERROR(err_info, ERR_INVALID_ARGUMENT, message);
+      return ERR_INVALID_ARGUMENT;
+    }
+
+    int t = chunk->num_traces;
+    if (t == 0 || strcmp(chunk->ids[t - 1], id) != 0) {
+      if (t == max_traces) {
+        strcpy(pending, line);
+        *has_pending = true;
+        break;
+      }
+      strcpy(chunk->ids[t], id);
+      chunk->num_traces++;
+    }
+
+    if (chunk->num_points == chunk->point_capacity) {
+      int capacity = chunk->point_capacity > 0 ? chunk->point_capacity * 2 : 4096;
+      GeoPoint *points = (GeoPoint *)realloc(chunk->points, (size_t)capacity * sizeof(GeoPoint));
+      if (points == NULL) {
+        SET_ERROR(err_info, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for trace points.");
+        return ERR_MEMORY_ALLOCATION;
+      }
+      chunk->points = points;
+      chunk->point_capacity = capacity;
+    }
+    chunk->points[chunk->num_points++] = fix;
+    chunk->first_point[chunk->num_traces] = chunk->num_points;
+  }
+  return ERR_SUCCESS;
+}
+
+// =================
+// Output
+// =================
+
+/**
+ * Writes one row: the trace ID, fix counts, the matched edges as edges.bin
+ * record numbers and the geometry as a WKT line string.
+ */
+static void write_matched_trace(FILE *out, const char *id, const MatchJob *job) {
+  if (job->err_code != ERR_SUCCESS) {
+    fprintf(out, "%s,%d,%d,0,\"\",\"\"\n", id, job->num_points, job->num_points);
+    return;
+  }
+
+  const MatchedTrace *trace = &job->trace;
+  fprintf(out, "%s,%d,%d,%d,\"", id, trace->num_points, trace->num_unmatched, trace->num_segments);
+  for (int k = 0; k < trace->num_edges; k++) {
+    fprintf(out, k == 0 ? "%lld" : " %lld", (long long)trace->edges[k]);
+  }
+  fprintf(out, "\",\"LINESTRING(");
+  for (int k = 0; k < trace->geometry_length; k++) {
+    fprintf(out, k == 0 ? "%.7f %.7f" : ", %.7f %.7f", trace->geometry[k].longitude, trace->geometry[k].latitude);
+  }
+  fprintf(out, ")\"\n");
+}
+
+// =================
+// Command Line
+// =================
+
+static void print_matcher_usage(const char *program_name) {
+  MatchParams defaults;
+  default_match_params(&defaults);
+  printf("Usage: %s <nodes.bin> <edges.bin> <traces.csv> <matched.csv> [options]\n", program_name);
+  printf("  Input rows are trace_id,lat,lon with the fixes of a trace consecutive and in time order.\n");
+  printf("  --threads T         Worker threads, 0 for one per processor (default 0)\n");
+  printf("  --radius M          Candidate search radius in meters (default %.0f)\n", defaults.search_radius_m);
+  printf("  --candidates K      Candidate edges per fix, 1 to %d (default %d)\n", MATCH_MAX_CANDIDATES, defaults.max_candidates);
+  printf("  --sigma M           GPS noise standard deviation in meters (default %.1f)\n", defaults.sigma_m);
+  printf("  --beta M            Route/great-circle difference scale in meters (default %.1f)\n", defaults.beta_m);
+  printf("  --route-factor F    Longest route searched, times the fix distance (default %.1f)\n", defaults.max_route_factor);
+  printf("  --cell M            Edge grid cell side in meters (default %.0f)\n", MATCH_DEFAULT_CELL_SIZE_M);
+  printf("  --chunk N           Traces read and matched at a time (default %d)\n", DEFAULT_CHUNK_TRACES);
+}
+
+static bool parse_matcher_options(int argc, char *argv[], MatcherOptions *options) {
+  if (argc < 5) return false;
+
+  options->nodes_file = argv[1];
+  options->edges_file = argv[2];
+  options->traces_file = argv[3];
+  options->output_file = argv[4];
+  default_match_params(&options->params);
+  options->cell_size_m = MATCH_DEFAULT_CELL_SIZE_M;
+  options->num_threads = 0;
+  options->chunk_traces = DEFAULT_CHUNK_TRACES;
+
+  for (int i = 5; i < argc; i++) {
+    if (i + 1 >= argc) return false;
+    const char *value = argv[i + 1];
+
+    if (strcmp(argv[i], "--threads") == 0) {
+      options->num_threads = atoi(value);
+    } else if (strcmp(argv[i], "--radius") == 0) {
+      options->params.search_radius_m = atof(value);
+    } else if (strcmp(argv[i], "--candidates") == 0) {
+      options->params.max_candidates = atoi(value);
+    } else if (strcmp(argv[i], "--sigma") == 0) {
+      options->params.sigma_m = atof(value);
+    } else if (strcmp(argv[i], "--beta") == 0) {
+      options->params.beta_m = atof(value);
+    } else if (strcmp(argv[i], "--route-factor") == 0) {
+      options->params.max_route_factor = atof(value);
+    } else if (strcmp(argv[i], "--cell") == 0) {
+      options->cell_size_m = atof(value);
+    } else if (strcmp(argv[i], "--chunk") == 0) {
+      options->chunk_traces = atoi(value);
+    } else {
+      return false;
+    }
+    i++;
+  }
+
+  return options->num_threads >= 0 && options->chunk_traces > 0 && options->cell_size_m > 0 &&
+         options->params.search_radius_m > 0 && options->params.max_candidates >= 1 &&
+         options->params.max_candidates <= MATCH_MAX_CANDIDATES && options->params.sigma_m > 0 &&
+         options->params.beta_m > 0 && options->params.max_route_factor >= 1.0;
+}
+
+// =================
+// Main function
+// =================
+
+int main(int argc, char *argv[]) {
+  MatcherOptions options;
+  if (!parse_matcher_options(argc, argv, &options)) {
+    print_matcher_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  error_info_t err_info;
+  error_code_t err_code;
+
+  fprintf(stderr, "Loading graph from %s and %s...\n", options.nodes_file, options.edges_file);
+  double load_start = now_seconds();
+  Graph *graph = NULL;
+  err_code = load_graph_from_binary(&graph, options.nodes_file, options.edges_file, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    return EXIT_FAILURE;
+  }
+  fprintf(stderr, "Loaded %d nodes and %lld edges in %.2f s\n",
+      graph->num_nodes, (long long)graph->num_edges, now_seconds() - load_start);
+
+  double grid_start = now_seconds();
+  EdgeGrid *grid = NULL;
+  err_code = build_edge_grid(graph, options.cell_size_m, &grid, &err_info);
+  if (err_code != ERR_SUCCESS) {
+    print_error(&err_info);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+  fprintf(stderr, "Built %dx%d edge grid in %.3f s\n", grid->rows, grid->cols, now_seconds() - grid_start);
+
+  FILE *in = fopen(options.traces_file, "r");
+  FILE *out = in != NULL ? fopen(options.output_file, "w") : NULL;
+  TraceChunk chunk;
+  memset(&chunk, 0, sizeof(TraceChunk));
+  chunk.ids = (char (*)[MAX_TRACE_ID])alloc_array(options.chunk_traces, MAX_TRACE_ID);
+  chunk.first_point = (int *)alloc_array((size_t)options.chunk_traces + 1, sizeof(int));
+  MatchJob *jobs = (MatchJob *)alloc_array(options.chunk_traces, sizeof(MatchJob));
+  if (in == NULL || out == NULL || chunk.ids == NULL || chunk.first_point == NULL || jobs == NULL) {
+    if (in == NULL || out == NULL) fprintf(stderr, "Failed to open %s\n", in == NULL ? options.traces_file : options.output_file);
+    else fprintf(stderr, "Failed to allocate memory for traces\n");
+    if (in != NULL) fclose(in);
+    if (out != NULL) fclose(out);
+    free(chunk.ids);
+    free(chunk.first_point);
+    free(jobs);
+    free_edge_grid(grid);
+    free_graph(graph);
+    return EXIT_FAILURE;
+  }
+
+  // Read, match and write a chunk at a time so memory does not grow with the input
+  fprintf(out, "trace_id,points,unmatched,segments,edges,geometry\n");
+  char pending[MAX_LINE];
+  bool has_pending = false;
+  long line_number = 0;
+  long long total_traces = 0, total_points = 0, total_unmatched = 0, failed = 0;
+  double match_seconds = 0.0;
+  while (true) {
+    err_code = read_trace_chunk(in, &chunk, options.chunk_traces, pending, &has_pending, &line_number, &err_info);
+    if (err_code != ERR_SUCCESS || chunk.num_traces == 0) break;
+
+    for (int t = 0; t < chunk.num_traces; t++) {
+      jobs[t].points = &chunk.points[chunk.first_point[t]];
+      jobs[t].num_points = chunk.first_point[t + 1] - chunk.first_point[t];
+    }
+
+    double start = now_seconds();
+    err_code = match_trace_batch(graph, grid, jobs, chunk.num_traces, &options.params, options.num_threads, &err_info);
+    match_seconds += now_seconds() - start;
+    if (err_code != ERR_SUCCESS) break;
+
+    for (int t = 0; t < chunk.num_traces; t++) {
+      write_matched_trace(out, chunk.ids[t], &jobs[t]);
+      total_points += jobs[t].num_points;
+      if (jobs[t].err_code != ERR_SUCCESS) {
+        fprintf(stderr, "Trace %s: ", chunk.ids[t]);
+        print_error(&jobs[t].err_info);
+        failed++;
+        continue;
+      }
+      total_unmatched += jobs[t].trace.num_unmatched;
+      free_matched_trace(&jobs[t].trace);
+    }
+    total_traces += chunk.num_traces;
+  }
+  if (err_code != ERR_SUCCESS) print_error(&err_info);
+
+  fprintf(stderr, "Matched %lld traces (%lld fixes, %lld unmatched, %lld failed) in %.3f s, %.0f fixes/s\n",
+      total_traces, total_points, total_unmatched, failed, match_seconds,
+      match_seconds > 0 ? total_points / match_seconds : 0.0);
+
+  fclose(in);
+  fclose(out);
+  free(chunk.ids);
+  free(chunk.first_point);
+  free(chunk.points);
+  free(jobs);
+  free_edge_grid(grid);
+  free_graph(graph);
+  return err_code == ERR_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}